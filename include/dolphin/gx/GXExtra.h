@@ -27,6 +27,89 @@ void GXDestroyTlutObj(GXTlutObj* obj);
 
 void GXColor4f32(float r, float g, float b, float a);
 
+/* Submit count indexed vertices in one call, between GXBegin and GXEnd.
+ * indices holds one u16 per GX_INDEX8/GX_INDEX16 attribute of the current
+ * vertex descriptor for each vertex, in GX attribute order. */
+void GXPCSubmitVertices(GXVtxFmt vtxfmt, const u16* indices, u32 count);
+
+typedef struct {
+  u32 entries;
+  u32 bytes;
+  u32 budget;
+  u32 hits;       /* loads served without decoding */
+  u32 rehashes;   /* stale entries revalidated by content hash */
+  u32 misses;     /* loads that required a decode */
+  u32 evictions;
+  u32 pool_bytes;   /* released decode buffers held for reuse */
+  u32 pool_reuses;  /* decodes that reused a pooled buffer */
+  u32 tlut_loads;   /* GXLoadTlut calls */
+  u32 tlut_changes; /* loads that switched a slot to a different palette */
+} GXPCTexCacheStats;
+
+void GXPCSetTexCacheBudget(u32 bytes);
+void GXPCGetTexCacheStats(GXPCTexCacheStats* stats);
+
+typedef struct {
+  u64 tris;            /* triangles submitted */
+  u64 tris_drawn;      /* triangles that survived culling and reached setup */
+  u64 guard_rejects;   /* dropped for exceeding the fixed-point range after clipping */
+  u64 pixels;          /* pixels written */
+  u64 clipped;         /* crossed the near plane or guard band and were clipped */
+  u64 frustum_rejects; /* entirely outside one frustum plane */
+  u64 culled;          /* back/front-face culled */
+} GXPCRasterStats;
+
+/* Cumulative since GXInit */
+void GXPCGetRasterStats(GXPCRasterStats* stats);
+
+typedef struct {
+  const char* name; /* "<class>/<TEV mode>/tex<0|1>" */
+  u64 draws;        /* draw calls resolved to this pixel pipeline */
+  u64 tris;         /* triangles shaded by it */
+} GXPCPixelPipeStat;
+
+/* Fills up to max entries, one per specialized pixel pipeline; returns
+ * the number written. Counts are cumulative since startup. */
+u32 GXPCGetPixelPipeStats(GXPCPixelPipeStat* stats, u32 max);
+
+typedef struct {
+  u32 kernels;      /* distinct TEV setups compiled (cache size) */
+  u64 draws;        /* draw calls that resolved a TEV setup */
+  u64 preset_draws; /* of those, served by a fixed single-stage pipeline */
+  u64 stages;       /* stages summed over the remaining, kernel-shaded draws */
+} GXPCTevKernelStats;
+
+/* Cumulative since startup */
+void GXPCGetTevKernelStats(GXPCTevKernelStats* stats);
+
+typedef struct {
+  u64 draws;      /* draw calls through the vertex pipeline */
+  u64 lit_draws;  /* of those, with a lit channel the TEV reads */
+  u64 lit_verts;  /* vertices run through the lighting stage */
+} GXPCLightStats;
+
+/* Cumulative since startup */
+void GXPCGetLightStats(GXPCLightStats* stats);
+
+/* Tell GX that the CPU rewrote [addr, addr + size). Compiled display lists
+ * whose vertex arrays overlap the range are decoded again on their next
+ * call. The DCFlushRange/DCStoreRange family calls this. */
+void GXPCInvalidateVtxRange(const void* addr, u32 size);
+
+typedef struct {
+  u32 lists;          /* live display lists */
+  u32 entry_bytes;    /* recorded command storage */
+  u32 compiled_bytes; /* pre-decoded vertices and triangle lists */
+  u32 arena_bytes;    /* host memory held by the DL arena, free space included */
+  u32 released;       /* lists reclaimed with their game buffer (cumulative) */
+  u32 decodes;        /* lists decoded on a call, first or after a rewrite (cumulative) */
+} GXPCDisplayListStats;
+
+/* Free the host-side data of every display list whose handle lives in
+ * [addr, addr + size). The HuMem allocator calls this when a block is freed. */
+void GXPCReleaseDisplayLists(const void* addr, u32 size);
+void GXPCGetDisplayListStats(GXPCDisplayListStats* stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -8,5 +8,8 @@ s32 HuPerfCreate(char *arg0, u8 arg1, u8 arg2, u8 arg3, u8 arg4);
 void HuPerfZero(void);
 void HuPerfBegin(s32 arg0);
 void HuPerfEnd(s32 arg0);
+#ifdef TARGET_PC
+s32 HuPerfGetSlots(const char **names, s64 *times, s32 max);
+#endif
 
 #endif
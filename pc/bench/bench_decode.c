@@ -0,0 +1,410 @@
+/*
+ * Data decompression micro-benchmark.
+ *
+ * Decodes every file of the game's data directories (the .bin files in
+ * data/ under the given path, MP4_DATA_PATH by default) with HuDecodeData
+ * and with a copy of the original byte-at-a-time decoders, checks that
+ * both write the same bytes, and reports output throughput (MB/s of
+ * decoded data) per codec. Without game data it uses seeded synthetic
+ * streams of each codec instead. Needs only the decoders:
+ *
+ *   cc -O2 -std=gnu11 -DTARGET_PC -Ipc -idirafter include \
+ *      pc/bench/bench_decode.c src/game/decode.c
+ *   ./a.out [data_path] [seconds_per_codec]
+ */
+#include <dirent.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dolphin/types.h"
+#include "game/data.h"
+#include "pc_config.h"
+
+#define BENCH_CODECS  6
+#define BENCH_PREFIX  4096 /* FSLIDE may read this far before the output */
+#define BENCH_SLACK   64
+
+void HuDecodeData(void *src, void *dst, u32 size, s32 decode_type);
+
+/* decode.c links against these */
+void DCFlushRange(void *addr, u32 nBytes) {
+    (void)addr;
+    (void)nBytes;
+}
+
+void OSReport(const char *msg, ...) {
+    va_list args;
+    va_start(args, msg);
+    vprintf(msg, args);
+    va_end(args);
+}
+
+typedef struct {
+    u8 *src;
+    u32 size;
+    s32 type;
+} BenchEntry;
+
+static BenchEntry *bench_entries;
+static u32 bench_count, bench_cap;
+
+static const char *bench_names[BENCH_CODECS] = {
+    "NONE", "LZ", "SLIDE", "FSLIDE3", "FSLIDE", "RLE",
+};
+
+static u32 bench_seed = 0x1234567;
+
+static u32 bench_rand(void) {
+    bench_seed = bench_seed * 1664525u + 1013904223u;
+    return bench_seed >> 8;
+}
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench_add(u8 *src, u32 size, s32 type) {
+    if (bench_count == bench_cap) {
+        bench_cap = bench_cap ? bench_cap * 2 : 256;
+        bench_entries = realloc(bench_entries, bench_cap * sizeof(*bench_entries));
+    }
+    bench_entries[bench_count++] = (BenchEntry){ src, size, type };
+}
+
+/* ---- Original decoders (reference output and baseline speed) ---- */
+
+static u8 ref_text[1024];
+
+static void ref_lz(u8 *src, u8 *dst, u32 size) {
+    u16 flag = 0, pos = 958;
+    s32 i, j, copy_len;
+    memset(ref_text, 0, sizeof(ref_text));
+    while (size) {
+        flag >>= 1;
+        if (!(flag & 0x100)) flag = (*src++) | 0xFF00;
+        if (flag & 0x1) {
+            ref_text[pos++] = *dst++ = *src++;
+            pos &= 0x3FF;
+            size--;
+        } else {
+            i = *src++;
+            copy_len = *src++;
+            i |= ((copy_len & ~0x3F) << 2);
+            copy_len = (copy_len & 0x3F) + 3;
+            for (j = 0; j < copy_len; j++) {
+                ref_text[pos++] = *dst++ = ref_text[(i + j) & 0x3FF];
+                pos &= 0x3FF;
+            }
+            size -= j;
+        }
+    }
+}
+
+static void ref_slide(u8 *src, u8 *dst, u32 size, int zero_window) {
+    u8 *base_dst = dst;
+    u32 num_bits = 0, flag = 0;
+    src += 4;
+    while (size) {
+        if (num_bits == 0) {
+            flag = (u32)(*src++) << 24;
+            flag += (*src++) << 16;
+            flag += (*src++) << 8;
+            flag += *src++;
+            num_bits = 32;
+        }
+        if (flag >> 31) {
+            *dst++ = *src++;
+            size--;
+        } else {
+            u32 dist = *src++ << 8;
+            dist += *src++;
+            u32 len = (dist >> 12) & 0xF;
+            dist &= 0xFFF;
+            u8 *from = dst - dist;
+            len = len == 0 ? (*src++) + 18 : len + 2;
+            size -= len;
+            while (len) {
+                *dst++ = (zero_window && from - 1 < base_dst) ? 0 : from[-1];
+                len--;
+                from++;
+            }
+        }
+        flag <<= 1;
+        num_bits--;
+    }
+}
+
+static void ref_rle(u8 *src, u8 *dst, u32 size) {
+    while (size) {
+        s32 n = *src++;
+        if (n < 128) {
+            s32 fill = *src++;
+            for (s32 i = 0; i < n; i++) *dst++ = fill;
+        } else {
+            n -= 128;
+            for (s32 i = 0; i < n; i++) *dst++ = *src++;
+        }
+        size -= n;
+    }
+}
+
+static void ref_decode(u8 *src, u8 *dst, u32 size, s32 type) {
+    switch (type) {
+    case DATA_DECODE_NONE:
+        for (u32 i = 0; i < size; i++) dst[i] = src[i];
+        break;
+    case DATA_DECODE_LZ: ref_lz(src, dst, size); break;
+    case DATA_DECODE_SLIDE: ref_slide(src, dst, size, 1); break;
+    case DATA_DECODE_FSLIDE_ALT:
+    case DATA_DECODE_FSLIDE: ref_slide(src, dst, size, 0); break;
+    case DATA_DECODE_RLE: ref_rle(src, dst, size); break;
+    }
+}
+
+/* ---- Game data ---- */
+
+static u32 bench_be32(const u8 *p) {
+    return ((u32)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void bench_load_dir(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    u8 *dir = len >= 4 ? malloc(len) : NULL;
+    if (!dir || fread(dir, 1, len, f) != (size_t)len) {
+        free(dir);
+        fclose(f);
+        return;
+    }
+    fclose(f);
+    u32 num = bench_be32(dir);
+    for (u32 i = 0; i < num && 8 + i * 4 <= (u32)len; i++) {
+        u32 ofs = bench_be32(dir + 4 + i * 4);
+        if (ofs + 8 > (u32)len) continue;
+        u32 size = bench_be32(dir + ofs);
+        s32 type = bench_be32(dir + ofs + 4);
+        if (type < 0 || type >= BENCH_CODECS || size > (64u << 20)) continue;
+        bench_add(dir + ofs + 8, size, type);
+    }
+}
+
+static void bench_load_game(const char *root) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/data", root);
+    DIR *d = opendir(path);
+    if (!d) return;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        size_t n = strlen(de->d_name);
+        if (n < 4 || strcmp(de->d_name + n - 4, ".bin") != 0) continue;
+        snprintf(path, sizeof(path), "%s/data/%s", root, de->d_name);
+        bench_load_dir(path);
+    }
+    closedir(d);
+}
+
+/* ---- Synthetic streams ----
+ * Each stream decodes to exactly size bytes: literals drawn from a small
+ * alphabet, references of mixed length and distance, including some that
+ * reach before the start of the output. */
+
+static u8 bench_literal(void) {
+    return "etaoin shrdlu\0\0\0\x80\xff"[bench_rand() % 18];
+}
+
+static u32 bench_ref_len(u32 max_len, u32 left) {
+    u32 len = 3 + (bench_rand() % 4 == 0 ? bench_rand() % (max_len - 2) : bench_rand() % 8);
+    return len < left ? len : left;
+}
+
+static u32 bench_ref_dist(u32 window) {
+    switch (bench_rand() % 4) {
+    case 0: return 1 + bench_rand() % 4;
+    case 1: return 1 + bench_rand() % 32;
+    default: return 1 + bench_rand() % window;
+    }
+}
+
+static u8 *bench_gen_lz(u32 size) {
+    u8 *out = malloc(size * 2 + 16), *p = out, *flag = NULL;
+    u32 n = 0, bit = 8;
+    while (n < size) {
+        if (bit == 8) {
+            flag = p++;
+            *flag = 0;
+            bit = 0;
+        }
+        u32 left = size - n;
+        if (left < 3 || bench_rand() % 3 == 0) {
+            *flag |= 1 << bit;
+            *p++ = bench_literal();
+            n++;
+        } else {
+            u32 len = bench_ref_len(66, left);
+            u32 i = (958 + n - bench_ref_dist(1024)) & 0x3FF;
+            *p++ = i & 0xFF;
+            *p++ = ((i >> 8) << 6) | (len - 3);
+            n += len;
+        }
+        bit++;
+    }
+    return out;
+}
+
+static u8 *bench_gen_slide(u32 size) {
+    u8 *out = malloc(size * 2 + 16), *p = out + 4, *flag = NULL;
+    u32 n = 0, bit = 32;
+    out[0] = size >> 24;
+    out[1] = size >> 16;
+    out[2] = size >> 8;
+    out[3] = size;
+    while (n < size) {
+        if (bit == 32) {
+            flag = p;
+            memset(flag, 0, 4);
+            p += 4;
+            bit = 0;
+        }
+        u32 left = size - n;
+        if (left < 3 || bench_rand() % 3 == 0) {
+            flag[bit >> 3] |= 0x80 >> (bit & 7);
+            *p++ = bench_literal();
+            n++;
+        } else {
+            u32 len = bench_ref_len(273, left);
+            u32 dist = bench_ref_dist(4096) - 1;
+            if (len < 18) {
+                *p++ = ((len - 2) << 4) | (dist >> 8);
+                *p++ = dist & 0xFF;
+            } else {
+                *p++ = dist >> 8;
+                *p++ = dist & 0xFF;
+                *p++ = len - 18;
+            }
+            n += len;
+        }
+        bit++;
+    }
+    return out;
+}
+
+static u8 *bench_gen_rle(u32 size) {
+    u8 *out = malloc(size * 2 + 16), *p = out;
+    u32 n = 0;
+    while (n < size) {
+        u32 left = size - n;
+        u32 len = 1 + bench_rand() % 127;
+        if (len > left) len = left;
+        if (bench_rand() % 2) {
+            *p++ = len;
+            *p++ = bench_literal();
+        } else {
+            *p++ = 128 + len;
+            for (u32 i = 0; i < len; i++) *p++ = bench_literal();
+        }
+        n += len;
+    }
+    return out;
+}
+
+static void bench_load_synthetic(u32 size) {
+    for (int i = 0; i < 16; i++) {
+        u32 len = size - bench_rand() % (size / 4);
+        u8 *none = malloc(len);
+        for (u32 j = 0; j < len; j++) none[j] = bench_literal();
+        bench_add(none, len, DATA_DECODE_NONE);
+        bench_add(bench_gen_lz(len), len, DATA_DECODE_LZ);
+        u8 *slide = bench_gen_slide(len);
+        bench_add(slide, len, DATA_DECODE_SLIDE);
+        bench_add(slide, len, DATA_DECODE_FSLIDE);
+        bench_add(bench_gen_rle(len), len, DATA_DECODE_RLE);
+    }
+}
+
+/* ---- Benchmark ---- */
+
+static double bench_run(s32 type, u8 *dst, int use_ref, double seconds, u64 *bytes) {
+    double start = bench_now(), now;
+    *bytes = 0;
+    do {
+        for (u32 i = 0; i < bench_count; i++) {
+            const BenchEntry *e = &bench_entries[i];
+            if (e->type != type) continue;
+            if (use_ref) ref_decode(e->src, dst, e->size, type);
+            else HuDecodeData(e->src, dst, e->size, type);
+            *bytes += e->size;
+        }
+        now = bench_now();
+    } while (now - start < seconds);
+    return now - start;
+}
+
+int main(int argc, char **argv) {
+    const char *root = getenv("MP4_DATA_PATH");
+    if (argc > 1) root = argv[1];
+    if (!root || !*root) root = MP4_DATA_PATH;
+    double seconds = argc > 2 ? atof(argv[2]) : 1.0;
+
+    bench_load_game(root);
+    const char *source = root;
+    if (bench_count == 0) {
+        bench_load_synthetic(256 * 1024);
+        source = "synthetic";
+    }
+
+    u32 max_size = 0;
+    for (u32 i = 0; i < bench_count; i++) {
+        if (bench_entries[i].size > max_size) max_size = bench_entries[i].size;
+    }
+    size_t buf_size = BENCH_PREFIX + max_size + BENCH_SLACK;
+    u8 *ref_buf = malloc(buf_size), *new_buf = malloc(buf_size);
+    if (!ref_buf || !new_buf) {
+        fprintf(stderr, "[BENCH] out of memory\n");
+        return 1;
+    }
+
+    /* Both decoders must leave identical buffers, slack included */
+    u32 mismatches = 0;
+    for (u32 i = 0; i < bench_count; i++) {
+        const BenchEntry *e = &bench_entries[i];
+        memset(ref_buf, 0xA5, buf_size);
+        memset(new_buf, 0xA5, buf_size);
+        ref_decode(e->src, ref_buf + BENCH_PREFIX, e->size, e->type);
+        HuDecodeData(e->src, new_buf + BENCH_PREFIX, e->size, e->type);
+        if (memcmp(ref_buf, new_buf, buf_size) != 0) {
+            if (mismatches++ < 8) {
+                printf("[BENCH] mismatch: entry %u (%s, %u bytes)\n", i, bench_names[e->type],
+                       e->size);
+            }
+        }
+    }
+
+    printf("[BENCH] decode: %u files from %s, %.2fs per codec, %u mismatches\n", bench_count,
+           source, seconds, mismatches);
+    for (s32 type = 0; type < BENCH_CODECS; type++) {
+        u32 files = 0;
+        u64 bytes = 0, ref_bytes, new_bytes;
+        for (u32 i = 0; i < bench_count; i++) {
+            if (bench_entries[i].type == type) {
+                files++;
+                bytes += bench_entries[i].size;
+            }
+        }
+        if (!files) continue;
+        double ref_t = bench_run(type, ref_buf + BENCH_PREFIX, 1, seconds, &ref_bytes);
+        double new_t = bench_run(type, new_buf + BENCH_PREFIX, 0, seconds, &new_bytes);
+        double ref_mbs = ref_bytes / ref_t / 1e6, new_mbs = new_bytes / new_t / 1e6;
+        printf("[BENCH] %-7s %8.1f MB/s  (original %8.1f MB/s, x%.2f)  %u files, %llu bytes\n",
+               bench_names[type], new_mbs, ref_mbs, new_mbs / ref_mbs, files,
+               (unsigned long long)bytes);
+    }
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * Compiled display list survival benchmark.
+ *
+ * Places indexed vertex arrays and display lists for a set of models in
+ * the data heap, calls every list each frame, and creates and kills one
+ * more model per frame the way Hu3DModelCreate and Hu3DModelKill do: a
+ * block is allocated and freed and the whole heap is flushed with
+ * HuMemDCFlush after each. Reports display list decodes and time per
+ * frame, once with HuMemDCFlush and once with the whole-heap
+ * DCFlushRangeNoSync it used to issue. Runs without SDL or game data:
+ *
+ *   cc -O2 -std=gnu11 -DTARGET_PC -Ipc -idirafter include \
+ *      pc/bench/bench_dlflush.c pc/game/malloc_pc.c src/game/memory.c \
+ *      pc/dolphin/gx_pc.c pc/dolphin/gx_capture.c pc/dolphin/gx_texdecode.c \
+ *      pc/dolphin/cache_pc.c pc/pc_jobs.c -lm -lpthread
+ *   ./a.out [frames] [models]
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dolphin/types.h"
+#include "dolphin/gx.h"
+#include "dolphin/mtx.h"
+#include "dolphin/os.h"
+#include "game/memory.h"
+
+#define BENCH_GRID   24
+#define BENCH_VERTS  (BENCH_GRID * BENCH_GRID)
+#define BENCH_DL_MAX 0x8000
+
+/* malloc_pc.c links against these; the heaps come from the host */
+volatile OSHeapHandle __OSCurrHeap = 0;
+OSHeapHandle currentHeapHandle = 0;
+
+void *OSAllocFromHeap(OSHeapHandle heap, u32 size) {
+    (void)heap;
+    return aligned_alloc(32, (size + 31) & ~31u);
+}
+
+long OSCheckHeap(OSHeapHandle heap) {
+    (void)heap;
+    return 0x400000;
+}
+
+void OSReport(const char *msg, ...) {
+    va_list args;
+    va_start(args, msg);
+    vprintf(msg, args);
+    va_end(args);
+}
+
+typedef struct {
+    f32 *pos;
+    u8 *clr;
+    void *dl;
+    u32 dl_size;
+} BenchModel;
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench_vtx(int i) {
+    GXPosition1x16((u16)i);
+    GXColor1x16((u16)i);
+}
+
+static void bench_model_init(BenchModel *m, int n) {
+    m->pos = (f32 *)HuMemDirectMalloc(HEAP_DATA, BENCH_VERTS * 3 * sizeof(f32));
+    m->clr = (u8 *)HuMemDirectMalloc(HEAP_DATA, BENCH_VERTS * 4);
+    m->dl = HuMemDirectMalloc(HEAP_DATA, BENCH_DL_MAX);
+    for (int y = 0; y < BENCH_GRID; y++) {
+        for (int x = 0; x < BENCH_GRID; x++) {
+            int i = y * BENCH_GRID + x;
+            m->pos[i * 3 + 0] = x * 1.5f + (n % 4) * 150.0f;
+            m->pos[i * 3 + 1] = y * 1.5f + (n / 4 % 4) * 110.0f;
+            m->pos[i * 3 + 2] = -10.0f;
+            for (int c = 0; c < 4; c++) m->clr[i * 4 + c] = (u8)(i * 13 + c * 71 + n);
+        }
+    }
+    GXSetArray(GX_VA_POS, m->pos, 3 * sizeof(f32));
+    GXSetArray(GX_VA_CLR0, m->clr, 4);
+    GXBeginDisplayList(m->dl, BENCH_DL_MAX);
+    for (int y = 0; y < BENCH_GRID - 1; y++) {
+        GXBegin(GX_TRIANGLESTRIP, GX_VTXFMT0, BENCH_GRID * 2);
+        for (int x = 0; x < BENCH_GRID; x++) {
+            bench_vtx(y * BENCH_GRID + x);
+            bench_vtx((y + 1) * BENCH_GRID + x);
+        }
+        GXEnd();
+    }
+    m->dl_size = GXEndDisplayList();
+}
+
+static void bench_flush_heap(int whole_heap) {
+    if (whole_heap) {
+        DCFlushRangeNoSync(HuMemHeapPtrGet(HEAP_DATA), HuMemHeapSizeGet(HEAP_DATA));
+    } else {
+        HuMemDCFlush(HEAP_DATA);
+    }
+}
+
+static void bench_run(const char *name, int frames, BenchModel *models, int count, int whole_heap) {
+    GXPCDisplayListStats before, after;
+    GXPCGetDisplayListStats(&before);
+    double t0 = bench_now();
+    for (int f = 0; f < frames; f++) {
+        /* Hu3DModelCreate, then Hu3DModelKill */
+        void *block = HuMemDirectMalloc(HEAP_DATA, 0x10000);
+        memset(block, f, 0x10000);
+        bench_flush_heap(whole_heap);
+        HuMemDirectFree(block);
+        bench_flush_heap(whole_heap);
+        for (int i = 0; i < count; i++) {
+            GXSetArray(GX_VA_POS, models[i].pos, 3 * sizeof(f32));
+            GXSetArray(GX_VA_CLR0, models[i].clr, 4);
+            GXCallDisplayList(models[i].dl, models[i].dl_size);
+        }
+        GXCopyDisp(NULL, GX_TRUE);
+    }
+    double elapsed = bench_now() - t0;
+    GXPCGetDisplayListStats(&after);
+    printf("[BENCH] dlflush %-20s %d frames x %d lists: %.2f decodes/frame, %.3f ms/frame\n",
+           name, frames, count, (double)(after.decodes - before.decodes) / frames,
+           elapsed * 1e3 / frames);
+}
+
+int main(int argc, char **argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 200;
+    int count = argc > 2 ? atoi(argv[2]) : 16;
+
+    HuMemInitAll();
+    GXInit(NULL, 0);
+
+    /* Screen-space orthographic projection, z in [0, 1] */
+    Mtx44 proj;
+    memset(proj, 0, sizeof(proj));
+    proj[0][0] = 2.0f / 640; proj[0][3] = -1.0f;
+    proj[1][1] = -2.0f / 480; proj[1][3] = 1.0f;
+    proj[2][2] = -1.0f / 100; proj[2][3] = -0.5f;
+    proj[3][3] = 1.0f;
+    Mtx ident = { {1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0} };
+    GXSetProjection(proj, GX_ORTHOGRAPHIC);
+    GXLoadPosMtxImm(ident, GX_PNMTX0);
+    GXSetCurrentMtx(GX_PNMTX0);
+    GXSetNumTexGens(0);
+    GXSetNumTevStages(1);
+    GXSetTevOrder(GX_TEVSTAGE0, GX_TEXCOORD_NULL, GX_TEXMAP_NULL, GX_COLOR0A0);
+    GXSetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
+    GXSetCullMode(GX_CULL_NONE);
+    GXClearVtxDesc();
+    GXSetVtxDesc(GX_VA_POS, GX_INDEX16);
+    GXSetVtxDesc(GX_VA_CLR0, GX_INDEX16);
+    GXSetVtxAttrFmt(GX_VTXFMT0, GX_VA_POS, GX_POS_XYZ, GX_F32, 0);
+    GXSetVtxAttrFmt(GX_VTXFMT0, GX_VA_CLR0, GX_CLR_RGBA, GX_RGBA8, 0);
+
+    BenchModel *models = (BenchModel *)calloc(count, sizeof(BenchModel));
+    for (int i = 0; i < count; i++) bench_model_init(&models[i], i);
+
+    /* Every list is decoded on its first call; keep that out of both runs */
+    bench_run("first call", 1, models, count, 0);
+    bench_run("HuMemDCFlush", frames, models, count, 0);
+    bench_run("DCFlushRangeNoSync", frames, models, count, 1);
+    return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * Texture layout micro-benchmark.
+ *
+ * Draws a large RGBA8 texture onto a screen quad rotated through a range
+ * of angles, once with the decoded-texture cache in linear rows and once
+ * in 4x4 blocks, and reports the best frame time of each over three runs.
+ * texel_step is the texels walked per pixel (mip generation is off, so
+ * steps above 1 stride through level 0). Runs without SDL or game data:
+ *
+ *   cc -O2 -std=gnu11 -DTARGET_PC -Ipc -idirafter include \
+ *      pc/bench/bench_texlayout.c pc/dolphin/gx_pc.c pc/dolphin/gx_capture.c \
+ *      pc/dolphin/gx_texdecode.c pc/pc_jobs.c -lm -lpthread
+ *   ./a.out [frames] [tex_size_px] [texel_step] [quads_per_frame]
+ *
+ * MP4_RASTER_THREADS selects the rasterizer mode as in the game.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dolphin/types.h"
+#include "dolphin/gx.h"
+#include "dolphin/mtx.h"
+
+static u32 bench_seed = 0x1234567;
+
+static u8 bench_rand_byte(void) {
+    bench_seed = bench_seed * 1664525u + 1013904223u;
+    return (u8)(bench_seed >> 24);
+}
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench_setup(void) {
+    Mtx44 proj;
+    memset(proj, 0, sizeof(proj));
+    proj[0][0] = 2.0f / 640; proj[0][3] = -1.0f;
+    proj[1][1] = -2.0f / 480; proj[1][3] = 1.0f;
+    proj[2][2] = -1.0f / 100; proj[2][3] = -0.5f;
+    proj[3][3] = 1.0f;
+    Mtx ident = { {1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0} };
+
+    GXSetProjection(proj, GX_ORTHOGRAPHIC);
+    GXLoadPosMtxImm(ident, GX_PNMTX0);
+    GXSetCurrentMtx(GX_PNMTX0);
+    GXClearVtxDesc();
+    GXSetVtxDesc(GX_VA_POS, GX_DIRECT);
+    GXSetVtxDesc(GX_VA_TEX0, GX_DIRECT);
+    GXSetVtxAttrFmt(GX_VTXFMT0, GX_VA_POS, GX_POS_XYZ, GX_F32, 0);
+    GXSetVtxAttrFmt(GX_VTXFMT0, GX_VA_TEX0, GX_TEX_ST, GX_F32, 0);
+    GXSetNumChans(0);
+    GXSetNumTexGens(1);
+    GXSetTexCoordGen(GX_TEXCOORD0, GX_TG_MTX2x4, GX_TG_TEX0, GX_IDENTITY);
+    GXSetNumTevStages(1);
+    GXSetTevOrder(GX_TEVSTAGE0, GX_TEXCOORD0, GX_TEXMAP0, GX_COLOR_NULL);
+    GXSetTevOp(GX_TEVSTAGE0, GX_REPLACE);
+    GXSetZMode(GX_FALSE, GX_ALWAYS, GX_FALSE);
+    GXSetBlendMode(GX_BM_NONE, GX_BL_ONE, GX_BL_ZERO, GX_LO_CLEAR);
+    GXSetCullMode(GX_CULL_NONE);
+}
+
+/* Square of side `size` px centered on screen, rotated by `deg`; texcoords
+ * cover the texture's center at `step` texels per pixel */
+static void bench_quad(float deg, float size, float tex_size, float step) {
+    float c = cosf(deg * 3.14159265f / 180.0f), s = sinf(deg * 3.14159265f / 180.0f);
+    static const float corner[4][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, 1} };
+    float st = size * step / tex_size * 0.5f;
+    GXBegin(GX_QUADS, GX_VTXFMT0, 4);
+    for (int i = 0; i < 4; i++) {
+        float x = corner[i][0] * size * 0.5f, y = corner[i][1] * size * 0.5f;
+        GXPosition3f32(320.0f + x * c - y * s, 240.0f + x * s + y * c, 0.0f);
+        GXTexCoord2f32(0.5f + corner[i][0] * st, 0.5f + corner[i][1] * st);
+    }
+    GXEnd();
+}
+
+int main(int argc, char **argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 30;
+    int size = argc > 2 ? atoi(argv[2]) : 1024;
+    float step = argc > 3 ? (float)atof(argv[3]) : 1.0f;
+    int quads = argc > 4 ? atoi(argv[4]) : 4;
+    static const float angles[] = { 0.0f, 15.0f, 30.0f, 45.0f, 60.0f, 90.0f };
+    static const char *layout_name[] = { "linear", "", "4x4" };
+
+    /* One copy of the texture per layout, so each decodes its own entry */
+    u32 bytes = (u32)size * size * 4;
+    u8 *tex_data[3] = { NULL, NULL, NULL };
+    tex_data[0] = aligned_alloc(32, bytes);
+    tex_data[2] = aligned_alloc(32, bytes);
+    if (!tex_data[0] || !tex_data[2]) return 1;
+    for (u32 i = 0; i < bytes; i++) tex_data[0][i] = bench_rand_byte();
+    memcpy(tex_data[2], tex_data[0], bytes);
+
+    /* Level 0 only: the comparison is about addressing, not mip selection */
+    setenv("MP4_TEX_AUTO_MIPS", "0", 1);
+
+    printf("[BENCH] texlayout: %dx%d RGBA8, %d quads of %d px per frame, %.2f texels/px, %d frames\n",
+           size, size, quads, 400, step, frames);
+    for (size_t a = 0; a < sizeof(angles) / sizeof(angles[0]); a++) {
+        double ms[3] = { 1e9, 1e9, 1e9 };
+        for (int run = 0; run < 6; run++) {
+            int layout = (run & 1) * 2;
+            setenv("MP4_TEX_LAYOUT", layout ? "2" : "0", 1);
+            GXInit(NULL, 0);
+            bench_setup();
+
+            GXTexObj tex;
+            GXInitTexObj(&tex, tex_data[layout], (u16)size, (u16)size, GX_TF_RGBA8,
+                         GX_REPEAT, GX_REPEAT, GX_FALSE);
+            GXLoadTexObj(&tex, GX_TEXMAP0);
+            bench_quad(angles[a], 400.0f, (float)size, step);  /* decode outside the timing */
+            GXCopyDisp(NULL, GX_TRUE);
+
+            double start = bench_now();
+            for (int f = 0; f < frames; f++) {
+                for (int q = 0; q < quads; q++) bench_quad(angles[a] + q * 0.5f, 400.0f, (float)size, step);
+                GXCopyDisp(NULL, GX_TRUE);
+            }
+            double t = (bench_now() - start) * 1e3 / frames;
+            if (t < ms[layout]) ms[layout] = t;
+        }
+        printf("[BENCH] %4.0f deg: %s %7.2f ms/frame  %s %7.2f ms/frame  (%.2fx)\n", angles[a],
+               layout_name[0], ms[0], layout_name[2], ms[2], ms[0] / ms[2]);
+    }
+
+    free(tex_data[0]);
+    free(tex_data[2]);
+    return 0;
+}
@@ -0,0 +1,532 @@
+/*
+ * GX trace replay benchmark.
+ *
+ * Plays back a trace written with MP4_GX_CAPTURE=<path> (see
+ * pc/dolphin/gx_capture.h) through the GX entry points, headless, without
+ * the game or its data. Each loop starts from GXInit and replays the whole
+ * trace; the report gives frame times per loop, the heaviest draws of the
+ * last loop with their triangle and pixel counts, and whether every frame
+ * hashed the same as when it was captured:
+ *
+ *   cc -O2 -std=gnu11 -DTARGET_PC -Ipc -idirafter include \
+ *      pc/bench/gx_replay.c pc/dolphin/gx_pc.c pc/dolphin/gx_capture.c \
+ *      pc/dolphin/gx_texdecode.c pc/pc_jobs.c -lm -lpthread -o gx_replay
+ *   ./gx_replay trace [loops] [top_draws]
+ *
+ * Environment settings (MP4_RASTER_THREADS, MP4_DL_COMPILE, ...) apply as
+ * in the game; images match only under the settings the trace was captured
+ * with. A draw's time runs from the end of the previous draw, so it
+ * includes the state changes that set it up. With threaded rasterization
+ * shading is deferred to the frame copy and draw pixels read 0; run with
+ * MP4_RASTER_THREADS=0 for per-draw shading costs. Exits 1 if a frame's
+ * image differs from the capture.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dolphin/types.h"
+#include "dolphin/gx.h"
+#include "dolphin/mtx.h"
+#include "dolphin/gx_state.h"
+#include "dolphin/gx_capture.h"
+
+extern u32 *g_gx_framebuffer;
+
+typedef struct {
+    u8 op;
+    u32 len;
+    const u32 *w;       /* payload, 8-byte aligned */
+} ReplayRecord;
+
+/* Captured address -> replay copy */
+typedef struct {
+    u64 addr;
+    u8 *buf;
+    u32 size, cap;
+} ReplayRegion;
+
+typedef struct {
+    u32 record;         /* END or CALL_DL record */
+    u32 frame;
+    double ms;
+    u64 tris, tris_drawn, pixels;
+} ReplayDraw;
+
+static struct {
+    ReplayRecord *recs;
+    u32 nrecs;
+    ReplayRegion *regions;
+    u32 nregions, regions_cap;
+    u32 *region_index;  /* open-addressed, index + 1 */
+    u32 index_cap;
+    u64 array_addr[GX_VA_MAX_ATTR];
+    u8 array_stride[GX_VA_MAX_ATTR];
+} g_rp;
+
+static double replay_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *replay_alloc(size_t size) {
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        fprintf(stderr, "gx_replay: out of memory\n");
+        exit(2);
+    }
+    return p;
+}
+
+static u64 replay_addr(const u32 *w) {
+    return w[0] | ((u64)w[1] << 32);
+}
+
+static f32 replay_f(u32 u) {
+    f32 f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+static GXColor replay_color(u32 u) {
+    GXColor c;
+    memcpy(&c, &u, sizeof(c));
+    return c;
+}
+
+/* ================================================================
+ * Memory regions
+ * ================================================================ */
+static u32 replay_hash(u64 addr) {
+    addr ^= addr >> 33;
+    addr *= 0xFF51AFD7ED558CCDull;
+    addr ^= addr >> 33;
+    return (u32)addr & (g_rp.index_cap - 1);
+}
+
+static ReplayRegion *replay_region(u64 addr) {
+    if (!addr || !g_rp.index_cap) return NULL;
+    for (u32 i = replay_hash(addr);; i = (i + 1) & (g_rp.index_cap - 1)) {
+        u32 r = g_rp.region_index[i];
+        if (!r) return NULL;
+        if (g_rp.regions[r - 1].addr == addr) return &g_rp.regions[r - 1];
+    }
+}
+
+static void replay_index_put(u32 r) {
+    u32 i = replay_hash(g_rp.regions[r].addr);
+    while (g_rp.region_index[i]) i = (i + 1) & (g_rp.index_cap - 1);
+    g_rp.region_index[i] = r + 1;
+}
+
+static ReplayRegion *replay_region_add(u64 addr) {
+    if ((g_rp.nregions + 1) * 2 > g_rp.index_cap) {
+        free(g_rp.region_index);
+        g_rp.index_cap = g_rp.index_cap ? g_rp.index_cap * 2 : 1024;
+        g_rp.region_index = (u32 *)calloc(g_rp.index_cap, sizeof(u32));
+        if (!g_rp.region_index) replay_alloc((size_t)-1);
+        for (u32 r = 0; r < g_rp.nregions; r++) replay_index_put(r);
+    }
+    if (g_rp.nregions == g_rp.regions_cap) {
+        g_rp.regions_cap = g_rp.regions_cap ? g_rp.regions_cap * 2 : 256;
+        g_rp.regions = (ReplayRegion *)realloc(g_rp.regions, g_rp.regions_cap * sizeof(ReplayRegion));
+        if (!g_rp.regions) replay_alloc((size_t)-1);
+    }
+    ReplayRegion *r = &g_rp.regions[g_rp.nregions];
+    memset(r, 0, sizeof(*r));
+    r->addr = addr;
+    replay_index_put(g_rp.nregions++);
+    return r;
+}
+
+static void *replay_ptr(u64 addr) {
+    ReplayRegion *r = replay_region(addr);
+    return r ? r->buf : NULL;
+}
+
+static void replay_set_array(u32 attr) {
+    GXSetArray((GXAttr)attr, replay_ptr(g_rp.array_addr[attr]), g_rp.array_stride[attr]);
+}
+
+static void replay_mem(const u32 *w, u32 len) {
+    u64 addr = replay_addr(w);
+    u32 size = len - 8;
+    ReplayRegion *r = replay_region(addr);
+    if (!r) r = replay_region_add(addr);
+    if (size > r->cap) {
+        /* Earlier buffers stay alive: decoded textures may still point at them */
+        r->buf = (u8 *)replay_alloc(size);
+        r->cap = size;
+        for (u32 a = 0; a < GX_VA_MAX_ATTR; a++) {
+            if (g_rp.array_addr[a] == addr) replay_set_array(a);
+        }
+    }
+    memcpy(r->buf, w + 2, size);
+    r->size = size;
+    GXPCInvalidateVtxRange(r->buf, size);
+}
+
+/* ================================================================
+ * Display lists
+ * ================================================================ */
+static void replay_dl_entries(const DLEntry *e, u32 count) {
+    for (u32 i = 0; i < count; i++, e++) {
+        switch (e->cmd) {
+            case DL_CMD_BEGIN:
+                GXBegin((GXPrimitive)e->begin.prim, (GXVtxFmt)e->begin.fmt, e->begin.nverts);
+                break;
+            case DL_CMD_END:          GXEnd(); break;
+            case DL_CMD_POSITION1X16: GXPosition1x16(e->index); break;
+            case DL_CMD_POSITION1X8:  GXPosition1x8((u8)e->index); break;
+            case DL_CMD_NORMAL1X16:   GXNormal1x16(e->index); break;
+            case DL_CMD_NORMAL1X8:    GXNormal1x8((u8)e->index); break;
+            case DL_CMD_COLOR1X16:    GXColor1x16(e->index); break;
+            case DL_CMD_COLOR1X8:     GXColor1x8((u8)e->index); break;
+            case DL_CMD_TEXCOORD1X16: GXTexCoord1x16(e->index); break;
+            case DL_CMD_TEXCOORD1X8:  GXTexCoord1x8((u8)e->index); break;
+            case DL_CMD_POSITION3F32: GXPosition3f32(e->pos.x, e->pos.y, e->pos.z); break;
+            case DL_CMD_NORMAL3F32:   GXNormal3f32(e->pos.x, e->pos.y, e->pos.z); break;
+            case DL_CMD_TEXCOORD2F32: GXTexCoord2f32(e->tc.s, e->tc.t); break;
+            case DL_CMD_COLOR4U8:     GXColor4u8(e->clr.r, e->clr.g, e->clr.b, e->clr.a); break;
+            case DL_CMD_COLOR1U32:    GXColor1u32(e->clr32); break;
+            default: break;
+        }
+    }
+}
+
+static void replay_dl_define(const u32 *w, u32 len) {
+    u64 addr = replay_addr(w);
+    ReplayRegion *r = replay_region(addr);
+    if (!r) r = replay_region_add(addr);
+    if (!r->buf) {
+        /* Room for the handle GXEndDisplayList stores */
+        r->cap = 64;
+        r->buf = (u8 *)replay_alloc(r->cap);
+    }
+    GXBeginDisplayList(r->buf, r->cap);
+    replay_dl_entries((const DLEntry *)(w + 2), (len - 8) / sizeof(DLEntry));
+    r->size = GXEndDisplayList();
+}
+
+/* ================================================================
+ * Records
+ * ================================================================ */
+static void replay_record(const ReplayRecord *rec) {
+    const u32 *w = rec->w;
+    switch (rec->op) {
+        case GXCAP_SET_PROJECTION: {
+            Mtx44 m;
+            memcpy(m, w + 1, sizeof(m));
+            GXSetProjection(m, (GXProjectionType)w[0]);
+            break;
+        }
+        case GXCAP_LOAD_POS_MTX:
+        case GXCAP_LOAD_NRM_MTX: {
+            Mtx m;
+            memcpy(m, w + 1, sizeof(m));
+            if (rec->op == GXCAP_LOAD_POS_MTX) GXLoadPosMtxImm(m, w[0]);
+            else GXLoadNrmMtxImm(m, w[0]);
+            break;
+        }
+        case GXCAP_LOAD_TEX_MTX: {
+            Mtx m;
+            memset(m, 0, sizeof(m));
+            memcpy(m, w + 2, rec->len - 8);
+            GXLoadTexMtxImm(m, w[0], (GXTexMtxType)w[1]);
+            break;
+        }
+        case GXCAP_SET_CURRENT_MTX: GXSetCurrentMtx(w[0]); break;
+        case GXCAP_SET_VIEWPORT:
+            GXSetViewport(replay_f(w[0]), replay_f(w[1]), replay_f(w[2]), replay_f(w[3]),
+                          replay_f(w[4]), replay_f(w[5]));
+            break;
+        case GXCAP_SET_SCISSOR: GXSetScissor(w[0], w[1], w[2], w[3]); break;
+        case GXCAP_SET_VTX_DESC: GXSetVtxDesc((GXAttr)w[0], (GXAttrType)w[1]); break;
+        case GXCAP_SET_VTX_DESCV: {
+            GXVtxDescList list[GX_MAX_VERTEX_ATTRS + 1];
+            u32 n = rec->len / 8;
+            for (u32 i = 0; i < n && i < GX_MAX_VERTEX_ATTRS; i++) {
+                list[i].attr = (GXAttr)w[2 * i];
+                list[i].type = (GXAttrType)w[2 * i + 1];
+            }
+            list[n < GX_MAX_VERTEX_ATTRS ? n : GX_MAX_VERTEX_ATTRS].attr = GX_VA_NULL;
+            GXSetVtxDescv(list);
+            break;
+        }
+        case GXCAP_CLEAR_VTX_DESC: GXClearVtxDesc(); break;
+        case GXCAP_SET_VTX_ATTR_FMT:
+            GXSetVtxAttrFmt((GXVtxFmt)w[0], (GXAttr)w[1], (GXCompCnt)w[2], (GXCompType)w[3], (u8)w[4]);
+            break;
+        case GXCAP_SET_ARRAY:
+            if (w[0] < GX_VA_MAX_ATTR) {
+                g_rp.array_addr[w[0]] = replay_addr(w + 1);
+                g_rp.array_stride[w[0]] = (u8)w[3];
+                replay_set_array(w[0]);
+            }
+            break;
+        case GXCAP_SET_NUM_TEX_GENS: GXSetNumTexGens((u8)w[0]); break;
+        case GXCAP_SET_NUM_CHANS: GXSetNumChans((u8)w[0]); break;
+        case GXCAP_SET_CHAN_CTRL:
+            GXSetChanCtrl((GXChannelID)w[0], (GXBool)w[1], (GXColorSrc)w[2], (GXColorSrc)w[3], w[4],
+                          (GXDiffuseFn)w[5], (GXAttnFn)w[6]);
+            break;
+        case GXCAP_SET_CHAN_AMB_COLOR: GXSetChanAmbColor((GXChannelID)w[0], replay_color(w[1])); break;
+        case GXCAP_SET_CHAN_MAT_COLOR: GXSetChanMatColor((GXChannelID)w[0], replay_color(w[1])); break;
+        case GXCAP_LOAD_LIGHT: {
+            GXLightObj obj;
+            memcpy(&obj, w + 1, sizeof(obj));
+            GXLoadLightObjImm(&obj, (GXLightID)w[0]);
+            break;
+        }
+        case GXCAP_SET_TEV_COLOR_IN:
+            GXSetTevColorIn((GXTevStageID)w[0], (GXTevColorArg)w[1], (GXTevColorArg)w[2],
+                            (GXTevColorArg)w[3], (GXTevColorArg)w[4]);
+            break;
+        case GXCAP_SET_TEV_ALPHA_IN:
+            GXSetTevAlphaIn((GXTevStageID)w[0], (GXTevAlphaArg)w[1], (GXTevAlphaArg)w[2],
+                            (GXTevAlphaArg)w[3], (GXTevAlphaArg)w[4]);
+            break;
+        case GXCAP_SET_TEV_COLOR_OP:
+            GXSetTevColorOp((GXTevStageID)w[0], (GXTevOp)w[1], (GXTevBias)w[2], (GXTevScale)w[3],
+                            (GXBool)w[4], (GXTevRegID)w[5]);
+            break;
+        case GXCAP_SET_TEV_ALPHA_OP:
+            GXSetTevAlphaOp((GXTevStageID)w[0], (GXTevOp)w[1], (GXTevBias)w[2], (GXTevScale)w[3],
+                            (GXBool)w[4], (GXTevRegID)w[5]);
+            break;
+        case GXCAP_SET_TEV_COLOR: GXSetTevColor((GXTevRegID)w[0], replay_color(w[1])); break;
+        case GXCAP_SET_TEV_COLOR_S10: {
+            GXColorS10 c;
+            memcpy(&c, w + 1, sizeof(c));
+            GXSetTevColorS10((GXTevRegID)w[0], c);
+            break;
+        }
+        case GXCAP_SET_TEV_KCOLOR: GXSetTevKColor((GXTevKColorID)w[0], replay_color(w[1])); break;
+        case GXCAP_SET_TEV_KCOLOR_SEL: GXSetTevKColorSel((GXTevStageID)w[0], (GXTevKColorSel)w[1]); break;
+        case GXCAP_SET_TEV_KALPHA_SEL: GXSetTevKAlphaSel((GXTevStageID)w[0], (GXTevKAlphaSel)w[1]); break;
+        case GXCAP_SET_TEV_SWAP_MODE:
+            GXSetTevSwapMode((GXTevStageID)w[0], (GXTevSwapSel)w[1], (GXTevSwapSel)w[2]);
+            break;
+        case GXCAP_SET_TEV_SWAP_TABLE:
+            GXSetTevSwapModeTable((GXTevSwapSel)w[0], (GXTevColorChan)w[1], (GXTevColorChan)w[2],
+                                  (GXTevColorChan)w[3], (GXTevColorChan)w[4]);
+            break;
+        case GXCAP_SET_ALPHA_COMPARE:
+            GXSetAlphaCompare((GXCompare)w[0], (u8)w[1], (GXAlphaOp)w[2], (GXCompare)w[3], (u8)w[4]);
+            break;
+        case GXCAP_SET_TEV_ORDER:
+            GXSetTevOrder((GXTevStageID)w[0], (GXTexCoordID)w[1], (GXTexMapID)w[2], (GXChannelID)w[3]);
+            break;
+        case GXCAP_SET_NUM_TEV_STAGES: GXSetNumTevStages((u8)w[0]); break;
+        case GXCAP_SET_NUM_IND_STAGES: GXSetNumIndStages((u8)w[0]); break;
+        case GXCAP_LOAD_TEX_OBJ: {
+            GXTexObj obj;
+            memcpy(&obj, w + 4, sizeof(obj));
+            GXInitTexObjData(&obj, replay_ptr(replay_addr(w + 2)));
+            GXLoadTexObj(&obj, (GXTexMapID)w[0]);
+            break;
+        }
+        case GXCAP_LOAD_TLUT: {
+            GXTlutObj obj;
+            GXInitTlutObj(&obj, replay_ptr(replay_addr(w + 1)), (GXTlutFmt)w[3], (u16)w[4]);
+            GXLoadTlut(&obj, w[0]);
+            break;
+        }
+        case GXCAP_SET_FOG:
+            GXSetFog((GXFogType)w[0], replay_f(w[1]), replay_f(w[2]), replay_f(w[3]), replay_f(w[4]),
+                     replay_color(w[5]));
+            break;
+        case GXCAP_SET_FOG_COLOR: GXSetFogColor(replay_color(w[0])); break;
+        case GXCAP_SET_BLEND_MODE:
+            GXSetBlendMode((GXBlendMode)w[0], (GXBlendFactor)w[1], (GXBlendFactor)w[2], (GXLogicOp)w[3]);
+            break;
+        case GXCAP_SET_COLOR_UPDATE: GXSetColorUpdate((GXBool)w[0]); break;
+        case GXCAP_SET_ALPHA_UPDATE: GXSetAlphaUpdate((GXBool)w[0]); break;
+        case GXCAP_SET_Z_MODE: GXSetZMode((GXBool)w[0], (GXCompare)w[1], (GXBool)w[2]); break;
+        case GXCAP_SET_CULL_MODE: GXSetCullMode((GXCullMode)w[0]); break;
+        case GXCAP_SET_COPY_CLEAR: GXSetCopyClear(replay_color(w[0]), w[1]); break;
+
+        case GXCAP_BEGIN: GXBegin((GXPrimitive)w[0], (GXVtxFmt)w[1], (u16)w[2]); break;
+        case GXCAP_END: GXEnd(); break;
+        case GXCAP_POSITION3F32: GXPosition3f32(replay_f(w[0]), replay_f(w[1]), replay_f(w[2])); break;
+        case GXCAP_POSITION1X16: GXPosition1x16((u16)w[0]); break;
+        case GXCAP_NORMAL3F32: GXNormal3f32(replay_f(w[0]), replay_f(w[1]), replay_f(w[2])); break;
+        case GXCAP_NORMAL1X16: GXNormal1x16((u16)w[0]); break;
+        case GXCAP_COLOR4U8: GXColor4u8(w[0] >> 24, w[0] >> 16, w[0] >> 8, w[0]); break;
+        case GXCAP_COLOR1X16: GXColor1x16((u16)w[0]); break;
+        case GXCAP_COLOR4F32:
+            GXColor4f32(replay_f(w[0]), replay_f(w[1]), replay_f(w[2]), replay_f(w[3]));
+            break;
+        case GXCAP_TEXCOORD2F32: GXTexCoord2f32(replay_f(w[0]), replay_f(w[1])); break;
+        case GXCAP_TEXCOORD1X16: GXTexCoord1x16((u16)w[0]); break;
+        case GXCAP_SUBMIT_VERTICES: GXPCSubmitVertices((GXVtxFmt)w[0], (const u16 *)(w + 2), w[1]); break;
+        case GXCAP_INVALIDATE_TEX_ALL: GXInvalidateTexAll(); break;
+        case GXCAP_DL_DEFINE: replay_dl_define(w, rec->len); break;
+        case GXCAP_CALL_DL: {
+            ReplayRegion *r = replay_region(replay_addr(w));
+            if (r) GXCallDisplayList(r->buf, r->size);
+            break;
+        }
+        case GXCAP_MEM: replay_mem(w, rec->len); break;
+        case GXCAP_COPY_DISP: GXCopyDisp(NULL, (GXBool)w[0]); break;
+        default: break;
+    }
+}
+
+/* Split the trace into records with aligned payloads */
+static int replay_load(const char *path, GXCapHeader *h) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "gx_replay: cannot open %s\n", path);
+        return 0;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    u8 *raw = (u8 *)replay_alloc(size);
+    if (size < (long)sizeof(*h) || fread(raw, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "gx_replay: cannot read %s\n", path);
+        fclose(f);
+        return 0;
+    }
+    fclose(f);
+    memcpy(h, raw, sizeof(*h));
+    if (h->magic != GXCAP_MAGIC || h->version != GXCAP_VERSION) {
+        fprintf(stderr, "gx_replay: %s is not a version %d GX trace\n", path, GXCAP_VERSION);
+        return 0;
+    }
+    if (h->ptr_size != sizeof(void *) || h->texobj_size != sizeof(GXTexObj) ||
+        h->lightobj_size != sizeof(GXLightObj) || h->dlentry_size != sizeof(DLEntry)) {
+        fprintf(stderr, "gx_replay: %s was captured on a different ABI\n", path);
+        return 0;
+    }
+
+    /* Payloads padded to 8 bytes: at most 8 arena bytes per 3 trace bytes */
+    u8 *arena = (u8 *)replay_alloc((size_t)size * 3 + 8);
+    u32 cap = 1024, arena_len = 0;
+    g_rp.recs = (ReplayRecord *)replay_alloc(cap * sizeof(ReplayRecord));
+    const u8 *p = raw + sizeof(*h), *end = raw + size;
+    while (p + 2 <= end) {
+        u8 op = p[0];
+        u32 len = p[1];
+        p += 2;
+        if (len == 255) {
+            if (p + 4 > end) break;
+            memcpy(&len, p, 4);
+            p += 4;
+        }
+        if (len > (u32)(end - p) || op >= GXCAP_OP_COUNT) {
+            fprintf(stderr, "gx_replay: trace truncated after %u records\n", g_rp.nrecs);
+            break;
+        }
+        if (g_rp.nrecs == cap) {
+            cap *= 2;
+            g_rp.recs = (ReplayRecord *)realloc(g_rp.recs, cap * sizeof(ReplayRecord));
+            if (!g_rp.recs) replay_alloc((size_t)-1);
+        }
+        ReplayRecord *r = &g_rp.recs[g_rp.nrecs++];
+        r->op = op;
+        r->len = len;
+        r->w = (const u32 *)(arena + arena_len);
+        memcpy(arena + arena_len, p, len);
+        arena_len += (len + 7) & ~7u;
+        p += len;
+    }
+    free(raw);
+    return 1;
+}
+
+static int replay_draw_cmp(const void *a, const void *b) {
+    double ma = ((const ReplayDraw *)a)->ms, mb = ((const ReplayDraw *)b)->ms;
+    return ma < mb ? 1 : ma > mb ? -1 : 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s trace [loops] [top_draws]\n", argv[0]);
+        return 2;
+    }
+    int loops = argc > 2 ? atoi(argv[2]) : 3;
+    int top = argc > 3 ? atoi(argv[3]) : 10;
+    if (loops < 1) loops = 1;
+
+    GXCapHeader h;
+    if (!replay_load(argv[1], &h)) return 2;
+    /* Replaying must not record a trace of its own */
+    unsetenv("MP4_GX_CAPTURE");
+
+    u32 nframes = 0, ndraws = 0;
+    u64 mem_bytes = 0;
+    for (u32 i = 0; i < g_rp.nrecs; i++) {
+        const ReplayRecord *r = &g_rp.recs[i];
+        if (r->op == GXCAP_FRAME) nframes++;
+        else if (r->op == GXCAP_END || r->op == GXCAP_CALL_DL) ndraws++;
+        else if (r->op == GXCAP_MEM) mem_bytes += r->len - 8;
+    }
+    printf("[BENCH] gx_replay: %s: %u records, %u frames, %u draws, %.1f MB of memory, captured from frame %u\n",
+           argv[1], g_rp.nrecs, nframes, ndraws, mem_bytes / (1024.0 * 1024.0), h.start_frame);
+    if (!nframes) return 2;
+
+    ReplayDraw *draws = (ReplayDraw *)replay_alloc((ndraws ? ndraws : 1) * sizeof(ReplayDraw));
+    u32 mismatches = 0;
+    for (int loop = 0; loop < loops; loop++) {
+        GXInit(NULL, 0);
+        double fmin = 1e9, fmax = 0, ftotal = 0;
+        u32 frame = 0, draw = 0, loop_mismatch = 0;
+        GXPCRasterStats rs0, rs1;
+        GXPCGetRasterStats(&rs0);
+        double frame_start = replay_now(), draw_start = frame_start;
+
+        for (u32 i = 0; i < g_rp.nrecs; i++) {
+            const ReplayRecord *rec = &g_rp.recs[i];
+            if (rec->op != GXCAP_FRAME) {
+                replay_record(rec);
+                if (rec->op != GXCAP_END && rec->op != GXCAP_CALL_DL) continue;
+                double now = replay_now();
+                GXPCGetRasterStats(&rs1);
+                ReplayDraw *d = &draws[draw++];
+                d->record = i;
+                d->frame = frame;
+                d->ms = (now - draw_start) * 1e3;
+                d->tris = rs1.tris - rs0.tris;
+                d->tris_drawn = rs1.tris_drawn - rs0.tris_drawn;
+                d->pixels = rs1.pixels - rs0.pixels;
+                rs0 = rs1;
+                draw_start = replay_now();
+                continue;
+            }
+
+            double ms = (replay_now() - frame_start) * 1e3;
+            ftotal += ms;
+            if (ms < fmin) fmin = ms;
+            if (ms > fmax) fmax = ms;
+            u64 hash = gx_hash64(g_gx_framebuffer, GX_FB_WIDTH * GX_FB_HEIGHT * sizeof(u32), 0);
+            if (hash != replay_addr(rec->w)) {
+                if (!loop_mismatch) printf("[BENCH] loop %d: frame %u image differs from the capture\n", loop, frame);
+                loop_mismatch++;
+            }
+            frame++;
+            GXPCGetRasterStats(&rs0);
+            frame_start = draw_start = replay_now();
+        }
+        mismatches += loop_mismatch;
+        printf("[BENCH] loop %d: %7.2f ms/frame mean  %7.2f min  %7.2f max  (%u/%u frames match)\n", loop,
+               ftotal / frame, fmin, fmax, frame - loop_mismatch, frame);
+    }
+
+    /* Heaviest draws of the last loop */
+    double dtotal = 0;
+    for (u32 i = 0; i < ndraws; i++) dtotal += draws[i].ms;
+    printf("[BENCH] draws: %.1f us mean over %u; heaviest:\n", ndraws ? dtotal * 1e3 / ndraws : 0.0, ndraws);
+    qsort(draws, ndraws, sizeof(ReplayDraw), replay_draw_cmp);
+    for (u32 i = 0; i < ndraws && i < (u32)top; i++) {
+        const ReplayDraw *d = &draws[i];
+        printf("[BENCH]   frame %3u record %8u %-7s %8.3f ms  tris %6llu  drawn %6llu  pixels %8llu\n", d->frame,
+               d->record, g_rp.recs[d->record].op == GXCAP_CALL_DL ? "list" : "draw", d->ms,
+               (unsigned long long)d->tris, (unsigned long long)d->tris_drawn, (unsigned long long)d->pixels);
+    }
+    free(draws);
+    return mismatches ? 1 : 0;
+}
@@ -1,14 +1,18 @@
 /*
- * Cache operations - all no-ops on PC
+ * Cache operations - no-ops on PC, except that data cache flushes mark the
+ * range as rewritten for GX (compiled display lists read vertex arrays
+ * ahead of time, and the game flushes after skinning or morphing them).
+ * HuMemDCFlush does not come here; see malloc_pc.c.
  */
 #include "dolphin/types.h"
 #include "dolphin/os/OSCache.h"
+#include "dolphin/gx/GXExtra.h"
 
 void DCInvalidateRange(void *addr, u32 nBytes) { (void)addr; (void)nBytes; }
-void DCFlushRange(void *addr, u32 nBytes) { (void)addr; (void)nBytes; }
-void DCStoreRange(void *addr, u32 nBytes) { (void)addr; (void)nBytes; }
-void DCFlushRangeNoSync(void *addr, u32 nBytes) { (void)addr; (void)nBytes; }
-void DCStoreRangeNoSync(void *addr, u32 nBytes) { (void)addr; (void)nBytes; }
+void DCFlushRange(void *addr, u32 nBytes) { GXPCInvalidateVtxRange(addr, nBytes); }
+void DCStoreRange(void *addr, u32 nBytes) { GXPCInvalidateVtxRange(addr, nBytes); }
+void DCFlushRangeNoSync(void *addr, u32 nBytes) { GXPCInvalidateVtxRange(addr, nBytes); }
+void DCStoreRangeNoSync(void *addr, u32 nBytes) { GXPCInvalidateVtxRange(addr, nBytes); }
 void DCZeroRange(void *addr, u32 nBytes) { (void)addr; (void)nBytes; }
 void DCTouchRange(void *addr, u32 nBytes) { (void)addr; (void)nBytes; }
 
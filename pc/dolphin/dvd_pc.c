@@ -1,130 +1,683 @@
 /*
  * DVD (Filesystem) replacement - reads from extracted game files
  */
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "dolphin/types.h"
 #include "dolphin/dvd.h"
 #include "pc_config.h"
+#include "dolphin/input_log.h"
 
-/* Simple FST for entrynum lookups */
-#define MAX_FST_ENTRIES 4096
+/*
+ * File table. DVDInit walks the data directory once and gives every file
+ * an entry number (in path order) and a fake disc address: files are laid
+ * out back to back, 32-byte aligned, as on a disc. The address goes into
+ * DVDFileInfo.startAddr, which is how reads find their file again and how
+ * data.c tells its in-flight reads apart. Paths are looked up in an
+ * open-addressed hash table; files that appear after DVDInit are added on
+ * first open.
+ *
+ * A file is opened on first use and stays open for the rest of the run,
+ * mapped whole (PC_DVD_MMAP = 1, reads are a memcpy) or read with pread.
+ */
 typedef struct {
-    char path[256];
-    s32 entrynum;
-} FSTEntry;
+    char *path;             /* relative to the data path, no leading '/' */
+    u32 addr;
+    u32 size;
+    s64 mtime;              /* ns, as found by DVDInit or the first open */
+    int fd;                 /* -1 until first use */
+    const u8 *map;
+    u8 *pre;                /* prefetched copy (DVDPCPrefetch) */
+    u8 pre_state;
+} DVDEntry;
+
+enum { DVD_PRE_NONE, DVD_PRE_QUEUED, DVD_PRE_READY };
 
-static FSTEntry g_fst[MAX_FST_ENTRIES];
-static int g_fst_count = 0;
+static struct {
+    DVDEntry *entries;
+    s32 count, cap;
+    s32 *hash;              /* entry numbers, -1 = empty */
+    u32 hash_mask;
+    u32 next_addr;
+    int use_mmap;
+    u32 pre_bytes, pre_budget;  /* prefetched and queued bytes */
+    u32 pre_hits;
+    pthread_mutex_t lock;   /* table and lazy opens; reads run unlocked */
+} g_dvd = { .lock = PTHREAD_MUTEX_INITIALIZER };
 
 static char g_data_path[512] = MP4_DATA_PATH;
 
-static void build_path(char *out, size_t out_size, const char *game_path) {
-    if (game_path[0] == '/') game_path++;
-    snprintf(out, out_size, "%s%s", g_data_path, game_path);
+#define DVD_ADDR_BASE 0x10000u
+
+static const char *dvd_rel_path(const char *game_path) {
+    while (game_path[0] == '/') game_path++;
+    return game_path;
 }
 
-void DVDInit(void) {
-    printf("[DVD] DVDInit() - data path: %s\n", g_data_path);
-    g_fst_count = 0;
+static u32 dvd_hash_str(const char *s) {
+    u32 h = 2166136261u;
+    while (*s) h = (h ^ (u8)*s++) * 16777619u;
+    return h;
 }
 
-BOOL DVDOpen(char *path, DVDFileInfo *fileInfo) {
-    char full_path[512];
-    build_path(full_path, sizeof(full_path), path);
+static void dvd_hash_insert(s32 entrynum) {
+    u32 i = dvd_hash_str(g_dvd.entries[entrynum].path) & g_dvd.hash_mask;
+    while (g_dvd.hash[i] >= 0) i = (i + 1) & g_dvd.hash_mask;
+    g_dvd.hash[i] = entrynum;
+}
 
-    FILE *f = fopen(full_path, "rb");
-    if (!f) {
-        printf("[DVD] DVDOpen failed: %s\n", full_path);
-        memset(fileInfo, 0, sizeof(*fileInfo));
-        return FALSE;
+/* Keeps the table at most half full */
+static void dvd_hash_reserve(s32 count) {
+    if (g_dvd.hash && (u32)count * 2 <= g_dvd.hash_mask + 1) return;
+    u32 size = 256;
+    while (size < (u32)count * 2) size *= 2;
+    free(g_dvd.hash);
+    g_dvd.hash = (s32 *)malloc(size * sizeof(s32));
+    memset(g_dvd.hash, 0xFF, size * sizeof(s32));
+    g_dvd.hash_mask = size - 1;
+    for (s32 i = 0; i < g_dvd.count; i++) dvd_hash_insert(i);
+}
+
+static s32 dvd_lookup(const char *rel) {
+    if (!g_dvd.hash) return -1;
+    u32 i = dvd_hash_str(rel) & g_dvd.hash_mask;
+    for (; g_dvd.hash[i] >= 0; i = (i + 1) & g_dvd.hash_mask) {
+        if (strcmp(g_dvd.entries[g_dvd.hash[i]].path, rel) == 0) return g_dvd.hash[i];
     }
+    return -1;
+}
 
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    fclose(f);
+static s64 dvd_mtime(const struct stat *st) {
+#ifdef __APPLE__
+    return (s64)st->st_mtimespec.tv_sec * 1000000000 + st->st_mtimespec.tv_nsec;
+#else
+    return (s64)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
 
-    memset(fileInfo, 0, sizeof(*fileInfo));
-    fileInfo->startAddr = 0;
-    fileInfo->length = (u32)size;
+static s32 dvd_add(const char *rel, u32 size, s64 mtime) {
+    dvd_hash_reserve(g_dvd.count + 1);
+    if (g_dvd.count == g_dvd.cap) {
+        g_dvd.cap = g_dvd.cap ? g_dvd.cap * 2 : 1024;
+        g_dvd.entries = (DVDEntry *)realloc(g_dvd.entries, g_dvd.cap * sizeof(DVDEntry));
+    }
+    s32 entrynum = g_dvd.count++;
+    DVDEntry *e = &g_dvd.entries[entrynum];
+    e->path = strdup(rel);
+    e->addr = g_dvd.next_addr;
+    e->size = size;
+    e->mtime = mtime;
+    e->fd = -1;
+    e->map = NULL;
+    e->pre = NULL;
+    e->pre_state = DVD_PRE_NONE;
+    /* Files start on 32-byte boundaries, as on the disc. An empty file
+     * still takes 32 bytes so it does not share its address with the next
+     * one, which dvd_find_addr could then return instead. */
+    g_dvd.next_addr += size ? (size + 31) & ~31u : 32;
+    dvd_hash_insert(entrynum);
+    return entrynum;
+}
 
-    /* Store the full path in the command block area for later reads */
-    strncpy((char *)&fileInfo->cb, full_path, sizeof(DVDCommandBlock));
+/* Entry holding the fake disc address, -1 if none */
+static s32 dvd_find_addr(u32 addr) {
+    s32 lo = 0, hi = g_dvd.count - 1;
+    while (lo <= hi) {
+        s32 mid = (lo + hi) / 2;
+        if (g_dvd.entries[mid].addr == addr) return mid;
+        if (g_dvd.entries[mid].addr < addr) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+typedef struct {
+    char *path;
+    u32 size;
+    s64 mtime;
+} DVDScanFile;
+
+typedef struct {
+    DVDScanFile *files;
+    int count, cap;
+} DVDScan;
+
+static int dvd_cmp_path(const void *a, const void *b) {
+    return strcmp(((const DVDScanFile *)a)->path, ((const DVDScanFile *)b)->path);
+}
 
-    /* Register in FST */
-    if (g_fst_count < MAX_FST_ENTRIES) {
-        strncpy(g_fst[g_fst_count].path, path, 255);
-        g_fst[g_fst_count].entrynum = g_fst_count;
-        g_fst_count++;
+static void dvd_scan(DVDScan *scan, const char *rel) {
+    char dir_path[1024];
+    snprintf(dir_path, sizeof(dir_path), "%s%s", g_data_path, rel);
+    DIR *dir = opendir(dir_path);
+    if (!dir) return;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] == '.') continue;
+        char child[512], full[1024];
+        struct stat st;
+        snprintf(child, sizeof(child), "%s%s%s", rel, *rel ? "/" : "", de->d_name);
+        snprintf(full, sizeof(full), "%s%s", g_data_path, child);
+        if (stat(full, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            dvd_scan(scan, child);
+        } else if (S_ISREG(st.st_mode)) {
+            if (scan->count == scan->cap) {
+                scan->cap = scan->cap ? scan->cap * 2 : 1024;
+                scan->files = (DVDScanFile *)realloc(scan->files, scan->cap * sizeof(DVDScanFile));
+            }
+            scan->files[scan->count].path = strdup(child);
+            scan->files[scan->count].size = (u32)st.st_size;
+            scan->files[scan->count].mtime = dvd_mtime(&st);
+            scan->count++;
+        }
     }
+    closedir(dir);
+}
 
-    return TRUE;
+/* Opens (and maps) the entry on first use; call with the lock held */
+static int dvd_open_entry(DVDEntry *e) {
+    if (e->fd >= 0) return 1;
+    char full[1024];
+    snprintf(full, sizeof(full), "%s%s", g_data_path, e->path);
+    int fd = open(full, O_RDONLY);
+    if (fd < 0) {
+        printf("[DVD] DVDRead: failed to open %s\n", full);
+        return 0;
+    }
+    if (g_dvd.use_mmap && e->size > 0) {
+        void *map = mmap(NULL, e->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) e->map = (const u8 *)map;
+    }
+    e->fd = fd;
+    return 1;
+}
+
+static void dvd_start_workers(void);
+
+void DVDInit(void) {
+    const char *e = getenv("MP4_DVD_MMAP");
+    g_dvd.use_mmap = (e && *e) ? atoi(e) : PC_DVD_MMAP;
+    e = getenv("MP4_PREFETCH_BUDGET");
+    g_dvd.pre_budget = (e && *e) ? (u32)strtoul(e, NULL, 0) : PC_PREFETCH_BUDGET;
+
+    pthread_mutex_lock(&g_dvd.lock);
+    if (!g_dvd.entries) {
+        DVDScan scan = { 0 };
+        g_dvd.next_addr = DVD_ADDR_BASE;
+        dvd_scan(&scan, "");
+        qsort(scan.files, scan.count, sizeof(DVDScanFile), dvd_cmp_path);
+        dvd_hash_reserve(scan.count);
+        for (int i = 0; i < scan.count; i++) {
+            dvd_add(scan.files[i].path, scan.files[i].size, scan.files[i].mtime);
+            free(scan.files[i].path);
+        }
+        free(scan.files);
+    }
+    pthread_mutex_unlock(&g_dvd.lock);
+    printf("[DVD] DVDInit() - data path: %s (%d files)\n", g_data_path, (int)g_dvd.count);
+    dvd_start_workers();
 }
 
 BOOL DVDFastOpen(s32 entrynum, DVDFileInfo *fileInfo) {
-    if (entrynum < 0 || entrynum >= g_fst_count) {
+    pthread_mutex_lock(&g_dvd.lock);
+    if (entrynum < 0 || entrynum >= g_dvd.count) {
+        pthread_mutex_unlock(&g_dvd.lock);
         return FALSE;
     }
-    return DVDOpen(g_fst[entrynum].path, fileInfo);
+    memset(fileInfo, 0, sizeof(*fileInfo));
+    fileInfo->startAddr = g_dvd.entries[entrynum].addr;
+    fileInfo->length = g_dvd.entries[entrynum].size;
+    pthread_mutex_unlock(&g_dvd.lock);
+    return TRUE;
 }
 
+BOOL DVDOpen(char *path, DVDFileInfo *fileInfo) {
+    s32 entrynum = DVDConvertPathToEntrynum(path);
+    if (entrynum < 0) {
+        printf("[DVD] DVDOpen failed: %s%s\n", g_data_path, dvd_rel_path(path));
+        memset(fileInfo, 0, sizeof(*fileInfo));
+        return FALSE;
+    }
+    return DVDFastOpen(entrynum, fileInfo);
+}
+
+/* Files stay open until exit */
 BOOL DVDClose(DVDFileInfo *fileInfo) {
     (void)fileInfo;
     return TRUE;
 }
 
+/* Reads from the file at disc address start; bytes read, or -1 */
+static s32 dvd_read(u32 start, void *addr, s32 length, s32 offset) {
+    pthread_mutex_lock(&g_dvd.lock);
+    s32 entrynum = dvd_find_addr(start);
+    if (entrynum < 0 || !dvd_open_entry(&g_dvd.entries[entrynum])) {
+        pthread_mutex_unlock(&g_dvd.lock);
+        return -1;
+    }
+    DVDEntry e = g_dvd.entries[entrynum];
+
+    /* Reads are rounded up to 32 bytes and may run past the end */
+    if (offset < 0 || length <= 0 || (u32)offset >= e.size) {
+        pthread_mutex_unlock(&g_dvd.lock);
+        return -1;
+    }
+    size_t n = (size_t)length;
+    if (n > e.size - (u32)offset) n = e.size - (u32)offset;
+    if (e.pre_state == DVD_PRE_READY) {
+        /* A whole-file read takes the prefetched copy's place */
+        DVDEntry *pe = &g_dvd.entries[entrynum];
+        memcpy(addr, pe->pre + offset, n);
+        if (offset == 0 && n == e.size) {
+            free(pe->pre);
+            pe->pre = NULL;
+            pe->pre_state = DVD_PRE_NONE;
+            g_dvd.pre_bytes -= e.size;
+            g_dvd.pre_hits++;
+        }
+        pthread_mutex_unlock(&g_dvd.lock);
+        return (s32)n;
+    }
+    pthread_mutex_unlock(&g_dvd.lock);
+    if (e.map) {
+        memcpy(addr, e.map + offset, n);
+        return (s32)n;
+    }
+    /* pread may return less than asked; stop at end of file or an error */
+    size_t done = 0;
+    while (done < n) {
+        ssize_t got = pread(e.fd, (u8 *)addr + done, n - done, offset + (off_t)done);
+        if (got <= 0) break;
+        done += (size_t)got;
+    }
+    return done > 0 ? (s32)done : -1;
+}
+
 BOOL DVDReadPrio(DVDFileInfo *fileInfo, void *addr, s32 length, s32 offset, s32 prio) {
     (void)prio;
-    char *path = (char *)&fileInfo->cb;
+    return dvd_read(fileInfo->startAddr, addr, length, offset) > 0;
+}
 
-    FILE *f = fopen(path, "rb");
-    if (!f) {
-        printf("[DVD] DVDRead: failed to open %s\n", path);
-        return FALSE;
+/* DVDRead and DVDReadAsync are macros in dvd.h that call DVDReadPrio/DVDReadAsyncPrio */
+
+/*
+ * Asynchronous reads. As in the SDK, a queued command block waits on one
+ * of four priority queues (0 is served first), linked through cb.next and
+ * cb.prev. PC_DVD_THREADS workers pop blocks and read them; finished
+ * blocks move to the done list and their callbacks run on the main
+ * thread, once per retrace (DVDPCDispatch) and whenever the main thread
+ * polls DVDGetDriveStatus or DVDGetCommandBlockStatus, which is how game
+ * code waits for a read. While input is recorded or replayed, those
+ * points first wait for every queued read, so completions land on the
+ * same frame in every run.
+ */
+#define DVD_MAX_THREADS 8
+#define DVD_PRIO_COUNT  4
+#define DVD_PRE_QUEUE   256
+
+typedef struct {
+    DVDCommandBlock *head, *tail;
+} DVDQueue;
+
+static struct {
+    pthread_t threads[DVD_MAX_THREADS];
+    DVDCommandBlock *active[DVD_MAX_THREADS];   /* block each worker reads */
+    int nthreads;
+    pthread_t main_thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;    /* a block was queued */
+    pthread_cond_t idle;    /* a worker finished a block */
+    DVDQueue waiting[DVD_PRIO_COUNT];
+    DVDQueue done;
+    int queued, busy;
+    s32 pre_queue[DVD_PRE_QUEUE];   /* entry numbers to prefetch */
+    u32 pre_head, pre_tail;
+} g_dvdq = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .idle = PTHREAD_COND_INITIALIZER,
+};
+
+static void dvd_queue_push(DVDQueue *q, DVDCommandBlock *b) {
+    b->next = NULL;
+    b->prev = q->tail;
+    if (q->tail) q->tail->next = b;
+    else q->head = b;
+    q->tail = b;
+}
+
+static void dvd_queue_remove(DVDQueue *q, DVDCommandBlock *b) {
+    if (b->prev) b->prev->next = b->next;
+    else q->head = b->next;
+    if (b->next) b->next->prev = b->prev;
+    else q->tail = b->prev;
+    b->next = b->prev = NULL;
+}
+
+/* Queue holding b, NULL if none */
+static DVDQueue *dvd_queue_of(DVDCommandBlock *b) {
+    for (int i = 0; i < DVD_PRIO_COUNT; i++) {
+        for (DVDCommandBlock *it = g_dvdq.waiting[i].head; it; it = it->next) {
+            if (it == b) return &g_dvdq.waiting[i];
+        }
+    }
+    for (DVDCommandBlock *it = g_dvdq.done.head; it; it = it->next) {
+        if (it == b) return &g_dvdq.done;
     }
+    return NULL;
+}
 
-    fseek(f, offset, SEEK_SET);
-    size_t bytes_read = fread(addr, 1, (size_t)length, f);
-    fclose(f);
-    return (bytes_read > 0);
+static int dvd_is_active(DVDCommandBlock *b) {
+    for (int i = 0; i < g_dvdq.nthreads; i++) {
+        if (g_dvdq.active[i] == b) return 1;
+    }
+    return 0;
 }
 
-/* DVDRead and DVDReadAsync are macros in dvd.h that call DVDReadPrio/DVDReadAsyncPrio */
+/*
+ * Prefetch. DVDPCPrefetch reserves a file's size against the budget
+ * (PC_PREFETCH_BUDGET) and queues it; idle workers copy the whole file
+ * to host memory. dvd_read serves reads of a prefetched file from the
+ * copy, and the first whole-file read hands the copy's bytes over and
+ * frees it. DVDPCPrefetchDrop releases whatever was not read.
+ */
+static void dvd_prefetch_file(s32 entrynum) {
+    pthread_mutex_lock(&g_dvd.lock);
+    DVDEntry *pe = &g_dvd.entries[entrynum];
+    if (pe->pre_state != DVD_PRE_QUEUED || !dvd_open_entry(pe)) {
+        pthread_mutex_unlock(&g_dvd.lock);
+        return;
+    }
+    DVDEntry e = *pe;
+    pthread_mutex_unlock(&g_dvd.lock);
+
+    u8 *buf = (u8 *)malloc(e.size);
+    int ok = buf != NULL;
+    if (ok && e.map) {
+        memcpy(buf, e.map, e.size);
+    } else if (ok) {
+        for (u32 pos = 0; ok && pos < e.size;) {
+            ssize_t got = pread(e.fd, buf + pos, e.size - pos, pos);
+            ok = got > 0;
+            pos += ok ? (u32)got : 0;
+        }
+    }
+
+    pthread_mutex_lock(&g_dvd.lock);
+    pe = &g_dvd.entries[entrynum];
+    if (ok && pe->pre_state == DVD_PRE_QUEUED) {
+        pe->pre = buf;
+        pe->pre_state = DVD_PRE_READY;
+        buf = NULL;
+    } else if (pe->pre_state == DVD_PRE_QUEUED) {
+        pe->pre_state = DVD_PRE_NONE;
+        g_dvd.pre_bytes -= e.size;
+    }
+    pthread_mutex_unlock(&g_dvd.lock);
+    free(buf);
+}
+
+BOOL DVDPCPrefetch(s32 entrynum) {
+    if (g_dvdq.nthreads == 0) return FALSE;
+    pthread_mutex_lock(&g_dvd.lock);
+    DVDEntry *e = entrynum >= 0 && entrynum < g_dvd.count ? &g_dvd.entries[entrynum] : NULL;
+    BOOL queued = e && e->size > 0 && e->pre_state == DVD_PRE_NONE &&
+                  e->size <= g_dvd.pre_budget - g_dvd.pre_bytes;
+    if (queued) {
+        e->pre_state = DVD_PRE_QUEUED;
+        g_dvd.pre_bytes += e->size;
+    }
+    pthread_mutex_unlock(&g_dvd.lock);
+    if (!queued) return FALSE;
+
+    pthread_mutex_lock(&g_dvdq.lock);
+    if (g_dvdq.pre_tail - g_dvdq.pre_head < DVD_PRE_QUEUE) {
+        g_dvdq.pre_queue[g_dvdq.pre_tail++ % DVD_PRE_QUEUE] = entrynum;
+        pthread_cond_signal(&g_dvdq.wake);
+    } else {
+        queued = FALSE;
+    }
+    pthread_mutex_unlock(&g_dvdq.lock);
+    if (!queued) {
+        pthread_mutex_lock(&g_dvd.lock);
+        e->pre_state = DVD_PRE_NONE;
+        g_dvd.pre_bytes -= e->size;
+        pthread_mutex_unlock(&g_dvd.lock);
+    }
+    return queued;
+}
+
+void DVDPCPrefetchDrop(void) {
+    pthread_mutex_lock(&g_dvdq.lock);
+    g_dvdq.pre_head = g_dvdq.pre_tail;
+    pthread_mutex_unlock(&g_dvdq.lock);
+    pthread_mutex_lock(&g_dvd.lock);
+    for (s32 i = 0; i < g_dvd.count; i++) {
+        DVDEntry *e = &g_dvd.entries[i];
+        if (e->pre_state == DVD_PRE_NONE) continue;
+        /* A copy in progress sees the state change and frees its buffer */
+        free(e->pre);
+        e->pre = NULL;
+        e->pre_state = DVD_PRE_NONE;
+        g_dvd.pre_bytes -= e->size;
+    }
+    pthread_mutex_unlock(&g_dvd.lock);
+}
+
+/* Size and modification time (ns) of a file, for caches derived from it */
+BOOL DVDPCFileStamp(s32 entrynum, u32 *size, s64 *mtime) {
+    pthread_mutex_lock(&g_dvd.lock);
+    BOOL found = entrynum >= 0 && entrynum < g_dvd.count;
+    if (found) {
+        *size = g_dvd.entries[entrynum].size;
+        *mtime = g_dvd.entries[entrynum].mtime;
+    }
+    pthread_mutex_unlock(&g_dvd.lock);
+    return found;
+}
+
+u32 DVDPCPrefetchHits(void) {
+    pthread_mutex_lock(&g_dvd.lock);
+    u32 hits = g_dvd.pre_hits;
+    pthread_mutex_unlock(&g_dvd.lock);
+    return hits;
+}
+
+static void *dvd_worker(void *arg) {
+    int slot = (int)(intptr_t)arg;
+    pthread_mutex_lock(&g_dvdq.lock);
+    for (;;) {
+        DVDCommandBlock *b = NULL;
+        for (int i = 0; i < DVD_PRIO_COUNT && !b; i++) b = g_dvdq.waiting[i].head;
+        if (!b && g_dvdq.pre_head != g_dvdq.pre_tail) {
+            /* Prefetches only run when no game read is waiting */
+            s32 entrynum = g_dvdq.pre_queue[g_dvdq.pre_head++ % DVD_PRE_QUEUE];
+            pthread_mutex_unlock(&g_dvdq.lock);
+            dvd_prefetch_file(entrynum);
+            pthread_mutex_lock(&g_dvdq.lock);
+            continue;
+        }
+        if (!b) {
+            pthread_cond_wait(&g_dvdq.wake, &g_dvdq.lock);
+            continue;
+        }
+        dvd_queue_remove(dvd_queue_of(b), b);
+        g_dvdq.queued--;
+        g_dvdq.busy++;
+        g_dvdq.active[slot] = b;
+        b->state = DVD_STATE_BUSY;
+        pthread_mutex_unlock(&g_dvdq.lock);
+
+        /* Queued blocks all belong to a DVDFileInfo */
+        s32 n = dvd_read(((DVDFileInfo *)b)->startAddr, b->addr, (s32)b->length, (s32)b->offset);
+
+        pthread_mutex_lock(&g_dvdq.lock);
+        b->transferredSize = n > 0 ? (u32)n : 0;
+        g_dvdq.active[slot] = NULL;
+        g_dvdq.busy--;
+        dvd_queue_push(&g_dvdq.done, b);
+        pthread_cond_broadcast(&g_dvdq.idle);
+    }
+    return NULL;
+}
+
+static void dvd_start_workers(void) {
+    if (g_dvdq.nthreads) return;
+    const char *e = getenv("MP4_DVD_THREADS");
+    int n = (e && *e) ? atoi(e) : PC_DVD_THREADS;
+    if (n > DVD_MAX_THREADS) n = DVD_MAX_THREADS;
+    g_dvdq.main_thread = pthread_self();
+    for (int i = 0; i < n; i++) {
+        if (pthread_create(&g_dvdq.threads[i], NULL, dvd_worker, (void *)(intptr_t)i) != 0) break;
+        g_dvdq.nthreads++;
+    }
+    printf("[DVD] %d read thread(s)\n", g_dvdq.nthreads);
+}
+
+/* Runs the callbacks of finished blocks; main thread only */
+static void dvd_dispatch(void) {
+    if (g_dvdq.nthreads == 0 || !pthread_equal(pthread_self(), g_dvdq.main_thread)) return;
+    pthread_mutex_lock(&g_dvdq.lock);
+    if (g_inlog_time) {
+        while (g_dvdq.queued || g_dvdq.busy) pthread_cond_wait(&g_dvdq.idle, &g_dvdq.lock);
+    }
+    DVDCommandBlock *b;
+    while ((b = g_dvdq.done.head) != NULL) {
+        dvd_queue_remove(&g_dvdq.done, b);
+        b->state = DVD_STATE_END;
+        s32 result = b->transferredSize ? (s32)b->transferredSize : DVD_RESULT_FATAL_ERROR;
+        pthread_mutex_unlock(&g_dvdq.lock);
+        if (b->callback) b->callback(result, b);
+        pthread_mutex_lock(&g_dvdq.lock);
+    }
+    pthread_mutex_unlock(&g_dvdq.lock);
+}
+
+void DVDPCDispatch(void) {
+    dvd_dispatch();
+}
+
+/* cb.callback of queued reads: hands the result to the DVDFileInfo callback */
+static void dvd_read_done(s32 result, DVDCommandBlock *block) {
+    DVDFileInfo *fileInfo = (DVDFileInfo *)block;
+    if (fileInfo->callback) fileInfo->callback(result, fileInfo);
+}
 
 BOOL DVDReadAsyncPrio(DVDFileInfo *fileInfo, void *addr, s32 length, s32 offset,
                       DVDCallback callback, s32 prio) {
-    BOOL result = DVDReadPrio(fileInfo, addr, length, offset, prio);
-    if (callback) {
-        callback(result ? 0 : -1, fileInfo);
+    if (g_dvdq.nthreads == 0) {
+        /* No workers: read now and call back inline */
+        s32 n = dvd_read(fileInfo->startAddr, addr, length, offset);
+        fileInfo->cb.transferredSize = n > 0 ? (u32)n : 0;
+        fileInfo->cb.state = DVD_STATE_END;
+        if (callback) {
+            callback(n > 0 ? n : DVD_RESULT_FATAL_ERROR, fileInfo);
+        }
+        return n > 0;
     }
-    return result;
+    DVDCommandBlock *b = &fileInfo->cb;
+    if (prio < 0) prio = 0;
+    if (prio >= DVD_PRIO_COUNT) prio = DVD_PRIO_COUNT - 1;
+    fileInfo->callback = callback;
+    b->addr = addr;
+    b->length = (u32)length;
+    b->offset = (u32)offset;
+    b->transferredSize = 0;
+    b->callback = dvd_read_done;
+    pthread_mutex_lock(&g_dvdq.lock);
+    b->state = DVD_STATE_WAITING;
+    dvd_queue_push(&g_dvdq.waiting[prio], b);
+    g_dvdq.queued++;
+    pthread_cond_signal(&g_dvdq.wake);
+    pthread_mutex_unlock(&g_dvdq.lock);
+    return TRUE;
 }
 
 s32 DVDConvertPathToEntrynum(char *path) {
-    for (int i = 0; i < g_fst_count; i++) {
-        if (strcmp(g_fst[i].path, path) == 0) {
-            return g_fst[i].entrynum;
-        }
+    const char *rel = dvd_rel_path(path);
+    pthread_mutex_lock(&g_dvd.lock);
+    s32 entrynum = dvd_lookup(rel);
+    if (entrynum < 0) {
+        /* Not seen by DVDInit */
+        char full[1024];
+        struct stat st;
+        snprintf(full, sizeof(full), "%s%s", g_data_path, rel);
+        if (stat(full, &st) == 0 && S_ISREG(st.st_mode)) entrynum = dvd_add(rel, (u32)st.st_size, dvd_mtime(&st));
     }
+    pthread_mutex_unlock(&g_dvd.lock);
+    return entrynum;
+}
 
-    /* Try opening the file to register it */
-    DVDFileInfo fi;
-    if (DVDOpen(path, &fi)) {
-        return g_fst_count - 1;
+/* As in the SDK, a canceled block's callback gets DVD_RESULT_CANCELED */
+s32 DVDCancel(DVDCommandBlock *block) {
+    pthread_mutex_lock(&g_dvdq.lock);
+    /* A read in progress cannot be stopped; let it land first */
+    while (dvd_is_active(block)) pthread_cond_wait(&g_dvdq.idle, &g_dvdq.lock);
+    DVDQueue *q = dvd_queue_of(block);
+    if (!q) {
+        pthread_mutex_unlock(&g_dvdq.lock);
+        return 0;
     }
+    if (q != &g_dvdq.done) g_dvdq.queued--;
+    dvd_queue_remove(q, block);
+    block->state = DVD_STATE_CANCELED;
+    pthread_mutex_unlock(&g_dvdq.lock);
+    if (block->callback) block->callback(DVD_RESULT_CANCELED, block);
+    return 0;
+}
 
-    return -1;
+BOOL DVDCancelAsync(DVDCommandBlock *block, DVDCBCallback callback) {
+    DVDCancel(block);
+    if (callback) callback(0, block);
+    return TRUE;
+}
+
+s32 DVDCancelAll(void) {
+    for (;;) {
+        DVDCommandBlock *b = NULL;
+        pthread_mutex_lock(&g_dvdq.lock);
+        for (int i = 0; i < DVD_PRIO_COUNT && !b; i++) b = g_dvdq.waiting[i].head;
+        for (int i = 0; i < g_dvdq.nthreads && !b; i++) b = g_dvdq.active[i];
+        if (!b) b = g_dvdq.done.head;
+        pthread_mutex_unlock(&g_dvdq.lock);
+        if (!b) return 0;
+        DVDCancel(b);
+    }
+}
+
+BOOL DVDCancelAllAsync(DVDCBCallback callback) {
+    DVDCancelAll();
+    if (callback) callback(0, NULL);
+    return TRUE;
+}
+
+s32 DVDGetCommandBlockStatus(const DVDCommandBlock *block) {
+    dvd_dispatch();
+    pthread_mutex_lock(&g_dvdq.lock);
+    s32 state = block->state;
+    pthread_mutex_unlock(&g_dvdq.lock);
+    /* Canceled blocks read as idle, as in the SDK */
+    return state == DVD_STATE_CANCELED ? DVD_STATE_END : state;
+}
+
+s32 DVDGetDriveStatus(void) {
+    dvd_dispatch();
+    pthread_mutex_lock(&g_dvdq.lock);
+    int busy = g_dvdq.queued || g_dvdq.busy || g_dvdq.done.head;
+    pthread_mutex_unlock(&g_dvdq.lock);
+    return busy ? DVD_STATE_BUSY : DVD_STATE_END;
 }
 
-s32 DVDCancel(DVDCommandBlock *block) { (void)block; return 0; }
-BOOL DVDCancelAsync(DVDCommandBlock *block, DVDCBCallback callback) { (void)block; (void)callback; return TRUE; }
-s32 DVDCancelAll(void) { return 0; }
-BOOL DVDCancelAllAsync(DVDCBCallback callback) { (void)callback; return TRUE; }
-s32 DVDGetCommandBlockStatus(const DVDCommandBlock *block) { (void)block; return DVD_STATE_END; }
-s32 DVDGetDriveStatus(void) { return DVD_STATE_END; }
 BOOL DVDSetAutoFatalMessaging(BOOL enable) { (void)enable; return TRUE; }
 void DVDReset(void) {}
 int DVDSetAutoInvalidation(int autoInval) { (void)autoInval; return 0; }
@@ -152,7 +705,7 @@ BOOL DVDGetStreamPlayAddrAsync(DVDCommandBlock *block, DVDCBCallback callback) {
     (void)block; (void)callback; return TRUE;
 }
 s32 DVDGetStreamPlayAddr(DVDCommandBlock *block) { (void)block; return 0; }
-u32 DVDGetTransferredSize(DVDFileInfo *fInfo) { (void)fInfo; return 0; }
+u32 DVDGetTransferredSize(DVDFileInfo *fInfo) { return fInfo->cb.transferredSize; }
 
 /* Dir stubs */
 BOOL DVDOpenDir(const char *path, DVDDir *dir) { (void)path; (void)dir; return FALSE; }
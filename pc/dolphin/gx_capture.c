@@ -0,0 +1,500 @@
+/*
+ * GX command-stream capture — see gx_capture.h for the trace format.
+ *
+ * Recording can start mid-game. From GXInit on, the last call of every
+ * state op (per slot: matrix id, TEV stage, texmap, ...) is kept in a
+ * shadow table; when recording starts, the shadow is written out in call
+ * order, which rebuilds the same GX state in the replay. Referenced
+ * memory is written when it is consumed: vertex arrays for the indices a
+ * draw or display list actually uses, textures and TLUTs at load. Each
+ * address is re-sent only when its bytes change. Vertex calls between
+ * GXBegin and GXEnd are buffered so the arrays they index can be written
+ * ahead of them.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dolphin/types.h"
+#include "dolphin/gx.h"
+#include "pc_config.h"
+#include "dolphin/gx_state.h"
+#include "dolphin/gx_capture.h"
+
+int g_gxcap_on;
+
+/* Open-addressed u64 -> u32 map; key 0 marks an empty slot */
+typedef struct {
+    u64 *keys;
+    u32 *vals;
+    u32 cap, count;
+} GXCapMap;
+
+typedef struct {
+    u32 seq;
+    u32 slot;
+    u8 op;
+    u32 len;
+    u8 *data;
+} GXCapShadow;
+
+typedef struct {
+    u64 hash;
+    u32 size;
+} GXCapMem;
+
+/* Display list already defined in the trace, with the array ranges it
+ * indexes: max index per POS/NRM/CLR0/TEX0 and the vertex formats used */
+typedef struct {
+    u64 hash;           /* of the DLEntry array */
+    u32 count;
+    s32 max_index[4];
+    u32 fmts;
+} GXCapList;
+
+static const u8 g_cap_list_attrs[4] = { GX_VA_POS, GX_VA_NRM, GX_VA_CLR0, GX_VA_TEX0 };
+
+static struct {
+    FILE *f;
+    char path[512];
+    int recording;
+    u32 start_frame, frames;
+    u32 frame;          /* frames shown before recording started */
+    u32 frames_done;
+    u64 bytes;
+    u32 draws;
+
+    GXCapMap shadow_map;
+    GXCapShadow *shadow;
+    u32 shadow_count, shadow_cap;
+    u32 seq;
+
+    int in_batch;
+    u8 *batch;
+    u32 batch_len, batch_cap;
+    s32 max_index[GX_VA_MAX_ATTR];
+
+    GXCapMap mem_map;
+    GXCapMem *mem;
+    u32 mem_count, mem_cap;
+
+    GXCapMap list_map;
+    GXCapList *lists;
+    u32 list_count, list_cap;
+} g_cap;
+
+static void cap_out_of_memory(void) {
+    fprintf(stderr, "[GX] capture: out of memory\n");
+    abort();
+}
+
+static void *cap_grow(void *p, u32 *cap, u32 need, size_t elem) {
+    if (need <= *cap) return p;
+    u32 n = *cap ? *cap : 64;
+    while (n < need) n *= 2;
+    p = realloc(p, n * elem);
+    if (!p) cap_out_of_memory();
+    *cap = n;
+    return p;
+}
+
+/* ================================================================
+ * Map
+ * ================================================================ */
+static u32 cap_map_hash(u64 key, u32 cap) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    return (u32)key & (cap - 1);
+}
+
+static void cap_map_put(GXCapMap *m, u64 key, u32 val);
+
+static void cap_map_rehash(GXCapMap *m) {
+    u64 *keys = m->keys;
+    u32 *vals = m->vals;
+    u32 old = m->cap;
+    m->cap = old ? old * 2 : 256;
+    m->keys = (u64 *)calloc(m->cap, sizeof(u64));
+    m->vals = (u32 *)malloc(m->cap * sizeof(u32));
+    if (!m->keys || !m->vals) cap_out_of_memory();
+    m->count = 0;
+    for (u32 i = 0; i < old; i++) {
+        if (keys[i]) cap_map_put(m, keys[i], vals[i]);
+    }
+    free(keys);
+    free(vals);
+}
+
+static u32 *cap_map_get(const GXCapMap *m, u64 key) {
+    if (!m->cap) return NULL;
+    for (u32 i = cap_map_hash(key, m->cap);; i = (i + 1) & (m->cap - 1)) {
+        if (m->keys[i] == key) return &m->vals[i];
+        if (!m->keys[i]) return NULL;
+    }
+}
+
+static void cap_map_put(GXCapMap *m, u64 key, u32 val) {
+    if ((m->count + 1) * 2 > m->cap) cap_map_rehash(m);
+    u32 i = cap_map_hash(key, m->cap);
+    while (m->keys[i] && m->keys[i] != key) i = (i + 1) & (m->cap - 1);
+    if (!m->keys[i]) m->count++;
+    m->keys[i] = key;
+    m->vals[i] = val;
+}
+
+static void cap_map_free(GXCapMap *m) {
+    free(m->keys);
+    free(m->vals);
+    memset(m, 0, sizeof(*m));
+}
+
+/* ================================================================
+ * Output
+ * ================================================================ */
+static void cap_write(const void *p, u32 len) {
+    if (g_cap.in_batch) {
+        g_cap.batch = (u8 *)cap_grow(g_cap.batch, &g_cap.batch_cap, g_cap.batch_len + len, 1);
+        memcpy(g_cap.batch + g_cap.batch_len, p, len);
+        g_cap.batch_len += len;
+        return;
+    }
+    fwrite(p, 1, len, g_cap.f);
+    g_cap.bytes += len;
+}
+
+static void cap_emit2(u8 op, const void *a, u32 alen, const void *b, u32 blen) {
+    u32 len = alen + blen;
+    u8 head[6] = { op, (u8)(len < 255 ? len : 255) };
+    if (len < 255) {
+        cap_write(head, 2);
+    } else {
+        memcpy(head + 2, &len, 4);
+        cap_write(head, 6);
+    }
+    if (alen) cap_write(a, alen);
+    if (blen) cap_write(b, blen);
+}
+
+/* Write the bytes at ptr unless the trace already holds them */
+static void cap_mem(const void *ptr, u32 size) {
+    if (!ptr || !size) return;
+    u64 addr = (u64)(uintptr_t)ptr;
+    u64 hash = gx_hash64(ptr, size, 0);
+    u32 *idx = cap_map_get(&g_cap.mem_map, addr);
+    if (idx) {
+        GXCapMem *m = &g_cap.mem[*idx];
+        if (m->size == size && m->hash == hash) return;
+        m->size = size;
+        m->hash = hash;
+    } else {
+        g_cap.mem = (GXCapMem *)cap_grow(g_cap.mem, &g_cap.mem_cap, g_cap.mem_count + 1, sizeof(GXCapMem));
+        g_cap.mem[g_cap.mem_count].size = size;
+        g_cap.mem[g_cap.mem_count].hash = hash;
+        cap_map_put(&g_cap.mem_map, addr, g_cap.mem_count++);
+    }
+    u32 head[2] = { (u32)addr, (u32)(addr >> 32) };
+    int in_batch = g_cap.in_batch;
+    g_cap.in_batch = 0;
+    cap_emit2(GXCAP_MEM, head, sizeof(head), ptr, size);
+    g_cap.in_batch = in_batch;
+}
+
+/* Bytes of one array element as the current vertex format reads it */
+static u32 cap_elem_size(u32 fmt, u32 attr) {
+    static const u8 comp_bytes[] = { 1, 1, 2, 2, 4 };     /* GXCompType */
+    static const u8 clr_bytes[] = { 2, 3, 4, 2, 3, 4 };   /* GX_RGB565..GX_RGBA8 */
+    const GXVtxAttrFmtEntry *f = &g_gx.vtx_attr_fmt[fmt][attr];
+    u32 comp = (u32)f->type <= GX_F32 ? comp_bytes[f->type] : 4;
+    switch (attr) {
+        case GX_VA_POS:  return (f->cnt == GX_POS_XY ? 2 : 3) * comp;
+        case GX_VA_NRM:  return (f->cnt == GX_NRM_XYZ ? 3 : 9) * comp;
+        case GX_VA_CLR0:
+        case GX_VA_CLR1: return (u32)f->type <= GX_RGBA8 ? clr_bytes[f->type] : 4;
+        default:         return (f->cnt == GX_TEX_S ? 1 : 2) * comp;
+    }
+}
+
+/* Write the part of attr's array that indices up to max_index reach */
+static void cap_array_mem(u32 attr, s32 max_index, u32 fmts) {
+    const GXVtxArray *arr = &g_gx.vtx_arrays[attr];
+    if (max_index < 0 || !arr->data) return;
+    u32 elem = 0;
+    for (u32 fmt = 0; fmt < GX_MAX_VTXFMT; fmt++) {
+        if (fmts & (1u << fmt)) {
+            u32 e = cap_elem_size(fmt, attr);
+            if (e > elem) elem = e;
+        }
+    }
+    cap_mem(arr->data, (u32)max_index * arr->stride + elem);
+}
+
+/* ================================================================
+ * Shadow state
+ * ================================================================ */
+static void cap_shadow_set(u8 op, u32 slot, const void *payload, u32 len) {
+    u64 key = ((u64)(op + 1) << 32) | slot;
+    u32 *idx = cap_map_get(&g_cap.shadow_map, key);
+    GXCapShadow *s;
+    if (idx) {
+        s = &g_cap.shadow[*idx];
+    } else {
+        g_cap.shadow = (GXCapShadow *)cap_grow(g_cap.shadow, &g_cap.shadow_cap, g_cap.shadow_count + 1,
+                                               sizeof(GXCapShadow));
+        s = &g_cap.shadow[g_cap.shadow_count];
+        memset(s, 0, sizeof(*s));
+        s->op = op;
+        s->slot = slot;
+        cap_map_put(&g_cap.shadow_map, key, g_cap.shadow_count++);
+    }
+    if (len > s->len || !s->data) {
+        s->data = (u8 *)realloc(s->data, len ? len : 1);
+        if (!s->data) cap_out_of_memory();
+    }
+    memcpy(s->data, payload, len);
+    s->len = len;
+    s->seq = g_cap.seq++;
+}
+
+static int cap_shadow_cmp(const void *a, const void *b) {
+    u32 sa = ((const GXCapShadow *)a)->seq, sb = ((const GXCapShadow *)b)->seq;
+    return sa < sb ? -1 : sa > sb;
+}
+
+/* Memory a state record refers to, written ahead of it */
+static void cap_state_mem(u8 op, const u32 *w) {
+    if (op == GXCAP_LOAD_TEX_OBJ) {
+        cap_mem((const void *)(uintptr_t)(w[2] | ((u64)w[3] << 32)), w[1]);
+    } else if (op == GXCAP_LOAD_TLUT) {
+        cap_mem((const void *)(uintptr_t)(w[1] | ((u64)w[2] << 32)), w[4] * 2);
+    }
+}
+
+static void cap_record(u8 op, u32 slot, const void *payload, u32 len) {
+    if (op < GXCAP_STATE_COUNT) cap_shadow_set(op, slot, payload, len);
+    if (!g_cap.recording) return;
+    cap_state_mem(op, (const u32 *)payload);
+    cap_emit2(op, payload, len, NULL, 0);
+}
+
+/* ================================================================
+ * Recording
+ * ================================================================ */
+static void cap_finish(void) {
+    if (!g_cap.f) return;
+    int err = ferror(g_cap.f);
+    err |= fclose(g_cap.f);
+    g_cap.f = NULL;
+    g_cap.recording = 0;
+    g_gxcap_on = 0;
+    printf("[GX] capture: %u frame(s), %u draws, %.1f MB written to %s%s\n", g_cap.frames_done,
+           g_cap.draws, g_cap.bytes / (1024.0 * 1024.0), g_cap.path, err ? " (write error)" : "");
+
+    for (u32 i = 0; i < g_cap.shadow_count; i++) free(g_cap.shadow[i].data);
+    free(g_cap.shadow);
+    free(g_cap.batch);
+    free(g_cap.mem);
+    free(g_cap.lists);
+    cap_map_free(&g_cap.shadow_map);
+    cap_map_free(&g_cap.mem_map);
+    cap_map_free(&g_cap.list_map);
+}
+
+static void cap_start(void) {
+    g_cap.f = fopen(g_cap.path, "wb");
+    if (!g_cap.f) {
+        fprintf(stderr, "[GX] capture: cannot open %s\n", g_cap.path);
+        g_gxcap_on = 0;
+        return;
+    }
+    setvbuf(g_cap.f, NULL, _IOFBF, 1 << 20);
+    g_cap.recording = 1;
+    atexit(cap_finish);
+
+    GXCapHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = GXCAP_MAGIC;
+    h.version = GXCAP_VERSION;
+    h.ptr_size = (u16)sizeof(void *);
+    h.texobj_size = sizeof(GXTexObj);
+    h.lightobj_size = sizeof(GXLightObj);
+    h.dlentry_size = sizeof(DLEntry);
+    h.start_frame = g_cap.frame;
+    fwrite(&h, sizeof(h), 1, g_cap.f);
+    g_cap.bytes = sizeof(h);
+
+    /* The state so far, oldest first so later calls win where they overlap */
+    qsort(g_cap.shadow, g_cap.shadow_count, sizeof(GXCapShadow), cap_shadow_cmp);
+    for (u32 i = 0; i < g_cap.shadow_count; i++) {
+        GXCapShadow *s = &g_cap.shadow[i];
+        cap_state_mem(s->op, (const u32 *)s->data);
+        cap_emit2(s->op, s->data, s->len, NULL, 0);
+    }
+    /* Sorting moved the entries; re-index them */
+    memset(g_cap.shadow_map.keys, 0, g_cap.shadow_map.cap * sizeof(u64));
+    g_cap.shadow_map.count = 0;
+    for (u32 i = 0; i < g_cap.shadow_count; i++) {
+        const GXCapShadow *s = &g_cap.shadow[i];
+        cap_map_put(&g_cap.shadow_map, ((u64)(s->op + 1) << 32) | s->slot, i);
+    }
+    printf("[GX] capture: recording %u frame(s) to %s\n", g_cap.frames, g_cap.path);
+}
+
+void gx_cap_init(void) {
+    const char *path = getenv("MP4_GX_CAPTURE");
+    if (!path || !*path || g_cap.recording) return;
+    snprintf(g_cap.path, sizeof(g_cap.path), "%s", path);
+    const char *e = getenv("MP4_GX_CAPTURE_START");
+    g_cap.start_frame = (e && *e) ? (u32)atoi(e) : PC_GX_CAPTURE_START;
+    e = getenv("MP4_GX_CAPTURE_FRAMES");
+    g_cap.frames = (e && *e) ? (u32)atoi(e) : PC_GX_CAPTURE_FRAMES;
+    if (g_cap.frames == 0) return;
+    for (int i = 0; i < GX_VA_MAX_ATTR; i++) g_cap.max_index[i] = -1;
+    g_gxcap_on = 1;
+    if (g_cap.start_frame == 0) cap_start();
+}
+
+/* ================================================================
+ * Entry points
+ * ================================================================ */
+static void cap_note_index(u32 attr, u32 index) {
+    if (!g_cap.in_batch) {
+        cap_array_mem(attr, (s32)index, 1u << g_gx.current_vtx_fmt);
+        return;
+    }
+    if ((s32)index > g_cap.max_index[attr]) g_cap.max_index[attr] = (s32)index;
+}
+
+/* GXEnd: write the arrays the batch indexed, then the batch itself */
+static void cap_batch_end(void) {
+    g_cap.in_batch = 0;
+    for (int attr = 0; attr < GX_VA_MAX_ATTR; attr++) {
+        if (g_cap.max_index[attr] < 0) continue;
+        cap_array_mem(attr, g_cap.max_index[attr], 1u << g_gx.current_vtx_fmt);
+        g_cap.max_index[attr] = -1;
+    }
+    cap_write(g_cap.batch, g_cap.batch_len);
+    g_cap.batch_len = 0;
+    g_cap.draws++;
+}
+
+void gx_cap_words(u8 op, u32 slot, const u32 *w, u32 n) {
+    if (op >= GXCAP_STATE_COUNT && !g_cap.recording) return;
+    switch (op) {
+        case GXCAP_BEGIN:
+            if (g_cap.in_batch) cap_batch_end();
+            g_cap.in_batch = 1;
+            break;
+        case GXCAP_POSITION1X16: cap_note_index(GX_VA_POS, w[0]); break;
+        case GXCAP_NORMAL1X16:   cap_note_index(GX_VA_NRM, w[0]); break;
+        case GXCAP_COLOR1X16:    cap_note_index(GX_VA_CLR0, w[0]); break;
+        case GXCAP_TEXCOORD1X16: cap_note_index(GX_VA_TEX0, w[0]); break;
+        default: break;
+    }
+    cap_record(op, slot, w, n * 4);
+    if (op == GXCAP_END && g_cap.in_batch) cap_batch_end();
+}
+
+void gx_cap_block(u8 op, u32 slot, const u32 *w, u32 n, const void *data, u32 size) {
+    u8 buf[512];
+    u32 len = n * 4 + size;
+    if (len > sizeof(buf)) {
+        fprintf(stderr, "[GX] capture: %u byte record for op %u\n", len, op);
+        abort();
+    }
+    memcpy(buf, w, n * 4);
+    memcpy(buf + n * 4, data, size);
+    cap_record(op, slot, buf, len);
+}
+
+void gx_cap_array(u32 attr, const void *base, u8 stride) {
+    u64 addr = (u64)(uintptr_t)base;
+    u32 w[4] = { attr, (u32)addr, (u32)(addr >> 32), stride };
+    cap_record(GXCAP_SET_ARRAY, attr, w, sizeof(w));
+}
+
+void gx_cap_tex_obj(u32 map, const void *obj, const void *image, u32 image_size) {
+    u64 addr = (u64)(uintptr_t)image;
+    u32 w[4] = { map, image_size, (u32)addr, (u32)(addr >> 32) };
+    gx_cap_block(GXCAP_LOAD_TEX_OBJ, map, w, 4, obj, sizeof(GXTexObj));
+}
+
+void gx_cap_tlut(u32 name, const void *lut, u32 fmt, u32 entries) {
+    u64 addr = (u64)(uintptr_t)lut;
+    u32 w[5] = { name, (u32)addr, (u32)(addr >> 32), fmt, entries };
+    cap_record(GXCAP_LOAD_TLUT, name, w, sizeof(w));
+}
+
+void gx_cap_submit(u32 fmt, const u16 *indices, u32 count, const u8 *attrs, u32 n) {
+    if (!g_cap.recording) return;
+    for (u32 i = 0; i < n; i++) {
+        u32 max = 0;
+        for (u32 v = 0; v < count; v++) {
+            if (indices[v * n + i] > max) max = indices[v * n + i];
+        }
+        if (count) cap_note_index(attrs[i], max);
+    }
+    u32 w[2] = { fmt, count };
+    cap_emit2(GXCAP_SUBMIT_VERTICES, w, sizeof(w), indices, count * n * (u32)sizeof(u16));
+}
+
+void gx_cap_call_dl(const void *list, const void *entries, u32 count) {
+    if (!g_cap.recording) return;
+    u64 addr = (u64)(uintptr_t)list;
+    u32 head[2] = { (u32)addr, (u32)(addr >> 32) };
+    u32 bytes = count * (u32)sizeof(DLEntry);
+    u64 hash = gx_hash64(entries, bytes, 0);
+
+    /* (Re)define the list the first time its commands are called */
+    u32 *idx = cap_map_get(&g_cap.list_map, addr);
+    GXCapList *l = idx ? &g_cap.lists[*idx] : NULL;
+    if (!l || l->hash != hash || l->count != count) {
+        if (!l) {
+            g_cap.lists = (GXCapList *)cap_grow(g_cap.lists, &g_cap.list_cap, g_cap.list_count + 1,
+                                                sizeof(GXCapList));
+            cap_map_put(&g_cap.list_map, addr, g_cap.list_count);
+            l = &g_cap.lists[g_cap.list_count++];
+        }
+        l->hash = hash;
+        l->count = count;
+        l->fmts = 0;
+        for (int s = 0; s < 4; s++) l->max_index[s] = -1;
+        const DLEntry *e = (const DLEntry *)entries;
+        for (u32 i = 0; i < count; i++, e++) {
+            int s;
+            switch (e->cmd) {
+                case DL_CMD_BEGIN:
+                    l->fmts |= 1u << (e->begin.fmt < GX_MAX_VTXFMT ? e->begin.fmt : GX_VTXFMT0);
+                    continue;
+                case DL_CMD_POSITION1X16: case DL_CMD_POSITION1X8: s = 0; break;
+                case DL_CMD_NORMAL1X16:   case DL_CMD_NORMAL1X8:   s = 1; break;
+                case DL_CMD_COLOR1X16:    case DL_CMD_COLOR1X8:    s = 2; break;
+                case DL_CMD_TEXCOORD1X16: case DL_CMD_TEXCOORD1X8: s = 3; break;
+                default: continue;
+            }
+            s32 index = (e->cmd >= DL_CMD_POSITION1X8) ? (u8)e->index : e->index;
+            if (index > l->max_index[s]) l->max_index[s] = index;
+        }
+        if (!l->fmts) l->fmts = 1u << GX_VTXFMT0;
+        cap_emit2(GXCAP_DL_DEFINE, head, sizeof(head), entries, bytes);
+    }
+    for (int s = 0; s < 4; s++) cap_array_mem(g_cap_list_attrs[s], l->max_index[s], l->fmts);
+    cap_emit2(GXCAP_CALL_DL, head, sizeof(head), NULL, 0);
+    g_cap.draws++;
+}
+
+/* GXCopyDisp, after the swap: image is the copy just shown */
+void gx_cap_frame_end(const u32 *image, u32 clear) {
+    if (!g_cap.recording) {
+        if (++g_cap.frame < g_cap.start_frame) return;
+        cap_start();
+        /* The first recorded frame draws over this copy's clear */
+        if (g_cap.recording) cap_emit2(GXCAP_COPY_DISP, &clear, sizeof(clear), NULL, 0);
+        return;
+    }
+    if (g_cap.in_batch) cap_batch_end();
+    u64 hash = gx_hash64(image, GX_FB_WIDTH * GX_FB_HEIGHT * sizeof(u32), 0);
+    u32 w[2] = { (u32)hash, (u32)(hash >> 32) };
+    cap_emit2(GXCAP_FRAME, w, sizeof(w), NULL, 0);
+    if (++g_cap.frames_done >= g_cap.frames) cap_finish();
+}
@@ -0,0 +1,152 @@
+#ifndef GX_CAPTURE_H
+#define GX_CAPTURE_H
+
+/*
+ * GX command-stream capture for offline replay (pc/bench/gx_replay.c).
+ *
+ * With MP4_GX_CAPTURE=<path> set, the GX entry points in gx_pc.c report
+ * each call here and a run of frames is written to a binary trace. The
+ * trace holds everything a replay needs without the game: the GX state as
+ * of the first recorded frame, every state and vertex call, the bytes of
+ * the vertex arrays, textures and TLUTs they reference, and the commands
+ * of each display list called.
+ *
+ * Capture is off unless the variable is set; every hook then costs one
+ * test of g_gxcap_on.
+ *
+ * Layout: a GXCapHeader, then records of
+ *   u8 op, u8 len[, u32 len if len == 255], len payload bytes
+ * in host byte order. Payloads are 32-bit words (floats as bit patterns)
+ * unless noted at the op. Memory is identified by its address in the
+ * capturing process: a GXCAP_MEM record carries the bytes at an address,
+ * and later records naming that address refer to them. A GXCAP_FRAME
+ * record follows every GXCAP_COPY_DISP with a hash of the displayed
+ * image, for replay to check against.
+ */
+
+#include "dolphin/types.h"
+#include "dolphin/gx/GXStruct.h"
+
+#include <string.h>
+
+#define GXCAP_MAGIC   0x52545847u /* "GXTR" */
+#define GXCAP_VERSION 1
+
+typedef struct {
+    u32 magic;
+    u16 version;
+    u16 ptr_size;       /* traces replay only on the same host ABI */
+    u32 texobj_size;    /* sizeof(GXTexObj) */
+    u32 lightobj_size;  /* sizeof(GXLightObj) */
+    u32 dlentry_size;   /* sizeof(DLEntry) */
+    u32 start_frame;    /* frames the game had shown before recording */
+} GXCapHeader;
+
+typedef enum {
+    /* State: w[] are the call's arguments in order */
+    GXCAP_SET_PROJECTION,     /* type, 16 floats */
+    GXCAP_LOAD_POS_MTX,       /* id, 12 floats */
+    GXCAP_LOAD_NRM_MTX,       /* id, 12 floats */
+    GXCAP_LOAD_TEX_MTX,       /* id, type, 8 or 12 floats */
+    GXCAP_SET_CURRENT_MTX,
+    GXCAP_SET_VIEWPORT,
+    GXCAP_SET_SCISSOR,
+    GXCAP_SET_VTX_DESC,
+    GXCAP_SET_VTX_DESCV,      /* attr, type pairs */
+    GXCAP_CLEAR_VTX_DESC,
+    GXCAP_SET_VTX_ATTR_FMT,
+    GXCAP_SET_ARRAY,          /* attr, address lo, address hi, stride */
+    GXCAP_SET_NUM_TEX_GENS,
+    GXCAP_SET_NUM_CHANS,
+    GXCAP_SET_CHAN_CTRL,
+    GXCAP_SET_CHAN_AMB_COLOR, /* chan, GXColor as bytes */
+    GXCAP_SET_CHAN_MAT_COLOR,
+    GXCAP_LOAD_LIGHT,         /* light, GXLightObj bytes */
+    GXCAP_SET_TEV_COLOR_IN,
+    GXCAP_SET_TEV_ALPHA_IN,
+    GXCAP_SET_TEV_COLOR_OP,
+    GXCAP_SET_TEV_ALPHA_OP,
+    GXCAP_SET_TEV_COLOR,      /* id, GXColor as bytes */
+    GXCAP_SET_TEV_COLOR_S10,  /* id, GXColorS10 as bytes */
+    GXCAP_SET_TEV_KCOLOR,     /* id, GXColor as bytes */
+    GXCAP_SET_TEV_KCOLOR_SEL,
+    GXCAP_SET_TEV_KALPHA_SEL,
+    GXCAP_SET_TEV_SWAP_MODE,
+    GXCAP_SET_TEV_SWAP_TABLE,
+    GXCAP_SET_ALPHA_COMPARE,
+    GXCAP_SET_TEV_ORDER,
+    GXCAP_SET_NUM_TEV_STAGES,
+    GXCAP_SET_NUM_IND_STAGES,
+    GXCAP_LOAD_TEX_OBJ,       /* map, source bytes, address lo, hi, GXTexObj bytes */
+    GXCAP_LOAD_TLUT,          /* name, address lo, hi, fmt, entries */
+    GXCAP_SET_FOG,            /* type, 4 floats, GXColor as bytes */
+    GXCAP_SET_FOG_COLOR,      /* GXColor as bytes */
+    GXCAP_SET_BLEND_MODE,
+    GXCAP_SET_COLOR_UPDATE,
+    GXCAP_SET_ALPHA_UPDATE,
+    GXCAP_SET_Z_MODE,
+    GXCAP_SET_CULL_MODE,
+    GXCAP_SET_COPY_CLEAR,     /* GXColor as bytes, z */
+    GXCAP_STATE_COUNT,
+
+    /* Stream */
+    GXCAP_BEGIN = GXCAP_STATE_COUNT,
+    GXCAP_END,
+    GXCAP_POSITION3F32,
+    GXCAP_POSITION1X16,
+    GXCAP_NORMAL3F32,
+    GXCAP_NORMAL1X16,
+    GXCAP_COLOR4U8,           /* 0xRRGGBBAA */
+    GXCAP_COLOR1X16,
+    GXCAP_COLOR4F32,
+    GXCAP_TEXCOORD2F32,
+    GXCAP_TEXCOORD1X16,
+    GXCAP_SUBMIT_VERTICES,    /* fmt, count, u16 indices */
+    GXCAP_INVALIDATE_TEX_ALL,
+    GXCAP_DL_DEFINE,          /* address lo, hi, DLEntry array */
+    GXCAP_CALL_DL,            /* address lo, hi */
+    GXCAP_MEM,                /* address lo, hi, bytes */
+    GXCAP_COPY_DISP,          /* clear */
+    GXCAP_FRAME,              /* image hash lo, hi */
+    GXCAP_OP_COUNT
+} GXCapOp;
+
+/* Nonzero while the entry points should report calls */
+extern int g_gxcap_on;
+
+void gx_cap_init(void);
+void gx_cap_words(u8 op, u32 slot, const u32 *w, u32 n);
+void gx_cap_block(u8 op, u32 slot, const u32 *w, u32 n, const void *data, u32 size);
+void gx_cap_array(u32 attr, const void *base, u8 stride);
+void gx_cap_tex_obj(u32 map, const void *obj, const void *image, u32 image_size);
+void gx_cap_tlut(u32 name, const void *lut, u32 fmt, u32 entries);
+void gx_cap_submit(u32 fmt, const u16 *indices, u32 count, const u8 *attrs, u32 n);
+void gx_cap_call_dl(const void *list, const void *entries, u32 count);
+void gx_cap_frame_end(const u32 *image, u32 clear);
+
+static inline u32 gx_cap_f(f32 f) {
+    u32 u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline u32 gx_cap_color(GXColor c) {
+    u32 u;
+    memcpy(&u, &c, sizeof(u));
+    return u;
+}
+
+#define GX_CAP(op, slot, ...)                                                \
+    do {                                                                     \
+        if (g_gxcap_on) {                                                    \
+            const u32 cap_w_[] = { __VA_ARGS__ };                            \
+            gx_cap_words((op), (slot), cap_w_, sizeof(cap_w_) / sizeof(u32)); \
+        }                                                                    \
+    } while (0)
+
+#define GX_CAP0(op)                                                          \
+    do {                                                                     \
+        if (g_gxcap_on) gx_cap_words((op), 0, NULL, 0);                      \
+    } while (0)
+
+#endif /* GX_CAPTURE_H */
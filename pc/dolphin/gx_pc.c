@@ -9,17 +9,22 @@
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include <time.h>
 
 #include "dolphin/types.h"
 #include "dolphin/gx.h"
 #include "pc_config.h"
+#include "pc_jobs.h"
 #include "dolphin/gx_state.h"
+#include "dolphin/gx_simd.h"
+#include "dolphin/gx_texdecode.h"
+#include "dolphin/gx_capture.h"
 
 /* Global GX state */
 GXState g_gx;
 
-/* Alias for vi_pc.c to access the framebuffer */
-u32 g_gx_framebuffer[GX_FB_WIDTH * GX_FB_HEIGHT];
+/* Display copy of the framebuffer as of the last GXCopyDisp */
+u32 *g_gx_framebuffer;
 
 /* GX FIFO object (opaque on GC, we just need something to return) */
 static GXFifoObj g_fifo_obj;
@@ -29,6 +34,10 @@ static int g_gx_dl_call_count = 0;
 static int g_gx_dl_fail_null = 0;
 static int g_gx_dl_fail_magic = 0;
 static int g_gx_dl_ok = 0;
+static int g_gx_dl_decodes = 0;  /* compiled lists (re)decoded */
+
+/* Compile display lists at GXEndDisplayList (PC_DL_COMPILE) */
+static int g_gx_dl_compile = 1;
 
 /* ---- Internal: PC-side texture object layout ----
  * GXTexObj has 22 u32 on PC. We overlay our own fields. */
@@ -40,7 +49,14 @@ typedef struct {
     u32 wrap_s;           /* 16: GXTexWrapMode */
     u32 wrap_t;           /* 20: GXTexWrapMode */
     u32 mipmap;           /* 24 */
-    u32 _pad[14];         /* fill to 22*4 = 88 bytes */
+    u32 tlut_name;        /* 28: TLUT slot for CI formats */
+    u8 min_filter;        /* 32: GXTexFilter */
+    u8 mag_filter;        /* 33 */
+    u16 _pad0;
+    f32 min_lod;          /* 36 */
+    f32 max_lod;          /* 40 */
+    f32 lod_bias;         /* 44 */
+    u32 _pad[10];         /* fill to 22*4 = 88 bytes */
 } GXTexObjPC;
 
 _Static_assert(sizeof(GXTexObjPC) == sizeof(GXTexObj), "GXTexObjPC size mismatch");
@@ -49,240 +65,825 @@ _Static_assert(sizeof(GXTexObjPC) == sizeof(GXTexObj), "GXTexObjPC size mismatch
  * Forward declarations for rasterizer
  * ================================================================ */
 static void rasterize_primitives(void);
-static void rasterize_triangle(GXSWVertex *v0, GXSWVertex *v1, GXSWVertex *v2);
-static void transform_vertex(GXSWVertex *in, float *out_screen, float *out_w);
+static void raster_init(void);
+static void fb_init(void);
+static void transform_vertex(const GXSWVertex *in, GXXfVertex *out);
 static void dl_record(DLEntry *entry);
+static void dl_capture_primitives(const GXSWVertex *vb, u32 nverts, const u32 *tris, u32 ntris);
+
+/* Set while a display list is being compiled: assembled primitives go to
+ * the compiler instead of the rasterizer */
+static int g_dl_capturing;
+
+/* ================================================================
+ * Performance counter state
+ *
+ * Read through the SDK metric calls (see "Performance counters" below).
+ * Geometry and texture cache counts are kept on the submitting thread.
+ * Pixel-stage counts go through t_gxperf_pix, which tile jobs point at
+ * their bin's block, and are summed at gx_raster_flush(), so worker
+ * threads never share a counter.
+ * ================================================================ */
+typedef struct {
+    u32 quads[5];    /* shaded 2x2 quads by covered lanes */
+    u32 passed;      /* fragments passing the depth test */
+    u32 blended;     /* fragments blended with the color buffer */
+    u32 texels;      /* texels fetched by the samplers */
+} GXPerfPix;
+
+static struct {
+    GXPerf0 perf0;
+    GXPerf1 perf1;
+    u64 gp_start_ns;     /* GXClearGPMetric time, for the CLOCKS metrics */
+    u32 vertices;        /* transformed */
+    u32 clip_vtx;        /* emitted by the clipper */
+    u32 tris;            /* entering setup */
+    u32 tris_culled;     /* facing or zero area */
+    u32 tris_scissored;  /* nothing left inside the scissor */
+    u32 tris_passed;     /* rasterized */
+    u32 tris_tex[9];     /* by texgen count */
+    u32 tris_clr[3];     /* by color channel count */
+    u32 fifo_req;        /* immediate-mode batches */
+    u32 call_req;        /* display list calls */
+    u32 vc_check;        /* vertex references */
+    u32 vc_miss;         /* distinct vertices fetched */
+    u32 tc_check;        /* texture cache lookups */
+    u32 tc_miss;         /* lookups that decoded */
+    u32 tc_lines;        /* 32-byte lines of texture data read */
+    u32 written;         /* color buffer writes */
+    u32 clear_pixels;    /* pixels cleared by copies */
+    u32 copy_pixels;     /* pixels copied out */
+    GXPerfPix pix;       /* flushed pixel-stage counts */
+} g_gxperf = { .perf0 = GX_PERF0_NONE, .perf1 = GX_PERF1_NONE };
+
+static _Thread_local GXPerfPix *t_gxperf_pix = &g_gxperf.pix;
+
+/* ================================================================
+ * TLUT memory
+ *
+ * Modeled as 16 slots, one per GX_TLUT0..15 name. GXLoadTlut expands the
+ * palette to RGBA8 once per distinct content and points the slot at it, as
+ * the hardware snapshots the TLUT into TMEM. Expanded palettes are never
+ * modified, so binned triangles can keep sampling an old one after the
+ * slot moves on. GX_TF_C4/C8 textures stay indexed in the texture cache
+ * and go through the slot colors at sample time: an animated palette
+ * costs one small expansion instead of a re-decode of every texture using
+ * it. C14X2 (and C4/C8 when PC_TEX_CI_INDEXED is 0) expand into RGBA8
+ * cache entries keyed by the palette hash as well as the index data.
+ * ================================================================ */
+#define TLUT_SLOTS      16
+#define TLUT_BUCKETS    256
+#define TLUT_MIN_COLORS 256   /* every C8 index is addressable */
+#define TLUT_CACHE_MAX  1024  /* expanded palettes kept before unused ones are dropped */
+
+typedef struct GXTlutPalette {
+    u64 hash;         /* TLUT bytes, format and entry count */
+    u32 n;            /* entries loaded */
+    u32 *colors;      /* max(n, TLUT_MIN_COLORS) colors, transparent black past n */
+    struct GXTlutPalette *next;
+} GXTlutPalette;
+
+/* Layout of GXTlutObj on PC */
+typedef struct {
+    const void *lut;
+    u32 fmt;          /* GXTlutFmt */
+    u16 n_entries;
+} GXTlutObjPC;
+
+_Static_assert(sizeof(GXTlutObjPC) <= sizeof(GXTlutObj), "GXTlutObjPC size mismatch");
+
+static u32 g_tlut_black[TLUT_MIN_COLORS];
+static GXTlutPalette g_tlut_empty = { 0, 0, g_tlut_black, NULL };
+
+static struct {
+    GXTlutPalette *slots[TLUT_SLOTS];
+    GXTlutPalette *buckets[TLUT_BUCKETS];
+    u32 count;
+    int indexed;      /* keep C4/C8 indexed (PC_TEX_CI_INDEXED) */
+} g_tlut = { .indexed = PC_TEX_CI_INDEXED };
+
+static inline int tex_fmt_is_ci(u32 fmt) {
+    return fmt == GX_TF_C4 || fmt == GX_TF_C8 || fmt == GX_TF_C14X2;
+}
+
+static inline int tex_fmt_indexed(u32 fmt) {
+    return g_tlut.indexed && (fmt == GX_TF_C4 || fmt == GX_TF_C8);
+}
+
+/* Palette loaded in a slot, or NULL for names outside GX_TLUT0..15 */
+static const GXTlutPalette *tlut_slot(u32 name) {
+    if (name >= TLUT_SLOTS) return NULL;
+    return g_tlut.slots[name] ? g_tlut.slots[name] : &g_tlut_empty;
+}
+
+/* Drop every expanded palette no slot currently holds */
+static void tlut_cache_trim(void) {
+    gx_raster_flush(); /* binned triangles may still sample any palette */
+    for (int b = 0; b < TLUT_BUCKETS; b++) {
+        GXTlutPalette **pp = &g_tlut.buckets[b];
+        while (*pp) {
+            GXTlutPalette *p = *pp;
+            int held = 0;
+            for (int i = 0; i < TLUT_SLOTS; i++) held |= g_tlut.slots[i] == p;
+            if (held) { pp = &p->next; continue; }
+            *pp = p->next;
+            free(p->colors);
+            free(p);
+            g_tlut.count--;
+        }
+    }
+}
+
+static GXTlutPalette *tlut_palette_get(const void *lut, u32 fmt, u32 n) {
+    u64 hash = gx_hash64(lut, n * 2, ((u64)n << 32) | fmt);
+    GXTlutPalette **bucket = &g_tlut.buckets[hash & (TLUT_BUCKETS - 1)];
+    for (GXTlutPalette *p = *bucket; p; p = p->next) {
+        if (p->hash == hash && p->n == n) return p;
+    }
+    if (g_tlut.count >= TLUT_CACHE_MAX) tlut_cache_trim();
+
+    u32 cap = n > TLUT_MIN_COLORS ? n : TLUT_MIN_COLORS;
+    GXTlutPalette *p = (GXTlutPalette *)malloc(sizeof(GXTlutPalette));
+    u32 *colors = (u32 *)calloc(cap, sizeof(u32));
+    if (!p || !colors) {
+        fprintf(stderr, "[GX] out of memory expanding a %u-entry TLUT\n", n);
+        abort();
+    }
+    gx_tex_decode_tlut(fmt, lut, colors, n);
+    p->hash = hash;
+    p->n = n;
+    p->colors = colors;
+    p->next = *bucket;
+    *bucket = p;
+    g_tlut.count++;
+    return p;
+}
 
 /* ================================================================
  * Texture decoding
+ *
+ * The format decoders live in gx_texdecode.c. Decoded levels go into
+ * 64-byte aligned buffers from a pool of power-of-two size classes, so
+ * evicting one texture and decoding the next reuses the same memory
+ * instead of round-tripping through the allocator. Up to PC_TEXPOOL_BYTES
+ * of released buffers are held; the free-list link lives in the buffer.
  * ================================================================ */
-static void gc_rgba8_decode(const u8 *src, u32 *dst, int w, int h) {
-    for (int ty = 0; ty < h; ty += 4) {
-        for (int tx = 0; tx < w; tx += 4) {
-            const u8 *ar = src;
-            const u8 *gb = src + 32;
-            for (int y = 0; y < 4; y++) {
-                for (int x = 0; x < 4; x++) {
-                    int px = tx + x, py = ty + y;
-                    if (px < w && py < h) {
-                        u8 a = *ar++; u8 r = *ar++;
-                        u8 g = *gb++; u8 b = *gb++;
-                        dst[py * w + px] = (r << 24) | (g << 16) | (b << 8) | a;
-                    } else { ar += 2; gb += 2; }
+#define TEXPOOL_MIN_SHIFT 8   /* smallest class: 256 bytes */
+#define TEXPOOL_CLASSES   16  /* largest class: 8MB, a 1024x2048 level */
+
+static struct {
+    void *free[TEXPOOL_CLASSES];
+    u32 held;   /* bytes sitting on the free lists */
+    u32 limit;
+    u32 reuses;
+} g_texpool = { .limit = PC_TEXPOOL_BYTES };
+
+static inline u32 texpool_class_bytes(int c) {
+    return 1u << (c + TEXPOOL_MIN_SHIFT);
+}
+
+/* Smallest class holding `bytes`, or -1 if none does */
+static int texpool_class(u32 bytes) {
+    for (int c = 0; c < TEXPOOL_CLASSES; c++) {
+        if (texpool_class_bytes(c) >= bytes) return c;
+    }
+    return -1;
+}
+
+/* Returns a buffer of at least `bytes`; *size receives its class size */
+static void *texpool_get(u32 bytes, u32 *size) {
+    int c = texpool_class(bytes);
+    if (c < 0) return NULL;
+    u32 cb = texpool_class_bytes(c);
+    void *p = g_texpool.free[c];
+    if (p) {
+        g_texpool.free[c] = *(void **)p;
+        g_texpool.held -= cb;
+        g_texpool.reuses++;
+    } else {
+        p = aligned_alloc(64, cb);
+    }
+    *size = cb;
+    return p;
+}
+
+static void texpool_put(void *p, u32 size) {
+    if (!p) return;
+    if (g_texpool.held + size > g_texpool.limit) {
+        free(p);
+        return;
+    }
+    int c = texpool_class(size);
+    *(void **)p = g_texpool.free[c];
+    g_texpool.free[c] = p;
+    g_texpool.held += size;
+}
+
+/* Bytes per decoded texel: indexed entries hold one 8-bit index */
+static inline u32 tex_texel_bytes(u32 fmt) {
+    return tex_fmt_indexed(fmt) ? 1 : sizeof(u32);
+}
+
+static struct {
+    int nearest;    /* PC_TEX_FORCE_NEAREST */
+    int auto_mips;  /* PC_TEX_AUTO_MIPS */
+    int layout;     /* PC_TEX_LAYOUT */
+} g_texfilter = { PC_TEX_FORCE_NEAREST, PC_TEX_AUTO_MIPS, PC_TEX_LAYOUT };
+
+static inline u32 tex_level_dim(u32 d, int level) {
+    d >>= level;
+    return d ? d : 1;
+}
+
+/* Levels down to 1x1, capped at GX_TEX_MAX_LEVELS */
+static int tex_full_levels(u16 w, u16 h) {
+    int levels = 1;
+    while (levels < GX_TEX_MAX_LEVELS && (tex_level_dim(w, levels - 1) > 1 || tex_level_dim(h, levels - 1) > 1))
+        levels++;
+    return levels;
+}
+
+/* Levels an entry stores: a GC chain as given, otherwise level 0 plus a
+ * generated pyramid for RGBA8 entries when PC_TEX_AUTO_MIPS is on */
+static int tex_stored_levels(u16 w, u16 h, u32 fmt, int src_levels) {
+    if (src_levels > 1 || !g_texfilter.auto_mips || tex_fmt_indexed(fmt)) return src_levels;
+    return tex_full_levels(w, h);
+}
+
+/* Whether a texture of this size is stored in 4x4 texel blocks: one
+ * 64-byte cache line per RGBA8 block, so steps in y stay as local as steps
+ * in x. Textures narrower than PC_TEX_TILE_MIN_SIZE stay linear. */
+static int tex_use_tiled(u16 w, u16 h) {
+    if (g_texfilter.layout == 2) return 1;
+    return g_texfilter.layout == 1 && w >= PC_TEX_TILE_MIN_SIZE && h >= PC_TEX_TILE_MIN_SIZE;
+}
+
+/* Texel offset of each level; returns the total texel count. Tiled levels
+ * are padded to whole blocks. */
+static u32 tex_level_layout(u16 w, u16 h, int levels, int tiled, u32 *ofs) {
+    u32 total = 0;
+    for (int l = 0; l < levels; l++) {
+        u32 lw = tex_level_dim(w, l), lh = tex_level_dim(h, l);
+        if (tiled) {
+            lw = (lw + 3) & ~3u;
+            lh = (lh + 3) & ~3u;
+        }
+        ofs[l] = total;
+        total += lw * lh;
+    }
+    return total;
+}
+
+/* Offsets of row y and column x within a level w texels wide. Their sum is
+ * the texel index: y * w + x, or for tiled levels the 4x4 block of (x, y)
+ * in row-major block order and the texel within it. */
+static inline u32 tex_row_ofs(int y, int w, int tiled) {
+    if (!tiled) return (u32)(y * w);
+    return (u32)((((y >> 2) * ((w + 3) >> 2)) << 4) | ((y & 3) << 2));
+}
+
+static inline u32 tex_col_ofs(int x, int tiled) {
+    if (!tiled) return (u32)x;
+    return (u32)(((x >> 2) << 4) | (x & 3));
+}
+
+/* Copy a linear w x h level into 4x4 blocks; the padding of partial
+ * blocks repeats the last row and column */
+static void tex_tile_level(const void *src, void *dst, int w, int h, u32 texel_bytes) {
+    const u8 *s = (const u8 *)src;
+    u8 *d = (u8 *)dst;
+    for (int by = 0; by < h; by += 4) {
+        for (int bx = 0; bx < w; bx += 4) {
+            for (int y = by; y < by + 4; y++) {
+                const u8 *row = s + (u32)(y < h ? y : h - 1) * w * texel_bytes;
+                if (bx + 4 <= w) {
+                    memcpy(d, row + (u32)bx * texel_bytes, 4 * texel_bytes);
+                    d += 4 * texel_bytes;
+                    continue;
                 }
-            }
-            src += 64;
-        }
-    }
-}
-
-static void gc_rgb5a3_decode(const u8 *src, u32 *dst, int w, int h) {
-    for (int ty = 0; ty < h; ty += 4) {
-        for (int tx = 0; tx < w; tx += 4) {
-            for (int y = 0; y < 4; y++) {
-                for (int x = 0; x < 4; x++) {
-                    int px = tx + x, py = ty + y;
-                    u16 pixel = (src[0] << 8) | src[1]; src += 2;
-                    if (px < w && py < h) {
-                        u8 r, g, b, a;
-                        if (pixel & 0x8000) {
-                            r = ((pixel >> 10) & 0x1F) * 255 / 31;
-                            g = ((pixel >> 5) & 0x1F) * 255 / 31;
-                            b = (pixel & 0x1F) * 255 / 31;
-                            a = 255;
-                        } else {
-                            a = ((pixel >> 12) & 0x7) * 255 / 7;
-                            r = ((pixel >> 8) & 0xF) * 255 / 15;
-                            g = ((pixel >> 4) & 0xF) * 255 / 15;
-                            b = (pixel & 0xF) * 255 / 15;
-                        }
-                        dst[py * w + px] = (r << 24) | (g << 16) | (b << 8) | a;
-                    }
+                for (int x = bx; x < bx + 4; x++) {
+                    memcpy(d, row + (u32)(x < w ? x : w - 1) * texel_bytes, texel_bytes);
+                    d += texel_bytes;
                 }
             }
         }
     }
 }
 
-static void gc_rgb565_decode(const u8 *src, u32 *dst, int w, int h) {
-    for (int ty = 0; ty < h; ty += 4) {
-        for (int tx = 0; tx < w; tx += 4) {
-            for (int y = 0; y < 4; y++) {
-                for (int x = 0; x < 4; x++) {
-                    int px = tx + x, py = ty + y;
-                    u16 pixel = (src[0] << 8) | src[1]; src += 2;
-                    if (px < w && py < h) {
-                        u8 r = ((pixel >> 11) & 0x1F) * 255 / 31;
-                        u8 g = ((pixel >> 5) & 0x3F) * 255 / 63;
-                        u8 b = (pixel & 0x1F) * 255 / 31;
-                        dst[py * w + px] = (r << 24) | (g << 16) | (b << 8) | 255;
-                    }
-                }
+/* Bytes of GC data holding the first `levels` levels of a mip chain */
+static u32 tex_chain_src_size(u32 fmt, u16 w, u16 h, int levels) {
+    u32 size = 0;
+    for (int l = 0; l < levels; l++)
+        size += gx_tex_src_size(fmt, tex_level_dim(w, l), tex_level_dim(h, l));
+    return size;
+}
+
+/* Box-filter level l - 1 into level l; a dimension already at 1 is not
+ * halved */
+static void tex_generate_level(u32 *texels, const u32 *ofs, u16 w, u16 h, int l) {
+    const u32 *src = texels + ofs[l - 1];
+    u32 *dst = texels + ofs[l];
+    u32 sw = tex_level_dim(w, l - 1), sh = tex_level_dim(h, l - 1);
+    u32 dw = tex_level_dim(w, l), dh = tex_level_dim(h, l);
+    u32 xs = sw > 1, ys = sh > 1 ? sw : 0;
+    for (u32 y = 0; y < dh; y++) {
+        const u32 *row = src + (y << (sh > 1)) * sw;
+        for (u32 x = 0; x < dw; x++) {
+            const u32 *p = row + (x << (sw > 1));
+            u32 t[4] = { p[0], p[xs], p[ys], p[xs + ys] };
+            /* Two channels per 16-bit field; four bytes sum to at most 10 bits */
+            u32 lo = 0x00020002, hi = 0x00020002;
+            for (int i = 0; i < 4; i++) {
+                lo += t[i] & 0x00FF00FF;
+                hi += (t[i] >> 8) & 0x00FF00FF;
             }
+            dst[y * dw + x] = ((lo >> 2) & 0x00FF00FF) | (((hi >> 2) & 0x00FF00FF) << 8);
         }
     }
 }
 
-static void gc_i4_decode(const u8 *src, u32 *dst, int w, int h) {
-    for (int ty = 0; ty < h; ty += 8) {
-        for (int tx = 0; tx < w; tx += 8) {
-            for (int y = 0; y < 8; y++) {
-                for (int x = 0; x < 8; x += 2) {
-                    u8 byte = *src++;
-                    for (int n = 0; n < 2; n++) {
-                        int px = tx + x + n, py = ty + y;
-                        u8 i = (n == 0) ? ((byte >> 4) & 0xF) : (byte & 0xF);
-                        i = i * 255 / 15;
-                        if (px < w && py < h)
-                            dst[py * w + px] = (i << 24) | (i << 16) | (i << 8) | 255;
-                    }
-                }
+/* Decode the GC levels of e and generate the rest, as linear levels at
+ * ofs in data */
+static void decode_levels(const GXTexCacheEntry *e, const void *raw_data, const GXTlutPalette *tlut,
+                          void *data, const u32 *ofs) {
+    u16 width = e->width, height = e->height;
+    GXTexFmt fmt = e->format;
+    const u8 *src = (const u8 *)raw_data;
+    for (int l = 0; l < e->src_levels; l++) {
+        int lw = (int)tex_level_dim(width, l), lh = (int)tex_level_dim(height, l);
+        if (tex_fmt_indexed(fmt)) {
+            gx_tex_decode_indices(fmt, src, (u8 *)data + ofs[l], lw, lh);
+        } else {
+            u32 *decoded = (u32 *)data + ofs[l];
+            int ok = tex_fmt_is_ci(fmt)
+                ? gx_tex_decode_ci(fmt, src, decoded, lw, lh, tlut->colors, tlut->n)
+                : gx_tex_decode(fmt, src, decoded, lw, lh);
+            if (!ok) {
+                /* Fill magenta for unsupported */
+                for (int i = 0; i < lw * lh; i++)
+                    decoded[i] = (255u << 24) | (0 << 16) | (255u << 8) | 255u;
             }
         }
+        src += gx_tex_src_size(fmt, lw, lh);
     }
+    for (int l = e->src_levels; l < e->levels; l++)
+        tex_generate_level((u32 *)data, ofs, width, height, l);
 }
 
-static void gc_i8_decode(const u8 *src, u32 *dst, int w, int h) {
-    for (int ty = 0; ty < h; ty += 4) {
-        for (int tx = 0; tx < w; tx += 8) {
-            for (int y = 0; y < 4; y++) {
-                for (int x = 0; x < 8; x++) {
-                    int px = tx + x, py = ty + y;
-                    u8 i = *src++;
-                    if (px < w && py < h)
-                        dst[py * w + px] = (i << 24) | (i << 16) | (i << 8) | 255;
-                }
-            }
+/* Decode the GC levels of e (width, height, format and src_levels set)
+ * into one pool buffer, to RGBA8 or to indices for tex_fmt_indexed
+ * formats; CI formats that are expanded go through the palette `tlut`.
+ * Tiled entries are decoded linearly into a scratch buffer first. */
+static int decode_texture(GXTexCacheEntry *e, const void *raw_data, const GXTlutPalette *tlut) {
+    u16 width = e->width, height = e->height;
+    GXTexFmt fmt = e->format;
+    u32 texel_bytes = tex_texel_bytes(fmt);
+    if (!raw_data || width == 0 || height == 0) return 0;
+
+    e->levels = (u8)tex_stored_levels(width, height, fmt, e->src_levels);
+    e->tiled = (u8)tex_use_tiled(width, height);
+    u32 texels = tex_level_layout(width, height, e->levels, e->tiled, e->level_ofs);
+    void *data = texpool_get(texels * texel_bytes, &e->bytes);
+    if (!data) return 0;
+
+    if (!e->tiled) {
+        decode_levels(e, raw_data, tlut, data, e->level_ofs);
+    } else {
+        u32 lin_ofs[GX_TEX_MAX_LEVELS], lin_size;
+        u32 lin_texels = tex_level_layout(width, height, e->levels, 0, lin_ofs);
+        void *lin = texpool_get(lin_texels * texel_bytes, &lin_size);
+        if (!lin) {
+            texpool_put(data, e->bytes);
+            return 0;
+        }
+        decode_levels(e, raw_data, tlut, lin, lin_ofs);
+        for (int l = 0; l < e->levels; l++) {
+            tex_tile_level((const u8 *)lin + lin_ofs[l] * texel_bytes,
+                           (u8 *)data + e->level_ofs[l] * texel_bytes,
+                           (int)tex_level_dim(width, l), (int)tex_level_dim(height, l), texel_bytes);
         }
+        texpool_put(lin, lin_size);
     }
+
+    if (tex_fmt_indexed(fmt)) e->indices = (u8 *)data;
+    else e->decoded = (u32 *)data;
+    return 1;
 }
 
-static void gc_ia4_decode(const u8 *src, u32 *dst, int w, int h) {
-    for (int ty = 0; ty < h; ty += 4) {
-        for (int tx = 0; tx < w; tx += 8) {
-            for (int y = 0; y < 4; y++) {
-                for (int x = 0; x < 8; x++) {
-                    int px = tx + x, py = ty + y;
-                    u8 byte = *src++;
-                    u8 i = (byte & 0xF) * 255 / 15;
-                    u8 a = ((byte >> 4) & 0xF) * 255 / 15;
-                    if (px < w && py < h)
-                        dst[py * w + px] = (i << 24) | (i << 16) | (i << 8) | a;
-                }
-            }
+/* ================================================================
+ * Decoded texture cache
+ *
+ * Decoded textures are kept in one global cache keyed by a hash of the GC
+ * source bytes plus (format, width, height, TLUT). A second index keyed by
+ * the source pointer lets repeated loads of the same texture within a frame
+ * skip hashing entirely. GXInvalidateTexAll only bumps the generation
+ * counter: the next load of a stale entry re-hashes its source and the
+ * decode is redone only if the content actually changed. Entries are
+ * evicted least-recently-used first once the memory budget is exceeded.
+ * ================================================================ */
+#define TEXCACHE_BUCKETS 4096
+
+static struct {
+    GXTexCacheEntry *by_hash[TEXCACHE_BUCKETS];
+    GXTexCacheEntry *by_src[TEXCACHE_BUCKETS];
+    GXTexCacheEntry *lru_head, *lru_tail; /* head = most recently used */
+    u32 gen;
+    u32 budget;
+    GXPCTexCacheStats stats;
+} g_texcache = { .gen = 1, .budget = PC_TEXCACHE_BUDGET };
+
+static inline u32 texcache_src_bucket(const void *src) {
+    return (u32)(((uintptr_t)src >> 5) * 0x9E3779B1u) >> (32 - 12);
+}
+
+static inline u32 texcache_hash_bucket(u64 hash) {
+    return (u32)hash & (TEXCACHE_BUCKETS - 1);
+}
+
+static void texcache_lru_unlink(GXTexCacheEntry *e) {
+    if (e->lru_prev) e->lru_prev->lru_next = e->lru_next; else g_texcache.lru_head = e->lru_next;
+    if (e->lru_next) e->lru_next->lru_prev = e->lru_prev; else g_texcache.lru_tail = e->lru_prev;
+    e->lru_prev = e->lru_next = NULL;
+}
+
+static void texcache_lru_push(GXTexCacheEntry *e) {
+    e->lru_prev = NULL;
+    e->lru_next = g_texcache.lru_head;
+    if (g_texcache.lru_head) g_texcache.lru_head->lru_prev = e;
+    g_texcache.lru_head = e;
+    if (!g_texcache.lru_tail) g_texcache.lru_tail = e;
+}
+
+static void texcache_touch(GXTexCacheEntry *e) {
+    if (g_texcache.lru_head == e) return;
+    texcache_lru_unlink(e);
+    texcache_lru_push(e);
+}
+
+static void texcache_src_unlink(GXTexCacheEntry *e) {
+    if (!e->src) return;
+    GXTexCacheEntry **pp = &g_texcache.by_src[texcache_src_bucket(e->src)];
+    while (*pp && *pp != e) pp = &(*pp)->src_next;
+    if (*pp) *pp = e->src_next;
+    e->src_next = NULL;
+    e->src = NULL;
+}
+
+static void texcache_src_link(GXTexCacheEntry *e, const void *src) {
+    u32 b = texcache_src_bucket(src);
+    e->src = src;
+    e->src_next = g_texcache.by_src[b];
+    g_texcache.by_src[b] = e;
+}
+
+static void texcache_hash_unlink(GXTexCacheEntry *e) {
+    GXTexCacheEntry **pp = &g_texcache.by_hash[texcache_hash_bucket(e->hash)];
+    while (*pp && *pp != e) pp = &(*pp)->hash_next;
+    if (*pp) *pp = e->hash_next;
+    e->hash_next = NULL;
+}
+
+static int texcache_is_bound(const GXTexCacheEntry *e) {
+    for (int i = 0; i < GX_MAX_TEXTURES; i++) {
+        if (g_gx.tex_map[i].entry == e) return 1;
+    }
+    return 0;
+}
+
+/* Evict least-recently-used entries until `incoming` more bytes fit.
+ * Entries bound to a texmap are skipped since the rasterizer may still
+ * sample them. */
+static void texcache_make_room(u32 incoming) {
+    if (g_texcache.stats.bytes + incoming <= g_texcache.budget) return;
+    gx_raster_flush(); /* binned triangles may still sample any entry */
+    GXTexCacheEntry *e = g_texcache.lru_tail;
+    while (e && g_texcache.stats.bytes + incoming > g_texcache.budget) {
+        GXTexCacheEntry *prev = e->lru_prev;
+        if (!texcache_is_bound(e)) {
+            texcache_lru_unlink(e);
+            texcache_hash_unlink(e);
+            texcache_src_unlink(e);
+            g_texcache.stats.bytes -= e->bytes;
+            g_texcache.stats.entries--;
+            g_texcache.stats.evictions++;
+            texpool_put(e->decoded ? (void *)e->decoded : (void *)e->indices, e->bytes);
+            free(e);
         }
+        e = prev;
     }
 }
 
-static void gc_ia8_decode(const u8 *src, u32 *dst, int w, int h) {
-    for (int ty = 0; ty < h; ty += 4) {
-        for (int tx = 0; tx < w; tx += 4) {
-            for (int y = 0; y < 4; y++) {
-                for (int x = 0; x < 4; x++) {
-                    int px = tx + x, py = ty + y;
-                    u8 a = *src++;
-                    u8 i = *src++;
-                    if (px < w && py < h)
-                        dst[py * w + px] = (i << 24) | (i << 16) | (i << 8) | a;
-                }
-            }
+static inline int texcache_matches(const GXTexCacheEntry *e, u32 fmt, u16 w, u16 h, int levels, u64 tlut_key) {
+    return e->format == (GXTexFmt)fmt && e->width == w && e->height == h &&
+           e->src_levels == levels && e->tlut_key == tlut_key;
+}
+
+/* `levels` is the length of the GC mip chain at src; `tlut` is the palette
+ * to expand a CI format through, NULL otherwise */
+static GXTexCacheEntry *texcache_lookup(const void *src, u16 w, u16 h, u32 fmt, int levels,
+                                        const GXTlutPalette *tlut) {
+    if (!src || w == 0 || h == 0) return NULL;
+    u64 tlut_key = tlut ? tlut->hash : 0;
+    g_gxperf.tc_check++;
+
+    /* Fast path: this exact source was already validated this generation */
+    GXTexCacheEntry *bound = g_texcache.by_src[texcache_src_bucket(src)];
+    while (bound && !(bound->src == src && texcache_matches(bound, fmt, w, h, levels, tlut_key)))
+        bound = bound->src_next;
+    if (bound && bound->gen == g_texcache.gen) {
+        g_texcache.stats.hits++;
+        texcache_touch(bound);
+        return bound;
+    }
+
+    u32 src_size = tex_chain_src_size(fmt, w, h, levels);
+    g_gxperf.tc_lines += (src_size + 31) / 32;
+    u64 seed = ((u64)fmt << 56) ^ ((u64)w << 40) ^ ((u64)h << 24) ^ ((u64)levels << 16) ^ tlut_key;
+    u64 hash = gx_hash64(src, src_size, seed);
+
+    if (bound) {
+        if (bound->hash == hash) {
+            bound->gen = g_texcache.gen;
+            g_texcache.stats.rehashes++;
+            texcache_touch(bound);
+            return bound;
         }
+        /* Source was rewritten; the old decode stays reachable by content */
+        texcache_src_unlink(bound);
     }
+
+    GXTexCacheEntry *e = g_texcache.by_hash[texcache_hash_bucket(hash)];
+    while (e && !(e->hash == hash && texcache_matches(e, fmt, w, h, levels, tlut_key)))
+        e = e->hash_next;
+    if (e) {
+        texcache_src_unlink(e);
+        texcache_src_link(e, src);
+        e->gen = g_texcache.gen;
+        g_texcache.stats.rehashes++;
+        texcache_touch(e);
+        return e;
+    }
+
+    u32 ofs[GX_TEX_MAX_LEVELS];
+    u32 texels = tex_level_layout(w, h, tex_stored_levels(w, h, fmt, levels), tex_use_tiled(w, h), ofs);
+    int c = texpool_class(texels * tex_texel_bytes(fmt));
+    if (c < 0) return NULL;
+    texcache_make_room(texpool_class_bytes(c));
+    e = (GXTexCacheEntry *)calloc(1, sizeof(GXTexCacheEntry));
+    if (!e) return NULL;
+    e->width = w;
+    e->height = h;
+    e->format = (GXTexFmt)fmt;
+    e->src_levels = (u8)levels;
+    if (!decode_texture(e, src, tlut)) { free(e); return NULL; }
+    u32 bytes = e->bytes;
+    e->tlut_key = tlut_key;
+    e->hash = hash;
+    e->src_size = src_size;
+    e->gen = g_texcache.gen;
+    u32 hb = texcache_hash_bucket(hash);
+    e->hash_next = g_texcache.by_hash[hb];
+    g_texcache.by_hash[hb] = e;
+    texcache_src_link(e, src);
+    texcache_lru_push(e);
+    g_texcache.stats.bytes += bytes;
+    g_texcache.stats.entries++;
+    g_texcache.stats.misses++;
+    g_gxperf.tc_miss++;
+    return e;
 }
 
-static void gc_cmpr_decode(const u8 *src, u32 *dst, int w, int h) {
-    /* S3TC/DXT1: 4x4 blocks in 2x2 meta-tiles (8x8 total) */
-    for (int ty = 0; ty < h; ty += 8) {
-        for (int tx = 0; tx < w; tx += 8) {
-            /* 4 sub-blocks in a 2x2 arrangement */
-            for (int by = 0; by < 2; by++) {
-                for (int bx = 0; bx < 2; bx++) {
-                    u16 c0 = (src[0] << 8) | src[1];
-                    u16 c1 = (src[2] << 8) | src[3];
-                    u32 bits = ((u32)src[4] << 24) | ((u32)src[5] << 16) | ((u32)src[6] << 8) | src[7];
-                    src += 8;
-
-                    u8 r0 = ((c0 >> 11) & 0x1F) * 255 / 31;
-                    u8 g0 = ((c0 >> 5) & 0x3F) * 255 / 63;
-                    u8 b0 = (c0 & 0x1F) * 255 / 31;
-                    u8 r1 = ((c1 >> 11) & 0x1F) * 255 / 31;
-                    u8 g1 = ((c1 >> 5) & 0x3F) * 255 / 63;
-                    u8 b1 = (c1 & 0x1F) * 255 / 31;
-
-                    u8 palette[4][4]; /* r,g,b,a */
-                    palette[0][0] = r0; palette[0][1] = g0; palette[0][2] = b0; palette[0][3] = 255;
-                    palette[1][0] = r1; palette[1][1] = g1; palette[1][2] = b1; palette[1][3] = 255;
-                    if (c0 > c1) {
-                        palette[2][0] = (2*r0 + r1) / 3; palette[2][1] = (2*g0 + g1) / 3;
-                        palette[2][2] = (2*b0 + b1) / 3; palette[2][3] = 255;
-                        palette[3][0] = (r0 + 2*r1) / 3; palette[3][1] = (g0 + 2*g1) / 3;
-                        palette[3][2] = (b0 + 2*b1) / 3; palette[3][3] = 255;
-                    } else {
-                        palette[2][0] = (r0 + r1) / 2; palette[2][1] = (g0 + g1) / 2;
-                        palette[2][2] = (b0 + b1) / 2; palette[2][3] = 255;
-                        palette[3][0] = 0; palette[3][1] = 0; palette[3][2] = 0; palette[3][3] = 0;
-                    }
+static inline int tex_filter_is_mip(u32 filter) {
+    return filter >= GX_NEAR_MIP_NEAR;
+}
 
-                    for (int y = 0; y < 4; y++) {
-                        for (int x = 0; x < 4; x++) {
-                            int px = tx + bx * 4 + x;
-                            int py = ty + by * 4 + y;
-                            int idx = (bits >> 30) & 3;
-                            bits <<= 2;
-                            if (px < w && py < h) {
-                                dst[py * w + px] = (palette[idx][0] << 24) | (palette[idx][1] << 16) |
-                                                   (palette[idx][2] << 8) | palette[idx][3];
-                            }
-                        }
-                    }
-                }
-            }
+/* Length of the GC mip chain a texture object samples: up to max_lod when
+ * its min filter uses mips, as the hardware reads them regardless of the
+ * mipmap flag given to GXInitTexObj */
+static int tex_obj_src_levels(const GXTexObjPC *pc) {
+    if (!tex_filter_is_mip(pc->min_filter) || pc->max_lod <= 0.0f) return 1;
+    int levels = (int)ceilf(pc->max_lod) + 1;
+    int full = tex_full_levels(pc->width, pc->height);
+    return levels < full ? levels : full;
+}
+
+/* Bind a texmap to the cache entry of its loaded texture object. CI
+ * textures also pick up the palette of their TLUT slot. */
+static void tex_map_resolve(GXTexMapID id) {
+    const GXTexObjPC *pc = (const GXTexObjPC *)&g_gx.tex_obj[id];
+    GXTexMapState *tm = &g_gx.tex_map[id];
+    const GXTlutPalette *tlut = NULL;
+    tm->entry = NULL; /* unbind first so the previous texture is evictable */
+    tm->tlut = NULL;
+    if (tex_fmt_is_ci(pc->format)) {
+        tlut = tlut_slot(pc->tlut_name);
+        if (!tlut) return;
+        if (tex_fmt_indexed(pc->format)) {
+            tm->tlut = tlut->colors;
+            tlut = NULL;
         }
     }
+    tm->entry = texcache_lookup(pc->image_ptr, pc->width, pc->height, pc->format,
+                                tex_obj_src_levels(pc), tlut);
+}
+
+/* Re-resolve a texmap whose entry went stale via GXInvalidateTexAll
+ * without the game reloading it. */
+static void tex_map_validate(GXTexMapID id) {
+    GXTexMapState *tm = &g_gx.tex_map[id];
+    if (!g_gx.tex_loaded[id] || (tm->entry && tm->entry->gen == g_texcache.gen)) return;
+    tex_map_resolve(id);
 }
 
-static u32 *decode_texture(void *raw_data, u16 width, u16 height, GXTexFmt fmt) {
-    if (!raw_data || width == 0 || height == 0) return NULL;
+void GXPCSetTexCacheBudget(u32 bytes) {
+    g_texcache.budget = bytes;
+    texcache_make_room(0);
+}
 
-    u32 *decoded = (u32 *)calloc(width * height, sizeof(u32));
-    if (!decoded) return NULL;
+void GXPCGetTexCacheStats(GXPCTexCacheStats *stats) {
+    if (!stats) return;
+    *stats = g_texcache.stats;
+    stats->budget = g_texcache.budget;
+    stats->pool_bytes = g_texpool.held;
+    stats->pool_reuses = g_texpool.reuses;
+}
 
-    switch (fmt) {
-        case GX_TF_RGBA8:  gc_rgba8_decode((const u8 *)raw_data, decoded, width, height); break;
-        case GX_TF_RGB5A3: gc_rgb5a3_decode((const u8 *)raw_data, decoded, width, height); break;
-        case GX_TF_RGB565: gc_rgb565_decode((const u8 *)raw_data, decoded, width, height); break;
-        case GX_TF_I4:     gc_i4_decode((const u8 *)raw_data, decoded, width, height); break;
-        case GX_TF_I8:     gc_i8_decode((const u8 *)raw_data, decoded, width, height); break;
-        case GX_TF_IA4:    gc_ia4_decode((const u8 *)raw_data, decoded, width, height); break;
-        case GX_TF_IA8:    gc_ia8_decode((const u8 *)raw_data, decoded, width, height); break;
-        case GX_TF_CMPR:   gc_cmpr_decode((const u8 *)raw_data, decoded, width, height); break;
-        default:
-            /* Fill magenta for unsupported */
-            for (int i = 0; i < width * height; i++)
-                decoded[i] = (255u << 24) | (0 << 16) | (255u << 8) | 255u;
-            break;
+/* ================================================================
+ * Texture sampling
+ * ================================================================ */
+
+/* Wrap a normalized coordinate into one period: [0, 1] for REPEAT and
+ * CLAMP, [0, 2) for MIRROR */
+static inline v4f tex_wrap_coord(v4f u, u32 mode) {
+    if (mode == GX_REPEAT) return v4f_sub(u, v4f_floor(u));
+    if (mode == GX_MIRROR) {
+        v4f two = v4f_set1(2.0f);
+        return v4f_sub(u, v4f_mul(two, v4f_floor(v4f_mul(u, v4f_set1(0.5f)))));
     }
-    return decoded;
+    return v4f_max(v4f_set1(0.0f), v4f_min(v4f_set1(1.0f), u));
 }
 
-static inline u32 sample_texture(GXTexCacheEntry *tc, float u, float v) {
-    if (!tc->decoded) return 0xFFFFFFFF;
-    int w = tc->width, h = tc->height;
+/* Wrap a texel coordinate within [-1, period * n + 1] onto 0..n-1. Small
+ * mip levels wrap on nearly every fetch, so this is kept branch-free. */
+static inline int tex_wrap_texel(int x, int n, u32 mode) {
+    if (mode == GX_REPEAT) {
+        x += (x < 0) ? n : 0;
+        return x - ((x >= n) ? n : 0);
+    }
+    if (mode == GX_MIRROR) {
+        int n2 = 2 * n;
+        x += (x < 0) ? n2 : 0;
+        x -= (x >= n2) ? n2 : 0;
+        return (x >= n) ? n2 - 1 - x : x;
+    }
+    x = (x < 0) ? 0 : x;
+    return (x >= n) ? n - 1 : x;
+}
+
+/* Texel i of one level; indexed entries go through the texmap's TLUT */
+static inline u32 tex_fetch(const GXTexMapState *tm, u32 base, u32 i) {
+    const GXTexCacheEntry *e = tm->entry;
+    if (e->indices) return tm->tlut[e->indices[base + i]];
+    return e->decoded[base + i];
+}
+
+/* Split four 0xRRGGBBAA texels into r, g, b, a planes in 0..1 */
+static inline void texel_planes(const u32 *t, v4f out[4]) {
+    v4i px = v4i_load(t);
+    v4i m = v4i_set1(0xFF);
+    v4f scale = v4f_set1(1.0f / 255.0f);
+    out[0] = v4f_mul(v4f_from_v4i(v4i_shr32(px, 24)), scale);
+    out[1] = v4f_mul(v4f_from_v4i(v4i_and(v4i_shr32(px, 16), m)), scale);
+    out[2] = v4f_mul(v4f_from_v4i(v4i_and(v4i_shr32(px, 8), m)), scale);
+    out[3] = v4f_mul(v4f_from_v4i(v4i_and(px, m)), scale);
+}
+
+/* Sample one level at the wrapped coordinates u, v: point sampling
+ * floor(u * w), or bilinear around u * w - 0.5 */
+static void tex_sample_level(const GXTexMapState *tm, int level, int linear,
+                             v4f u, v4f v, v4f out[4]) {
+    const GXTexCacheEntry *e = tm->entry;
+    int w = (int)tex_level_dim(e->width, level), h = (int)tex_level_dim(e->height, level);
+    u32 base = e->level_ofs[level];
+    int tiled = e->tiled;
+    float half = linear ? 0.5f : 0.0f;
+    t_gxperf_pix->texels += linear ? 16 : 4;
+
+    /* The clamp keeps NaN and huge coordinates inside the int range */
+    float hu = (float)(tm->wrap_s == GX_MIRROR ? 2 * w : w);
+    float hv = (float)(tm->wrap_t == GX_MIRROR ? 2 * h : h);
+    v4f fu = v4f_sub(v4f_mul(u, v4f_set1((float)w)), v4f_set1(half));
+    v4f fv = v4f_sub(v4f_mul(v, v4f_set1((float)h)), v4f_set1(half));
+    fu = v4f_max(v4f_set1(-1.0f), v4f_min(fu, v4f_set1(hu)));
+    fv = v4f_max(v4f_set1(-1.0f), v4f_min(fv, v4f_set1(hv)));
+    v4f flu = v4f_floor(fu), flv = v4f_floor(fv);
+    s32 x[4], y[4];
+    v4i_store(x, v4i_from_v4f(flu));
+    v4i_store(y, v4i_from_v4f(flv));
+
+    u32 t00[4] __attribute__((aligned(16)));
+    if (!linear) {
+        for (int l = 0; l < 4; l++) {
+            int tx = tex_wrap_texel(x[l], w, tm->wrap_s), ty = tex_wrap_texel(y[l], h, tm->wrap_t);
+            t00[l] = tex_fetch(tm, base, tex_row_ofs(ty, w, tiled) + tex_col_ofs(tx, tiled));
+        }
+        texel_planes(t00, out);
+        return;
+    }
+
+    u32 t10[4] __attribute__((aligned(16)));
+    u32 t01[4] __attribute__((aligned(16)));
+    u32 t11[4] __attribute__((aligned(16)));
+    for (int l = 0; l < 4; l++) {
+        u32 x0 = tex_col_ofs(tex_wrap_texel(x[l], w, tm->wrap_s), tiled);
+        u32 x1 = tex_col_ofs(tex_wrap_texel(x[l] + 1, w, tm->wrap_s), tiled);
+        u32 r0 = tex_row_ofs(tex_wrap_texel(y[l], h, tm->wrap_t), w, tiled);
+        u32 r1 = tex_row_ofs(tex_wrap_texel(y[l] + 1, h, tm->wrap_t), w, tiled);
+        t00[l] = tex_fetch(tm, base, r0 + x0);
+        t10[l] = tex_fetch(tm, base, r0 + x1);
+        t01[l] = tex_fetch(tm, base, r1 + x0);
+        t11[l] = tex_fetch(tm, base, r1 + x1);
+    }
+    v4f ax = v4f_sub(fu, flu), ay = v4f_sub(fv, flv);
+    v4f c00[4], c10[4], c01[4], c11[4];
+    texel_planes(t00, c00);
+    texel_planes(t10, c10);
+    texel_planes(t01, c01);
+    texel_planes(t11, c11);
+    for (int c = 0; c < 4; c++) {
+        v4f top = v4f_add(c00[c], v4f_mul(v4f_sub(c10[c], c00[c]), ax));
+        v4f bot = v4f_add(c01[c], v4f_mul(v4f_sub(c11[c], c01[c]), ax));
+        out[c] = v4f_add(top, v4f_mul(v4f_sub(bot, top), ay));
+    }
+}
+
+/* Level of detail of a quad: log2 of the larger texel footprint of a
+ * pixel step in x (lanes 0-1) or y (lanes 0-2), plus the texmap bias */
+static float tex_quad_lod(const GXTexMapState *tm, v4f u, v4f v) {
+    float us[4], vs[4];
+    v4f_store(us, u);
+    v4f_store(vs, v);
+    float w = (float)tm->entry->width, h = (float)tm->entry->height;
+    float dux = (us[1] - us[0]) * w, dvx = (vs[1] - vs[0]) * h;
+    float duy = (us[2] - us[0]) * w, dvy = (vs[2] - vs[0]) * h;
+    float rx = dux * dux + dvx * dvx, ry = duy * duy + dvy * dvy;
+    return 0.5f * log2f(rx > ry ? rx : ry) + tm->lod_bias;
+}
+
+/* Filter the four lanes of a quad at texcoords u, v (lane order as in
+ * shade_quad) into r, g, b, a planes in 0..1. Follows the texmap's
+ * GXInitTexObjLOD filters: mag filter when the quad magnifies, else the
+ * min filter over the entry's mip levels, trilinear for *_MIP_LIN. */
+static void sample_texture4(const GXTexMapState *tm, v4f u, v4f v, v4f out[4]) {
+    const GXTexCacheEntry *e = tm->entry;
+    if (!e) {
+        for (int c = 0; c < 4; c++) out[c] = v4f_set1(1.0f);
+        return;
+    }
+    /* Derivatives come from the unwrapped coordinates */
+    float lod = g_texfilter.nearest ? 0.0f : tex_quad_lod(tm, u, v);
+    u = tex_wrap_coord(u, tm->wrap_s);
+    v = tex_wrap_coord(v, tm->wrap_t);
+    if (g_texfilter.nearest) {
+        tex_sample_level(tm, 0, 0, u, v, out);
+        return;
+    }
+
+    if (!(lod > 0.0f)) {
+        tex_sample_level(tm, 0, tm->mag_filter != GX_NEAR, u, v, out);
+        return;
+    }
 
-    /* Wrap mode */
-    if (tc->wrap_s == GX_REPEAT) { u = u - floorf(u); }
-    else if (tc->wrap_s == GX_MIRROR) { float f = floorf(u); u = ((int)f & 1) ? (1.0f - (u - f)) : (u - f); }
-    else { if (u < 0) u = 0; if (u > 1) u = 1; }
+    u32 filter = tm->min_filter;
+    float max_lod = tm->max_lod;
+    if (e->levels > e->src_levels) {
+        /* Generated pyramid: mip between levels for the non-mip filters */
+        if (filter == GX_NEAR) filter = GX_NEAR_MIP_NEAR;
+        else if (filter == GX_LINEAR) filter = GX_LIN_MIP_NEAR;
+        max_lod = (float)(e->levels - 1);
+    }
+    int linear = filter == GX_LINEAR || filter == GX_LIN_MIP_NEAR || filter == GX_LIN_MIP_LIN;
+    if (!tex_filter_is_mip(filter) || e->levels == 1) {
+        tex_sample_level(tm, 0, linear, u, v, out);
+        return;
+    }
 
-    if (tc->wrap_t == GX_REPEAT) { v = v - floorf(v); }
-    else if (tc->wrap_t == GX_MIRROR) { float f = floorf(v); v = ((int)f & 1) ? (1.0f - (v - f)) : (v - f); }
-    else { if (v < 0) v = 0; if (v > 1) v = 1; }
+    if (max_lod > (float)(e->levels - 1)) max_lod = (float)(e->levels - 1);
+    if (lod > max_lod) lod = max_lod;
+    if (lod < tm->min_lod) lod = tm->min_lod;
+    if (filter == GX_NEAR_MIP_NEAR || filter == GX_LIN_MIP_NEAR) {
+        tex_sample_level(tm, (int)(lod + 0.5f), linear, u, v, out);
+        return;
+    }
 
-    int tx = (int)(u * (w - 1) + 0.5f);
-    int ty = (int)(v * (h - 1) + 0.5f);
-    if (tx < 0) tx = 0; if (tx >= w) tx = w - 1;
-    if (ty < 0) ty = 0; if (ty >= h) ty = h - 1;
-    return tc->decoded[ty * w + tx];
+    int l0 = (int)lod;
+    float f = lod - (float)l0;
+    tex_sample_level(tm, l0, linear, u, v, out);
+    if (f > 0.0f && l0 + 1 < e->levels) {
+        v4f next[4], fv = v4f_set1(f);
+        tex_sample_level(tm, l0 + 1, linear, u, v, next);
+        for (int c = 0; c < 4; c++) out[c] = v4f_add(out[c], v4f_mul(v4f_sub(next[c], out[c]), fv));
+    }
 }
 
 /* ================================================================
@@ -294,7 +895,21 @@ GXFifoObj *GXInit(void *base, u32 size) {
     printf("[GX] GXInit()\n");
 
     memset(&g_gx, 0, sizeof(g_gx));
-    memset(g_gx_framebuffer, 0, sizeof(g_gx_framebuffer));
+    raster_init();
+    fb_init();
+    GXSetGPMetric(GX_PERF0_NONE, GX_PERF1_NONE);
+    GXClearGPMetric();
+
+    const char *dl_env = getenv("MP4_DL_COMPILE");
+    g_gx_dl_compile = (dl_env && *dl_env) ? (atoi(dl_env) != 0) : PC_DL_COMPILE;
+    const char *ci_env = getenv("MP4_TEX_CI_INDEXED");
+    g_tlut.indexed = (ci_env && *ci_env) ? (atoi(ci_env) != 0) : PC_TEX_CI_INDEXED;
+    const char *nearest_env = getenv("MP4_TEX_NEAREST");
+    g_texfilter.nearest = (nearest_env && *nearest_env) ? (atoi(nearest_env) != 0) : PC_TEX_FORCE_NEAREST;
+    const char *mips_env = getenv("MP4_TEX_AUTO_MIPS");
+    g_texfilter.auto_mips = (mips_env && *mips_env) ? (atoi(mips_env) != 0) : PC_TEX_AUTO_MIPS;
+    const char *layout_env = getenv("MP4_TEX_LAYOUT");
+    g_texfilter.layout = (layout_env && *layout_env) ? atoi(layout_env) : PC_TEX_LAYOUT;
 
     /* Default state */
     g_gx.vp_wd = 640.0f;
@@ -323,6 +938,15 @@ GXFifoObj *GXInit(void *base, u32 size) {
     g_gx.alpha_comp1 = GX_ALWAYS;
     g_gx.alpha_ref1  = 0;
 
+    /* Unlit channels taking the material from the vertex color */
+    GXColor black = { 0, 0, 0, 0 }, white = { 255, 255, 255, 255 };
+    GXSetChanCtrl(GX_COLOR0A0, GX_DISABLE, GX_SRC_REG, GX_SRC_VTX, GX_LIGHT_NULL, GX_DF_NONE, GX_AF_NONE);
+    GXSetChanAmbColor(GX_COLOR0A0, black);
+    GXSetChanMatColor(GX_COLOR0A0, white);
+    GXSetChanCtrl(GX_COLOR1A1, GX_DISABLE, GX_SRC_REG, GX_SRC_VTX, GX_LIGHT_NULL, GX_DF_NONE, GX_AF_NONE);
+    GXSetChanAmbColor(GX_COLOR1A1, black);
+    GXSetChanMatColor(GX_COLOR1A1, white);
+
     /* Identity matrices */
     for (int i = 0; i < GX_MAX_POS_MATRICES; i++) {
         g_gx.pos_mtx[i][0][0] = 1.0f;
@@ -346,9 +970,17 @@ GXFifoObj *GXInit(void *base, u32 size) {
         g_gx.tev_order[i].coord = GX_TEXCOORD0;
         g_gx.tev_order[i].map = GX_TEXMAP0;
         g_gx.tev_order[i].color = GX_COLOR0A0;
-        g_gx.tev_mode[i] = GX_PASSCLR;
+        GXSetTevOp((GXTevStageID)i, GX_PASSCLR);
+        GXSetTevKColorSel((GXTevStageID)i, GX_TEV_KCSEL_1_4);
+        GXSetTevKAlphaSel((GXTevStageID)i, GX_TEV_KASEL_1);
+        GXSetTevSwapMode((GXTevStageID)i, GX_TEV_SWAP0, GX_TEV_SWAP0);
     }
+    GXSetTevSwapModeTable(GX_TEV_SWAP0, GX_CH_RED, GX_CH_GREEN, GX_CH_BLUE, GX_CH_ALPHA);
+    GXSetTevSwapModeTable(GX_TEV_SWAP1, GX_CH_RED, GX_CH_RED, GX_CH_RED, GX_CH_ALPHA);
+    GXSetTevSwapModeTable(GX_TEV_SWAP2, GX_CH_GREEN, GX_CH_GREEN, GX_CH_GREEN, GX_CH_ALPHA);
+    GXSetTevSwapModeTable(GX_TEV_SWAP3, GX_CH_BLUE, GX_CH_BLUE, GX_CH_BLUE, GX_CH_ALPHA);
 
+    gx_cap_init();
     return &g_fifo_obj;
 }
 
@@ -391,18 +1023,24 @@ void GXDisableBreakPt(void) {}
  * Transform
  * ================================================================ */
 void GXSetProjection(const void *mtx, GXProjectionType type) {
+    if (g_gxcap_on && mtx) {
+        const u32 w = type;
+        gx_cap_block(GXCAP_SET_PROJECTION, 0, &w, 1, mtx, sizeof(float) * 16);
+    }
     if (mtx) memcpy(g_gx.projection, mtx, sizeof(float) * 16);
     g_gx.proj_type = type;
 }
 
 void GXLoadPosMtxImm(const void *mtx, u32 id) {
     if (id < GX_MAX_POS_MATRICES && mtx) {
+        if (g_gxcap_on) gx_cap_block(GXCAP_LOAD_POS_MTX, id, &id, 1, mtx, sizeof(float) * 12);
         memcpy(g_gx.pos_mtx[id], mtx, sizeof(float) * 12);
     }
 }
 
 void GXLoadNrmMtxImm(const void *mtx, u32 id) {
     if (id < GX_MAX_NRM_MATRICES && mtx) {
+        if (g_gxcap_on) gx_cap_block(GXCAP_LOAD_NRM_MTX, id, &id, 1, mtx, sizeof(float) * 12);
         memcpy(g_gx.nrm_mtx[id], mtx, sizeof(float) * 12);
     }
 }
@@ -411,15 +1049,22 @@ void GXLoadTexMtxImm(const void *mtx, u32 id, GXTexMtxType type) {
     (void)type;
     u32 idx = (id >= 30) ? (id - 30) : id;
     if (idx < GX_MAX_TEX_MATRICES && mtx) {
+        if (g_gxcap_on) {
+            const u32 w[2] = { id, type };
+            gx_cap_block(GXCAP_LOAD_TEX_MTX, idx, w, 2, mtx, sizeof(float) * (type == GX_MTX3x4 ? 12 : 8));
+        }
         memcpy(g_gx.tex_mtx[idx], mtx, sizeof(float) * 12);
     }
 }
 
 void GXSetCurrentMtx(u32 id) {
+    GX_CAP(GXCAP_SET_CURRENT_MTX, 0, id);
     g_gx.current_pos_mtx = id;
 }
 
 void GXSetViewport(f32 left, f32 top, f32 wd, f32 ht, f32 nearz, f32 farz) {
+    GX_CAP(GXCAP_SET_VIEWPORT, 0, gx_cap_f(left), gx_cap_f(top), gx_cap_f(wd), gx_cap_f(ht),
+           gx_cap_f(nearz), gx_cap_f(farz));
     g_gx.vp_left = left;
     g_gx.vp_top = top;
     g_gx.vp_wd = wd;
@@ -434,6 +1079,7 @@ void GXSetViewportJitter(f32 left, f32 top, f32 wd, f32 ht, f32 nearz, f32 farz,
 }
 
 void GXSetScissor(u32 left, u32 top, u32 wd, u32 ht) {
+    GX_CAP(GXCAP_SET_SCISSOR, 0, left, top, wd, ht);
     g_gx.sc_left = left;
     g_gx.sc_top = top;
     g_gx.sc_wd = wd;
@@ -482,10 +1128,32 @@ void GXGetProjectionv(f32 *p) {
 /* ================================================================
  * Geometry / Vertex Format
  * ================================================================ */
+/* Recompute what completes an immediate-mode vertex and drop compiled
+ * formats. Vertices complete on the last described attribute in
+ * pos, nrm, clr, texcoord order. */
+static void vtx_desc_changed(void) {
+    int need_nrm = 0, need_clr = 0, need_tc = 0;
+    for (int i = 0; i < g_gx.vtx_desc_count; i++) {
+        GXAttr a = g_gx.vtx_desc[i].attr;
+        if (g_gx.vtx_desc[i].type == GX_NONE) continue;
+        if (a == GX_VA_NRM || a == GX_VA_NBT) need_nrm = 1;
+        if (a == GX_VA_CLR0 || a == GX_VA_CLR1) need_clr = 1;
+        if (a >= GX_VA_TEX0 && a <= GX_VA_TEX7) need_tc = 1;
+    }
+    g_gx.vtx_submit_on = need_tc ? GX_SUBMIT_ON_TEX :
+                         need_clr ? GX_SUBMIT_ON_CLR :
+                         need_nrm ? GX_SUBMIT_ON_NRM : GX_SUBMIT_ON_POS;
+    g_gx.vtx_fetch_valid = 0;
+}
+
 void GXSetVtxDesc(GXAttr attr, GXAttrType type) {
+    GX_CAP(GXCAP_SET_VTX_DESC, attr, attr, type);
     for (int i = 0; i < g_gx.vtx_desc_count; i++) {
         if (g_gx.vtx_desc[i].attr == attr) {
-            g_gx.vtx_desc[i].type = type;
+            if (g_gx.vtx_desc[i].type != type) {
+                g_gx.vtx_desc[i].type = type;
+                vtx_desc_changed();
+            }
             return;
         }
     }
@@ -493,41 +1161,63 @@ void GXSetVtxDesc(GXAttr attr, GXAttrType type) {
         g_gx.vtx_desc[g_gx.vtx_desc_count].attr = attr;
         g_gx.vtx_desc[g_gx.vtx_desc_count].type = type;
         g_gx.vtx_desc_count++;
+        vtx_desc_changed();
     }
 }
 
 void GXSetVtxDescv(GXVtxDescList *list) {
     g_gx.vtx_desc_count = 0;
-    if (!list) return;
-    while (list->attr != GX_VA_NULL) {
-        if (g_gx.vtx_desc_count < GX_MAX_VERTEX_ATTRS) {
-            g_gx.vtx_desc[g_gx.vtx_desc_count] = *list;
-            g_gx.vtx_desc_count++;
+    if (list) {
+        while (list->attr != GX_VA_NULL) {
+            if (g_gx.vtx_desc_count < GX_MAX_VERTEX_ATTRS) {
+                g_gx.vtx_desc[g_gx.vtx_desc_count] = *list;
+                g_gx.vtx_desc_count++;
+            }
+            list++;
+        }
+    }
+    vtx_desc_changed();
+    if (g_gxcap_on) {
+        u32 w[2 * GX_MAX_VERTEX_ATTRS];
+        for (int i = 0; i < g_gx.vtx_desc_count; i++) {
+            w[2 * i] = g_gx.vtx_desc[i].attr;
+            w[2 * i + 1] = g_gx.vtx_desc[i].type;
         }
-        list++;
+        gx_cap_words(GXCAP_SET_VTX_DESCV, 0, w, 2 * g_gx.vtx_desc_count);
     }
 }
 
 void GXClearVtxDesc(void) {
+    GX_CAP0(GXCAP_CLEAR_VTX_DESC);
     g_gx.vtx_desc_count = 0;
+    vtx_desc_changed();
 }
 
 void GXSetVtxAttrFmt(GXVtxFmt vtxfmt, GXAttr attr, GXCompCnt cnt, GXCompType type, u8 frac) {
     if (vtxfmt < GX_MAX_VTXFMT && attr < GX_VA_MAX_ATTR) {
+        GX_CAP(GXCAP_SET_VTX_ATTR_FMT, vtxfmt * GX_VA_MAX_ATTR + attr, vtxfmt, attr, cnt, type, frac);
         g_gx.vtx_attr_fmt[vtxfmt][attr].cnt = cnt;
         g_gx.vtx_attr_fmt[vtxfmt][attr].type = type;
         g_gx.vtx_attr_fmt[vtxfmt][attr].frac = frac;
+        g_gx.vtx_fetch_valid &= ~(1 << vtxfmt);
     }
 }
 
 void GXSetArray(GXAttr attr, const void *data, u8 stride) {
     if (attr < GX_VA_MAX_ATTR) {
+        if (g_gxcap_on) gx_cap_array(attr, data, stride);
+        /* Unknown color formats read alpha only from 4-byte elements */
+        if (attr == GX_VA_CLR0 && (stride >= 4) != (g_gx.vtx_arrays[attr].stride >= 4))
+            g_gx.vtx_fetch_valid = 0;
         g_gx.vtx_arrays[attr].data = data;
         g_gx.vtx_arrays[attr].stride = stride;
     }
 }
 
-void GXSetNumTexGens(u8 nTexGens) { g_gx.num_tex_gens = nTexGens; }
+void GXSetNumTexGens(u8 nTexGens) {
+    GX_CAP(GXCAP_SET_NUM_TEX_GENS, 0, nTexGens);
+    g_gx.num_tex_gens = nTexGens;
+}
 
 void GXSetTexCoordGen2(GXTexCoordID dst_coord, GXTexGenType func, GXTexGenSrc src_param,
                        u32 mtx, GXBool normalize, u32 postmtx) {
@@ -555,27 +1245,136 @@ void GXGetVtxAttrFmt(GXVtxFmt idx, GXAttr attr, GXCompCnt *compCnt, GXCompType *
 }
 
 /* ================================================================
- * Indexed vertex reading helpers
+ * Vertex fetch compiler
+ *
+ * Component readers are specialized per (type, count); vtx_fetch_get()
+ * picks them once per format change so the indexed attribute calls and
+ * GXPCSubmitVertices don't switch on component types per vertex.
  * ================================================================ */
-static inline float read_comp_float(const u8 *data, GXCompType type, u8 frac) {
-    float scale = (frac > 0) ? (1.0f / (float)(1 << frac)) : 1.0f;
-    switch (type) {
-        case GX_U8:  return (float)(*(const u8 *)data) * scale;
-        case GX_S8:  return (float)(*(const s8 *)data) * scale;
-        case GX_U16: { u16 v = (data[0] << 8) | data[1]; return (float)v * scale; }
-        case GX_S16: { s16 v = (s16)((data[0] << 8) | data[1]); return (float)v * scale; }
-        case GX_F32: { float v; memcpy(&v, data, 4); return v; }
-        default: return 0.0f;
+static inline float load_u8(const u8 *p)  { return (float)p[0]; }
+static inline float load_s8(const u8 *p)  { return (float)(s8)p[0]; }
+static inline float load_u16(const u8 *p) { return (float)(u16)((p[0] << 8) | p[1]); }
+static inline float load_s16(const u8 *p) { return (float)(s16)((p[0] << 8) | p[1]); }
+
+#define COMP_READER(name, load, size, n)                                  \
+    static void name(float *out, const u8 *p, float scale) {             \
+        for (int i = 0; i < (n); i++) out[i] = load(p + i * (size)) * scale; \
+        for (int i = (n); i < 3; i++) out[i] = 0.0f;                      \
     }
+COMP_READER(read_u8_2, load_u8, 1, 2)   COMP_READER(read_u8_3, load_u8, 1, 3)
+COMP_READER(read_s8_2, load_s8, 1, 2)   COMP_READER(read_s8_3, load_s8, 1, 3)
+COMP_READER(read_u16_2, load_u16, 2, 2) COMP_READER(read_u16_3, load_u16, 2, 3)
+COMP_READER(read_s16_2, load_s16, 2, 2) COMP_READER(read_s16_3, load_s16, 2, 3)
+#undef COMP_READER
+
+/* F32 data is stored host-endian and ignores frac */
+static void read_f32_2(float *out, const u8 *p, float scale) {
+    (void)scale;
+    memcpy(out, p, 8);
+    out[2] = 0.0f;
+}
+static void read_f32_3(float *out, const u8 *p, float scale) {
+    (void)scale;
+    memcpy(out, p, 12);
+}
+static void read_none_3(float *out, const u8 *p, float scale) {
+    (void)p; (void)scale;
+    out[0] = out[1] = out[2] = 0.0f;
+}
+
+static void read_rgba8(float *out, const u8 *p, float scale) {
+    (void)scale;
+    out[0] = p[0] / 255.0f; out[1] = p[1] / 255.0f;
+    out[2] = p[2] / 255.0f; out[3] = p[3] / 255.0f;
+}
+static void read_rgb8(float *out, const u8 *p, float scale) {
+    (void)scale;
+    out[0] = p[0] / 255.0f; out[1] = p[1] / 255.0f;
+    out[2] = p[2] / 255.0f; out[3] = 255 / 255.0f;
+}
+static void read_rgba4(float *out, const u8 *p, float scale) {
+    (void)scale;
+    u16 v = (p[0] << 8) | p[1];
+    out[0] = (u8)(((v >> 12) & 0xF) * 17) / 255.0f;
+    out[1] = (u8)(((v >> 8) & 0xF) * 17) / 255.0f;
+    out[2] = (u8)(((v >> 4) & 0xF) * 17) / 255.0f;
+    out[3] = (u8)((v & 0xF) * 17) / 255.0f;
+}
+static void read_rgba6(float *out, const u8 *p, float scale) {
+    (void)scale;
+    /* 24-bit packed RGBA6 */
+    u32 v = ((u32)p[0] << 16) | ((u32)p[1] << 8) | p[2];
+    out[0] = (u8)(((v >> 18) & 0x3F) * 4) / 255.0f;
+    out[1] = (u8)(((v >> 12) & 0x3F) * 4) / 255.0f;
+    out[2] = (u8)(((v >> 6) & 0x3F) * 4) / 255.0f;
+    out[3] = (u8)((v & 0x3F) * 4) / 255.0f;
 }
 
-static inline int comp_size(GXCompType type) {
+static GXCompReadFunc comp_reader(GXCompType type, int n) {
     switch (type) {
-        case GX_U8: case GX_S8: return 1;
-        case GX_U16: case GX_S16: return 2;
-        case GX_F32: return 4;
-        default: return 1;
+        case GX_U8:  return n == 3 ? read_u8_3 : read_u8_2;
+        case GX_S8:  return n == 3 ? read_s8_3 : read_s8_2;
+        case GX_U16: return n == 3 ? read_u16_3 : read_u16_2;
+        case GX_S16: return n == 3 ? read_s16_3 : read_s16_2;
+        case GX_F32: return n == 3 ? read_f32_3 : read_f32_2;
+        default:     return read_none_3;
+    }
+}
+
+static GXAttrFetch fetch_for(const GXVtxAttrFmtEntry *fmt, int n, float extra_scale) {
+    GXAttrFetch f;
+    f.read = comp_reader(fmt->type, n);
+    f.scale = ((fmt->frac > 0) ? (1.0f / (float)(1 << fmt->frac)) : 1.0f) * extra_scale;
+    return f;
+}
+
+static void vtx_fetch_compile(GXVtxFmt vtxfmt) {
+    GXVtxFetch *f = &g_gx.vtx_fetch[vtxfmt];
+    const GXVtxAttrFmtEntry *fmt = g_gx.vtx_attr_fmt[vtxfmt];
+
+    f->pos = fetch_for(&fmt[GX_VA_POS], fmt[GX_VA_POS].cnt == GX_POS_XYZ ? 3 : 2, 1.0f);
+
+    /* Fixed-point normals are stored with 6 (S8) or 14 (S16) fraction bits */
+    const GXVtxAttrFmtEntry *nrm = &fmt[GX_VA_NRM];
+    float nrm_scale = (nrm->type == GX_S8) ? 1.0f / 64.0f :
+                      (nrm->type == GX_S16) ? 1.0f / 16384.0f : 1.0f;
+    f->nrm = fetch_for(nrm, 3, nrm_scale);
+
+    f->clr.scale = 1.0f;
+    switch (fmt[GX_VA_CLR0].type) {
+        case GX_RGBA8: f->clr.read = read_rgba8; break;
+        case GX_RGB8:
+        case GX_RGBX8: f->clr.read = read_rgb8; break;
+        case GX_RGBA4: f->clr.read = read_rgba4; break;
+        case GX_RGBA6: f->clr.read = read_rgba6; break;
+        default:
+            /* Assume RGBA8 */
+            f->clr.read = (g_gx.vtx_arrays[GX_VA_CLR0].stride >= 4) ? read_rgba8 : read_rgb8;
+            break;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        f->tex[i] = fetch_for(&fmt[GX_VA_TEX0 + i], 2, 1.0f);
+    }
+
+    /* Indexed attributes in the order GX streams them */
+    f->bulk_count = 0;
+    for (int attr = GX_VA_POS; attr <= GX_VA_TEX7; attr++) {
+        for (int i = 0; i < g_gx.vtx_desc_count; i++) {
+            if (g_gx.vtx_desc[i].attr != (GXAttr)attr) continue;
+            if (g_gx.vtx_desc[i].type == GX_INDEX8 || g_gx.vtx_desc[i].type == GX_INDEX16) {
+                f->bulk_attrs[f->bulk_count++] = (u8)attr;
+            }
+            break;
+        }
     }
+    g_gx.vtx_fetch_valid |= 1 << vtxfmt;
+}
+
+static inline const GXVtxFetch *vtx_fetch_get(GXVtxFmt vtxfmt) {
+    if (vtxfmt >= GX_MAX_VTXFMT) vtxfmt = GX_VTXFMT0;
+    if (!(g_gx.vtx_fetch_valid & (1 << vtxfmt))) vtx_fetch_compile(vtxfmt);
+    return &g_gx.vtx_fetch[vtxfmt];
 }
 
 /* ================================================================
@@ -591,6 +1390,8 @@ void GXBegin(GXPrimitive type, GXVtxFmt vtxfmt, u16 nverts) {
         dl_record(&e);
         return;
     }
+    GX_CAP(GXCAP_BEGIN, 0, type, vtxfmt, nverts);
+    g_gxperf.fifo_req++;
     g_gx.current_prim = type;
     g_gx.current_vtx_fmt = vtxfmt;
     g_gx.current_prim_nverts = nverts;
@@ -603,38 +1404,33 @@ void GXBegin(GXPrimitive type, GXVtxFmt vtxfmt, u16 nverts) {
 }
 
 static void submit_vertex(void) {
+    GXSWVertex *cur = &g_gx.current_vertex;
     if (g_gx.verts_submitted < GX_MAX_PENDING_VERTS) {
-        g_gx.vert_buf[g_gx.verts_submitted] = g_gx.current_vertex;
+        g_gx.vert_buf[g_gx.verts_submitted] = *cur;
         g_gx.verts_submitted++;
     }
-    memset(&g_gx.current_vertex, 0, sizeof(GXSWVertex));
+    /* Attributes are only ever written together with their flag, so
+     * clearing the flagged ones leaves the accumulator all zero */
+    if (g_gx.cur_vtx_has_pos) memset(cur->pos, 0, sizeof(cur->pos));
+    if (g_gx.cur_vtx_has_nrm) memset(cur->nrm, 0, sizeof(cur->nrm));
+    if (g_gx.cur_vtx_has_clr) memset(cur->color, 0, sizeof(cur->color));
+    if (g_gx.cur_vtx_texcoord_count)
+        memset(cur->texcoord, 0, g_gx.cur_vtx_texcoord_count * sizeof(cur->texcoord[0]));
     g_gx.cur_vtx_has_pos = 0;
     g_gx.cur_vtx_has_nrm = 0;
     g_gx.cur_vtx_has_clr = 0;
     g_gx.cur_vtx_texcoord_count = 0;
 }
 
-/* Determine if the current vertex is complete based on vtx_desc and auto-submit */
-static void maybe_auto_submit(void) {
-    /* Check if we have all required attributes.
-     * For simplicity, we submit when the last expected attribute arrives.
-     * The order is: pos, nrm, clr, texcoord. We check what's described. */
-    int need_nrm = 0, need_clr = 0, need_tc = 0;
-    for (int i = 0; i < g_gx.vtx_desc_count; i++) {
-        GXAttr a = g_gx.vtx_desc[i].attr;
-        if (g_gx.vtx_desc[i].type == GX_NONE) continue;
-        if (a == GX_VA_NRM || a == GX_VA_NBT) need_nrm = 1;
-        if (a == GX_VA_CLR0 || a == GX_VA_CLR1) need_clr = 1;
-        if (a >= GX_VA_TEX0 && a <= GX_VA_TEX7) need_tc = 1;
-    }
-
+/* Submit the current vertex once its last described attribute has arrived */
+static inline void maybe_auto_submit(void) {
     if (!g_gx.cur_vtx_has_pos) return;
-
-    /* If we need texcoords and have them, or if we don't need them but have everything else */
-    if (need_tc && g_gx.cur_vtx_texcoord_count > 0) { submit_vertex(); return; }
-    if (!need_tc && need_clr && g_gx.cur_vtx_has_clr) { submit_vertex(); return; }
-    if (!need_tc && !need_clr && need_nrm && g_gx.cur_vtx_has_nrm) { submit_vertex(); return; }
-    if (!need_tc && !need_clr && !need_nrm && g_gx.cur_vtx_has_pos) { submit_vertex(); return; }
+    switch (g_gx.vtx_submit_on) {
+        case GX_SUBMIT_ON_TEX: if (g_gx.cur_vtx_texcoord_count > 0) submit_vertex(); break;
+        case GX_SUBMIT_ON_CLR: if (g_gx.cur_vtx_has_clr) submit_vertex(); break;
+        case GX_SUBMIT_ON_NRM: if (g_gx.cur_vtx_has_nrm) submit_vertex(); break;
+        default:               submit_vertex(); break;
+    }
 }
 
 void GXPosition3f32(f32 x, f32 y, f32 z) {
@@ -642,6 +1438,7 @@ void GXPosition3f32(f32 x, f32 y, f32 z) {
         DLEntry e; e.cmd = DL_CMD_POSITION3F32; e.pos.x = x; e.pos.y = y; e.pos.z = z;
         dl_record(&e); return;
     }
+    GX_CAP(GXCAP_POSITION3F32, 0, gx_cap_f(x), gx_cap_f(y), gx_cap_f(z));
     g_gx.current_vertex.pos[0] = x;
     g_gx.current_vertex.pos[1] = y;
     g_gx.current_vertex.pos[2] = z;
@@ -663,17 +1460,12 @@ void GXPosition1x16(u16 index) {
         DLEntry e; e.cmd = DL_CMD_POSITION1X16; e.index = index;
         dl_record(&e); return;
     }
+    GX_CAP(GXCAP_POSITION1X16, 0, index);
     GXVtxArray *arr = &g_gx.vtx_arrays[GX_VA_POS];
     if (!arr->data) { g_gx.cur_vtx_has_pos = 1; return; }
     const u8 *p = (const u8 *)arr->data + index * arr->stride;
-    GXVtxAttrFmtEntry *fmt = &g_gx.vtx_attr_fmt[g_gx.current_vtx_fmt][GX_VA_POS];
-    int cs = comp_size(fmt->type);
-    g_gx.current_vertex.pos[0] = read_comp_float(p, fmt->type, fmt->frac); p += cs;
-    g_gx.current_vertex.pos[1] = read_comp_float(p, fmt->type, fmt->frac); p += cs;
-    if (fmt->cnt == GX_POS_XYZ)
-        g_gx.current_vertex.pos[2] = read_comp_float(p, fmt->type, fmt->frac);
-    else
-        g_gx.current_vertex.pos[2] = 0.0f;
+    const GXAttrFetch *f = &vtx_fetch_get(g_gx.current_vtx_fmt)->pos;
+    f->read(g_gx.current_vertex.pos, p, f->scale);
     g_gx.cur_vtx_has_pos = 1;
     maybe_auto_submit();
 }
@@ -691,6 +1483,7 @@ void GXNormal3f32(f32 x, f32 y, f32 z) {
         DLEntry e; e.cmd = DL_CMD_NORMAL3F32; e.pos.x = x; e.pos.y = y; e.pos.z = z;
         dl_record(&e); return;
     }
+    GX_CAP(GXCAP_NORMAL3F32, 0, gx_cap_f(x), gx_cap_f(y), gx_cap_f(z));
     g_gx.current_vertex.nrm[0] = x;
     g_gx.current_vertex.nrm[1] = y;
     g_gx.current_vertex.nrm[2] = z;
@@ -705,23 +1498,12 @@ void GXNormal1x16(u16 index) {
         DLEntry e; e.cmd = DL_CMD_NORMAL1X16; e.index = index;
         dl_record(&e); return;
     }
+    GX_CAP(GXCAP_NORMAL1X16, 0, index);
     GXVtxArray *arr = &g_gx.vtx_arrays[GX_VA_NRM];
     if (!arr->data) { g_gx.cur_vtx_has_nrm = 1; return; }
     const u8 *p = (const u8 *)arr->data + index * arr->stride;
-    GXVtxAttrFmtEntry *fmt = &g_gx.vtx_attr_fmt[g_gx.current_vtx_fmt][GX_VA_NRM];
-    int cs = comp_size(fmt->type);
-    float nx = read_comp_float(p, fmt->type, fmt->frac); p += cs;
-    float ny = read_comp_float(p, fmt->type, fmt->frac); p += cs;
-    float nz = read_comp_float(p, fmt->type, fmt->frac);
-    /* S8 normals need to be divided by 64 (or 127) to normalize */
-    if (fmt->type == GX_S8) {
-        nx /= 64.0f; ny /= 64.0f; nz /= 64.0f;
-    } else if (fmt->type == GX_S16) {
-        nx /= 16384.0f; ny /= 16384.0f; nz /= 16384.0f;
-    }
-    g_gx.current_vertex.nrm[0] = nx;
-    g_gx.current_vertex.nrm[1] = ny;
-    g_gx.current_vertex.nrm[2] = nz;
+    const GXAttrFetch *f = &vtx_fetch_get(g_gx.current_vtx_fmt)->nrm;
+    f->read(g_gx.current_vertex.nrm, p, f->scale);
     g_gx.cur_vtx_has_nrm = 1;
     maybe_auto_submit();
 }
@@ -740,6 +1522,7 @@ void GXColor4u8(u8 r, u8 g, u8 b, u8 a) {
         e.clr.r = r; e.clr.g = g; e.clr.b = b; e.clr.a = a;
         dl_record(&e); return;
     }
+    GX_CAP(GXCAP_COLOR4U8, 0, ((u32)r << 24) | ((u32)g << 16) | ((u32)b << 8) | a);
     g_gx.current_vertex.color[0] = r / 255.0f;
     g_gx.current_vertex.color[1] = g / 255.0f;
     g_gx.current_vertex.color[2] = b / 255.0f;
@@ -767,28 +1550,14 @@ void GXColor1x16(u16 index) {
         DLEntry e; e.cmd = DL_CMD_COLOR1X16; e.index = index;
         dl_record(&e); return;
     }
+    GX_CAP(GXCAP_COLOR1X16, 0, index);
     GXVtxArray *arr = &g_gx.vtx_arrays[GX_VA_CLR0];
     if (!arr->data) { g_gx.cur_vtx_has_clr = 1; return; }
     const u8 *p = (const u8 *)arr->data + index * arr->stride;
-    /* Color arrays are typically RGBA8 (4 bytes) or RGB8 (3 bytes) */
-    GXVtxAttrFmtEntry *fmt = &g_gx.vtx_attr_fmt[g_gx.current_vtx_fmt][GX_VA_CLR0];
-    if (fmt->type == GX_RGBA8) {
-        GXColor4u8(p[0], p[1], p[2], p[3]);
-    } else if (fmt->type == GX_RGB8) {
-        GXColor4u8(p[0], p[1], p[2], 255);
-    } else if (fmt->type == GX_RGBX8) {
-        GXColor4u8(p[0], p[1], p[2], 255);
-    } else if (fmt->type == GX_RGBA4) {
-        u16 v = (p[0] << 8) | p[1];
-        GXColor4u8(((v>>12)&0xF)*17, ((v>>8)&0xF)*17, ((v>>4)&0xF)*17, (v&0xF)*17);
-    } else if (fmt->type == GX_RGBA6) {
-        /* 24-bit packed RGBA6 */
-        u32 v = ((u32)p[0] << 16) | ((u32)p[1] << 8) | p[2];
-        GXColor4u8(((v>>18)&0x3F)*4, ((v>>12)&0x3F)*4, ((v>>6)&0x3F)*4, (v&0x3F)*4);
-    } else {
-        /* Default: assume RGBA8 */
-        GXColor4u8(p[0], p[1], p[2], (arr->stride >= 4) ? p[3] : 255);
-    }
+    const GXAttrFetch *f = &vtx_fetch_get(g_gx.current_vtx_fmt)->clr;
+    f->read(g_gx.current_vertex.color, p, f->scale);
+    g_gx.cur_vtx_has_clr = 1;
+    maybe_auto_submit();
 }
 
 void GXColor1x8(u8 index) {
@@ -800,6 +1569,7 @@ void GXColor1x8(u8 index) {
 }
 
 void GXColor4f32(float r, float g, float b, float a) {
+    GX_CAP(GXCAP_COLOR4F32, 0, gx_cap_f(r), gx_cap_f(g), gx_cap_f(b), gx_cap_f(a));
     g_gx.current_vertex.color[0] = r;
     g_gx.current_vertex.color[1] = g;
     g_gx.current_vertex.color[2] = b;
@@ -813,6 +1583,7 @@ void GXTexCoord2f32(f32 s, f32 t) {
         DLEntry e; e.cmd = DL_CMD_TEXCOORD2F32; e.tc.s = s; e.tc.t = t;
         dl_record(&e); return;
     }
+    GX_CAP(GXCAP_TEXCOORD2F32, 0, gx_cap_f(s), gx_cap_f(t));
     int tc = g_gx.cur_vtx_texcoord_count;
     if (tc < 8) {
         g_gx.current_vertex.texcoord[tc][0] = s;
@@ -836,17 +1607,17 @@ void GXTexCoord1x16(u16 index) {
         DLEntry e; e.cmd = DL_CMD_TEXCOORD1X16; e.index = index;
         dl_record(&e); return;
     }
+    GX_CAP(GXCAP_TEXCOORD1X16, 0, index);
     GXVtxArray *arr = &g_gx.vtx_arrays[GX_VA_TEX0];
     if (!arr->data) { submit_vertex(); return; }
     const u8 *p = (const u8 *)arr->data + index * arr->stride;
-    GXVtxAttrFmtEntry *fmt = &g_gx.vtx_attr_fmt[g_gx.current_vtx_fmt][GX_VA_TEX0];
-    int cs = comp_size(fmt->type);
-    float s = read_comp_float(p, fmt->type, fmt->frac); p += cs;
-    float t = read_comp_float(p, fmt->type, fmt->frac);
+    const GXAttrFetch *f = &vtx_fetch_get(g_gx.current_vtx_fmt)->tex[0];
+    float st[3];
+    f->read(st, p, f->scale);
     int tc = g_gx.cur_vtx_texcoord_count;
     if (tc < 8) {
-        g_gx.current_vertex.texcoord[tc][0] = s;
-        g_gx.current_vertex.texcoord[tc][1] = t;
+        g_gx.current_vertex.texcoord[tc][0] = st[0];
+        g_gx.current_vertex.texcoord[tc][1] = st[1];
         g_gx.cur_vtx_texcoord_count = tc + 1;
     }
     submit_vertex();
@@ -860,6 +1631,100 @@ void GXTexCoord1x8(u8 index) {
     GXTexCoord1x16((u16)index);
 }
 
+/* Bulk indexed submission: decode count whole vertices between GXBegin and
+ * GXEnd. indices holds, per vertex, one host-endian u16 for every attribute
+ * the current vertex descriptor marks GX_INDEX8/GX_INDEX16, in GX stream
+ * order (POS, NRM, CLR0, CLR1, TEX0..TEX7). Each TEXn reads its own array
+ * into texcoord slot n. */
+void GXPCSubmitVertices(GXVtxFmt vtxfmt, const u16 *indices, u32 count) {
+    const GXVtxFetch *f = vtx_fetch_get(vtxfmt);
+    int n = f->bulk_count;
+
+    if (g_gx.recording_dl) {
+        /* Display lists store per-attribute commands, which have no form
+         * for CLR1 or TEX1..TEX7; those indices are dropped */
+        static int warned_dl = 0;
+        for (u32 v = 0; v < count; v++, indices += n) {
+            for (int i = 0; i < n; i++) {
+                switch (f->bulk_attrs[i]) {
+                    case GX_VA_POS:  GXPosition1x16(indices[i]); break;
+                    case GX_VA_NRM:  GXNormal1x16(indices[i]); break;
+                    case GX_VA_CLR0: GXColor1x16(indices[i]); break;
+                    case GX_VA_TEX0: GXTexCoord1x16(indices[i]); break;
+                    default:
+                        if (!warned_dl) {
+                            printf("[GX] GXPCSubmitVertices: attribute %d not recorded in display list\n",
+                                   f->bulk_attrs[i]);
+                            warned_dl = 1;
+                        }
+                        break;
+                }
+            }
+        }
+        return;
+    }
+    if (g_gxcap_on) gx_cap_submit(vtxfmt, indices, count, f->bulk_attrs, n);
+
+    static int warned_direct = 0;
+    if (!warned_direct) {
+        for (int i = 0; i < g_gx.vtx_desc_count; i++) {
+            GXAttr a = g_gx.vtx_desc[i].attr;
+            if (g_gx.vtx_desc[i].type == GX_DIRECT && a >= GX_VA_POS && a <= GX_VA_TEX7) {
+                printf("[GX] GXPCSubmitVertices: direct attribute %d ignored\n", a);
+                warned_direct = 1;
+                break;
+            }
+        }
+    }
+
+    /* Resolve sources once per call */
+    const u8 *base[GX_MAX_VERTEX_ATTRS];
+    u32 stride[GX_MAX_VERTEX_ATTRS];
+    int has_pos = 0, has_nrm = 0, has_clr = 0, tc_slots = 0;
+    for (int i = 0; i < n; i++) {
+        u8 a = f->bulk_attrs[i];
+        base[i] = (const u8 *)g_gx.vtx_arrays[a].data;
+        stride[i] = g_gx.vtx_arrays[a].stride;
+        if (a == GX_VA_POS) has_pos = 1;
+        else if (a == GX_VA_NRM) has_nrm = 1;
+        else if (a == GX_VA_CLR0) has_clr = 1;
+        else if (a >= GX_VA_TEX0) tc_slots |= 1 << (a - GX_VA_TEX0);
+    }
+
+    if (count > GX_MAX_PENDING_VERTS - g_gx.verts_submitted)
+        count = GX_MAX_PENDING_VERTS - g_gx.verts_submitted;
+
+    GXSWVertex *out = &g_gx.vert_buf[g_gx.verts_submitted];
+    for (u32 v = 0; v < count; v++, out++, indices += n) {
+        /* Clear only what the descriptor doesn't supply */
+        if (!has_pos) memset(out->pos, 0, sizeof(out->pos));
+        if (!has_nrm) memset(out->nrm, 0, sizeof(out->nrm));
+        if (!has_clr) memset(out->color, 0, sizeof(out->color));
+        if (tc_slots != 0xFF) memset(out->texcoord, 0, sizeof(out->texcoord));
+
+        for (int i = 0; i < n; i++) {
+            u8 a = f->bulk_attrs[i];
+            if (!base[i]) continue;
+            const u8 *p = base[i] + indices[i] * stride[i];
+            float tmp[3];
+            switch (a) {
+                case GX_VA_POS:  f->pos.read(out->pos, p, f->pos.scale); break;
+                case GX_VA_NRM:  f->nrm.read(out->nrm, p, f->nrm.scale); break;
+                case GX_VA_CLR0: f->clr.read(out->color, p, f->clr.scale); break;
+                case GX_VA_CLR1: break;
+                default: {
+                    const GXAttrFetch *tf = &f->tex[a - GX_VA_TEX0];
+                    tf->read(tmp, p, tf->scale);
+                    out->texcoord[a - GX_VA_TEX0][0] = tmp[0];
+                    out->texcoord[a - GX_VA_TEX0][1] = tmp[1];
+                    break;
+                }
+            }
+        }
+    }
+    g_gx.verts_submitted += count;
+}
+
 /* ================================================================
  * GXEnd — rasterize collected primitives
  * ================================================================ */
@@ -870,6 +1735,7 @@ void GXEnd(void) {
         DLEntry e; e.cmd = DL_CMD_END;
         dl_record(&e); return;
     }
+    GX_CAP0(GXCAP_END);
     g_gx_end_count++;
     if (g_gx.verts_submitted > 0) {
         rasterize_primitives();
@@ -887,43 +1753,488 @@ void GXEnd(void) {
 /* ================================================================
  * Transform Pipeline
  * ================================================================ */
-static void transform_vertex(GXSWVertex *in, float *out_screen, float *out_w) {
-    u32 mtx_id = g_gx.current_pos_mtx;
-    if (mtx_id >= GX_MAX_POS_MATRICES) mtx_id = 0;
-    float (*mv)[4] = g_gx.pos_mtx[mtx_id];
-
-    /* Modelview transform (3x4) */
-    float ex = mv[0][0]*in->pos[0] + mv[0][1]*in->pos[1] + mv[0][2]*in->pos[2] + mv[0][3];
-    float ey = mv[1][0]*in->pos[0] + mv[1][1]*in->pos[1] + mv[1][2]*in->pos[2] + mv[1][3];
-    float ez = mv[2][0]*in->pos[0] + mv[2][1]*in->pos[1] + mv[2][2]*in->pos[2] + mv[2][3];
-
-    /* Projection transform (4x4) */
-    float (*p)[4] = g_gx.projection;
-    float cx = p[0][0]*ex + p[0][1]*ey + p[0][2]*ez + p[0][3];
-    float cy = p[1][0]*ex + p[1][1]*ey + p[1][2]*ez + p[1][3];
-    float cz = p[2][0]*ex + p[2][1]*ey + p[2][2]*ez + p[2][3];
-    float cw = p[3][0]*ex + p[3][1]*ey + p[3][2]*ez + p[3][3];
+/* Guard band in NDC units: vertices within +-CLIP_GUARD_NDC of the
+ * viewport center need no x/y clipping, the fixed-point setup covers them */
+#define CLIP_GUARD_NDC 32.0f
 
-    /* Perspective divide */
+/* Perspective divide and viewport transform of a clip-space position */
+static void project_vertex(GXXfVertex *v) {
+    float cw = v->clip[3];
     float inv_w;
     if (fabsf(cw) > 1e-6f) {
         inv_w = 1.0f / cw;
     } else {
         inv_w = 1.0f;
     }
-    float ndcx = cx * inv_w;
-    float ndcy = cy * inv_w;
-    float ndcz = cz * inv_w;
+    float ndcx = v->clip[0] * inv_w;
+    float ndcy = v->clip[1] * inv_w;
+    float ndcz = v->clip[2] * inv_w;
 
     /* Viewport transform: NDC [-1,1] → screen coords */
-    out_screen[0] = g_gx.vp_left + g_gx.vp_wd * (ndcx + 1.0f) * 0.5f;
-    out_screen[1] = g_gx.vp_top  + g_gx.vp_ht * (1.0f - ndcy) * 0.5f;
-    out_screen[2] = g_gx.vp_nearz + (g_gx.vp_farz - g_gx.vp_nearz) * (ndcz + 1.0f) * 0.5f;
-    *out_w = cw;
+    v->screen[0] = g_gx.vp_left + g_gx.vp_wd * (ndcx + 1.0f) * 0.5f;
+    v->screen[1] = g_gx.vp_top  + g_gx.vp_ht * (1.0f - ndcy) * 0.5f;
+    v->screen[2] = g_gx.vp_nearz + (g_gx.vp_farz - g_gx.vp_nearz) * (ndcz + 1.0f) * 0.5f;
+    v->w = cw;
+}
+
+/* Clip-space outcode (GXClipBits) */
+static u32 clip_outcode(const float *c) {
+    float x = c[0], y = c[1], z = c[2], w = c[3];
+    float gw = CLIP_GUARD_NDC * w;
+    u32 code = 0;
+    if (x < -w) code |= CLIP_LEFT;
+    if (x > w) code |= CLIP_RIGHT;
+    if (y < -w) code |= CLIP_BOTTOM;
+    if (y > w) code |= CLIP_TOP;
+    if (z < -w) code |= CLIP_NEAR;
+    if (x < -gw) code |= CLIP_GUARD_LEFT;
+    if (x > gw) code |= CLIP_GUARD_RIGHT;
+    if (y < -gw) code |= CLIP_GUARD_BOTTOM;
+    if (y > gw) code |= CLIP_GUARD_TOP;
+    return code;
+}
+
+static void transform_vertex(const GXSWVertex *in, GXXfVertex *out) {
+    u32 mtx_id = g_gx.current_pos_mtx;
+    if (mtx_id >= GX_MAX_POS_MATRICES) mtx_id = 0;
+    float (*mv)[4] = g_gx.pos_mtx[mtx_id];
+
+    /* Modelview transform (3x4) */
+    float ex = mv[0][0]*in->pos[0] + mv[0][1]*in->pos[1] + mv[0][2]*in->pos[2] + mv[0][3];
+    float ey = mv[1][0]*in->pos[0] + mv[1][1]*in->pos[1] + mv[1][2]*in->pos[2] + mv[1][3];
+    float ez = mv[2][0]*in->pos[0] + mv[2][1]*in->pos[1] + mv[2][2]*in->pos[2] + mv[2][3];
+
+    /* Projection transform (4x4) */
+    float (*p)[4] = g_gx.projection;
+    out->clip[0] = p[0][0]*ex + p[0][1]*ey + p[0][2]*ez + p[0][3];
+    out->clip[1] = p[1][0]*ex + p[1][1]*ey + p[1][2]*ez + p[1][3];
+    out->clip[2] = p[2][0]*ex + p[2][1]*ey + p[2][2]*ez + p[2][3];
+    out->clip[3] = p[3][0]*ex + p[3][1]*ey + p[3][2]*ez + p[3][3];
+    out->outcode = clip_outcode(out->clip);
+    project_vertex(out);
+}
+
+/* ================================================================
+ * Lighting
+ *
+ * Channel colors are computed per vertex after the transform, four
+ * vertices at a time in SoA form. Channel and light state resolves to a
+ * GXLightSetup only when it changes; draws whose channels are all unlit
+ * keep the plain vertex or material color and skip the stage entirely.
+ * ================================================================ */
+
+/* How COLOR0A0 reaches the rasterizer (GXDrawState.chan0) */
+enum {
+    LIGHT_CHAN_VTX,     /* vertex color; all zeros falls back to the material */
+    LIGHT_CHAN_REG,     /* material register, flat */
+    LIGHT_CHAN_LIT,     /* per vertex from light_batch */
+};
+
+/* One rasterized color: rgb from a COLOR channel, alpha from an ALPHA one */
+typedef struct {
+    GXChanCtrl ctrl[2]; /* color, alpha */
+    u8 merged;          /* both lit by the same lights and functions */
+    u8 vtx;             /* has a vertex color (COLOR0A0 only) */
+    float mat[4], amb[4];
+} GXLightOutput;
+
+typedef struct {
+    u8 chan0;           /* LIGHT_CHAN_* */
+    u8 chan1_lit;       /* COLOR1A1 varies per vertex */
+    GXLightOutput out[2];
+    float light_color[GX_MAX_LIGHTS][4];
+} GXLightSetup;
+
+static struct {
+    u8 dirty;
+    GXLightSetup setup;
+    GXPCLightStats stats;
+} g_light = { .dirty = 1 };
+
+/* Private layout of GXLightObj, as in the SDK */
+typedef struct {
+    u32 reserved[3];
+    GXColor color;
+    f32 a[3], k[3], lpos[3], ldir[3];
+} GXLightObjData;
+
+#define LIGHT_OBJ(o) ((GXLightObjData *)(o))
+
+/* Resolve the channel and light state the next draws light with */
+static const GXLightSetup *light_setup_get(void) {
+    GXLightSetup *ls = &g_light.setup;
+    if (!g_light.dirty) return ls;
+    g_light.dirty = 0;
+
+    for (int o = 0; o < 2; o++) {
+        GXLightOutput *out = &ls->out[o];
+        out->ctrl[0] = g_gx.chan_ctrl[GX_COLOR0 + o];
+        out->ctrl[1] = g_gx.chan_ctrl[GX_ALPHA0 + o];
+        if (o >= g_gx.num_chans) out->ctrl[0].enable = out->ctrl[1].enable = GX_FALSE;
+        const GXChanCtrl *c = out->ctrl;
+        out->merged = c[0].enable && c[1].enable && c[0].light_mask == c[1].light_mask &&
+                      c[0].diff_fn == c[1].diff_fn && c[0].attn_fn == c[1].attn_fn;
+        /* CLR1 is not kept per vertex; COLOR1A1 always reads its registers */
+        out->vtx = (o == 0);
+        const u8 *mat = (const u8 *)&g_gx.chan_mat[o];
+        const u8 *amb = (const u8 *)&g_gx.chan_amb[o];
+        for (int i = 0; i < 4; i++) {
+            out->mat[i] = mat[i] / 255.0f;
+            out->amb[i] = amb[i] / 255.0f;
+        }
+    }
+
+    const GXChanCtrl *c0 = ls->out[0].ctrl;
+    if (g_gx.num_chans == 0) {
+        ls->chan0 = LIGHT_CHAN_VTX;
+    } else if (!c0[0].enable && !c0[1].enable && c0[0].mat_src == c0[1].mat_src) {
+        ls->chan0 = (c0[0].mat_src == GX_SRC_VTX) ? LIGHT_CHAN_VTX : LIGHT_CHAN_REG;
+    } else {
+        ls->chan0 = LIGHT_CHAN_LIT;
+    }
+    ls->chan1_lit = ls->out[1].ctrl[0].enable || ls->out[1].ctrl[1].enable;
+
+    for (int i = 0; i < GX_MAX_LIGHTS; i++) {
+        const u8 *c = (const u8 *)&g_gx.lights[i].color;
+        for (int ch = 0; ch < 4; ch++) ls->light_color[i][ch] = c[ch] / 255.0f;
+    }
+    return ls;
+}
+
+/* Four vertices in eye space */
+typedef struct {
+    v4f pos[3];
+    v4f nrm[3];
+    v4f color[4];   /* vertex color */
+    v4f has_color;  /* 1 where the vertex color is not all zeros */
+} GXLightVerts4;
+
+/* Add the lights in ctrl's mask to components [first, first + count) */
+static void light_accumulate(const GXLightSetup *ls, const GXChanCtrl *ctrl, const GXLightVerts4 *lv,
+                             v4f *sum, int first, int count) {
+    v4f zero = v4f_set1(0.0f);
+    for (u32 m = ctrl->light_mask; m; m &= m - 1) {
+        int li = __builtin_ctz(m);
+        const GXLight *lt = &g_gx.lights[li];
+        v4f lx = v4f_sub(v4f_set1(lt->pos[0]), lv->pos[0]);
+        v4f ly = v4f_sub(v4f_set1(lt->pos[1]), lv->pos[1]);
+        v4f lz = v4f_sub(v4f_set1(lt->pos[2]), lv->pos[2]);
+        v4f d2 = v4f_add(v4f_add(v4f_mul(lx, lx), v4f_mul(ly, ly)), v4f_mul(lz, lz));
+        v4f d = v4f_sqrt(v4f_max(d2, v4f_set1(1e-20f)));
+        v4f inv_d = v4f_div(v4f_set1(1.0f), d);
+        lx = v4f_mul(lx, inv_d);
+        ly = v4f_mul(ly, inv_d);
+        lz = v4f_mul(lz, inv_d);
+        v4f ndotl = v4f_add(v4f_add(v4f_mul(lv->nrm[0], lx), v4f_mul(lv->nrm[1], ly)),
+                            v4f_mul(lv->nrm[2], lz));
+
+        /* Angle and distance attenuation; specular uses N.H for both */
+        v4f attn = v4f_set1(1.0f);
+        if (ctrl->attn_fn == GX_AF_SPEC || ctrl->attn_fn == GX_AF_SPOT) {
+            v4f cosine, dist, dist2;
+            if (ctrl->attn_fn == GX_AF_SPEC) {
+                v4f ndoth = v4f_add(v4f_add(v4f_mul(lv->nrm[0], v4f_set1(lt->dir[0])),
+                                            v4f_mul(lv->nrm[1], v4f_set1(lt->dir[1]))),
+                                    v4f_mul(lv->nrm[2], v4f_set1(lt->dir[2])));
+                cosine = v4f_select_gez(ndotl, v4f_max(zero, ndoth), zero);
+                dist = cosine;
+                dist2 = v4f_mul(cosine, cosine);
+            } else {
+                v4f ldotd = v4f_add(v4f_add(v4f_mul(lx, v4f_set1(lt->dir[0])),
+                                            v4f_mul(ly, v4f_set1(lt->dir[1]))),
+                                    v4f_mul(lz, v4f_set1(lt->dir[2])));
+                cosine = v4f_max(zero, ldotd);
+                dist = d;
+                dist2 = d2;
+            }
+            v4f num = v4f_add(v4f_add(v4f_set1(lt->a[0]), v4f_mul(v4f_set1(lt->a[1]), cosine)),
+                              v4f_mul(v4f_set1(lt->a[2]), v4f_mul(cosine, cosine)));
+            v4f den = v4f_add(v4f_add(v4f_set1(lt->k[0]), v4f_mul(v4f_set1(lt->k[1]), dist)),
+                              v4f_mul(v4f_set1(lt->k[2]), dist2));
+            attn = v4f_select_absgt(den, 1e-10f, v4f_div(v4f_max(zero, num), den), zero);
+        }
+        if (ctrl->diff_fn == GX_DF_SIGN) {
+            attn = v4f_mul(attn, ndotl);
+        } else if (ctrl->diff_fn == GX_DF_CLAMP) {
+            attn = v4f_mul(attn, v4f_max(zero, ndotl));
+        }
+
+        for (int c = first; c < first + count; c++) {
+            sum[c] = v4f_add(sum[c], v4f_mul(v4f_set1(ls->light_color[li][c]), attn));
+        }
+    }
+}
+
+/* Register value, or the vertex color where the vertex has one */
+static inline v4f light_source(const GXLightOutput *out, const GXLightVerts4 *lv, GXColorSrc src,
+                               float reg, int c) {
+    v4f r = v4f_set1(reg);
+    if (src != GX_SRC_VTX || !out->vtx) return r;
+    return v4f_add(r, v4f_mul(lv->has_color, v4f_sub(lv->color[c], r)));
+}
+
+/* One output color for four vertices */
+static void light_output4(const GXLightSetup *ls, const GXLightOutput *out, const GXLightVerts4 *lv,
+                          v4f *res) {
+    v4f sum[4];
+    for (int c = 0; c < 4; c++) {
+        const GXChanCtrl *cc = &out->ctrl[c == 3];
+        res[c] = light_source(out, lv, cc->mat_src, out->mat[c], c);
+        if (cc->enable) sum[c] = light_source(out, lv, cc->amb_src, out->amb[c], c);
+    }
+    if (out->merged) {
+        light_accumulate(ls, &out->ctrl[0], lv, sum, 0, 4);
+    } else {
+        if (out->ctrl[0].enable) light_accumulate(ls, &out->ctrl[0], lv, sum, 0, 3);
+        if (out->ctrl[1].enable) light_accumulate(ls, &out->ctrl[1], lv, sum, 3, 1);
+    }
+    v4f zero = v4f_set1(0.0f), one = v4f_set1(1.0f);
+    for (int c = 0; c < 4; c++) {
+        if (out->ctrl[c == 3].enable) res[c] = v4f_mul(res[c], v4f_max(zero, v4f_min(one, sum[c])));
+    }
+}
+
+/* Light n transformed vertices into xf[].color; bit o of outputs selects
+ * COLOR0A0 / COLOR1A1 */
+static void light_batch(const GXSWVertex *vb, GXXfVertex *xf, u32 n, int outputs) {
+    const GXLightSetup *ls = light_setup_get();
+    u32 mtx_id = g_gx.current_pos_mtx;
+    if (mtx_id >= GX_MAX_POS_MATRICES) mtx_id = 0;
+    float (*mv)[4] = g_gx.pos_mtx[mtx_id];
+    float (*nm)[4] = g_gx.nrm_mtx[mtx_id];
+
+    for (u32 i = 0; i < n; i += 4) {
+        /* Gather four vertices, repeating the last one past the end */
+        const GXSWVertex *v[4];
+        for (int l = 0; l < 4; l++) v[l] = &vb[(i + l < n) ? i + l : n - 1];
+        GXLightVerts4 lv;
+        v4f p[3], nr[3];
+        for (int c = 0; c < 3; c++) {
+            p[c] = v4f_set(v[0]->pos[c], v[1]->pos[c], v[2]->pos[c], v[3]->pos[c]);
+            nr[c] = v4f_set(v[0]->nrm[c], v[1]->nrm[c], v[2]->nrm[c], v[3]->nrm[c]);
+        }
+        for (int r = 0; r < 3; r++) {
+            lv.pos[r] = v4f_add(v4f_add(v4f_mul(v4f_set1(mv[r][0]), p[0]), v4f_mul(v4f_set1(mv[r][1]), p[1])),
+                                v4f_add(v4f_mul(v4f_set1(mv[r][2]), p[2]), v4f_set1(mv[r][3])));
+            lv.nrm[r] = v4f_add(v4f_add(v4f_mul(v4f_set1(nm[r][0]), nr[0]), v4f_mul(v4f_set1(nm[r][1]), nr[1])),
+                                v4f_mul(v4f_set1(nm[r][2]), nr[2]));
+        }
+        float has[4];
+        for (int l = 0; l < 4; l++) {
+            const float *c = v[l]->color;
+            has[l] = (c[0] != 0.0f || c[1] != 0.0f || c[2] != 0.0f || c[3] != 0.0f) ? 1.0f : 0.0f;
+        }
+        lv.has_color = v4f_load(has);
+        for (int c = 0; c < 4; c++) {
+            lv.color[c] = v4f_set(v[0]->color[c], v[1]->color[c], v[2]->color[c], v[3]->color[c]);
+        }
+
+        u32 lanes = (n - i < 4) ? n - i : 4;
+        for (int o = 0; o < 2; o++) {
+            if (!(outputs & (1 << o))) continue;
+            v4f res[4];
+            float out[4][4];
+            light_output4(ls, &ls->out[o], &lv, res);
+            for (int c = 0; c < 4; c++) v4f_store(out[c], res[c]);
+            for (u32 l = 0; l < lanes; l++) {
+                for (int c = 0; c < 4; c++) xf[i + l].color[o][c] = out[c][l];
+            }
+        }
+    }
+    g_light.stats.lit_verts += n;
+}
+
+void GXPCGetLightStats(GXPCLightStats *stats) {
+    if (stats) *stats = g_light.stats;
+}
+
+void GXSetNumChans(u8 nChans) {
+    GX_CAP(GXCAP_SET_NUM_CHANS, 0, nChans);
+    g_gx.num_chans = nChans;
+    g_light.dirty = 1;
+}
+
+void GXSetChanCtrl(GXChannelID chan, GXBool enable, GXColorSrc amb_src, GXColorSrc mat_src,
+                   u32 light_mask, GXDiffuseFn diff_fn, GXAttnFn attn_fn) {
+    if (chan > GX_COLOR1A1) return;
+    GX_CAP(GXCAP_SET_CHAN_CTRL, chan, chan, enable, amb_src, mat_src, light_mask, diff_fn, attn_fn);
+    GXChanCtrl c;
+    c.enable = enable;
+    c.amb_src = amb_src;
+    c.mat_src = mat_src;
+    c.light_mask = (u8)light_mask;
+    /* As in the SDK, specular channels take no diffuse term */
+    c.diff_fn = (u8)(attn_fn == GX_AF_SPEC ? GX_DF_NONE : diff_fn);
+    c.attn_fn = (u8)attn_fn;
+    int idx = chan & 3;
+    g_gx.chan_ctrl[idx] = c;
+    if (chan == GX_COLOR0A0 || chan == GX_COLOR1A1) g_gx.chan_ctrl[idx + 2] = c;
+    g_light.dirty = 1;
+}
+
+/* COLORn sets rgb, ALPHAn alpha, COLORnAn all four */
+static void chan_color_set(GXColor *regs, GXChannelID chan, GXColor color) {
+    switch (chan) {
+        case GX_COLOR0: case GX_COLOR1:
+            regs[chan].r = color.r;
+            regs[chan].g = color.g;
+            regs[chan].b = color.b;
+            break;
+        case GX_ALPHA0: case GX_ALPHA1:
+            regs[chan - GX_ALPHA0].a = color.a;
+            break;
+        case GX_COLOR0A0: case GX_COLOR1A1:
+            regs[chan - GX_COLOR0A0] = color;
+            break;
+        default:
+            return;
+    }
+    g_light.dirty = 1;
+}
+
+void GXSetChanAmbColor(GXChannelID chan, GXColor color) {
+    GX_CAP(GXCAP_SET_CHAN_AMB_COLOR, chan, chan, gx_cap_color(color));
+    chan_color_set(g_gx.chan_amb, chan, color);
+}
+void GXSetChanMatColor(GXChannelID chan, GXColor color) {
+    GX_CAP(GXCAP_SET_CHAN_MAT_COLOR, chan, chan, gx_cap_color(color));
+    chan_color_set(g_gx.chan_mat, chan, color);
+}
+
+void GXInitLightSpot(GXLightObj *lt_obj, f32 cutoff, GXSpotFn spot_func) {
+    float a0, a1, a2;
+    if (cutoff <= 0.0f || cutoff > 90.0f) spot_func = GX_SP_OFF;
+    float cr = cosf(cutoff * 3.1415927f / 180.0f);
+    float d;
+    switch (spot_func) {
+        case GX_SP_FLAT:
+            a0 = -1000.0f * cr; a1 = 1000.0f; a2 = 0.0f;
+            break;
+        case GX_SP_COS:
+            a0 = -cr / (1.0f - cr); a1 = 1.0f / (1.0f - cr); a2 = 0.0f;
+            break;
+        case GX_SP_COS2:
+            a0 = 0.0f; a1 = -cr / (1.0f - cr); a2 = 1.0f / (1.0f - cr);
+            break;
+        case GX_SP_SHARP:
+            d = (1.0f - cr) * (1.0f - cr);
+            a0 = cr * (cr - 2.0f) / d; a1 = 2.0f / d; a2 = -1.0f / d;
+            break;
+        case GX_SP_RING1:
+            d = (1.0f - cr) * (1.0f - cr);
+            a0 = -4.0f * cr / d; a1 = 4.0f * (1.0f + cr) / d; a2 = -4.0f / d;
+            break;
+        case GX_SP_RING2:
+            d = (1.0f - cr) * (1.0f - cr);
+            a0 = 1.0f - 2.0f * cr * cr / d; a1 = 4.0f * cr / d; a2 = -2.0f / d;
+            break;
+        case GX_SP_OFF:
+        default:
+            a0 = 1.0f; a1 = 0.0f; a2 = 0.0f;
+            break;
+    }
+    GXInitLightAttnA(lt_obj, a0, a1, a2);
+}
+
+void GXInitLightDistAttn(GXLightObj *lt_obj, f32 ref_distance, f32 ref_brightness, GXDistAttnFn dist_func) {
+    float k0, k1, k2;
+    if (ref_distance < 0.0f || ref_brightness <= 0.0f || ref_brightness >= 1.0f) dist_func = GX_DA_OFF;
+    switch (dist_func) {
+        case GX_DA_GENTLE:
+            k0 = 1.0f;
+            k1 = (1.0f - ref_brightness) / (ref_brightness * ref_distance);
+            k2 = 0.0f;
+            break;
+        case GX_DA_MEDIUM:
+            k0 = 1.0f;
+            k1 = 0.5f * (1.0f - ref_brightness) / (ref_brightness * ref_distance);
+            k2 = 0.5f * (1.0f - ref_brightness) / (ref_brightness * ref_distance * ref_distance);
+            break;
+        case GX_DA_STEEP:
+            k0 = 1.0f;
+            k1 = 0.0f;
+            k2 = (1.0f - ref_brightness) / (ref_brightness * ref_distance * ref_distance);
+            break;
+        case GX_DA_OFF:
+        default:
+            k0 = 1.0f; k1 = 0.0f; k2 = 0.0f;
+            break;
+    }
+    GXInitLightAttnK(lt_obj, k0, k1, k2);
+}
+
+void GXInitLightPos(GXLightObj *lt_obj, f32 x, f32 y, f32 z) {
+    GXLightObjData *o = LIGHT_OBJ(lt_obj);
+    o->lpos[0] = x; o->lpos[1] = y; o->lpos[2] = z;
+}
+
+/* Stored negated, as the hardware expects */
+void GXInitLightDir(GXLightObj *lt_obj, f32 nx, f32 ny, f32 nz) {
+    GXLightObjData *o = LIGHT_OBJ(lt_obj);
+    o->ldir[0] = -nx; o->ldir[1] = -ny; o->ldir[2] = -nz;
+}
+
+/* Infinite specular light: the half-angle between the light and a viewer
+ * on the +z axis, and a position far along the light direction */
+void GXInitSpecularDir(GXLightObj *lt_obj, f32 nx, f32 ny, f32 nz) {
+    GXLightObjData *o = LIGHT_OBJ(lt_obj);
+    float vx = -nx, vy = -ny, vz = -nz + 1.0f;
+    float mag = vx * vx + vy * vy + vz * vz;
+    mag = (mag > 0.0f) ? 1.0f / sqrtf(mag) : 0.0f;
+    o->ldir[0] = vx * mag; o->ldir[1] = vy * mag; o->ldir[2] = vz * mag;
+    o->lpos[0] = -nx * 1048576.0f; o->lpos[1] = -ny * 1048576.0f; o->lpos[2] = -nz * 1048576.0f;
+}
+
+void GXInitLightColor(GXLightObj *lt_obj, GXColor color) { LIGHT_OBJ(lt_obj)->color = color; }
+
+void GXInitLightAttn(GXLightObj *lt_obj, f32 a0, f32 a1, f32 a2, f32 k0, f32 k1, f32 k2) {
+    GXInitLightAttnA(lt_obj, a0, a1, a2);
+    GXInitLightAttnK(lt_obj, k0, k1, k2);
+}
+
+void GXInitLightAttnA(GXLightObj *lt_obj, f32 a0, f32 a1, f32 a2) {
+    GXLightObjData *o = LIGHT_OBJ(lt_obj);
+    o->a[0] = a0; o->a[1] = a1; o->a[2] = a2;
+}
+
+void GXInitLightAttnK(GXLightObj *lt_obj, f32 k0, f32 k1, f32 k2) {
+    GXLightObjData *o = LIGHT_OBJ(lt_obj);
+    o->k[0] = k0; o->k[1] = k1; o->k[2] = k2;
+}
+
+void GXLoadLightObjImm(GXLightObj *lt_obj, GXLightID light) {
+    const GXLightObjData *o = LIGHT_OBJ(lt_obj);
+    int idx = (light && light < GX_MAX_LIGHT) ? __builtin_ctz(light) : 0;
+    if (g_gxcap_on) {
+        const u32 w = light;
+        gx_cap_block(GXCAP_LOAD_LIGHT, idx, &w, 1, lt_obj, sizeof(GXLightObj));
+    }
+    GXLight *lt = &g_gx.lights[idx];
+    lt->color = o->color;
+    memcpy(lt->a, o->a, sizeof(lt->a));
+    memcpy(lt->k, o->k, sizeof(lt->k));
+    memcpy(lt->pos, o->lpos, sizeof(lt->pos));
+    memcpy(lt->dir, o->ldir, sizeof(lt->dir));
+    g_light.dirty = 1;
+}
+
+void GXGetLightPos(const GXLightObj *lt_obj, f32 *x, f32 *y, f32 *z) {
+    const GXLightObjData *o = (const GXLightObjData *)lt_obj;
+    if (x) *x = o->lpos[0];
+    if (y) *y = o->lpos[1];
+    if (z) *z = o->lpos[2];
+}
+
+void GXGetLightColor(const GXLightObj *lt_obj, GXColor *color) {
+    if (color) *color = ((const GXLightObjData *)lt_obj)->color;
 }
 
 /* ================================================================
- * TEV Evaluation (simplified)
+ * TEV presets
+ *
+ * Single-stage GXSetTevOp setups have fixed pixel pipelines (see
+ * pixel_pipe_select); these are the SDK's expansions of each mode for
+ * stage 0, evaluated directly.
  * ================================================================ */
 static inline void tev_evaluate(float *ras_color, float *tex_color, int has_texture, GXTevMode mode,
                                 float *out) {
@@ -946,8 +2257,11 @@ static inline void tev_evaluate(float *ras_color, float *tex_color, int has_text
             break;
         case GX_DECAL:
             if (has_texture) {
-                out[0] = tex_color[0]; out[1] = tex_color[1];
-                out[2] = tex_color[2]; out[3] = ras_color[3];
+                float a = tex_color[3];
+                out[0] = ras_color[0] * (1.0f - a) + tex_color[0] * a;
+                out[1] = ras_color[1] * (1.0f - a) + tex_color[1] * a;
+                out[2] = ras_color[2] * (1.0f - a) + tex_color[2] * a;
+                out[3] = ras_color[3];
             } else {
                 out[0] = ras_color[0]; out[1] = ras_color[1];
                 out[2] = ras_color[2]; out[3] = ras_color[3];
@@ -964,11 +2278,10 @@ static inline void tev_evaluate(float *ras_color, float *tex_color, int has_text
             break;
         case GX_BLEND:
             if (has_texture) {
-                float a = tex_color[3];
-                out[0] = ras_color[0] * (1.0f - a) + tex_color[0] * a;
-                out[1] = ras_color[1] * (1.0f - a) + tex_color[1] * a;
-                out[2] = ras_color[2] * (1.0f - a) + tex_color[2] * a;
-                out[3] = ras_color[3];
+                out[0] = ras_color[0] * (1.0f - tex_color[0]) + tex_color[0];
+                out[1] = ras_color[1] * (1.0f - tex_color[1]) + tex_color[1];
+                out[2] = ras_color[2] * (1.0f - tex_color[2]) + tex_color[2];
+                out[3] = tex_color[3] * ras_color[3];
             } else {
                 out[0] = ras_color[0]; out[1] = ras_color[1];
                 out[2] = ras_color[2]; out[3] = ras_color[3];
@@ -977,6 +2290,349 @@ static inline void tev_evaluate(float *ras_color, float *tex_color, int has_text
     }
 }
 
+/* ================================================================
+ * TEV kernels
+ *
+ * Any other setup is compiled once per distinct configuration into a
+ * list of pre-decoded ops, one per active stage. Every operand is
+ * resolved at compile time to either a varying slot (a register after
+ * its first write, the stage's texel, the rasterized color) or a per-draw
+ * uniform (konst colors, register values on entry, fixed constants),
+ * with the swap tables folded into the slot choice. Lerp terms whose
+ * inputs are the constants 0 or 1 reduce to a copy, a product or
+ * nothing, so shading cost follows the stages actually in use.
+ * ================================================================ */
+
+/* Varying slots, one v4f (four fragments) per channel */
+enum {
+    TEV_V_REG = 0,      /* PREV, REG0, REG1, REG2; rgba each */
+    TEV_V_TEX = 16,     /* current texel */
+    TEV_V_RAS = 20,     /* COLOR0A0 */
+    TEV_V_RAS1 = 24,    /* COLOR1A1 when lit per vertex */
+    TEV_VARYINGS = 28,
+};
+
+/* Per-draw uniforms (GXDrawState.tev_uniform) */
+enum {
+    TEV_U_ZERO = 0,
+    TEV_U_EIGHTHS = 1,  /* 1/8 .. 8/8 */
+    TEV_U_HALF = TEV_U_EIGHTHS + 3,
+    TEV_U_ONE = TEV_U_EIGHTHS + 7,
+    TEV_U_REG = 9,      /* registers on entry; rgba each */
+    TEV_U_KONST = 25,   /* K0..K3; rgba each */
+    TEV_U_RAS1 = 41,    /* COLOR1A1 when unlit */
+    TEV_UNIFORMS = 45,
+};
+
+/* Operand flag: index into the uniforms rather than the varyings */
+#define TEV_UNIFORM 0x80
+
+/* What an op's lerp term a * (1 - c) + b * c folds to */
+enum {
+    TEV_TERM_ZERO,
+    TEV_TERM_A,     /* c == 0, or a == b */
+    TEV_TERM_B,     /* c == 1 */
+    TEV_TERM_MUL,   /* a == 0: b * c */
+    TEV_TERM_LERP,
+};
+
+typedef struct {
+    u8 term;
+    u8 cmp;         /* GX_TEV_COMP_* op, 0 for add/sub */
+    u8 sub;
+    u8 has_d;
+    u8 has_bias_scale;
+    u8 clamp;
+    u8 out;         /* varying slot of the first channel written */
+    u8 in[4][3];    /* a, b, c, d per channel; alpha ops use channel 0 */
+    float bias, scale;
+} GXTevKernelOp;
+
+typedef struct {
+    u8 sample;      /* fetch a new texel before this stage */
+    u8 map;         /* GXTexMapID */
+    u8 coord;       /* texcoord plane */
+    GXTevKernelOp color, alpha;
+} GXTevKernelStage;
+
+/* Everything a kernel depends on; the prefix covering num_stages stages
+ * is the cache key */
+typedef struct {
+    u8 num_stages;
+    u8 tex_bound;   /* bit n: texmap n has a decoded texture */
+    u8 ras1_lit;    /* COLOR1A1 varies per vertex */
+    u8 pad;
+    struct {
+        GXTevStage tev;
+        u8 coord, map, color;
+        u8 swap[2][4];  /* resolved ras and tex swap tables */
+        u8 pad;
+    } stage[GX_MAX_TEV_STAGES];
+} GXTevConfig;
+
+#define TEV_CONFIG_SIZE(n) (offsetof(GXTevConfig, stage) + (n) * sizeof(((GXTevConfig *)0)->stage[0]))
+
+typedef struct GXTevKernel {
+    struct GXTevKernel *next; /* hash bucket chain */
+    u64 hash;
+    GXTevConfig config;
+    s8 preset;      /* GXTevMode with a fixed pipeline, or -1 */
+    u8 num_stages;
+    u8 out_color;   /* varying slot of the final color (rgb) */
+    u8 out_alpha;   /* and alpha */
+    u8 map_mask;    /* texmaps sampled */
+    u8 coord_mask;  /* texcoords interpolated */
+    u8 ras1;        /* reads the TEV_V_RAS1 varying */
+    GXTevKernelStage stage[GX_MAX_TEV_STAGES];
+} GXTevKernel;
+
+#define TEV_KERNEL_BUCKETS 256
+
+static struct {
+    GXTevKernel *buckets[TEV_KERNEL_BUCKETS];
+    GXTevConfig last_config;
+    const GXTevKernel *last;
+    GXPCTevKernelStats stats;
+} g_tev;
+
+/* Stage 0 inputs of each GXSetTevOp mode: color a-d, then alpha a-d */
+static const u8 k_tev_presets[GX_PASSCLR + 1][8] = {
+    [GX_MODULATE] = { GX_CC_ZERO, GX_CC_TEXC, GX_CC_RASC, GX_CC_ZERO,
+                      GX_CA_ZERO, GX_CA_TEXA, GX_CA_RASA, GX_CA_ZERO },
+    [GX_DECAL]    = { GX_CC_RASC, GX_CC_TEXC, GX_CC_TEXA, GX_CC_ZERO,
+                      GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, GX_CA_RASA },
+    [GX_BLEND]    = { GX_CC_RASC, GX_CC_ONE, GX_CC_TEXC, GX_CC_ZERO,
+                      GX_CA_ZERO, GX_CA_TEXA, GX_CA_RASA, GX_CA_ZERO },
+    [GX_REPLACE]  = { GX_CC_ZERO, GX_CC_ZERO, GX_CC_ZERO, GX_CC_TEXC,
+                      GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, GX_CA_TEXA },
+    [GX_PASSCLR]  = { GX_CC_ZERO, GX_CC_ZERO, GX_CC_ZERO, GX_CC_RASC,
+                      GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, GX_CA_RASA },
+};
+
+/* Operand resolution context for one stage */
+typedef struct {
+    const GXTevConfig *cfg;
+    int stage;
+    int textured;
+    u8 written;     /* bit r: register r color written; bit 4 + r: alpha */
+} GXTevCompileCtx;
+
+static u8 tev_reg_operand(const GXTevCompileCtx *cx, int reg, int comp) {
+    int bit = (comp == 3) ? (1 << (4 + reg)) : (1 << reg);
+    return (cx->written & bit) ? (u8)(TEV_V_REG + reg * 4 + comp)
+                               : (u8)(TEV_UNIFORM | (TEV_U_REG + reg * 4 + comp));
+}
+
+static u8 tev_tex_operand(const GXTevCompileCtx *cx, int comp) {
+    /* Unbound texmaps read as white */
+    if (!cx->textured) return TEV_UNIFORM | TEV_U_ONE;
+    return (u8)(TEV_V_TEX + cx->cfg->stage[cx->stage].swap[1][comp]);
+}
+
+static u8 tev_ras_operand(const GXTevCompileCtx *cx, int comp) {
+    int ch = comp == 3 ? cx->cfg->stage[cx->stage].swap[0][3] : cx->cfg->stage[cx->stage].swap[0][comp];
+    switch (cx->cfg->stage[cx->stage].color) {
+        case GX_COLOR0: case GX_ALPHA0: case GX_COLOR0A0:
+            return (u8)(TEV_V_RAS + ch);
+        case GX_COLOR1: case GX_ALPHA1: case GX_COLOR1A1:
+            if (cx->cfg->ras1_lit) return (u8)(TEV_V_RAS1 + ch);
+            return (u8)(TEV_UNIFORM | (TEV_U_RAS1 + ch));
+        default:
+            return TEV_UNIFORM | TEV_U_ZERO;
+    }
+}
+
+/* Konst selection: fixed fractions, a whole konst color or one channel of it */
+static u8 tev_konst_operand(int sel, int comp) {
+    if (sel <= GX_TEV_KCSEL_1_8) return (u8)(TEV_UNIFORM | (TEV_U_EIGHTHS + 7 - sel));
+    if (sel >= GX_TEV_KCSEL_K0 && sel <= GX_TEV_KCSEL_K3)
+        return (u8)(TEV_UNIFORM | (TEV_U_KONST + (sel - GX_TEV_KCSEL_K0) * 4 + comp));
+    if (sel >= GX_TEV_KCSEL_K0_R && sel <= GX_TEV_KCSEL_K3_A)
+        return (u8)(TEV_UNIFORM | (TEV_U_KONST + (sel & 3) * 4 + ((sel - GX_TEV_KCSEL_K0_R) >> 2)));
+    return TEV_UNIFORM | TEV_U_ZERO;
+}
+
+static u8 tev_color_operand(const GXTevCompileCtx *cx, int arg, int ch) {
+    const GXTevStage *ts = &cx->cfg->stage[cx->stage].tev;
+    switch (arg) {
+        case GX_CC_CPREV: case GX_CC_C0: case GX_CC_C1: case GX_CC_C2:
+            return tev_reg_operand(cx, arg / 2, ch);
+        case GX_CC_APREV: case GX_CC_A0: case GX_CC_A1: case GX_CC_A2:
+            return tev_reg_operand(cx, arg / 2, 3);
+        case GX_CC_TEXC:  return tev_tex_operand(cx, ch);
+        case GX_CC_TEXA:  return tev_tex_operand(cx, 3);
+        case GX_CC_RASC:  return tev_ras_operand(cx, ch);
+        case GX_CC_RASA:  return tev_ras_operand(cx, 3);
+        case GX_CC_ONE:   return TEV_UNIFORM | TEV_U_ONE;
+        case GX_CC_HALF:  return TEV_UNIFORM | TEV_U_HALF;
+        case GX_CC_KONST: return tev_konst_operand(ts->kcolor_sel, ch);
+        default:          return TEV_UNIFORM | TEV_U_ZERO;
+    }
+}
+
+static u8 tev_alpha_operand(const GXTevCompileCtx *cx, int arg) {
+    const GXTevStage *ts = &cx->cfg->stage[cx->stage].tev;
+    switch (arg) {
+        case GX_CA_APREV: case GX_CA_A0: case GX_CA_A1: case GX_CA_A2:
+            return tev_reg_operand(cx, arg, 3);
+        case GX_CA_TEXA:  return tev_tex_operand(cx, 3);
+        case GX_CA_RASA:  return tev_ras_operand(cx, 3);
+        case GX_CA_KONST: return tev_konst_operand(ts->kalpha_sel, 3);
+        default:          return TEV_UNIFORM | TEV_U_ZERO;
+    }
+}
+
+/* Fold an op's lerp term and bias/scale from its resolved operands */
+static void tev_compile_op(GXTevKernelOp *op, int nch, int tev_op, int bias, int scale, int clamp,
+                           int reg, int alpha) {
+    static const float k_bias[] = { 0.0f, 0.5f, -0.5f, 0.0f };
+    static const float k_scale[] = { 1.0f, 2.0f, 4.0f, 0.5f };
+    int a_zero = 1, b_zero = 1, c_zero = 1, c_one = 1, d_zero = 1, a_eq_b = 1;
+    for (int ch = 0; ch < nch; ch++) {
+        a_zero &= op->in[0][ch] == (TEV_UNIFORM | TEV_U_ZERO);
+        b_zero &= op->in[1][ch] == (TEV_UNIFORM | TEV_U_ZERO);
+        c_zero &= op->in[2][ch] == (TEV_UNIFORM | TEV_U_ZERO);
+        c_one &= op->in[2][ch] == (TEV_UNIFORM | TEV_U_ONE);
+        d_zero &= op->in[3][ch] == (TEV_UNIFORM | TEV_U_ZERO);
+        a_eq_b &= op->in[0][ch] == op->in[1][ch];
+    }
+    if (c_zero || a_eq_b) op->term = a_zero ? TEV_TERM_ZERO : TEV_TERM_A;
+    else if (c_one)       op->term = b_zero ? TEV_TERM_ZERO : TEV_TERM_B;
+    else if (a_zero)      op->term = b_zero ? TEV_TERM_ZERO : TEV_TERM_MUL;
+    else                  op->term = TEV_TERM_LERP;
+
+    op->cmp = (tev_op >= GX_TEV_COMP_R8_GT) ? (u8)tev_op : 0;
+    op->sub = (tev_op == GX_TEV_SUB);
+    op->has_d = !d_zero;
+    op->bias = op->cmp ? 0.0f : k_bias[bias & 3];
+    op->scale = op->cmp ? 1.0f : k_scale[scale & 3];
+    op->has_bias_scale = (op->bias != 0.0f || op->scale != 1.0f);
+    op->clamp = (u8)clamp;
+    op->out = (u8)(TEV_V_REG + (reg & 3) * 4 + (alpha ? 3 : 0));
+}
+
+static void tev_out_of_memory(void) {
+    fprintf(stderr, "[GX] TEV: out of memory for compiled kernels\n");
+    abort();
+}
+
+static GXTevKernel *tev_kernel_compile(const GXTevConfig *cfg, u64 hash) {
+    GXTevKernel *k = (GXTevKernel *)calloc(1, sizeof(GXTevKernel));
+    if (!k) tev_out_of_memory();
+    k->hash = hash;
+    memcpy(&k->config, cfg, TEV_CONFIG_SIZE(cfg->num_stages));
+    k->num_stages = cfg->num_stages;
+
+    GXTevCompileCtx cx = { cfg, 0, 0, 0 };
+    int last_map = -1, last_coord = -1;
+    for (int s = 0; s < cfg->num_stages; s++) {
+        const GXTevStage *ts = &cfg->stage[s].tev;
+        GXTevKernelStage *ks = &k->stage[s];
+        int map = cfg->stage[s].map, coord = cfg->stage[s].coord;
+        cx.stage = s;
+        cx.textured = map < GX_MAX_TEXTURES && (cfg->tex_bound & (1 << map));
+        if (coord >= GX_MAX_TEXCOORD) coord = 0;
+        if (cx.textured) {
+            ks->map = (u8)map;
+            ks->coord = (u8)coord;
+            ks->sample = (map != last_map || coord != last_coord);
+            last_map = map;
+            last_coord = coord;
+            k->map_mask |= 1 << map;
+            k->coord_mask |= 1 << coord;
+        }
+
+        /* Both ops read the registers as they were before the stage */
+        for (int i = 0; i < 4; i++) {
+            for (int ch = 0; ch < 3; ch++) ks->color.in[i][ch] = tev_color_operand(&cx, ts->color_in[i], ch);
+            ks->alpha.in[i][0] = tev_alpha_operand(&cx, ts->alpha_in[i]);
+            for (int ch = 0; ch < 3; ch++) {
+                u8 in = ks->color.in[i][ch];
+                if (in >= TEV_V_RAS1 && in < TEV_VARYINGS) k->ras1 = 1;
+            }
+            u8 in = ks->alpha.in[i][0];
+            if (in >= TEV_V_RAS1 && in < TEV_VARYINGS) k->ras1 = 1;
+        }
+        tev_compile_op(&ks->color, 3, ts->color_op, ts->color_bias, ts->color_scale,
+                       ts->color_clamp, ts->color_out, 0);
+        tev_compile_op(&ks->alpha, 1, ts->alpha_op, ts->alpha_bias, ts->alpha_scale,
+                       ts->alpha_clamp, ts->alpha_out, 1);
+        cx.written |= (u8)((1 << (ts->color_out & 3)) | (1 << (4 + (ts->alpha_out & 3))));
+        k->out_color = ks->color.out;
+        k->out_alpha = ks->alpha.out;
+    }
+
+    /* A lone GXSetTevOp stage reading COLOR0A0 unswizzled keeps its fixed
+     * pipeline. Untextured, only the modes that ignore the texel do. */
+    k->preset = -1;
+    const GXTevStage *ts = &cfg->stage[0].tev;
+    static const u8 k_identity[4] = { GX_CH_RED, GX_CH_GREEN, GX_CH_BLUE, GX_CH_ALPHA };
+    if (cfg->num_stages == 1 && cfg->stage[0].color == GX_COLOR0A0 &&
+        memcmp(cfg->stage[0].swap[0], k_identity, 4) == 0 &&
+        memcmp(cfg->stage[0].swap[1], k_identity, 4) == 0 &&
+        ts->color_op == GX_TEV_ADD && ts->alpha_op == GX_TEV_ADD &&
+        ts->color_bias == GX_TB_ZERO && ts->alpha_bias == GX_TB_ZERO &&
+        ts->color_scale == GX_CS_SCALE_1 && ts->alpha_scale == GX_CS_SCALE_1 &&
+        ts->color_clamp && ts->alpha_clamp && ts->color_out == ts->alpha_out) {
+        for (int mode = GX_MODULATE; mode <= GX_PASSCLR; mode++) {
+            if (memcmp(ts->color_in, k_tev_presets[mode], 4) != 0 ||
+                memcmp(ts->alpha_in, k_tev_presets[mode] + 4, 4) != 0) continue;
+            if (k->map_mask || mode == GX_MODULATE || mode == GX_PASSCLR) k->preset = (s8)mode;
+            break;
+        }
+    }
+    return k;
+}
+
+/* Resolve the current TEV setup to its compiled kernel */
+static const GXTevKernel *tev_kernel_get(void) {
+    GXTevConfig cfg;
+    int n = g_gx.num_tev_stages;
+    if (n < 1) n = 1;
+    if (n > GX_MAX_TEV_STAGES) n = GX_MAX_TEV_STAGES;
+    size_t size = TEV_CONFIG_SIZE(n);
+    memset(&cfg, 0, size);
+    cfg.num_stages = (u8)n;
+    cfg.ras1_lit = light_setup_get()->chan1_lit;
+    for (int i = 0; i < GX_MAX_TEXTURES; i++) {
+        if (g_gx.tex_loaded[i] && g_gx.tex_map[i].entry) cfg.tex_bound |= 1 << i;
+    }
+    for (int s = 0; s < n; s++) {
+        const GXTevStage *ts = &g_gx.tev_stage[s];
+        cfg.stage[s].tev = *ts;
+        cfg.stage[s].coord = (u8)g_gx.tev_order[s].coord;
+        cfg.stage[s].map = (u8)g_gx.tev_order[s].map;
+        cfg.stage[s].color = (u8)g_gx.tev_order[s].color;
+        memcpy(cfg.stage[s].swap[0], g_gx.tev_swap_table[ts->ras_swap & 3], 4);
+        memcpy(cfg.stage[s].swap[1], g_gx.tev_swap_table[ts->tex_swap & 3], 4);
+    }
+
+    g_tev.stats.draws++;
+    if (g_tev.last && g_tev.last->num_stages == n && memcmp(&g_tev.last_config, &cfg, size) == 0) {
+        return g_tev.last;
+    }
+
+    u64 hash = gx_hash64(&cfg, size, 0x7E7);
+    GXTevKernel **bucket = &g_tev.buckets[hash % TEV_KERNEL_BUCKETS];
+    GXTevKernel *k = *bucket;
+    while (k && !(k->hash == hash && k->num_stages == n && memcmp(&k->config, &cfg, size) == 0)) {
+        k = k->next;
+    }
+    if (!k) {
+        k = tev_kernel_compile(&cfg, hash);
+        k->next = *bucket;
+        *bucket = k;
+        g_tev.stats.kernels++;
+    }
+    memcpy(&g_tev.last_config, &cfg, size);
+    g_tev.last = k;
+    return k;
+}
+
+void GXPCGetTevKernelStats(GXPCTevKernelStats *stats) {
+    if (stats) *stats = g_tev.stats;
+}
+
 /* ================================================================
  * Blend factor helpers
  * ================================================================ */
@@ -1022,6 +2678,14 @@ static inline int depth_test(float z, float zbuf, GXCompare func) {
 
 /* ================================================================
  * Triangle Rasterizer (edge-function based)
+ *
+ * Triangles are transformed, culled and bounded on the submitting thread
+ * (setup_triangle), then either shaded immediately or recorded into
+ * 32x32 pixel tile bins together with a snapshot of the pixel-stage state.
+ * Bins are shaded in parallel by the PCJobs pool at gx_raster_flush().
+ * Each tile job only touches its own slice of the framebuffer and zbuffer
+ * and walks its bin in submission order, so the result is bit-identical
+ * to shading every triangle serially.
  * ================================================================ */
 static int g_gx_tri_count = 0;
 static int g_gx_pixel_count = 0;
@@ -1029,29 +2693,1012 @@ static int g_gx_reject_cull = 0;
 static int g_gx_reject_degen = 0;
 static int g_gx_reject_oob = 0;
 static int g_gx_reject_allclip = 0;
+static int g_gx_reject_frustum = 0;
+static int g_gx_clip_count = 0;
 static int g_gx_tri_raster_ok = 0;
 static int g_gx_tri_diag_printed = 0;
 
-static void rasterize_triangle(GXSWVertex *v0, GXSWVertex *v1, GXSWVertex *v2) {
-    float screen[3][3]; /* [vertex][x,y,z] */
-    float w[3];
+/* Pixel-stage state captured per draw so binned triangles can be shaded
+ * after the game has moved on to other state. */
+typedef struct {
+    GXTexMapState tex[GX_MAX_TEXTURES]; /* by texmap; entry NULL unless sampled */
+    const GXTevKernel *tev;
+    float         tev_uniform[TEV_UNIFORMS]; /* kernel-shaded draws only */
+    u8            tex_map;    /* texmap and texcoord of the preset pipelines */
+    u8            tex_coord;
+    u8            coord_mask; /* texcoords the triangles need planes for */
+    u8            chan0;      /* LIGHT_CHAN_*: source of COLOR0A0 */
+    GXColor       mat_color;
+    GXBool        z_enable;
+    GXCompare     z_func;
+    GXBool        z_write;
+    GXBool        color_update;
+    GXBool        alpha_update;
+    GXBlendMode   blend_type;
+    GXBlendFactor blend_src;
+    GXBlendFactor blend_dst;
+    GXCompare     alpha_comp0;
+    u8            alpha_ref0;
+    GXAlphaOp     alpha_op;
+    GXCompare     alpha_comp1;
+    u8            alpha_ref1;
+    u8            pipe;       /* index into g_pixel_pipes */
+} GXDrawState;
+
+/* Per-batch transform scratch; every vertex is transformed once even when
+ * shared by several triangles */
+static struct {
+    GXXfVertex *verts;
+    u32 cap;
+    u32 *tris;       /* assembled triangles, 3 vertex indices each */
+    u32 tri_cap;
+} g_xf;
+
+/* Attribute plane: value at pixel (px, py) = a + dx * px + dy * py,
+ * with the pixel-center offset folded into a. */
+typedef struct {
+    float a, dx, dy;
+} GXPlane;
+
+/* Triangle after setup. Coverage uses 28.4 fixed-point edge functions
+ * E(px, py) = edge_a * px + edge_b * py + edge_c, positive inside with the
+ * top-left fill rule folded into edge_c. Attributes are plane equations;
+ * color and texcoords are divided by w for perspective correction. */
+typedef struct {
+    s32 edge_a[3], edge_b[3];
+    s64 edge_c[3];
+    GXPlane z;
+    GXPlane inv_w;
+    GXPlane color[4];
+    GXPlane color1[4];                    /* COLOR1A1; only for kernels reading it */
+    GXPlane texcoord[GX_MAX_TEXCOORD][2]; /* s, t; only the draw's coord_mask is set */
+    u8 has_vtx_color;
+    s16 minx, miny, maxx, maxy; /* scissor/framebuffer clamped bounds */
+    u32 state;                  /* index into g_raster.states */
+} GXRasterTri;
+
+/* Vertices beyond this many pixels from the origin cannot be represented
+ * in the fixed-point edge setup without overflow */
+#define RASTER_GUARD_BAND 65536.0f
+#define RASTER_SUBPIXEL   16
+#define RASTER_BLOCK      8
+
+#define RASTER_TILE_SIZE  32
+#define RASTER_TILES_X    ((GX_FB_WIDTH + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE)
+#define RASTER_TILES_Y    ((GX_FB_HEIGHT + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE)
+#define RASTER_NUM_TILES  (RASTER_TILES_X * RASTER_TILES_Y)
+#define RASTER_MAX_TRIS   16384 /* flush early beyond this to bound memory */
 
-    g_gx_tri_count++;
+typedef struct {
+    u32 *tris;
+    u32 count, cap;
+    int pixels; /* pixels written by the last flush */
+    GXPerfPix perf;
+} GXRasterBin;
+
+static struct {
+    int binned;          /* 0 = shade immediately on the calling thread */
+    GXRasterTri *tris;
+    u32 tri_count, tri_cap;
+    GXDrawState *states;
+    u32 state_count, state_cap;
+    GXRasterBin bins[RASTER_NUM_TILES];
+    GXPCRasterStats stats; /* cumulative, never reset */
+} g_raster;
+
+static void raster_init(void) {
+    int threads = PC_RASTER_THREADS;
+    const char *env = getenv("MP4_RASTER_THREADS");
+    if (env && *env) threads = atoi(env);
+    if (threads < 0) threads = PCJobsCpuCount();
+
+    g_raster.binned = (threads != 0);
+    if (threads > 1) PCJobsInit(threads - 1);
+    printf("[GX] rasterizer: %s, %d thread(s)\n",
+           g_raster.binned ? "tile-binned" : "immediate",
+           g_raster.binned ? PCJobsThreadCount() : 1);
+}
+
+static void raster_out_of_memory(void) {
+    fprintf(stderr, "[GX] rasterizer: out of memory for triangle bins\n");
+    abort();
+}
+
+/* ================================================================
+ * Framebuffer
+ *
+ * Two color buffers: g_gx.framebuffer is rendered into, g_gx_framebuffer
+ * is the display copy from the last GXCopyDisp, which swaps them. A
+ * clearing copy only marks every raster tile as fast-cleared; a tile's
+ * color and depth are filled with the clear values when a bin first
+ * shades into it, and readers substitute the clear color for tiles
+ * nothing touched. With PC_FB_LAZY_CLEAR = 0 the fill happens at the
+ * copy instead (still in parallel), for comparison.
+ * ================================================================ */
+static u32 g_gx_fb[2][GX_FB_WIDTH * GX_FB_HEIGHT] __attribute__((aligned(64)));
+
+static struct {
+    u8 pending[RASTER_NUM_TILES]; /* tile still holds the last fast clear */
+    u32 color;
+    float z;
+    int lazy;                     /* PC_FB_LAZY_CLEAR */
+} g_fbclear;
+
+static void fb_init(void) {
+    memset(g_gx_fb, 0, sizeof(g_gx_fb));
+    memset(&g_fbclear, 0, sizeof(g_fbclear));
+    g_gx.framebuffer = g_gx_fb[0];
+    g_gx_framebuffer = g_gx_fb[1];
+    const char *env = getenv("MP4_FB_LAZY_CLEAR");
+    g_fbclear.lazy = (env && *env) ? (atoi(env) != 0) : PC_FB_LAZY_CLEAR;
+}
+
+/* Fill the part of a tile inside the framebuffer with the clear color,
+ * and with the clear depth if zbuffer is non-NULL */
+static void fb_fill_tile(int tile, u32 *color, float *zbuffer) {
+    int x0 = (tile % RASTER_TILES_X) * RASTER_TILE_SIZE;
+    int y0 = (tile / RASTER_TILES_X) * RASTER_TILE_SIZE;
+    int w = GX_FB_WIDTH - x0 < RASTER_TILE_SIZE ? GX_FB_WIDTH - x0 : RASTER_TILE_SIZE;
+    int h = GX_FB_HEIGHT - y0 < RASTER_TILE_SIZE ? GX_FB_HEIGHT - y0 : RASTER_TILE_SIZE;
+    v4i c = v4i_set1((s32)g_fbclear.color);
+    v4f z = v4f_set1(g_fbclear.z);
+    for (int y = y0; y < y0 + h; y++) {
+        u32 *crow = color + y * GX_FB_WIDTH + x0;
+        for (int x = 0; x < w; x += 4) v4i_store(crow + x, c);
+        if (zbuffer) {
+            float *zrow = zbuffer + y * GX_FB_WIDTH + x0;
+            for (int x = 0; x < w; x += 4) v4f_store(zrow + x, z);
+        }
+    }
+}
+
+/* Materialize a fast-cleared tile of the render target before shading it */
+static inline void fb_tile_resolve(int tile) {
+    if (!g_fbclear.pending[tile]) return;
+    fb_fill_tile(tile, g_gx.framebuffer, g_gx.zbuffer);
+    g_fbclear.pending[tile] = 0;
+}
+
+/* Immediate shading writes anywhere in the triangle's bounds */
+static void fb_resolve_rect(int minx, int miny, int maxx, int maxy) {
+    for (int ty = miny / RASTER_TILE_SIZE; ty <= maxy / RASTER_TILE_SIZE; ty++) {
+        for (int tx = minx / RASTER_TILE_SIZE; tx <= maxx / RASTER_TILE_SIZE; tx++)
+            fb_tile_resolve(ty * RASTER_TILES_X + tx);
+    }
+}
+
+/* Fill pending tiles of `color` (and of the zbuffer when `depth`) */
+typedef struct {
+    u32 *color;
+    int depth;
+} GXFbResolve;
+
+static void fb_resolve_job(void *arg, int tile) {
+    const GXFbResolve *r = (const GXFbResolve *)arg;
+    if (!g_fbclear.pending[tile]) return;
+    fb_fill_tile(tile, r->color, r->depth ? g_gx.zbuffer : NULL);
+    g_fbclear.pending[tile] = 0;
+}
+
+static void fb_resolve_all(u32 *color, int depth) {
+    GXFbResolve r = { color, depth };
+    PCJobsParallelFor(fb_resolve_job, &r, RASTER_NUM_TILES);
+}
+
+static void fb_read_job(void *arg, int band) {
+    const GXFbResolve *r = (const GXFbResolve *)arg;
+    u32 pitch = (u32)r->depth;
+    v4i c = v4i_set1((s32)g_fbclear.color);
+    int y0 = band * RASTER_TILE_SIZE;
+    int y1 = y0 + RASTER_TILE_SIZE < GX_FB_HEIGHT ? y0 + RASTER_TILE_SIZE : GX_FB_HEIGHT;
+    for (int y = y0; y < y1; y++) {
+        const u32 *src = g_gx.framebuffer + y * GX_FB_WIDTH;
+        u32 *dst = (u32 *)((u8 *)r->color + (size_t)y * pitch);
+        for (int tx = 0; tx < RASTER_TILES_X; tx++) {
+            int x0 = tx * RASTER_TILE_SIZE;
+            int w = GX_FB_WIDTH - x0 < RASTER_TILE_SIZE ? GX_FB_WIDTH - x0 : RASTER_TILE_SIZE;
+            if (g_fbclear.pending[band * RASTER_TILES_X + tx]) {
+                for (int x = x0; x < x0 + w; x += 4) v4i_store(dst + x, c);
+            } else {
+                memcpy(dst + x0, src + x0, (size_t)w * sizeof(u32));
+            }
+        }
+    }
+}
+
+void gx_fb_read(u32 *dst, u32 pitch) {
+    gx_raster_flush();
+    GXFbResolve r = { dst, (int)pitch };
+    PCJobsParallelFor(fb_read_job, &r, RASTER_TILES_Y);
+}
+
+/* ================================================================
+ * Pixel pipelines
+ *
+ * The per-fragment stages are written once as always-inline templates
+ * whose mode arguments are compile-time constants in each instantiation,
+ * so the compiler folds away the depth/TEV/blend/alpha-compare switches.
+ * raster_capture_state() resolves a draw's state to one instantiation;
+ * the rasterizer then calls it through a function pointer per 2x2 quad.
+ * ================================================================ */
+
+#define GX_ALWAYS_INLINE inline __attribute__((always_inline))
+
+/* Pipeline classes, from most to least specialized */
+enum {
+    PIPE_ZLEQ,    /* no blend, z LEQUAL + write, alpha test always passes */
+    PIPE_OPAQUE,  /* no blend, any z mode, alpha test always passes */
+    PIPE_ALPHA,   /* SRCALPHA/INVSRCALPHA blend, any z mode, alpha test always passes */
+    PIPE_GENERIC, /* everything read from the draw state */
+};
+
+#define PIPE_TEV_MODULATE GX_MODULATE
+#define PIPE_TEV_DECAL    GX_DECAL
+#define PIPE_TEV_BLEND    GX_BLEND
+#define PIPE_TEV_REPLACE  GX_REPLACE
+#define PIPE_TEV_PASSCLR  GX_PASSCLR
+#define PIPE_TEV_KERNEL   (-1)     /* compiled TEV kernel (st->tev) */
+#define PIPE_TEV_SLOTS    6
+
+static int alpha_compare(const GXDrawState *st, u8 a8) {
+    int pass0, pass1;
+    switch (st->alpha_comp0) {
+        case GX_NEVER:   pass0 = 0; break;
+        case GX_LESS:    pass0 = (a8 <  st->alpha_ref0); break;
+        case GX_EQUAL:   pass0 = (a8 == st->alpha_ref0); break;
+        case GX_LEQUAL:  pass0 = (a8 <= st->alpha_ref0); break;
+        case GX_GREATER: pass0 = (a8 >  st->alpha_ref0); break;
+        case GX_NEQUAL:  pass0 = (a8 != st->alpha_ref0); break;
+        case GX_GEQUAL:  pass0 = (a8 >= st->alpha_ref0); break;
+        default:         pass0 = 1; break; /* GX_ALWAYS */
+    }
+    switch (st->alpha_comp1) {
+        case GX_NEVER:   pass1 = 0; break;
+        case GX_LESS:    pass1 = (a8 <  st->alpha_ref1); break;
+        case GX_EQUAL:   pass1 = (a8 == st->alpha_ref1); break;
+        case GX_LEQUAL:  pass1 = (a8 <= st->alpha_ref1); break;
+        case GX_GREATER: pass1 = (a8 >  st->alpha_ref1); break;
+        case GX_NEQUAL:  pass1 = (a8 != st->alpha_ref1); break;
+        case GX_GEQUAL:  pass1 = (a8 >= st->alpha_ref1); break;
+        default:         pass1 = 1; break; /* GX_ALWAYS */
+    }
+    switch (st->alpha_op) {
+        case GX_AOP_AND:  return pass0 && pass1;
+        case GX_AOP_OR:   return pass0 || pass1;
+        case GX_AOP_XOR:  return pass0 ^ pass1;
+        case GX_AOP_XNOR: return !(pass0 ^ pass1);
+        default:          return 1;
+    }
+}
+
+static inline u32 pack_color(float r, float g, float b, u8 a) {
+    return ((u32)(u8)(r * 255.0f) << 24) | ((u32)(u8)(g * 255.0f) << 16) |
+           ((u32)(u8)(b * 255.0f) << 8) | a;
+}
+
+/* TEV, blend, alpha compare and write for one fragment that passed the
+ * depth test. Returns 1 if the color buffer was written. */
+static GX_ALWAYS_INLINE int shade_fragment(const GXDrawState *st, int fb_idx, float z,
+                                           const float *frag_color, const float *tex_color,
+                                           const int tev, const int has_texture, const int cls) {
+    /* TEV */
+    float out_color[4];
+    tev_evaluate((float *)frag_color, (float *)tex_color, has_texture, (GXTevMode)tev, out_color);
+
+    /* Alpha blending */
+    float final_r = out_color[0], final_g = out_color[1];
+    float final_b = out_color[2], final_a = out_color[3];
+
+    if (cls == PIPE_ALPHA) {
+        u32 dst_pixel = g_gx.framebuffer[fb_idx];
+        float sa = final_a, ia = 1.0f - final_a;
+        float dc[4] = {
+            ((dst_pixel >> 24) & 0xFF) / 255.0f, ((dst_pixel >> 16) & 0xFF) / 255.0f,
+            ((dst_pixel >> 8) & 0xFF) / 255.0f, (dst_pixel & 0xFF) / 255.0f,
+        };
+        float sc[4] = { final_r, final_g, final_b, final_a };
+        float res[4];
+        for (int c = 0; c < 4; c++) {
+            float val = sc[c] * sa + dc[c] * ia;
+            res[c] = val < 0 ? 0 : (val > 1 ? 1 : val);
+        }
+        final_r = res[0]; final_g = res[1]; final_b = res[2]; final_a = res[3];
+    } else if (cls == PIPE_GENERIC && st->blend_type == GX_BM_BLEND) {
+        u32 dst_pixel = g_gx.framebuffer[fb_idx];
+        float dr = ((dst_pixel >> 24) & 0xFF) / 255.0f;
+        float dg = ((dst_pixel >> 16) & 0xFF) / 255.0f;
+        float db = ((dst_pixel >> 8) & 0xFF) / 255.0f;
+        float da = (dst_pixel & 0xFF) / 255.0f;
+
+        for (int c = 0; c < 4; c++) {
+            float sc[] = {final_r, final_g, final_b, final_a};
+            float dc[] = {dr, dg, db, da};
+            float sf = blend_factor(st->blend_src, final_r, final_g, final_b, final_a,
+                                   dr, dg, db, da, c);
+            float df = blend_factor(st->blend_dst, final_r, final_g, final_b, final_a,
+                                   dr, dg, db, da, c);
+            float val = sc[c] * sf + dc[c] * df;
+            if (val < 0) val = 0; if (val > 1) val = 1;
+            if (c == 0) final_r = val;
+            else if (c == 1) final_g = val;
+            else if (c == 2) final_b = val;
+            else final_a = val;
+        }
+    }
+
+    /* Alpha compare test — discard pixel if it fails. The specialized
+     * classes are only chosen when it passes for every alpha value. */
+    if (cls == PIPE_GENERIC && !alpha_compare(st, (u8)(final_a * 255.0f)))
+        return 0;
+
+    int wrote = 0;
+    /* Write to framebuffer */
+    if (cls != PIPE_GENERIC || st->color_update) {
+        /* On GC, framebuffer alpha wasn't used for display (XFB is YUV).
+         * On PC we use alpha for compositing with sprites, so any rendered
+         * pixel must be opaque (255) unless TEV explicitly outputs transparency. */
+        u8 ab = st->alpha_update ? (u8)(final_a * 255.0f) : 0xFF;
+        g_gx.framebuffer[fb_idx] = pack_color(final_r, final_g, final_b, ab);
+        wrote = 1;
+    }
+
+    /* Write depth */
+    if (st->z_write) {
+        g_gx.zbuffer[fb_idx] = z;
+    }
+    return wrote;
+}
+
+/* TEV on four fragments at once; same arithmetic as tev_evaluate() */
+static GX_ALWAYS_INLINE void tev_evaluate4(const v4f *ras, const v4f *tex, const int has_texture,
+                                           const int tev, v4f *out) {
+    for (int c = 0; c < 4; c++) out[c] = ras[c];
+    if (!has_texture) return;
+    switch (tev) {
+        case GX_MODULATE:
+            for (int c = 0; c < 4; c++) out[c] = v4f_mul(tex[c], ras[c]);
+            break;
+        case GX_DECAL: {
+            v4f ia = v4f_sub(v4f_set1(1.0f), tex[3]);
+            for (int c = 0; c < 3; c++)
+                out[c] = v4f_add(v4f_mul(ras[c], ia), v4f_mul(tex[c], tex[3]));
+            break;
+        }
+        case GX_REPLACE:
+            for (int c = 0; c < 4; c++) out[c] = tex[c];
+            break;
+        case GX_BLEND:
+            for (int c = 0; c < 3; c++)
+                out[c] = v4f_add(v4f_mul(ras[c], v4f_sub(v4f_set1(1.0f), tex[c])), tex[c]);
+            out[3] = v4f_mul(tex[3], ras[3]);
+            break;
+        default:
+            break;
+    }
+}
+
+static inline v4f plane_eval4(const GXPlane *p, v4f xs, v4f ys) {
+    return v4f_add(v4f_set1(p->a), v4f_add(v4f_mul(v4f_set1(p->dx), xs), v4f_mul(v4f_set1(p->dy), ys)));
+}
+
+static inline v4f tev_operand(const v4f *rf, const float *uni, u8 op) {
+    return (op & TEV_UNIFORM) ? v4f_set1(uni[op & ~TEV_UNIFORM]) : rf[op];
+}
+
+/* Clamped results stay in 0..1, others in the registers' signed 11-bit range */
+static inline v4f tev_clamp(v4f r, int clamp) {
+    return clamp ? v4f_max(v4f_set1(0.0f), v4f_min(v4f_set1(1.0f), r))
+                 : v4f_max(v4f_set1(-1024.0f / 255.0f), v4f_min(v4f_set1(1023.0f / 255.0f), r));
+}
+
+/* (d +/- folded lerp term + bias) * scale for one channel */
+static inline v4f tev_op_channel(const GXTevKernelOp *op, const v4f *rf, const float *uni, int ch) {
+    v4f r;
+    switch (op->term) {
+        case TEV_TERM_A:
+            r = tev_operand(rf, uni, op->in[0][ch]);
+            break;
+        case TEV_TERM_B:
+            r = tev_operand(rf, uni, op->in[1][ch]);
+            break;
+        case TEV_TERM_MUL:
+            r = v4f_mul(tev_operand(rf, uni, op->in[1][ch]), tev_operand(rf, uni, op->in[2][ch]));
+            break;
+        case TEV_TERM_LERP: {
+            v4f a = tev_operand(rf, uni, op->in[0][ch]);
+            r = v4f_add(a, v4f_mul(v4f_sub(tev_operand(rf, uni, op->in[1][ch]), a),
+                                   tev_operand(rf, uni, op->in[2][ch])));
+            break;
+        }
+        default:
+            r = v4f_set1(0.0f);
+            break;
+    }
+    if (op->has_d) {
+        v4f d = tev_operand(rf, uni, op->in[3][ch]);
+        r = op->sub ? v4f_sub(d, r) : v4f_add(d, r);
+    } else if (op->sub) {
+        r = v4f_sub(v4f_set1(0.0f), r);
+    }
+    if (op->has_bias_scale) r = v4f_mul(v4f_add(r, v4f_set1(op->bias)), v4f_set1(op->scale));
+    return tev_clamp(r, op->clamp);
+}
+
+static inline int tev_u8(float x) {
+    return x <= 0.0f ? 0 : (x >= 1.0f ? 255 : (int)(x * 255.0f + 0.5f));
+}
+
+/* Compare ops: d + (a > b, or a == b, ? c : 0) on 8-bit values. R8, GR16
+ * and BGR24 compare the stage's color inputs packed into one number, for
+ * the alpha op too; RGB8 (A8 for alpha) compares channel by channel. */
+static void tev_op_compare(const GXTevKernelOp *op, const GXTevKernelOp *color_op,
+                           const v4f *rf, const float *uni, int nch, v4f *res) {
+    int eq = op->cmp & 1;
+    int cond[3][4];
+    if (op->cmp >= GX_TEV_COMP_RGB8_GT) {
+        for (int ch = 0; ch < nch; ch++) {
+            float a[4], b[4];
+            v4f_store(a, tev_operand(rf, uni, op->in[0][ch]));
+            v4f_store(b, tev_operand(rf, uni, op->in[1][ch]));
+            for (int l = 0; l < 4; l++) {
+                int ia = tev_u8(a[l]), ib = tev_u8(b[l]);
+                cond[ch][l] = eq ? ia == ib : ia > ib;
+            }
+        }
+    } else {
+        int bytes = (op->cmp - GX_TEV_COMP_R8_GT) / 2 + 1;
+        u32 ka[4] = {0}, kb[4] = {0};
+        for (int i = 0; i < bytes; i++) {
+            float a[4], b[4];
+            v4f_store(a, tev_operand(rf, uni, color_op->in[0][i]));
+            v4f_store(b, tev_operand(rf, uni, color_op->in[1][i]));
+            for (int l = 0; l < 4; l++) {
+                ka[l] |= (u32)tev_u8(a[l]) << (i * 8);
+                kb[l] |= (u32)tev_u8(b[l]) << (i * 8);
+            }
+        }
+        for (int ch = 0; ch < nch; ch++) {
+            for (int l = 0; l < 4; l++) cond[ch][l] = eq ? ka[l] == kb[l] : ka[l] > kb[l];
+        }
+    }
+    for (int ch = 0; ch < nch; ch++) {
+        float c[4], d[4];
+        v4f_store(c, tev_operand(rf, uni, op->in[2][ch]));
+        v4f_store(d, tev_operand(rf, uni, op->in[3][ch]));
+        for (int l = 0; l < 4; l++) d[l] += cond[ch][l] ? c[l] : 0.0f;
+        res[ch] = tev_clamp(v4f_load(d), op->clamp);
+    }
+}
+
+/* Run a compiled TEV kernel on all four lanes of a quad; the caller drops
+ * the uncovered ones. ras is the interpolated COLOR0A0, a lit COLOR1A1
+ * comes from the triangle. Writes the final color, clamped to 0..1. */
+static void tev_kernel_run4(const GXTevKernel *k, const GXDrawState *st, const GXRasterTri *t,
+                            v4f xs, v4f ys, v4f pc_inv, const v4f *ras, v4f *out) {
+    v4f rf[TEV_VARYINGS];
+    const float *uni = st->tev_uniform;
+    for (int c = 0; c < 4; c++) rf[TEV_V_RAS + c] = ras[c];
+    if (k->ras1) {
+        v4f zero = v4f_set1(0.0f), one = v4f_set1(1.0f);
+        for (int c = 0; c < 4; c++) {
+            v4f val = v4f_mul(plane_eval4(&t->color1[c], xs, ys), pc_inv);
+            rf[TEV_V_RAS1 + c] = v4f_max(zero, v4f_min(one, val));
+        }
+    }
+
+    for (int s = 0; s < k->num_stages; s++) {
+        const GXTevKernelStage *ks = &k->stage[s];
+        if (ks->sample) {
+            v4f u = v4f_mul(plane_eval4(&t->texcoord[ks->coord][0], xs, ys), pc_inv);
+            v4f v = v4f_mul(plane_eval4(&t->texcoord[ks->coord][1], xs, ys), pc_inv);
+            sample_texture4(&st->tex[ks->map], u, v, &rf[TEV_V_TEX]);
+        }
+
+        /* Both ops see the registers from before the stage */
+        v4f color[3], alpha;
+        if (ks->color.cmp) {
+            tev_op_compare(&ks->color, &ks->color, rf, uni, 3, color);
+        } else {
+            for (int ch = 0; ch < 3; ch++) color[ch] = tev_op_channel(&ks->color, rf, uni, ch);
+        }
+        if (ks->alpha.cmp) {
+            tev_op_compare(&ks->alpha, &ks->color, rf, uni, 1, &alpha);
+        } else {
+            alpha = tev_op_channel(&ks->alpha, rf, uni, 0);
+        }
+        for (int ch = 0; ch < 3; ch++) rf[ks->color.out + ch] = color[ch];
+        rf[ks->alpha.out] = alpha;
+    }
+
+    v4f zero = v4f_set1(0.0f), one = v4f_set1(1.0f);
+    for (int c = 0; c < 3; c++) out[c] = v4f_max(zero, v4f_min(one, rf[k->out_color + c]));
+    out[3] = v4f_max(zero, v4f_min(one, rf[k->out_alpha]));
+}
+
+/* Interpolate and shade the covered lanes of the 2x2 quad at (qx, qy).
+ * Lane order: (x,y) (x+1,y) (x,y+1) (x+1,y+1). */
+static GX_ALWAYS_INLINE int shade_quad(const GXRasterTri *t, const GXDrawState *st,
+                                       int qx, int qy, int mask,
+                                       const int tev, const int has_texture, const int cls) {
+    v4f xs = v4f_set((float)qx, (float)(qx + 1), (float)qx, (float)(qx + 1));
+    v4f ys = v4f_set((float)qy, (float)qy, (float)(qy + 1), (float)(qy + 1));
+    int idx[4];
+    idx[0] = qy * GX_FB_WIDTH + qx;
+    idx[1] = idx[0] + 1;
+    idx[2] = idx[0] + GX_FB_WIDTH;
+    idx[3] = idx[2] + 1;
+
+    GXPerfPix *perf = t_gxperf_pix;
+    perf->quads[__builtin_popcount(mask)]++;
+
+    v4f z = plane_eval4(&t->z, xs, ys);
+    if (cls == PIPE_ZLEQ) {
+        /* Early depth test for the whole quad. Lanes outside the
+         * framebuffer are masked off already; clamp their reads. */
+        float zb[4];
+        for (int l = 0; l < 4; l++) {
+            zb[l] = (mask & (1 << l)) ? g_gx.zbuffer[idx[l]] : 0.0f;
+        }
+        mask &= v4f_cmple_mask(z, v4f_load(zb));
+        if (!mask) return 0;
+    } else if (st->z_enable) {
+        /* Lanes are distinct pixels, so testing the quad up front is
+         * the same as testing each fragment before it is written */
+        float zs[4];
+        v4f_store(zs, z);
+        for (int l = 0; l < 4; l++) {
+            if ((mask & (1 << l)) && !depth_test(zs[l], g_gx.zbuffer[idx[l]], st->z_func))
+                mask &= ~(1 << l);
+        }
+        if (!mask) return 0;
+    }
+    int live = __builtin_popcount(mask);
+    perf->passed += live;
+    if (cls == PIPE_ALPHA || (cls == PIPE_GENERIC && st->blend_type == GX_BM_BLEND))
+        perf->blended += live;
+
+    /* Perspective-correct interpolation factor */
+    v4f denom = plane_eval4(&t->inv_w, xs, ys);
+    v4f pc_inv = v4f_select_absgt(denom, 1e-10f, v4f_div(v4f_set1(1.0f), denom), v4f_set1(1.0f));
+
+    v4f color[4];
+    if (t->has_vtx_color) {
+        v4f zero = v4f_set1(0.0f), one = v4f_set1(1.0f);
+        for (int c = 0; c < 4; c++) {
+            v4f val = v4f_mul(plane_eval4(&t->color[c], xs, ys), pc_inv);
+            color[c] = v4f_max(zero, v4f_min(one, val));
+        }
+    } else {
+        /* Use material color */
+        for (int c = 0; c < 4; c++) {
+            color[c] = v4f_set1(((const u8 *)&st->mat_color)[c] / 255.0f);
+        }
+    }
+
+    /* A compiled kernel produces the final color here; the stages below
+     * then pass it through like PASSCLR */
+    if (tev == PIPE_TEV_KERNEL) {
+        v4f shaded[4];
+        tev_kernel_run4(st->tev, st, t, xs, ys, pc_inv, color, shaded);
+        for (int c = 0; c < 4; c++) color[c] = shaded[c];
+    }
+    const int tev_mode = (tev == PIPE_TEV_KERNEL) ? PIPE_TEV_PASSCLR : tev;
+    const int textured = has_texture && tev != PIPE_TEV_KERNEL;
+
+    /* The whole quad is sampled up front: its LOD needs every lane */
+    v4f tex[4];
+    if (textured) {
+        v4f u = v4f_mul(plane_eval4(&t->texcoord[st->tex_coord][0], xs, ys), pc_inv);
+        v4f v = v4f_mul(plane_eval4(&t->texcoord[st->tex_coord][1], xs, ys), pc_inv);
+        sample_texture4(&st->tex[st->tex_map], u, v, tex);
+    }
+
+    int pixels = 0;
+    if (cls == PIPE_ZLEQ) {
+        /* Opaque fast path: no blend, no alpha test, depth already tested */
+        v4f out[4];
+        tev_evaluate4(color, tex, textured, tev_mode, out);
+
+        float o[4][4], zs[4];
+        for (int c = 0; c < 4; c++) v4f_store(o[c], out[c]);
+        v4f_store(zs, z);
+        for (int l = 0; l < 4; l++) {
+            if (!(mask & (1 << l))) continue;
+            u8 ab = st->alpha_update ? (u8)(o[3][l] * 255.0f) : 0xFF;
+            g_gx.framebuffer[idx[l]] = pack_color(o[0][l], o[1][l], o[2][l], ab);
+            g_gx.zbuffer[idx[l]] = zs[l];
+            pixels++;
+        }
+        return pixels;
+    }
+
+    float zs[4], col[4][4], tc[4][4];
+    v4f_store(zs, z);
+    for (int c = 0; c < 4; c++) v4f_store(col[c], color[c]);
+    if (textured) {
+        for (int c = 0; c < 4; c++) v4f_store(tc[c], tex[c]);
+    }
+    for (int l = 0; l < 4; l++) {
+        if (!(mask & (1 << l))) continue;
+        float frag_color[4] = { col[0][l], col[1][l], col[2][l], col[3][l] };
+        float tex_color[4] = { 1, 1, 1, 1 };
+        if (textured) {
+            for (int c = 0; c < 4; c++) tex_color[c] = tc[c][l];
+        }
+        pixels += shade_fragment(st, idx[l], zs[l], frag_color, tex_color,
+                                 tev_mode, textured, cls);
+    }
+    return pixels;
+}
+
+typedef int (*GXPixelQuadFunc)(const GXRasterTri *t, const GXDrawState *st,
+                               int qx, int qy, int mask);
+
+/* Every instantiation, ordered by (class, TEV slot, texture) so
+ * pixel_pipe_select() can index the table directly */
+#define PIXEL_PIPE_TEX(X, cls, tev) X(cls, tev, 0) X(cls, tev, 1)
+#define PIXEL_PIPE_TEVS(X, cls)                                              \
+    PIXEL_PIPE_TEX(X, cls, MODULATE) PIXEL_PIPE_TEX(X, cls, DECAL)           \
+    PIXEL_PIPE_TEX(X, cls, BLEND) PIXEL_PIPE_TEX(X, cls, REPLACE)            \
+    PIXEL_PIPE_TEX(X, cls, PASSCLR) PIXEL_PIPE_TEX(X, cls, KERNEL)
+#define PIXEL_PIPE_LIST(X)                                                   \
+    PIXEL_PIPE_TEVS(X, ZLEQ) PIXEL_PIPE_TEVS(X, OPAQUE)                      \
+    PIXEL_PIPE_TEVS(X, ALPHA) PIXEL_PIPE_TEVS(X, GENERIC)
+
+#define PIXEL_PIPE_DEFINE(cls, tev, tex)                                         \
+    static int pixel_pipe_##cls##_##tev##_##tex(const GXRasterTri *t, const GXDrawState *st, \
+                                                int qx, int qy, int mask) {      \
+        return shade_quad(t, st, qx, qy, mask, PIPE_TEV_##tev, tex, PIPE_##cls); \
+    }
+PIXEL_PIPE_LIST(PIXEL_PIPE_DEFINE)
+#undef PIXEL_PIPE_DEFINE
+
+typedef struct {
+    const char *name;
+    GXPixelQuadFunc fn;
+} GXPixelPipe;
+
+static const GXPixelPipe g_pixel_pipes[] = {
+#define PIXEL_PIPE_ENTRY(cls, tev, tex) { #cls "/" #tev "/tex" #tex, pixel_pipe_##cls##_##tev##_##tex },
+    PIXEL_PIPE_LIST(PIXEL_PIPE_ENTRY)
+#undef PIXEL_PIPE_ENTRY
+};
+
+#define PIXEL_PIPE_COUNT ((int)(sizeof(g_pixel_pipes) / sizeof(g_pixel_pipes[0])))
+
+/* Hits per pipeline: draws resolved to it, and triangles shaded by it */
+static struct {
+    u64 draws;
+    u64 tris;
+} g_pixel_pipe_hits[PIXEL_PIPE_COUNT];
+
+static int alpha_comp_always(GXCompare comp, u8 ref) {
+    return comp == GX_ALWAYS || (comp == GX_LEQUAL && ref == 255) || (comp == GX_GEQUAL && ref == 0);
+}
+
+/* Conservative: XOR/XNOR combinations always take the generic path */
+static int alpha_compare_always_passes(const GXDrawState *st) {
+    int p0 = alpha_comp_always(st->alpha_comp0, st->alpha_ref0);
+    int p1 = alpha_comp_always(st->alpha_comp1, st->alpha_ref1);
+    switch (st->alpha_op) {
+        case GX_AOP_AND: return p0 && p1;
+        case GX_AOP_OR:  return p0 || p1;
+        default:         return 0;
+    }
+}
+
+/* Resolve a draw state to its pipeline index */
+static u8 pixel_pipe_select(const GXDrawState *st) {
+    int cls = PIPE_GENERIC;
+    if (st->color_update && alpha_compare_always_passes(st)) {
+        if (st->blend_type != GX_BM_BLEND) {
+            cls = (st->z_enable && st->z_func == GX_LEQUAL && st->z_write) ? PIPE_ZLEQ : PIPE_OPAQUE;
+        } else if (st->blend_src == GX_BL_SRCALPHA && st->blend_dst == GX_BL_INVSRCALPHA) {
+            cls = PIPE_ALPHA;
+        }
+    }
+    int tev, tex;
+    if (st->tev->preset >= 0) {
+        tev = st->tev->preset;
+        tex = (st->tex[st->tex_map].entry != NULL);
+    } else {
+        tev = PIPE_TEV_SLOTS - 1;
+        tex = (st->tev->map_mask != 0);
+    }
+    return (u8)((cls * PIPE_TEV_SLOTS + tev) * 2 + tex);
+}
+
+u32 GXPCGetPixelPipeStats(GXPCPixelPipeStat *stats, u32 max) {
+    u32 n = 0;
+    for (int i = 0; i < PIXEL_PIPE_COUNT && n < max; i++) {
+        stats[n].name = g_pixel_pipes[i].name;
+        stats[n].draws = g_pixel_pipe_hits[i].draws;
+        stats[n].tris = g_pixel_pipe_hits[i].tris;
+        n++;
+    }
+    return n;
+}
+
+/* Shade the part of a triangle inside [minx,maxx] x [miny,maxy].
+ * Walks 8x8 blocks: blocks outside any edge are skipped, blocks inside all
+ * edges skip per-pixel coverage, and partial blocks step the edge functions
+ * incrementally per 2x2 quad in 32-bit SIMD lanes. */
+static int shade_triangle(const GXRasterTri *t, const GXDrawState *st,
+                          int minx, int miny, int maxx, int maxy) {
+    GXPixelQuadFunc quad = g_pixel_pipes[st->pipe].fn;
+    int pixels = 0;
+    const int last = RASTER_BLOCK - 1;
+
+    for (int by = miny & ~last; by <= maxy; by += RASTER_BLOCK) {
+        for (int bx = minx & ~last; bx <= maxx; bx += RASTER_BLOCK) {
+            /* Classify the block against each edge from its extreme corners */
+            s32 e_block[3], step_x[3], step_y[3];
+            int partial = 0, skip = 0;
+            for (int i = 0; i < 3; i++) {
+                s64 a = t->edge_a[i], b = t->edge_b[i];
+                s64 e = t->edge_c[i] + a * bx + b * by;
+                s64 emax = e + (a > 0 ? a * last : 0) + (b > 0 ? b * last : 0);
+                s64 emin = e + (a < 0 ? a * last : 0) + (b < 0 ? b * last : 0);
+                if (emax < 0) { skip = 1; break; }
+                if (emin >= 0) {
+                    /* Entirely inside this edge: ignore it for the block */
+                    e_block[i] = 0; step_x[i] = 0; step_y[i] = 0;
+                } else {
+                    /* Straddling edge: values are within 32-bit range here */
+                    e_block[i] = (s32)e; step_x[i] = (s32)a; step_y[i] = (s32)b;
+                    partial = 1;
+                }
+            }
+            if (skip) continue;
+
+            v4i lane_e[3];
+            for (int i = 0; i < 3; i++) {
+                lane_e[i] = v4i_set(0, step_x[i], step_y[i], step_x[i] + step_y[i]);
+            }
+
+            for (int qy = by; qy < by + RASTER_BLOCK; qy += 2) {
+                if (qy + 1 < miny || qy > maxy) continue;
+                int row_mask = ((qy >= miny && qy <= maxy) ? 0x3 : 0) |
+                               ((qy + 1 >= miny && qy + 1 <= maxy) ? 0xC : 0);
+                for (int qx = bx; qx < bx + RASTER_BLOCK; qx += 2) {
+                    if (qx + 1 < minx || qx > maxx) continue;
+                    int col_mask = ((qx >= minx && qx <= maxx) ? 0x5 : 0) |
+                                   ((qx + 1 >= minx && qx + 1 <= maxx) ? 0xA : 0);
+                    int mask = row_mask & col_mask;
+                    if (partial) {
+                        v4i outside = v4i_set1(0);
+                        for (int i = 0; i < 3; i++) {
+                            s32 e = e_block[i] + step_x[i] * (qx - bx) + step_y[i] * (qy - by);
+                            outside = v4i_or(outside, v4i_add(v4i_set1(e), lane_e[i]));
+                        }
+                        mask &= ~v4i_signmask(outside);
+                    }
+                    if (mask) pixels += quad(t, st, qx, qy, mask);
+                }
+            }
+        }
+    }
+    return pixels;
+}
+
+static void raster_tile_job(void *arg, int tile) {
+    (void)arg;
+    GXRasterBin *bin = &g_raster.bins[tile];
+    if (bin->count) fb_tile_resolve(tile);
+    int tx0 = (tile % RASTER_TILES_X) * RASTER_TILE_SIZE;
+    int ty0 = (tile / RASTER_TILES_X) * RASTER_TILE_SIZE;
+    int tx1 = tx0 + RASTER_TILE_SIZE - 1;
+    int ty1 = ty0 + RASTER_TILE_SIZE - 1;
+    int pixels = 0;
+    t_gxperf_pix = &bin->perf;
+
+    for (u32 i = 0; i < bin->count; i++) {
+        const GXRasterTri *t = &g_raster.tris[bin->tris[i]];
+        int minx = t->minx > tx0 ? t->minx : tx0;
+        int miny = t->miny > ty0 ? t->miny : ty0;
+        int maxx = t->maxx < tx1 ? t->maxx : tx1;
+        int maxy = t->maxy < ty1 ? t->maxy : ty1;
+        pixels += shade_triangle(t, &g_raster.states[t->state], minx, miny, maxx, maxy);
+    }
+    bin->pixels = pixels;
+    t_gxperf_pix = &g_gxperf.pix;
+}
+
+void GXPCGetRasterStats(GXPCRasterStats *stats) {
+    *stats = g_raster.stats;
+}
+
+/* Shade every binned triangle. Must run before anything reads the
+ * framebuffer/zbuffer or frees a texture a pending draw may sample. */
+void gx_raster_flush(void) {
+    if (g_raster.tri_count == 0) return;
+
+    PCJobsParallelFor(raster_tile_job, NULL, RASTER_NUM_TILES);
+
+    for (int i = 0; i < RASTER_NUM_TILES; i++) {
+        GXRasterBin *bin = &g_raster.bins[i];
+        g_gx_pixel_count += bin->pixels;
+        g_raster.stats.pixels += bin->pixels;
+        g_gxperf.written += bin->pixels;
+        if (bin->count) {
+            for (int q = 0; q < 5; q++) g_gxperf.pix.quads[q] += bin->perf.quads[q];
+            g_gxperf.pix.passed += bin->perf.passed;
+            g_gxperf.pix.blended += bin->perf.blended;
+            g_gxperf.pix.texels += bin->perf.texels;
+            memset(&bin->perf, 0, sizeof(bin->perf));
+        }
+        bin->count = 0;
+        bin->pixels = 0;
+    }
+    g_raster.tri_count = 0;
+    g_raster.state_count = 0;
+}
+
+/* Per-draw values the compiled TEV kernels read as uniforms */
+static void tev_fill_uniforms(float *u) {
+    u[TEV_U_ZERO] = 0.0f;
+    for (int i = 0; i < 8; i++) u[TEV_U_EIGHTHS + i] = (i + 1) / 8.0f;
+    for (int r = 0; r < GX_MAX_TEVREG; r++) {
+        const GXColorS10 *c = &g_gx.tev_reg[r];
+        u[TEV_U_REG + r * 4 + 0] = c->r / 255.0f;
+        u[TEV_U_REG + r * 4 + 1] = c->g / 255.0f;
+        u[TEV_U_REG + r * 4 + 2] = c->b / 255.0f;
+        u[TEV_U_REG + r * 4 + 3] = c->a / 255.0f;
+    }
+    for (int i = 0; i < GX_MAX_KCOLOR; i++) {
+        const u8 *c = (const u8 *)&g_gx.tev_kcolor[i];
+        for (int ch = 0; ch < 4; ch++) u[TEV_U_KONST + i * 4 + ch] = c[ch] / 255.0f;
+    }
+    const u8 *m = (const u8 *)&g_gx.chan_mat[1];
+    for (int ch = 0; ch < 4; ch++) u[TEV_U_RAS1 + ch] = m[ch] / 255.0f;
+}
+
+/* Snapshot the pixel-stage state for the current draw, reusing the
+ * previous snapshot when nothing changed. */
+static u32 raster_capture_state(void) {
+    GXDrawState st;
+    memset(&st, 0, sizeof(st));
+
+    const GXTevKernel *k = tev_kernel_get();
+    st.tev = k;
+    if (k->preset >= 0) {
+        /* Fixed pipeline: stage 0's texture, if any */
+        GXTexMapID tex_map = g_gx.tev_order[0].map;
+        GXTexCoordID coord = g_gx.tev_order[0].coord;
+        if (tex_map < GX_MAX_TEXTURES && (k->config.tex_bound & (1 << tex_map))) {
+            st.tex_map = (u8)tex_map;
+            st.tex_coord = (u8)(coord < GX_MAX_TEXCOORD ? coord : GX_TEXCOORD0);
+            st.tex[tex_map] = g_gx.tex_map[tex_map];
+            st.coord_mask = (u8)(1 << st.tex_coord);
+        }
+        g_tev.stats.preset_draws++;
+    } else {
+        for (int i = 0; i < GX_MAX_TEXTURES; i++) {
+            if (k->map_mask & (1 << i)) st.tex[i] = g_gx.tex_map[i];
+        }
+        st.coord_mask = k->coord_mask;
+        tev_fill_uniforms(st.tev_uniform);
+        g_tev.stats.stages += k->num_stages;
+    }
+    st.chan0 = light_setup_get()->chan0;
+    st.mat_color = g_gx.chan_mat[0];
+    st.z_enable = g_gx.z_enable;
+    st.z_func = g_gx.z_func;
+    st.z_write = g_gx.z_write;
+    st.color_update = g_gx.color_update;
+    st.alpha_update = g_gx.alpha_update;
+    st.blend_type = g_gx.blend_type;
+    st.blend_src = g_gx.blend_src;
+    st.blend_dst = g_gx.blend_dst;
+    st.alpha_comp0 = g_gx.alpha_comp0;
+    st.alpha_ref0 = g_gx.alpha_ref0;
+    st.alpha_op = g_gx.alpha_op;
+    st.alpha_comp1 = g_gx.alpha_comp1;
+    st.alpha_ref1 = g_gx.alpha_ref1;
+    st.pipe = pixel_pipe_select(&st);
+
+    if (g_raster.state_count > 0 &&
+        memcmp(&g_raster.states[g_raster.state_count - 1], &st, sizeof(st)) == 0) {
+        return g_raster.state_count - 1;
+    }
+    if (g_raster.state_count == g_raster.state_cap) {
+        u32 cap = g_raster.state_cap ? g_raster.state_cap * 2 : 256;
+        GXDrawState *grown = (GXDrawState *)realloc(g_raster.states, cap * sizeof(GXDrawState));
+        if (!grown) raster_out_of_memory();
+        g_raster.states = grown;
+        g_raster.state_cap = cap;
+    }
+    g_raster.states[g_raster.state_count] = st;
+    return g_raster.state_count++;
+}
+
+static void raster_bin_push(GXRasterBin *bin, u32 tri) {
+    if (bin->count == bin->cap) {
+        u32 cap = bin->cap ? bin->cap * 2 : 64;
+        u32 *grown = (u32 *)realloc(bin->tris, cap * sizeof(u32));
+        if (!grown) raster_out_of_memory();
+        bin->tris = grown;
+        bin->cap = cap;
+    }
+    bin->tris[bin->count++] = tri;
+}
+
+/* Fit a plane through the three vertex values f[] at the fixed-point
+ * vertex positions, evaluated at pixel centers */
+static void raster_setup_plane(GXPlane *p, const float *xs, const float *ys,
+                               float inv_area, float f0, float f1, float f2) {
+    float d1 = f1 - f0, d2 = f2 - f0;
+    p->dx = (d1 * (ys[2] - ys[0]) - d2 * (ys[1] - ys[0])) * inv_area;
+    p->dy = (d2 * (xs[1] - xs[0]) - d1 * (xs[2] - xs[0])) * inv_area;
+    p->a = f0 + p->dx * (0.5f - xs[0]) + p->dy * (0.5f - ys[0]);
+}
 
-    transform_vertex(v0, screen[0], &w[0]);
-    transform_vertex(v1, screen[1], &w[1]);
-    transform_vertex(v2, screen[2], &w[2]);
+/* Edge function from vertex a to b in 28.4 fixed point, oriented so the
+ * interior is positive. Pixels exactly on an edge belong to the triangle
+ * only for top and left edges, so shared edges are drawn once. */
+static void raster_setup_edge(GXRasterTri *t, int i, const s32 *a, const s32 *b, int sign) {
+    s64 dx = (s64)b[0] - a[0];
+    s64 dy = (s64)b[1] - a[1];
+    s64 ea = -dy * sign;
+    s64 eb = dx * sign;
+    const s64 half = RASTER_SUBPIXEL / 2;
+    s64 c = (dx * (half - a[1]) - dy * (half - a[0])) * sign;
+    int top_left = (ea > 0) || (ea == 0 && eb > 0);
+    t->edge_a[i] = (s32)(ea * RASTER_SUBPIXEL);
+    t->edge_b[i] = (s32)(eb * RASTER_SUBPIXEL);
+    t->edge_c[i] = c - (top_left ? 0 : 1);
+}
 
-    float x0 = screen[0][0], y0 = screen[0][1], z0 = screen[0][2];
-    float x1 = screen[1][0], y1 = screen[1][1], z1 = screen[1][2];
-    float x2 = screen[2][0], y2 = screen[2][1], z2 = screen[2][2];
+/* True if a triangle with this screen-space signed area is culled */
+static inline int raster_cull(float signed_area) {
+    switch (g_gx.cull_mode) {
+        case GX_CULL_BACK:  return signed_area <= 0;
+        case GX_CULL_FRONT: return signed_area >= 0;
+        case GX_CULL_ALL:   return 1;
+        default:            return 0;
+    }
+}
+
+/* Cull, bound and set up one triangle whose vertices are inside the near
+ * plane and guard band, then bin or shade it */
+static void raster_setup_triangle(const GXSWVertex *v0, const GXSWVertex *v1, const GXSWVertex *v2,
+                                  const GXXfVertex *xf0, const GXXfVertex *xf1, const GXXfVertex *xf2,
+                                  u32 state) {
+    const float *screen[3] = { xf0->screen, xf1->screen, xf2->screen }; /* [vertex][x,y,z] */
+    const float w[3] = { xf0->w, xf1->w, xf2->w };
+
+    /* The clipper keeps vertices within the guard band; this only trips
+     * for viewports so large that the band exceeds the fixed-point range */
+    for (int i = 0; i < 3; i++) {
+        if (!(fabsf(screen[i][0]) <= RASTER_GUARD_BAND && fabsf(screen[i][1]) <= RASTER_GUARD_BAND)) {
+            g_gx_reject_allclip++;
+            g_raster.stats.guard_rejects++;
+            return;
+        }
+    }
+
+    /* Snap to 28.4 fixed point */
+    s32 fx[3][2];
+    float xs[3], ys[3];
+    for (int i = 0; i < 3; i++) {
+        fx[i][0] = (s32)lrintf(screen[i][0] * RASTER_SUBPIXEL);
+        fx[i][1] = (s32)lrintf(screen[i][1] * RASTER_SUBPIXEL);
+        xs[i] = fx[i][0] * (1.0f / RASTER_SUBPIXEL);
+        ys[i] = fx[i][1] * (1.0f / RASTER_SUBPIXEL);
+    }
+    float x0 = xs[0], y0 = ys[0];
+    float x1 = xs[1], y1 = ys[1];
+    float x2 = xs[2], y2 = ys[2];
 
     /* Signed area for culling */
     float signed_area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
 
-    if (g_gx.cull_mode == GX_CULL_BACK && signed_area <= 0) { g_gx_reject_cull++; return; }
-    if (g_gx.cull_mode == GX_CULL_FRONT && signed_area >= 0) { g_gx_reject_cull++; return; }
-    if (g_gx.cull_mode == GX_CULL_ALL) { g_gx_reject_cull++; return; }
+    if (raster_cull(signed_area)) {
+        g_gx_reject_cull++;
+        g_raster.stats.culled++;
+        g_gxperf.tris_culled++;
+        return;
+    }
 
     /* Diagnostic for visible triangles (disabled - set threshold > 0 to re-enable) */
     if (g_gx_tri_diag_printed < 0) {
@@ -1061,9 +3708,11 @@ static void rasterize_triangle(GXSWVertex *v0, GXSWVertex *v1, GXSWVertex *v2) {
         g_gx_tri_diag_printed++;
     }
 
-    if (fabsf(signed_area) < 0.5f) { g_gx_reject_degen++; return; } /* Degenerate triangle */
-
-    float inv_area = 1.0f / signed_area;
+    if (fabsf(signed_area) < 0.5f) { /* Degenerate triangle */
+        g_gx_reject_degen++;
+        g_gxperf.tris_culled++;
+        return;
+    }
 
     /* Bounding box */
     float fminx = fminf(fminf(x0, x1), x2);
@@ -1083,291 +3732,439 @@ static void rasterize_triangle(GXSWVertex *v0, GXSWVertex *v1, GXSWVertex *v2) {
     if (maxx >= GX_FB_WIDTH) maxx = GX_FB_WIDTH - 1;
     if (maxy >= GX_FB_HEIGHT) maxy = GX_FB_HEIGHT - 1;
 
-    if (minx > maxx || miny > maxy) { g_gx_reject_oob++; return; }
+    if (minx > maxx || miny > maxy) {
+        g_gx_reject_oob++;
+        g_gxperf.tris_scissored++;
+        return;
+    }
 
     g_gx_tri_raster_ok++;
+    g_gxperf.tris_passed++;
+    g_raster.stats.tris_drawn++;
+    g_pixel_pipe_hits[g_raster.states[state].pipe].tris++;
+
+    GXRasterTri local;
+    GXRasterTri *t = &local;
+    if (g_raster.binned) {
+        if (g_raster.tri_count == g_raster.tri_cap) {
+            u32 cap = g_raster.tri_cap ? g_raster.tri_cap * 2 : 1024;
+            GXRasterTri *grown = (GXRasterTri *)realloc(g_raster.tris, cap * sizeof(GXRasterTri));
+            if (!grown) raster_out_of_memory();
+            g_raster.tris = grown;
+            g_raster.tri_cap = cap;
+        }
+        t = &g_raster.tris[g_raster.tri_count];
+    }
 
-    /* Determine rasterized color source */
-    float ras_r, ras_g, ras_b, ras_a;
-    int vtx_has_color = (v0->color[3] != 0.0f || v0->color[0] != 0.0f ||
-                         v0->color[1] != 0.0f || v0->color[2] != 0.0f);
-    if (!vtx_has_color) {
-        /* Use material color */
-        ras_r = g_gx.chan_mat[0].r / 255.0f;
-        ras_g = g_gx.chan_mat[0].g / 255.0f;
-        ras_b = g_gx.chan_mat[0].b / 255.0f;
-        ras_a = g_gx.chan_mat[0].a / 255.0f;
+    /* Edge functions */
+    int sign = signed_area > 0 ? 1 : -1;
+    raster_setup_edge(t, 0, fx[1], fx[2], sign);
+    raster_setup_edge(t, 1, fx[2], fx[0], sign);
+    raster_setup_edge(t, 2, fx[0], fx[1], sign);
+
+    /* Attribute planes; color and texcoords are pre-divided by w */
+    const GXSWVertex *v[3] = { v0, v1, v2 };
+    float inv_area = 1.0f / signed_area;
+    float inv_w[3];
+    for (int i = 0; i < 3; i++) {
+        inv_w[i] = (fabsf(w[i]) > 1e-6f) ? 1.0f / w[i] : 1.0f;
+    }
+    raster_setup_plane(&t->z, xs, ys, inv_area, screen[0][2], screen[1][2], screen[2][2]);
+    raster_setup_plane(&t->inv_w, xs, ys, inv_area, inv_w[0], inv_w[1], inv_w[2]);
+
+    const GXDrawState *st = &g_raster.states[state];
+    if (st->chan0 == LIGHT_CHAN_LIT) {
+        const GXXfVertex *xv[3] = { xf0, xf1, xf2 };
+        t->has_vtx_color = 1;
+        for (int c = 0; c < 4; c++) {
+            raster_setup_plane(&t->color[c], xs, ys, inv_area,
+                               xv[0]->color[0][c] * inv_w[0], xv[1]->color[0][c] * inv_w[1],
+                               xv[2]->color[0][c] * inv_w[2]);
+        }
+    } else if (st->chan0 == LIGHT_CHAN_VTX) {
+        /* A vertex color of all zeros on the first vertex means "no color
+         * attribute"; fall back to the material color */
+        t->has_vtx_color = (v0->color[3] != 0.0f || v0->color[0] != 0.0f ||
+                            v0->color[1] != 0.0f || v0->color[2] != 0.0f);
+        if (t->has_vtx_color) {
+            for (int c = 0; c < 4; c++) {
+                raster_setup_plane(&t->color[c], xs, ys, inv_area,
+                                   v[0]->color[c] * inv_w[0], v[1]->color[c] * inv_w[1],
+                                   v[2]->color[c] * inv_w[2]);
+            }
+        }
     } else {
-        ras_r = ras_g = ras_b = ras_a = 0; /* will interpolate per-pixel */
+        t->has_vtx_color = 0;
+    }
+    if (st->tev->ras1) {
+        for (int c = 0; c < 4; c++) {
+            raster_setup_plane(&t->color1[c], xs, ys, inv_area,
+                               xf0->color[1][c] * inv_w[0], xf1->color[1][c] * inv_w[1],
+                               xf2->color[1][c] * inv_w[2]);
+        }
+    }
+    for (u32 mask = st->coord_mask; mask; mask &= mask - 1) {
+        int n = __builtin_ctz(mask);
+        for (int c = 0; c < 2; c++) {
+            raster_setup_plane(&t->texcoord[n][c], xs, ys, inv_area,
+                               v[0]->texcoord[n][c] * inv_w[0], v[1]->texcoord[n][c] * inv_w[1],
+                               v[2]->texcoord[n][c] * inv_w[2]);
+        }
     }
 
-    /* TEV: figure out which texture is used by stage 0 */
-    GXTexMapID tex_map = g_gx.tev_order[0].map;
-    int has_texture = 0;
-    GXTexCacheEntry *tc = NULL;
-    if (tex_map < GX_MAX_TEXTURES && g_gx.tex_loaded[tex_map] && g_gx.tex_cache[tex_map].decoded) {
-        tc = &g_gx.tex_cache[tex_map];
-        has_texture = 1;
+    t->minx = (s16)minx; t->miny = (s16)miny;
+    t->maxx = (s16)maxx; t->maxy = (s16)maxy;
+    t->state = state;
+
+    if (!g_raster.binned) {
+        fb_resolve_rect(minx, miny, maxx, maxy);
+        int pixels = shade_triangle(t, &g_raster.states[state], minx, miny, maxx, maxy);
+        g_gx_pixel_count += pixels;
+        g_raster.stats.pixels += pixels;
+        g_gxperf.written += pixels;
+        return;
     }
 
-    GXTevMode tev_mode = g_gx.tev_mode[0];
+    u32 idx = g_raster.tri_count++;
+    for (int ty = miny / RASTER_TILE_SIZE; ty <= maxy / RASTER_TILE_SIZE; ty++) {
+        for (int tx = minx / RASTER_TILE_SIZE; tx <= maxx / RASTER_TILE_SIZE; tx++) {
+            raster_bin_push(&g_raster.bins[ty * RASTER_TILES_X + tx], idx);
+        }
+    }
+}
 
-    /* Perspective-correct interpolation: 1/w per vertex */
-    float inv_w0 = (fabsf(w[0]) > 1e-6f) ? 1.0f / w[0] : 1.0f;
-    float inv_w1 = (fabsf(w[1]) > 1e-6f) ? 1.0f / w[1] : 1.0f;
-    float inv_w2 = (fabsf(w[2]) > 1e-6f) ? 1.0f / w[2] : 1.0f;
+/* Vertex of a polygon being clipped */
+typedef struct {
+    GXSWVertex v;
+    float clip[4];
+    float color[2][4]; /* lit channel colors */
+} GXClipVertex;
+
+#define CLIP_MAX_VERTS 9 /* a triangle cut by five planes */
+
+/* Signed distance to a clip plane, >= 0 inside */
+static inline float clip_plane_dist(u32 plane, const float *c) {
+    float gw = CLIP_GUARD_NDC * c[3];
+    switch (plane) {
+        case CLIP_NEAR:         return c[2] + c[3];
+        case CLIP_GUARD_LEFT:   return c[0] + gw;
+        case CLIP_GUARD_RIGHT:  return gw - c[0];
+        case CLIP_GUARD_BOTTOM: return c[1] + gw;
+        default:                return gw - c[1];
+    }
+}
 
-    for (int py = miny; py <= maxy; py++) {
-        for (int px = minx; px <= maxx; px++) {
-            float pxf = px + 0.5f, pyf = py + 0.5f;
+static void clip_lerp(GXClipVertex *out, const GXClipVertex *a, const GXClipVertex *b, float t) {
+    const float *fa = (const float *)&a->v, *fb = (const float *)&b->v;
+    float *fo = (float *)&out->v;
+    for (u32 i = 0; i < sizeof(GXSWVertex) / sizeof(float); i++) fo[i] = fa[i] + (fb[i] - fa[i]) * t;
+    for (int i = 0; i < 4; i++) out->clip[i] = a->clip[i] + (b->clip[i] - a->clip[i]) * t;
+    for (int ch = 0; ch < 2; ch++) {
+        for (int i = 0; i < 4; i++)
+            out->color[ch][i] = a->color[ch][i] + (b->color[ch][i] - a->color[ch][i]) * t;
+    }
+}
 
-            /* Barycentric coordinates */
-            float e0 = (x1 - x0) * (pyf - y0) - (y1 - y0) * (pxf - x0);
-            float e1 = (x2 - x1) * (pyf - y1) - (y2 - y1) * (pxf - x1);
-            float e2 = (x0 - x2) * (pyf - y2) - (y0 - y2) * (pxf - x2);
+/* Sutherland-Hodgman against one plane; returns the new vertex count */
+static int clip_polygon(u32 plane, const GXClipVertex *in, int n, GXClipVertex *out) {
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        const GXClipVertex *a = &in[i], *b = &in[(i + 1) % n];
+        float da = clip_plane_dist(plane, a->clip);
+        float db = clip_plane_dist(plane, b->clip);
+        if (da >= 0) out[m++] = *a;
+        if ((da >= 0) != (db >= 0)) clip_lerp(&out[m++], a, b, da / (da - db));
+    }
+    return m;
+}
 
-            /* Winding check */
-            if (signed_area > 0) {
-                if (e0 < 0 || e1 < 0 || e2 < 0) continue;
-            } else {
-                if (e0 > 0 || e1 > 0 || e2 > 0) continue;
-            }
+/* Reject, cull or clip one triangle, then set up what remains. Triangles
+ * inside the near plane and guard band go straight to setup; only those
+ * crossing them pay for clipping. */
+static void rasterize_triangle(const GXSWVertex *v0, const GXSWVertex *v1, const GXSWVertex *v2,
+                               const GXXfVertex *xf0, const GXXfVertex *xf1, const GXXfVertex *xf2,
+                               u32 state) {
+    g_gx_tri_count++;
+    g_raster.stats.tris++;
+    g_gxperf.tris++;
+
+    if (xf0->outcode & xf1->outcode & xf2->outcode) {
+        g_gx_reject_frustum++;
+        g_raster.stats.frustum_rejects++;
+        return;
+    }
+    u32 planes = (xf0->outcode | xf1->outcode | xf2->outcode) & CLIP_MUST_CLIP;
+    if (!planes) {
+        raster_setup_triangle(v0, v1, v2, xf0, xf1, xf2, state);
+        return;
+    }
 
-            float bary2 = e0 * inv_area;
-            float bary0 = e1 * inv_area;
-            float bary1 = e2 * inv_area;
+    /* Facing from the homogeneous (x, y, w) determinant holds for the
+     * visible part even with vertices behind the eye, so culled triangles
+     * skip clipping. Viewport y points down, hence the sign flip. */
+    const float *c0 = xf0->clip, *c1 = xf1->clip, *c2 = xf2->clip;
+    float det = c0[0] * (c1[1] * c2[3] - c2[1] * c1[3])
+              - c0[1] * (c1[0] * c2[3] - c2[0] * c1[3])
+              + c0[3] * (c1[0] * c2[1] - c2[0] * c1[1]);
+    if (raster_cull(-det * g_gx.vp_wd * g_gx.vp_ht)) {
+        g_gx_reject_cull++;
+        g_raster.stats.culled++;
+        g_gxperf.tris_culled++;
+        return;
+    }
 
-            /* Interpolate depth */
-            float z = bary0 * z0 + bary1 * z1 + bary2 * z2;
+    g_gx_clip_count++;
+    g_raster.stats.clipped++;
 
-            /* Depth test */
-            int fb_idx = py * GX_FB_WIDTH + px;
-            if (g_gx.z_enable && !depth_test(z, g_gx.zbuffer[fb_idx], g_gx.z_func))
-                continue;
+    GXClipVertex buf[2][CLIP_MAX_VERTS];
+    const GXSWVertex *src[3] = { v0, v1, v2 };
+    const GXXfVertex *xsrc[3] = { xf0, xf1, xf2 };
+    for (int i = 0; i < 3; i++) {
+        buf[0][i].v = *src[i];
+        memcpy(buf[0][i].clip, xsrc[i]->clip, sizeof(buf[0][i].clip));
+        memcpy(buf[0][i].color, xsrc[i]->color, sizeof(buf[0][i].color));
+    }
+    int n = 3, cur = 0;
+    for (u32 plane = CLIP_NEAR; plane <= CLIP_GUARD_TOP && n >= 3; plane <<= 1) {
+        if (!(planes & plane)) continue;
+        n = clip_polygon(plane, buf[cur], n, buf[cur ^ 1]);
+        cur ^= 1;
+    }
+    if (n < 3) return;
+    g_gxperf.clip_vtx += n;
+
+    GXXfVertex xf[CLIP_MAX_VERTS];
+    for (int i = 0; i < n; i++) {
+        memcpy(xf[i].clip, buf[cur][i].clip, sizeof(xf[i].clip));
+        memcpy(xf[i].color, buf[cur][i].color, sizeof(xf[i].color));
+        xf[i].outcode = 0;
+        project_vertex(&xf[i]);
+    }
+    for (int i = 1; i + 1 < n; i++) {
+        raster_setup_triangle(&buf[cur][0].v, &buf[cur][i].v, &buf[cur][i + 1].v,
+                              &xf[0], &xf[i], &xf[i + 1], state);
+    }
+}
 
-            /* Perspective-correct interpolation factor */
-            float pc_denom = bary0 * inv_w0 + bary1 * inv_w1 + bary2 * inv_w2;
-            float pc_inv = (fabsf(pc_denom) > 1e-10f) ? 1.0f / pc_denom : 1.0f;
-
-            /* Interpolate vertex color */
-            float frag_color[4];
-            if (vtx_has_color) {
-                for (int c = 0; c < 4; c++) {
-                    float val = (bary0 * v0->color[c] * inv_w0 +
-                                 bary1 * v1->color[c] * inv_w1 +
-                                 bary2 * v2->color[c] * inv_w2) * pc_inv;
-                    frag_color[c] = fmaxf(0.0f, fminf(1.0f, val));
-                }
-            } else {
-                frag_color[0] = ras_r; frag_color[1] = ras_g;
-                frag_color[2] = ras_b; frag_color[3] = ras_a;
-            }
+/* ================================================================
+ * Primitive Assembly
+ * ================================================================ */
+/* Transform every vertex of a batch once into g_xf */
+static GXXfVertex *raster_transform(const GXSWVertex *vb, u32 n) {
+    if (n > g_xf.cap) {
+        u32 cap = g_xf.cap ? g_xf.cap : 1024;
+        while (cap < n) cap *= 2;
+        GXXfVertex *grown = (GXXfVertex *)realloc(g_xf.verts, cap * sizeof(GXXfVertex));
+        if (!grown) raster_out_of_memory();
+        g_xf.verts = grown;
+        g_xf.cap = cap;
+    }
+    for (u32 i = 0; i < n; i++) {
+        transform_vertex(&vb[i], &g_xf.verts[i]);
+    }
+    g_gxperf.vertices += n;
+    return g_xf.verts;
+}
 
-            /* Sample texture */
-            float tex_color[4] = {1,1,1,1};
-            if (has_texture) {
-                float u = (bary0 * v0->texcoord[0][0] * inv_w0 +
-                           bary1 * v1->texcoord[0][0] * inv_w1 +
-                           bary2 * v2->texcoord[0][0] * inv_w2) * pc_inv;
-                float v = (bary0 * v0->texcoord[0][1] * inv_w0 +
-                           bary1 * v1->texcoord[0][1] * inv_w1 +
-                           bary2 * v2->texcoord[0][1] * inv_w2) * pc_inv;
-                u32 texel = sample_texture(tc, u, v);
-                tex_color[0] = ((texel >> 24) & 0xFF) / 255.0f;
-                tex_color[1] = ((texel >> 16) & 0xFF) / 255.0f;
-                tex_color[2] = ((texel >> 8) & 0xFF) / 255.0f;
-                tex_color[3] = (texel & 0xFF) / 255.0f;
-            }
+/* Validate textures and snapshot pixel state for a draw of ntris */
+static u32 raster_begin_draw(u32 ntris) {
+    GXTexMapID tex_map = g_gx.tev_order[0].map;
+    if (tex_map < GX_MAX_TEXTURES) tex_map_validate(tex_map);
 
-            /* TEV */
-            float out_color[4];
-            tev_evaluate(frag_color, tex_color, has_texture, tev_mode, out_color);
-
-            /* Alpha blending */
-            float final_r = out_color[0], final_g = out_color[1];
-            float final_b = out_color[2], final_a = out_color[3];
-
-            if (g_gx.blend_type == GX_BM_BLEND) {
-                u32 dst_pixel = g_gx.framebuffer[fb_idx];
-                float dr = ((dst_pixel >> 24) & 0xFF) / 255.0f;
-                float dg = ((dst_pixel >> 16) & 0xFF) / 255.0f;
-                float db = ((dst_pixel >> 8) & 0xFF) / 255.0f;
-                float da = (dst_pixel & 0xFF) / 255.0f;
-
-                for (int c = 0; c < 4; c++) {
-                    float sc[] = {final_r, final_g, final_b, final_a};
-                    float dc[] = {dr, dg, db, da};
-                    float sf = blend_factor(g_gx.blend_src, final_r, final_g, final_b, final_a,
-                                           dr, dg, db, da, c);
-                    float df = blend_factor(g_gx.blend_dst, final_r, final_g, final_b, final_a,
-                                           dr, dg, db, da, c);
-                    float val = sc[c] * sf + dc[c] * df;
-                    if (val < 0) val = 0; if (val > 1) val = 1;
-                    if (c == 0) final_r = val;
-                    else if (c == 1) final_g = val;
-                    else if (c == 2) final_b = val;
-                    else final_a = val;
-                }
-            }
+    if (g_raster.tri_count + ntris > RASTER_MAX_TRIS) gx_raster_flush();
+    if (!g_raster.binned) g_raster.state_count = 0;
+    u32 st = raster_capture_state();
+    g_pixel_pipe_hits[g_raster.states[st].pipe].draws++;
+    return st;
+}
 
-            /* Alpha compare test — discard pixel if it fails */
-            {
-                u8 a8 = (u8)(final_a * 255.0f);
-                int pass0, pass1, pass;
-                switch (g_gx.alpha_comp0) {
-                    case GX_NEVER:   pass0 = 0; break;
-                    case GX_LESS:    pass0 = (a8 <  g_gx.alpha_ref0); break;
-                    case GX_EQUAL:   pass0 = (a8 == g_gx.alpha_ref0); break;
-                    case GX_LEQUAL:  pass0 = (a8 <= g_gx.alpha_ref0); break;
-                    case GX_GREATER: pass0 = (a8 >  g_gx.alpha_ref0); break;
-                    case GX_NEQUAL:  pass0 = (a8 != g_gx.alpha_ref0); break;
-                    case GX_GEQUAL:  pass0 = (a8 >= g_gx.alpha_ref0); break;
-                    default:         pass0 = 1; break; /* GX_ALWAYS */
-                }
-                switch (g_gx.alpha_comp1) {
-                    case GX_NEVER:   pass1 = 0; break;
-                    case GX_LESS:    pass1 = (a8 <  g_gx.alpha_ref1); break;
-                    case GX_EQUAL:   pass1 = (a8 == g_gx.alpha_ref1); break;
-                    case GX_LEQUAL:  pass1 = (a8 <= g_gx.alpha_ref1); break;
-                    case GX_GREATER: pass1 = (a8 >  g_gx.alpha_ref1); break;
-                    case GX_NEQUAL:  pass1 = (a8 != g_gx.alpha_ref1); break;
-                    case GX_GEQUAL:  pass1 = (a8 >= g_gx.alpha_ref1); break;
-                    default:         pass1 = 1; break; /* GX_ALWAYS */
-                }
-                switch (g_gx.alpha_op) {
-                    case GX_AOP_AND:  pass = pass0 && pass1; break;
-                    case GX_AOP_OR:   pass = pass0 || pass1; break;
-                    case GX_AOP_XOR:  pass = pass0 ^ pass1; break;
-                    case GX_AOP_XNOR: pass = !(pass0 ^ pass1); break;
-                    default:          pass = 1; break;
-                }
-                if (!pass) goto skip_pixel;
+/* Split n vertices of prim into triangles, 3 indices each, in g_xf.tris.
+ * Odd strip triangles are flipped to keep a consistent winding. */
+static u32 prim_assemble(GXPrimitive prim, u32 n) {
+    if (n > g_xf.tri_cap) {
+        u32 cap = g_xf.tri_cap ? g_xf.tri_cap : 1024;
+        while (cap < n) cap *= 2;
+        u32 *grown = (u32 *)realloc(g_xf.tris, cap * 3 * sizeof(u32));
+        if (!grown) raster_out_of_memory();
+        g_xf.tris = grown;
+        g_xf.tri_cap = cap;
+    }
+    u32 *t = g_xf.tris;
+#define TRI(a, b, c) (t[0] = (a), t[1] = (b), t[2] = (c), t += 3)
+    switch (prim) {
+        case GX_TRIANGLES:
+            for (u32 i = 0; i + 2 < n; i += 3) {
+                TRI(i, i+1, i+2);
             }
-
-            /* Write to framebuffer */
-            if (g_gx.color_update) {
-                u8 rb = (u8)(final_r * 255.0f);
-                u8 gb = (u8)(final_g * 255.0f);
-                u8 bb = (u8)(final_b * 255.0f);
-                /* On GC, framebuffer alpha wasn't used for display (XFB is YUV).
-                 * On PC we use alpha for compositing with sprites, so any rendered
-                 * pixel must be opaque (255) unless TEV explicitly outputs transparency. */
-                u8 ab = g_gx.alpha_update ? (u8)(final_a * 255.0f) : 0xFF;
-                g_gx.framebuffer[fb_idx] = ((u32)rb << 24) | ((u32)gb << 16) | ((u32)bb << 8) | ab;
-                g_gx_pixel_count++;
+            break;
+        case GX_QUADS:
+            for (u32 i = 0; i + 3 < n; i += 4) {
+                TRI(i, i+1, i+2);
+                TRI(i, i+2, i+3);
             }
-
-            /* Write depth */
-            if (g_gx.z_write) {
-                g_gx.zbuffer[fb_idx] = z;
+            break;
+        case GX_TRIANGLESTRIP:
+            for (u32 i = 0; i + 2 < n; i++) {
+                if (i & 1)
+                    TRI(i+1, i, i+2);
+                else
+                    TRI(i, i+1, i+2);
             }
-            skip_pixel: ;
-        }
+            break;
+        case GX_TRIANGLEFAN:
+            for (u32 i = 1; i + 1 < n; i++) {
+                TRI(0, i, i+1);
+            }
+            break;
+        default:
+            break;
+    }
+#undef TRI
+    return (u32)(t - g_xf.tris) / 3;
+}
+
+/* Draw a pre-assembled triangle list (3 indices per triangle into vb) */
+static void rasterize_indexed(const GXSWVertex *vb, u32 nverts, const u32 *tris, u32 ntris) {
+    u32 st = raster_begin_draw(ntris);
+    GXXfVertex *xf = raster_transform(vb, nverts);
+    g_gxperf.vc_check += ntris * 3;
+    g_gxperf.vc_miss += nverts;
+    g_gxperf.tris_tex[g_gx.num_tex_gens < 8 ? g_gx.num_tex_gens : 8] += ntris;
+    g_gxperf.tris_clr[g_gx.num_chans < 2 ? g_gx.num_chans : 2] += ntris;
+
+    /* Lighting runs only for the channels the draw actually reads lit */
+    const GXDrawState *ds = &g_raster.states[st];
+    int outputs = (ds->chan0 == LIGHT_CHAN_LIT) | (ds->tev->ras1 << 1);
+    g_light.stats.draws++;
+    if (outputs) {
+        g_light.stats.lit_draws++;
+        light_batch(vb, xf, nverts, outputs);
+    }
+    for (u32 i = 0; i < ntris; i++, tris += 3) {
+        rasterize_triangle(&vb[tris[0]], &vb[tris[1]], &vb[tris[2]],
+                           &xf[tris[0]], &xf[tris[1]], &xf[tris[2]], st);
     }
 }
 
-/* ================================================================
- * Primitive Assembly
- * ================================================================ */
 static void rasterize_primitives(void) {
-    int n = g_gx.verts_submitted;
-    GXSWVertex *vb = g_gx.vert_buf;
+    u32 n = g_gx.verts_submitted;
+    u32 ntris = prim_assemble(g_gx.current_prim, n);
+    if (g_dl_capturing) {
+        dl_capture_primitives(g_gx.vert_buf, n, g_xf.tris, ntris);
+        return;
+    }
+    rasterize_indexed(g_gx.vert_buf, n, g_xf.tris, ntris);
+}
 
-    switch (g_gx.current_prim) {
-        case GX_TRIANGLES:
-            for (int i = 0; i + 2 < n; i += 3) {
-                rasterize_triangle(&vb[i], &vb[i+1], &vb[i+2]);
-            }
+/* ================================================================
+ * TEV (Texture Environment)
+ * ================================================================ */
+void GXSetTevOp(GXTevStageID id, GXTevMode mode) {
+    if (id >= GX_MAX_TEV_STAGES) return;
+    /* Same expansion as the SDK: later stages read the previous stage's
+     * output where stage 0 reads the rasterized color */
+    GXTevColorArg carg = (id == GX_TEVSTAGE0) ? GX_CC_RASC : GX_CC_CPREV;
+    GXTevAlphaArg aarg = (id == GX_TEVSTAGE0) ? GX_CA_RASA : GX_CA_APREV;
+    switch (mode) {
+        case GX_MODULATE:
+            GXSetTevColorIn(id, GX_CC_ZERO, GX_CC_TEXC, carg, GX_CC_ZERO);
+            GXSetTevAlphaIn(id, GX_CA_ZERO, GX_CA_TEXA, aarg, GX_CA_ZERO);
+            break;
+        case GX_DECAL:
+            GXSetTevColorIn(id, carg, GX_CC_TEXC, GX_CC_TEXA, GX_CC_ZERO);
+            GXSetTevAlphaIn(id, GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, aarg);
             break;
-        case GX_QUADS:
-            for (int i = 0; i + 3 < n; i += 4) {
-                rasterize_triangle(&vb[i], &vb[i+1], &vb[i+2]);
-                rasterize_triangle(&vb[i], &vb[i+2], &vb[i+3]);
-            }
+        case GX_BLEND:
+            GXSetTevColorIn(id, carg, GX_CC_ONE, GX_CC_TEXC, GX_CC_ZERO);
+            GXSetTevAlphaIn(id, GX_CA_ZERO, GX_CA_TEXA, aarg, GX_CA_ZERO);
             break;
-        case GX_TRIANGLESTRIP:
-            for (int i = 0; i + 2 < n; i++) {
-                if (i & 1)
-                    rasterize_triangle(&vb[i+1], &vb[i], &vb[i+2]);
-                else
-                    rasterize_triangle(&vb[i], &vb[i+1], &vb[i+2]);
-            }
+        case GX_REPLACE:
+            GXSetTevColorIn(id, GX_CC_ZERO, GX_CC_ZERO, GX_CC_ZERO, GX_CC_TEXC);
+            GXSetTevAlphaIn(id, GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, GX_CA_TEXA);
             break;
-        case GX_TRIANGLEFAN:
-            for (int i = 1; i + 1 < n; i++) {
-                rasterize_triangle(&vb[0], &vb[i], &vb[i+1]);
-            }
+        case GX_PASSCLR:
+            GXSetTevColorIn(id, GX_CC_ZERO, GX_CC_ZERO, GX_CC_ZERO, carg);
+            GXSetTevAlphaIn(id, GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, aarg);
             break;
         default:
             break;
     }
+    GXSetTevColorOp(id, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+    GXSetTevAlphaOp(id, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
 }
-
-/* ================================================================
- * Lighting
- * ================================================================ */
-void GXSetNumChans(u8 nChans) { g_gx.num_chans = nChans; }
-void GXSetChanCtrl(GXChannelID chan, GXBool enable, GXColorSrc amb_src, GXColorSrc mat_src,
-                   u32 light_mask, GXDiffuseFn diff_fn, GXAttnFn attn_fn) {
-    (void)chan; (void)enable; (void)amb_src; (void)mat_src;
-    (void)light_mask; (void)diff_fn; (void)attn_fn;
-}
-void GXSetChanAmbColor(GXChannelID chan, GXColor color) {
-    int idx = (chan == GX_COLOR0A0 || chan == GX_COLOR0) ? 0 : 1;
-    g_gx.chan_amb[idx] = color;
+void GXSetTevColorIn(GXTevStageID stage, GXTevColorArg a, GXTevColorArg b, GXTevColorArg c, GXTevColorArg d) {
+    if (stage >= GX_MAX_TEV_STAGES) return;
+    GX_CAP(GXCAP_SET_TEV_COLOR_IN, stage, stage, a, b, c, d);
+    GXTevStage *ts = &g_gx.tev_stage[stage];
+    ts->color_in[0] = (u8)a; ts->color_in[1] = (u8)b;
+    ts->color_in[2] = (u8)c; ts->color_in[3] = (u8)d;
 }
-void GXSetChanMatColor(GXChannelID chan, GXColor color) {
-    int idx = (chan == GX_COLOR0A0 || chan == GX_COLOR0) ? 0 : 1;
-    g_gx.chan_mat[idx] = color;
+void GXSetTevAlphaIn(GXTevStageID stage, GXTevAlphaArg a, GXTevAlphaArg b, GXTevAlphaArg c, GXTevAlphaArg d) {
+    if (stage >= GX_MAX_TEV_STAGES) return;
+    GX_CAP(GXCAP_SET_TEV_ALPHA_IN, stage, stage, a, b, c, d);
+    GXTevStage *ts = &g_gx.tev_stage[stage];
+    ts->alpha_in[0] = (u8)a; ts->alpha_in[1] = (u8)b;
+    ts->alpha_in[2] = (u8)c; ts->alpha_in[3] = (u8)d;
 }
-void GXInitLightSpot(GXLightObj *lt_obj, f32 cutoff, GXSpotFn spot_func) { (void)lt_obj; (void)cutoff; (void)spot_func; }
-void GXInitLightDistAttn(GXLightObj *lt_obj, f32 ref_distance, f32 ref_brightness, GXDistAttnFn dist_func) {
-    (void)lt_obj; (void)ref_distance; (void)ref_brightness; (void)dist_func;
+void GXSetTevColorOp(GXTevStageID stage, GXTevOp op, GXTevBias bias, GXTevScale scale, GXBool clamp, GXTevRegID out_reg) {
+    if (stage >= GX_MAX_TEV_STAGES) return;
+    GX_CAP(GXCAP_SET_TEV_COLOR_OP, stage, stage, op, bias, scale, clamp, out_reg);
+    GXTevStage *ts = &g_gx.tev_stage[stage];
+    ts->color_op = (u8)op; ts->color_bias = (u8)bias; ts->color_scale = (u8)scale;
+    ts->color_clamp = clamp ? 1 : 0; ts->color_out = (u8)out_reg;
 }
-void GXInitLightPos(GXLightObj *lt_obj, f32 x, f32 y, f32 z) { (void)lt_obj; (void)x; (void)y; (void)z; }
-void GXInitLightDir(GXLightObj *lt_obj, f32 nx, f32 ny, f32 nz) { (void)lt_obj; (void)nx; (void)ny; (void)nz; }
-void GXInitLightColor(GXLightObj *lt_obj, GXColor color) { (void)lt_obj; (void)color; }
-void GXInitLightAttn(GXLightObj *lt_obj, f32 a0, f32 a1, f32 a2, f32 k0, f32 k1, f32 k2) {
-    (void)lt_obj; (void)a0; (void)a1; (void)a2; (void)k0; (void)k1; (void)k2;
+void GXSetTevAlphaOp(GXTevStageID stage, GXTevOp op, GXTevBias bias, GXTevScale scale, GXBool clamp, GXTevRegID out_reg) {
+    if (stage >= GX_MAX_TEV_STAGES) return;
+    GX_CAP(GXCAP_SET_TEV_ALPHA_OP, stage, stage, op, bias, scale, clamp, out_reg);
+    GXTevStage *ts = &g_gx.tev_stage[stage];
+    ts->alpha_op = (u8)op; ts->alpha_bias = (u8)bias; ts->alpha_scale = (u8)scale;
+    ts->alpha_clamp = clamp ? 1 : 0; ts->alpha_out = (u8)out_reg;
 }
-void GXInitLightAttnA(GXLightObj *lt_obj, f32 a0, f32 a1, f32 a2) { (void)lt_obj; (void)a0; (void)a1; (void)a2; }
-void GXInitLightAttnK(GXLightObj *lt_obj, f32 k0, f32 k1, f32 k2) { (void)lt_obj; (void)k0; (void)k1; (void)k2; }
-void GXLoadLightObjImm(GXLightObj *lt_obj, GXLightID light) { (void)lt_obj; (void)light; }
-void GXGetLightPos(const GXLightObj *lt_obj, f32 *x, f32 *y, f32 *z) {
-    (void)lt_obj; if (x) *x = 0; if (y) *y = 0; if (z) *z = 0;
+void GXSetTevColor(GXTevRegID id, GXColor color) {
+    if (id >= GX_MAX_TEVREG) return;
+    GX_CAP(GXCAP_SET_TEV_COLOR, id, id, gx_cap_color(color));
+    GXColorS10 c = { color.r, color.g, color.b, color.a };
+    g_gx.tev_reg[id] = c;
 }
-void GXGetLightColor(const GXLightObj *lt_obj, GXColor *color) {
-    (void)lt_obj; if (color) { color->r = 255; color->g = 255; color->b = 255; color->a = 255; }
+void GXSetTevColorS10(GXTevRegID id, GXColorS10 color) {
+    if (id >= GX_MAX_TEVREG) return;
+    if (g_gxcap_on) {
+        const u32 w = id;
+        gx_cap_block(GXCAP_SET_TEV_COLOR_S10, id, &w, 1, &color, sizeof(color));
+    }
+    g_gx.tev_reg[id] = color;
 }
-
-/* ================================================================
- * TEV (Texture Environment)
- * ================================================================ */
-void GXSetTevOp(GXTevStageID id, GXTevMode mode) {
-    if (id < GX_MAX_TEV_STAGES) g_gx.tev_mode[id] = mode;
+void GXSetTevKColor(GXTevKColorID id, GXColor color) {
+    if (id >= GX_MAX_KCOLOR) return;
+    GX_CAP(GXCAP_SET_TEV_KCOLOR, id, id, gx_cap_color(color));
+    g_gx.tev_kcolor[id] = color;
 }
-void GXSetTevColorIn(GXTevStageID stage, GXTevColorArg a, GXTevColorArg b, GXTevColorArg c, GXTevColorArg d) {
-    (void)stage; (void)a; (void)b; (void)c; (void)d;
+void GXSetTevKColorSel(GXTevStageID stage, GXTevKColorSel sel) {
+    if (stage >= GX_MAX_TEV_STAGES) return;
+    GX_CAP(GXCAP_SET_TEV_KCOLOR_SEL, stage, stage, sel);
+    g_gx.tev_stage[stage].kcolor_sel = (u8)sel;
 }
-void GXSetTevAlphaIn(GXTevStageID stage, GXTevAlphaArg a, GXTevAlphaArg b, GXTevAlphaArg c, GXTevAlphaArg d) {
-    (void)stage; (void)a; (void)b; (void)c; (void)d;
+void GXSetTevKAlphaSel(GXTevStageID stage, GXTevKAlphaSel sel) {
+    if (stage >= GX_MAX_TEV_STAGES) return;
+    GX_CAP(GXCAP_SET_TEV_KALPHA_SEL, stage, stage, sel);
+    g_gx.tev_stage[stage].kalpha_sel = (u8)sel;
 }
-void GXSetTevColorOp(GXTevStageID stage, GXTevOp op, GXTevBias bias, GXTevScale scale, GXBool clamp, GXTevRegID out_reg) {
-    (void)stage; (void)op; (void)bias; (void)scale; (void)clamp; (void)out_reg;
+void GXSetTevSwapMode(GXTevStageID stage, GXTevSwapSel ras_sel, GXTevSwapSel tex_sel) {
+    if (stage >= GX_MAX_TEV_STAGES) return;
+    GX_CAP(GXCAP_SET_TEV_SWAP_MODE, stage, stage, ras_sel, tex_sel);
+    g_gx.tev_stage[stage].ras_swap = (u8)ras_sel;
+    g_gx.tev_stage[stage].tex_swap = (u8)tex_sel;
 }
-void GXSetTevAlphaOp(GXTevStageID stage, GXTevOp op, GXTevBias bias, GXTevScale scale, GXBool clamp, GXTevRegID out_reg) {
-    (void)stage; (void)op; (void)bias; (void)scale; (void)clamp; (void)out_reg;
-}
-void GXSetTevColor(GXTevRegID id, GXColor color) { (void)id; (void)color; }
-void GXSetTevColorS10(GXTevRegID id, GXColorS10 color) { (void)id; (void)color; }
-void GXSetTevKColor(GXTevKColorID id, GXColor color) { (void)id; (void)color; }
-void GXSetTevKColorSel(GXTevStageID stage, GXTevKColorSel sel) { (void)stage; (void)sel; }
-void GXSetTevKAlphaSel(GXTevStageID stage, GXTevKAlphaSel sel) { (void)stage; (void)sel; }
-void GXSetTevSwapMode(GXTevStageID stage, GXTevSwapSel ras_sel, GXTevSwapSel tex_sel) { (void)stage; (void)ras_sel; (void)tex_sel; }
 void GXSetTevSwapModeTable(GXTevSwapSel table, GXTevColorChan red, GXTevColorChan green, GXTevColorChan blue, GXTevColorChan alpha) {
-    (void)table; (void)red; (void)green; (void)blue; (void)alpha;
+    if (table >= GX_MAX_TEVSWAP) return;
+    GX_CAP(GXCAP_SET_TEV_SWAP_TABLE, table, table, red, green, blue, alpha);
+    g_gx.tev_swap_table[table][0] = (u8)red;
+    g_gx.tev_swap_table[table][1] = (u8)green;
+    g_gx.tev_swap_table[table][2] = (u8)blue;
+    g_gx.tev_swap_table[table][3] = (u8)alpha;
 }
 void GXSetAlphaCompare(GXCompare comp0, u8 ref0, GXAlphaOp op, GXCompare comp1, u8 ref1) {
+    GX_CAP(GXCAP_SET_ALPHA_COMPARE, 0, comp0, ref0, op, comp1, ref1);
     g_gx.alpha_comp0 = comp0;
     g_gx.alpha_ref0  = ref0;
     g_gx.alpha_op    = op;
@@ -1377,12 +4174,18 @@ void GXSetAlphaCompare(GXCompare comp0, u8 ref0, GXAlphaOp op, GXCompare comp1,
 void GXSetZTexture(GXZTexOp op, GXTexFmt fmt, u32 bias) { (void)op; (void)fmt; (void)bias; }
 void GXSetTevOrder(GXTevStageID stage, GXTexCoordID coord, GXTexMapID map, GXChannelID color) {
     if (stage < GX_MAX_TEV_STAGES) {
+        GX_CAP(GXCAP_SET_TEV_ORDER, stage, stage, coord, map, color);
         g_gx.tev_order[stage].coord = coord;
         g_gx.tev_order[stage].map = map;
         g_gx.tev_order[stage].color = color;
     }
 }
-void GXSetNumTevStages(u8 nStages) { g_gx.num_tev_stages = nStages; }
+void GXSetNumTevStages(u8 nStages) {
+    GX_CAP(GXCAP_SET_NUM_TEV_STAGES, 0, nStages);
+    if (nStages < 1) nStages = 1;
+    if (nStages > GX_MAX_TEV_STAGES) nStages = GX_MAX_TEV_STAGES;
+    g_gx.num_tev_stages = nStages;
+}
 
 /* ================================================================
  * Textures
@@ -1413,18 +4216,30 @@ void GXInitTexObj(GXTexObj *obj, void *image_ptr, u16 width, u16 height, GXTexFm
     pc->wrap_s = (u32)wrap_s;
     pc->wrap_t = (u32)wrap_t;
     pc->mipmap = mipmap;
+    /* SDK defaults: bilinear, trilinear over the full chain when mipmapped */
+    pc->mag_filter = GX_LINEAR;
+    pc->min_filter = GX_LINEAR;
+    if (mipmap) {
+        pc->min_filter = tex_fmt_is_ci(format) ? GX_LIN_MIP_NEAR : GX_LIN_MIP_LIN;
+        pc->max_lod = (f32)(tex_full_levels(width, height) - 1);
+    }
 }
 void GXInitTexObjCI(GXTexObj *obj, void *image_ptr, u16 width, u16 height, GXCITexFmt format,
                     GXTexWrapMode wrap_s, GXTexWrapMode wrap_t, u8 mipmap, u32 tlut_name) {
-    /* Treat CI textures as regular for now (will show wrong colors but won't crash) */
-    (void)tlut_name;
     GXInitTexObj(obj, image_ptr, width, height, (GXTexFmt)format, wrap_s, wrap_t, mipmap);
+    if (obj) ((GXTexObjPC *)obj)->tlut_name = tlut_name;
 }
 void GXInitTexObjLOD(GXTexObj *obj, GXTexFilter min_filt, GXTexFilter mag_filt,
                      f32 min_lod, f32 max_lod, f32 lod_bias, GXBool bias_clamp,
                      GXBool do_edge_lod, GXAnisotropy max_aniso) {
-    (void)obj; (void)min_filt; (void)mag_filt; (void)min_lod; (void)max_lod;
-    (void)lod_bias; (void)bias_clamp; (void)do_edge_lod; (void)max_aniso;
+    (void)bias_clamp; (void)do_edge_lod; (void)max_aniso;
+    if (!obj) return;
+    GXTexObjPC *pc = (GXTexObjPC *)obj;
+    pc->min_filter = (u8)min_filt;
+    pc->mag_filter = (u8)mag_filt;
+    pc->min_lod = min_lod;
+    pc->max_lod = max_lod;
+    pc->lod_bias = lod_bias;
 }
 void GXInitTexObjData(GXTexObj *obj, void *image_ptr) {
     if (obj) ((GXTexObjPC *)obj)->image_ptr = image_ptr;
@@ -1432,7 +4247,9 @@ void GXInitTexObjData(GXTexObj *obj, void *image_ptr) {
 void GXInitTexObjWrapMode(GXTexObj *obj, GXTexWrapMode s, GXTexWrapMode t) {
     if (obj) { ((GXTexObjPC *)obj)->wrap_s = s; ((GXTexObjPC *)obj)->wrap_t = t; }
 }
-void GXInitTexObjTlut(GXTexObj *obj, u32 tlut_name) { (void)obj; (void)tlut_name; }
+void GXInitTexObjTlut(GXTexObj *obj, u32 tlut_name) {
+    if (obj) ((GXTexObjPC *)obj)->tlut_name = tlut_name;
+}
 void GXInitTexObjUserData(GXTexObj *obj, void *user_data) { (void)obj; (void)user_data; }
 void *GXGetTexObjUserData(const GXTexObj *obj) { (void)obj; return NULL; }
 void GXLoadTexObjPreLoaded(GXTexObj *obj, GXTexRegion *region, GXTexMapID id) { (void)obj; (void)region; (void)id; }
@@ -1442,42 +4259,48 @@ void GXLoadTexObj(GXTexObj *obj, GXTexMapID id) {
     g_gx.tex_obj[id] = *obj;
     g_gx.tex_loaded[id] = 1;
 
-    /* Decode texture into cache */
+    /* Resolve the decoded texture through the global cache */
     GXTexObjPC *pc = (GXTexObjPC *)obj;
-    GXTexCacheEntry *tc = &g_gx.tex_cache[id];
-
-    /* Check if already decoded for this data pointer */
-    if (tc->decoded && tc->raw_data == pc->image_ptr &&
-        tc->width == pc->width && tc->height == pc->height) {
-        /* Already cached */
-        tc->wrap_s = (GXTexWrapMode)pc->wrap_s;
-        tc->wrap_t = (GXTexWrapMode)pc->wrap_t;
-        return;
-    }
-
-    /* Free old decoded data */
-    if (tc->decoded) {
-        free(tc->decoded);
-        tc->decoded = NULL;
-    }
-
-    tc->raw_data = pc->image_ptr;
-    tc->width = pc->width;
-    tc->height = pc->height;
-    tc->format = (GXTexFmt)pc->format;
-    tc->wrap_s = (GXTexWrapMode)pc->wrap_s;
-    tc->wrap_t = (GXTexWrapMode)pc->wrap_t;
-
-    if (pc->image_ptr && pc->width > 0 && pc->height > 0) {
-        tc->decoded = decode_texture(pc->image_ptr, pc->width, pc->height, tc->format);
+    if (g_gxcap_on) {
+        gx_cap_tex_obj(id, obj, pc->image_ptr,
+                       tex_chain_src_size(pc->format, pc->width, pc->height, tex_obj_src_levels(pc)));
     }
+    GXTexMapState *tm = &g_gx.tex_map[id];
+    tm->wrap_s = (GXTexWrapMode)pc->wrap_s;
+    tm->wrap_t = (GXTexWrapMode)pc->wrap_t;
+    tm->min_filter = pc->min_filter;
+    tm->mag_filter = pc->mag_filter;
+    tm->min_lod = pc->min_lod;
+    tm->max_lod = pc->max_lod;
+    tm->lod_bias = pc->lod_bias;
+    tex_map_resolve(id);
 }
 
 void GXInitTlutObj(GXTlutObj *tlut_obj, void *lut, GXTlutFmt fmt, u16 n_entries) {
-    if (tlut_obj) memset(tlut_obj, 0, sizeof(GXTlutObj));
-    (void)lut; (void)fmt; (void)n_entries;
+    if (!tlut_obj) return;
+    memset(tlut_obj, 0, sizeof(GXTlutObj));
+    GXTlutObjPC *pc = (GXTlutObjPC *)tlut_obj;
+    pc->lut = lut;
+    pc->fmt = (u32)fmt;
+    pc->n_entries = n_entries;
+}
+void GXLoadTlut(GXTlutObj *tlut_obj, u32 tlut_name) {
+    const GXTlutObjPC *obj = (const GXTlutObjPC *)tlut_obj;
+    if (!obj || !obj->lut || tlut_name >= TLUT_SLOTS) return;
+    if (g_gxcap_on) gx_cap_tlut(tlut_name, obj->lut, obj->fmt, obj->n_entries);
+    g_texcache.stats.tlut_loads++;
+    GXTlutPalette *pal = tlut_palette_get(obj->lut, obj->fmt, obj->n_entries);
+    if (g_tlut.slots[tlut_name] == pal) return;
+    g_tlut.slots[tlut_name] = pal;
+    g_texcache.stats.tlut_changes++;
+
+    /* Texmaps already bound to this slot see the new palette */
+    for (int i = 0; i < GX_MAX_TEXTURES; i++) {
+        const GXTexObjPC *pc = (const GXTexObjPC *)&g_gx.tex_obj[i];
+        if (g_gx.tex_loaded[i] && tex_fmt_is_ci(pc->format) && pc->tlut_name == tlut_name)
+            tex_map_resolve((GXTexMapID)i);
+    }
 }
-void GXLoadTlut(GXTlutObj *tlut_obj, u32 tlut_name) { (void)tlut_obj; (void)tlut_name; }
 void GXInitTexCacheRegion(GXTexRegion *region, u8 is_32b_mipmap, u32 tmem_even,
                           GXTexCacheSize size_even, u32 tmem_odd, GXTexCacheSize size_odd) {
     (void)region; (void)is_32b_mipmap; (void)tmem_even; (void)size_even; (void)tmem_odd; (void)size_odd;
@@ -1490,15 +4313,10 @@ void GXInitTlutRegion(GXTlutRegion *region, u32 tmem_addr, GXTlutSize tlut_size)
 }
 void GXInvalidateTexRegion(GXTexRegion *region) { (void)region; }
 void GXInvalidateTexAll(void) {
-    /* Clear texture cache */
-    for (int i = 0; i < GX_MAX_TEXTURES; i++) {
-        if (g_gx.tex_cache[i].decoded) {
-            free(g_gx.tex_cache[i].decoded);
-            g_gx.tex_cache[i].decoded = NULL;
-        }
-        g_gx.tex_cache[i].raw_data = NULL;
-        g_gx.tex_loaded[i] = 0;
-    }
+    GX_CAP0(GXCAP_INVALIDATE_TEX_ALL);
+    /* Mark every decoded texture stale; each is re-hashed on its next load
+     * and only re-decoded if its source bytes changed. */
+    g_texcache.gen++;
 }
 GXTexRegionCallback GXSetTexRegionCallback(GXTexRegionCallback f) { (void)f; return NULL; }
 GXTlutRegionCallback GXSetTlutRegionCallback(GXTlutRegionCallback f) { (void)f; return NULL; }
@@ -1524,19 +4342,32 @@ void GXDestroyTlutObj(GXTlutObj *obj) { if (obj) memset(obj, 0, sizeof(GXTlutObj
  * Pixel / Blend / Z
  * ================================================================ */
 void GXSetFog(GXFogType type, f32 startz, f32 endz, f32 nearz, f32 farz, GXColor color) {
+    GX_CAP(GXCAP_SET_FOG, 0, type, gx_cap_f(startz), gx_cap_f(endz), gx_cap_f(nearz), gx_cap_f(farz),
+           gx_cap_color(color));
     g_gx.fog_type = type; g_gx.fog_startz = startz; g_gx.fog_endz = endz;
     g_gx.fog_nearz = nearz; g_gx.fog_farz = farz; g_gx.fog_color = color;
 }
-void GXSetFogColor(GXColor color) { g_gx.fog_color = color; }
+void GXSetFogColor(GXColor color) {
+    GX_CAP(GXCAP_SET_FOG_COLOR, 0, gx_cap_color(color));
+    g_gx.fog_color = color;
+}
 void GXSetBlendMode(GXBlendMode type, GXBlendFactor src_factor, GXBlendFactor dst_factor, GXLogicOp op) {
+    GX_CAP(GXCAP_SET_BLEND_MODE, 0, type, src_factor, dst_factor, op);
     (void)op;
     g_gx.blend_type = type;
     g_gx.blend_src = src_factor;
     g_gx.blend_dst = dst_factor;
 }
-void GXSetColorUpdate(GXBool update_enable) { g_gx.color_update = update_enable; }
-void GXSetAlphaUpdate(GXBool update_enable) { g_gx.alpha_update = update_enable; }
+void GXSetColorUpdate(GXBool update_enable) {
+    GX_CAP(GXCAP_SET_COLOR_UPDATE, 0, update_enable);
+    g_gx.color_update = update_enable;
+}
+void GXSetAlphaUpdate(GXBool update_enable) {
+    GX_CAP(GXCAP_SET_ALPHA_UPDATE, 0, update_enable);
+    g_gx.alpha_update = update_enable;
+}
 void GXSetZMode(GXBool compare_enable, GXCompare func, GXBool update_enable) {
+    GX_CAP(GXCAP_SET_Z_MODE, 0, compare_enable, func, update_enable);
     g_gx.z_enable = compare_enable;
     g_gx.z_func = func;
     g_gx.z_write = update_enable;
@@ -1545,13 +4376,17 @@ void GXSetZCompLoc(GXBool before_tex) { (void)before_tex; }
 void GXSetDither(GXBool dither) { (void)dither; }
 void GXSetDstAlpha(GXBool enable, u8 alpha) { (void)enable; (void)alpha; }
 void GXSetFieldMode(u8 field_mode, u8 half_aspect_ratio) { (void)field_mode; (void)half_aspect_ratio; }
-void GXSetCullMode(GXCullMode mode) { g_gx.cull_mode = mode; }
+void GXSetCullMode(GXCullMode mode) {
+    GX_CAP(GXCAP_SET_CULL_MODE, 0, mode);
+    g_gx.cull_mode = mode;
+}
 void GXSetCoPlanar(GXBool enable) { (void)enable; }
 
 /* ================================================================
  * Framebuffer
  * ================================================================ */
 void GXSetCopyClear(GXColor clear_clr, u32 clear_z) {
+    GX_CAP(GXCAP_SET_COPY_CLEAR, 0, gx_cap_color(clear_clr), clear_z);
     g_gx.clear_color = clear_clr;
     g_gx.clear_z = clear_z;
 }
@@ -1559,9 +4394,20 @@ void GXSetCopyClear(GXColor clear_clr, u32 clear_z) {
 void GXCopyDisp(void *dest, GXBool clear) {
     static int copy_count = 0;
     g_gx.xfb_ptr = dest;
+    GX_CAP(GXCAP_COPY_DISP, 0, clear);
 
-    /* Copy software framebuffer to the external display buffer */
-    memcpy(g_gx_framebuffer, g_gx.framebuffer, sizeof(g_gx_framebuffer));
+    gx_raster_flush();
+
+    /* The render target becomes the display copy. Its fast-cleared tiles
+     * are filled in; a non-clearing copy also keeps depth and starts the
+     * next frame from the same pixels. */
+    fb_resolve_all(g_gx.framebuffer, !clear);
+    u32 *shown = g_gx.framebuffer;
+    g_gx.framebuffer = g_gx_framebuffer;
+    g_gx_framebuffer = shown;
+    if (!clear) memcpy(g_gx.framebuffer, g_gx_framebuffer, sizeof(g_gx_fb[0]));
+    if (g_gxcap_on) gx_cap_frame_end(shown, clear);
+    g_gxperf.copy_pixels += GX_FB_WIDTH * GX_FB_HEIGHT;
 
     if (copy_count % 60 == 0) {
         /* Count non-clear pixels */
@@ -1569,22 +4415,27 @@ void GXCopyDisp(void *dest, GXBool clear) {
                   ((u32)g_gx.clear_color.b << 8) | (u32)g_gx.clear_color.a;
         int non_clear = 0;
         for (int i = 0; i < GX_FB_WIDTH * GX_FB_HEIGHT; i += 100) {
-            if (g_gx.framebuffer[i] != clr) non_clear++;
+            if (g_gx_framebuffer[i] != clr) non_clear++;
         }
-        printf("[GX] CopyDisp #%d: tris=%d pixels=%d non_clear=%d/%d clear=0x%08x DL(call=%d ok=%d null=%d magic=%d)\n",
+        printf("[GX] CopyDisp #%d: tris=%d pixels=%d non_clear=%d/%d clear=0x%08x DL(call=%d ok=%d decode=%d null=%d magic=%d)\n",
                copy_count, g_gx_tri_count, g_gx_pixel_count, non_clear, GX_FB_WIDTH*GX_FB_HEIGHT/100, clr,
-               g_gx_dl_call_count, g_gx_dl_ok, g_gx_dl_fail_null, g_gx_dl_fail_magic);
-        printf("[GX]   reject: cull=%d degen=%d oob=%d | raster_ok=%d\n",
-               g_gx_reject_cull, g_gx_reject_degen, g_gx_reject_oob, g_gx_tri_raster_ok);
+               g_gx_dl_call_count, g_gx_dl_ok, g_gx_dl_decodes, g_gx_dl_fail_null, g_gx_dl_fail_magic);
+        printf("[GX]   reject: cull=%d degen=%d oob=%d guard=%d frustum=%d | clipped=%d raster_ok=%d\n",
+               g_gx_reject_cull, g_gx_reject_degen, g_gx_reject_oob, g_gx_reject_allclip,
+               g_gx_reject_frustum, g_gx_clip_count, g_gx_tri_raster_ok);
         g_gx_tri_count = 0;
         g_gx_pixel_count = 0;
         g_gx_reject_cull = 0;
         g_gx_reject_degen = 0;
         g_gx_reject_oob = 0;
+        g_gx_reject_allclip = 0;
+        g_gx_reject_frustum = 0;
+        g_gx_clip_count = 0;
         g_gx_tri_raster_ok = 0;
         g_gx_tri_diag_printed = 0;
         g_gx_dl_call_count = 0;
         g_gx_dl_ok = 0;
+        g_gx_dl_decodes = 0;
         g_gx_dl_fail_null = 0;
         g_gx_dl_fail_magic = 0;
     }
@@ -1594,12 +4445,12 @@ void GXCopyDisp(void *dest, GXBool clear) {
         /* Force alpha=0 so cleared pixels are transparent when composited
          * via SDL alpha blending. This lets background sprites show through
          * areas where no 3D geometry was rendered. */
-        u32 clr = ((u32)g_gx.clear_color.r << 24) | ((u32)g_gx.clear_color.g << 16) |
-                  ((u32)g_gx.clear_color.b << 8) | 0x00;
-        for (int i = 0; i < GX_FB_WIDTH * GX_FB_HEIGHT; i++) {
-            g_gx.framebuffer[i] = clr;
-            g_gx.zbuffer[i] = 1.0f;
-        }
+        g_fbclear.color = ((u32)g_gx.clear_color.r << 24) | ((u32)g_gx.clear_color.g << 16) |
+                          ((u32)g_gx.clear_color.b << 8) | 0x00;
+        g_fbclear.z = 1.0f;
+        memset(g_fbclear.pending, 1, sizeof(g_fbclear.pending));
+        if (!g_fbclear.lazy) fb_resolve_all(g_gx.framebuffer, 1);
+        g_gxperf.clear_pixels += GX_FB_WIDTH * GX_FB_HEIGHT;
     }
 }
 
@@ -1638,41 +4489,186 @@ void GXFlush(void) {}
 void GXPixModeSync(void) {}
 void GXSetMisc(GXMiscToken token, u32 val) { (void)token; (void)val; }
 GXDrawDoneCallback GXSetDrawDoneCallback(GXDrawDoneCallback cb) { (void)cb; return NULL; }
-void GXSetDrawSync(u16 token) { (void)token; }
-GXDrawSyncCallback GXSetDrawSyncCallback(GXDrawSyncCallback callback) { (void)callback; return NULL; }
+
+/* Drawing is synchronous on PC: the "GPU" reaches a sync token as soon as
+ * the work before it is shaded, so the callback runs right away */
+static GXDrawSyncCallback g_draw_sync_cb;
+
+void GXSetDrawSync(u16 token) {
+    if (g_draw_sync_cb) {
+        gx_raster_flush();
+        g_draw_sync_cb(token);
+    }
+}
+GXDrawSyncCallback GXSetDrawSyncCallback(GXDrawSyncCallback callback) {
+    GXDrawSyncCallback old = g_draw_sync_cb;
+    g_draw_sync_cb = callback;
+    return old;
+}
 
 /* ================================================================
- * Performance counters (stubs)
+ * Performance counters
+ *
+ * The SDK metrics read the counters in g_gxperf. Event counts map onto
+ * what the software pipeline does: VERTICES are vertices transformed,
+ * the vertex cache sees every triangle corner and misses once per
+ * distinct vertex of a draw, TC_CHECK1_2/TC_MISS are decoded-texture
+ * cache lookups, and the pixel metrics count fragments tested against
+ * depth (top in), passing it (top out), blended (bottom in) and written
+ * (bottom out). CLOCKS is wall time since the clear at the GC's GPU
+ * clock; the remaining clock, stall and bus metrics have no software
+ * counterpart and read 0. Reads and clears flush binned triangles first
+ * so they see every draw issued before them.
  * ================================================================ */
-void GXSetGPMetric(GXPerf0 perf0, GXPerf1 perf1) { (void)perf0; (void)perf1; }
-void GXClearGPMetric(void) {}
+#define GXPERF_GP_CLOCK_HZ 162000000ull
+
+static u64 gxperf_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static u32 gxperf_gp_clocks(void) {
+    return (u32)((gxperf_now_ns() - g_gxperf.gp_start_ns) * GXPERF_GP_CLOCK_HZ / 1000000000ull);
+}
+
+static u32 gxperf_quads(void) {
+    u32 n = 0;
+    for (int q = 1; q < 5; q++) n += g_gxperf.pix.quads[q];
+    return n;
+}
+
+static u32 gxperf_tested(void) {
+    u32 n = 0;
+    for (int q = 1; q < 5; q++) n += g_gxperf.pix.quads[q] * q;
+    return n;
+}
+
+static u32 gxperf_read0(GXPerf0 perf) {
+    if (perf >= GX_PERF0_TRIANGLES_0TEX && perf <= GX_PERF0_TRIANGLES_8TEX)
+        return g_gxperf.tris_tex[perf - GX_PERF0_TRIANGLES_0TEX];
+    if (perf >= GX_PERF0_TRIANGLES_0CLR && perf <= GX_PERF0_TRIANGLES_2CLR)
+        return g_gxperf.tris_clr[perf - GX_PERF0_TRIANGLES_0CLR];
+    if (perf >= GX_PERF0_QUAD_0CVG && perf <= GX_PERF0_QUAD_4CVG && perf != GX_PERF0_QUAD_NON0CVG)
+        return g_gxperf.pix.quads[perf == GX_PERF0_QUAD_0CVG ? 0 : perf - GX_PERF0_QUAD_1CVG + 1];
+    switch (perf) {
+        case GX_PERF0_VERTICES:           return g_gxperf.vertices;
+        case GX_PERF0_CLIP_VTX:           return g_gxperf.clip_vtx;
+        case GX_PERF0_TRIANGLES:          return g_gxperf.tris;
+        case GX_PERF0_TRIANGLES_CULLED:   return g_gxperf.tris_culled;
+        case GX_PERF0_TRIANGLES_PASSED:   return g_gxperf.tris_passed;
+        case GX_PERF0_TRIANGLES_SCISSORED: return g_gxperf.tris_scissored;
+        case GX_PERF0_QUAD_NON0CVG:       return gxperf_quads();
+        case GX_PERF0_AVG_QUAD_CNT:
+            return g_gxperf.tris_passed ? gxperf_quads() / g_gxperf.tris_passed : 0;
+        case GX_PERF0_CLOCKS:             return gxperf_gp_clocks();
+        default:                          return 0;
+    }
+}
+
+static u32 gxperf_read1(GXPerf1 perf) {
+    switch (perf) {
+        case GX_PERF1_TEXELS:      return g_gxperf.pix.texels;
+        case GX_PERF1_TC_CHECK1_2: return g_gxperf.tc_check;
+        case GX_PERF1_TC_MISS:     return g_gxperf.tc_miss;
+        case GX_PERF1_VERTICES:    return g_gxperf.vertices;
+        case GX_PERF1_FIFO_REQ:    return g_gxperf.fifo_req;
+        case GX_PERF1_CALL_REQ:    return g_gxperf.call_req;
+        case GX_PERF1_VC_MISS_REQ: return g_gxperf.vc_miss;
+        case GX_PERF1_CP_ALL_REQ:  return g_gxperf.fifo_req + g_gxperf.call_req;
+        case GX_PERF1_CLOCKS:      return gxperf_gp_clocks();
+        default:                   return 0;
+    }
+}
+
+void GXSetGPMetric(GXPerf0 perf0, GXPerf1 perf1) {
+    g_gxperf.perf0 = perf0;
+    g_gxperf.perf1 = perf1;
+}
+
+/* Clears every counter either GP metric can select */
+void GXClearGPMetric(void) {
+    gx_raster_flush();
+    g_gxperf.gp_start_ns = gxperf_now_ns();
+    g_gxperf.vertices = 0;
+    g_gxperf.clip_vtx = 0;
+    g_gxperf.tris = 0;
+    g_gxperf.tris_culled = 0;
+    g_gxperf.tris_scissored = 0;
+    g_gxperf.tris_passed = 0;
+    memset(g_gxperf.tris_tex, 0, sizeof(g_gxperf.tris_tex));
+    memset(g_gxperf.tris_clr, 0, sizeof(g_gxperf.tris_clr));
+    memset(g_gxperf.pix.quads, 0, sizeof(g_gxperf.pix.quads));
+    g_gxperf.pix.texels = 0;
+    g_gxperf.tc_check = 0;
+    g_gxperf.tc_miss = 0;
+}
+
 void GXReadXfRasMetric(u32 *xfWaitIn, u32 *xfWaitOut, u32 *rasBusy, u32 *clocks) {
     if (xfWaitIn) *xfWaitIn = 0; if (xfWaitOut) *xfWaitOut = 0;
-    if (rasBusy) *rasBusy = 0; if (clocks) *clocks = 0;
+    if (rasBusy) *rasBusy = 0; if (clocks) *clocks = gxperf_gp_clocks();
 }
-void GXReadGPMetric(u32 *count0, u32 *count1) { if (count0) *count0 = 0; if (count1) *count1 = 0; }
-u32 GXReadGP0Metric(void) { return 0; }
-u32 GXReadGP1Metric(void) { return 0; }
+void GXReadGPMetric(u32 *count0, u32 *count1) {
+    gx_raster_flush();
+    if (count0) *count0 = gxperf_read0(g_gxperf.perf0);
+    if (count1) *count1 = gxperf_read1(g_gxperf.perf1);
+}
+u32 GXReadGP0Metric(void) {
+    gx_raster_flush();
+    return gxperf_read0(g_gxperf.perf0);
+}
+u32 GXReadGP1Metric(void) {
+    gx_raster_flush();
+    return gxperf_read1(g_gxperf.perf1);
+}
+
+/* cpReq counts batches and display list calls, tcReq texture lines read */
 void GXReadMemMetric(u32 *cpReq, u32 *tcReq, u32 *cpuReadReq, u32 *cpuWriteReq,
                      u32 *dspReq, u32 *ioReq, u32 *viReq, u32 *peReq, u32 *rfReq, u32 *fiReq) {
-    if (cpReq) *cpReq = 0; if (tcReq) *tcReq = 0;
+    if (cpReq) *cpReq = g_gxperf.fifo_req + g_gxperf.call_req;
+    if (tcReq) *tcReq = g_gxperf.tc_lines;
     if (cpuReadReq) *cpuReadReq = 0; if (cpuWriteReq) *cpuWriteReq = 0;
     if (dspReq) *dspReq = 0; if (ioReq) *ioReq = 0;
     if (viReq) *viReq = 0; if (peReq) *peReq = 0;
     if (rfReq) *rfReq = 0; if (fiReq) *fiReq = 0;
 }
-void GXClearMemMetric(void) {}
+void GXClearMemMetric(void) {
+    g_gxperf.fifo_req = 0;
+    g_gxperf.call_req = 0;
+    g_gxperf.tc_lines = 0;
+}
+
+/* copyClocks assumes the copy pipe's one pixel per clock */
 void GXReadPixMetric(u32 *topIn, u32 *topOut, u32 *bottomIn, u32 *bottomOut, u32 *clearIn, u32 *copyClocks) {
-    if (topIn) *topIn = 0; if (topOut) *topOut = 0;
-    if (bottomIn) *bottomIn = 0; if (bottomOut) *bottomOut = 0;
-    if (clearIn) *clearIn = 0; if (copyClocks) *copyClocks = 0;
+    gx_raster_flush();
+    if (topIn) *topIn = gxperf_tested();
+    if (topOut) *topOut = g_gxperf.pix.passed;
+    if (bottomIn) *bottomIn = g_gxperf.pix.blended;
+    if (bottomOut) *bottomOut = g_gxperf.written;
+    if (clearIn) *clearIn = g_gxperf.clear_pixels;
+    if (copyClocks) *copyClocks = g_gxperf.copy_pixels;
 }
-void GXClearPixMetric(void) {}
+void GXClearPixMetric(void) {
+    gx_raster_flush();
+    memset(g_gxperf.pix.quads, 0, sizeof(g_gxperf.pix.quads));
+    g_gxperf.pix.passed = 0;
+    g_gxperf.pix.blended = 0;
+    g_gxperf.written = 0;
+    g_gxperf.clear_pixels = 0;
+    g_gxperf.copy_pixels = 0;
+}
+
+/* Vertices are fetched whole, so every attribute selection reads the same */
 void GXSetVCacheMetric(GXVCachePerf attr) { (void)attr; }
 void GXReadVCacheMetric(u32 *check, u32 *miss, u32 *stall) {
-    if (check) *check = 0; if (miss) *miss = 0; if (stall) *stall = 0;
+    if (check) *check = g_gxperf.vc_check;
+    if (miss) *miss = g_gxperf.vc_miss;
+    if (stall) *stall = 0;
+}
+void GXClearVCacheMetric(void) {
+    g_gxperf.vc_check = 0;
+    g_gxperf.vc_miss = 0;
 }
-void GXClearVCacheMetric(void) {}
 void GXInitXfRasMetric(void) {}
 u32 GXReadClksPerVtx(void) { return 0; }
 
@@ -1680,7 +4676,10 @@ u32 GXReadClksPerVtx(void) { return 0; }
  * Indirect Textures (bump mapping)
  * ================================================================ */
 void GXSetTevDirect(GXTevStageID tev_stage) { (void)tev_stage; }
-void GXSetNumIndStages(u8 nIndStages) { g_gx.num_ind_stages = nIndStages; }
+void GXSetNumIndStages(u8 nIndStages) {
+    GX_CAP(GXCAP_SET_NUM_IND_STAGES, 0, nIndStages);
+    g_gx.num_ind_stages = nIndStages;
+}
 void GXSetIndTexMtx(GXIndTexMtxID mtx_sel, const void *offset, s8 scale_exp) {
     (void)mtx_sel; (void)offset; (void)scale_exp;
 }
@@ -1715,66 +4714,328 @@ static void dl_record(DLEntry *entry) {
     }
 }
 
+/* ----------------------------------------------------------------
+ * Vertex array write tracking
+ *
+ * Skinning (EnvelopeProc), morphing (ShapeProc), cluster deformation and
+ * particles rewrite vertex arrays on the CPU and then DCFlush/DCStore the
+ * range so the GPU sees it. cache_pc.c forwards those flushes here. Pages
+ * are hashed into a fixed table holding the write sequence of their last
+ * flush; a collision can only cause a spurious recompile.
+ * ---------------------------------------------------------------- */
+#define VTX_DIRTY_PAGE_SHIFT 12
+#define VTX_DIRTY_SLOTS      65536
+
+static u32 g_vtx_dirty[VTX_DIRTY_SLOTS];
+static u32 g_vtx_write_seq;
+static u32 g_vtx_dirty_all;  /* seq of the last flush too large to track */
+
+void GXPCInvalidateVtxRange(const void *addr, u32 size) {
+    if (!addr || size == 0) return;
+    u32 seq = ++g_vtx_write_seq;
+    uintptr_t first = (uintptr_t)addr >> VTX_DIRTY_PAGE_SHIFT;
+    uintptr_t last = ((uintptr_t)addr + size - 1) >> VTX_DIRTY_PAGE_SHIFT;
+    if (last - first >= VTX_DIRTY_SLOTS) {
+        g_vtx_dirty_all = seq;
+        return;
+    }
+    for (uintptr_t page = first; page <= last; page++) {
+        g_vtx_dirty[page & (VTX_DIRTY_SLOTS - 1)] = seq;
+    }
+}
+
+/* True if [addr, addr + size) was flushed after sequence point seq */
+static int vtx_range_dirty(const void *addr, u32 size, u32 seq) {
+    if (g_vtx_dirty_all > seq) return 1;
+    if (!addr || size == 0) return 0;
+    uintptr_t first = (uintptr_t)addr >> VTX_DIRTY_PAGE_SHIFT;
+    uintptr_t last = ((uintptr_t)addr + size - 1) >> VTX_DIRTY_PAGE_SHIFT;
+    for (uintptr_t page = first; page <= last; page++) {
+        if (g_vtx_dirty[page & (VTX_DIRTY_SLOTS - 1)] > seq) return 1;
+    }
+    return 0;
+}
+
+/* ----------------------------------------------------------------
+ * Display list arena
+ *
+ * Host-side storage for recorded entries and compiled data. Requests up
+ * to 64 KB are rounded to a power-of-two size class and carved from
+ * 256 KB slabs; freed blocks go back on their class's free list, so
+ * recreating models across board and minigame transitions reuses the
+ * same memory. Larger requests go straight to malloc.
+ * ---------------------------------------------------------------- */
+#define DL_ARENA_MIN_SHIFT 6
+#define DL_ARENA_MAX_SHIFT 16
+#define DL_ARENA_CLASSES   (DL_ARENA_MAX_SHIFT - DL_ARENA_MIN_SHIFT + 1)
+#define DL_ARENA_SLAB_SIZE (256 * 1024)
+
+typedef struct DLFreeBlock {
+    struct DLFreeBlock *next;
+} DLFreeBlock;
+
+static struct {
+    DLFreeBlock *free[DL_ARENA_CLASSES];
+    u8 *slab;           /* current slab and bytes left in it */
+    u32 slab_left;
+    u32 slab_bytes;     /* total slab memory */
+    u32 large_bytes;    /* live blocks above the largest class */
+} g_dl_arena;
+
+static void dl_out_of_memory(void) {
+    fprintf(stderr, "[GX] display list arena: out of memory\n");
+    abort();
+}
+
+static int dl_arena_class(u32 size) {
+    int c = 0;
+    while ((1u << (c + DL_ARENA_MIN_SHIFT)) < size) c++;
+    return c;
+}
+
+static void *dl_arena_alloc(u32 size) {
+    if (size > (1u << DL_ARENA_MAX_SHIFT)) {
+        void *p = malloc(size);
+        if (!p) dl_out_of_memory();
+        g_dl_arena.large_bytes += size;
+        return p;
+    }
+    int c = dl_arena_class(size);
+    DLFreeBlock *b = g_dl_arena.free[c];
+    if (b) {
+        g_dl_arena.free[c] = b->next;
+        return b;
+    }
+    u32 block = 1u << (c + DL_ARENA_MIN_SHIFT);
+    if (g_dl_arena.slab_left < block) {
+        /* The tail of the old slab feeds the smaller classes */
+        while (g_dl_arena.slab_left >= (1u << DL_ARENA_MIN_SHIFT)) {
+            int tc = dl_arena_class(g_dl_arena.slab_left);
+            if ((1u << (tc + DL_ARENA_MIN_SHIFT)) > g_dl_arena.slab_left) tc--;
+            DLFreeBlock *t = (DLFreeBlock *)g_dl_arena.slab;
+            t->next = g_dl_arena.free[tc];
+            g_dl_arena.free[tc] = t;
+            g_dl_arena.slab += 1u << (tc + DL_ARENA_MIN_SHIFT);
+            g_dl_arena.slab_left -= 1u << (tc + DL_ARENA_MIN_SHIFT);
+        }
+        g_dl_arena.slab = (u8 *)malloc(DL_ARENA_SLAB_SIZE);
+        if (!g_dl_arena.slab) dl_out_of_memory();
+        g_dl_arena.slab_left = DL_ARENA_SLAB_SIZE;
+        g_dl_arena.slab_bytes += DL_ARENA_SLAB_SIZE;
+    }
+    void *p = g_dl_arena.slab;
+    g_dl_arena.slab += block;
+    g_dl_arena.slab_left -= block;
+    return p;
+}
+
+/* size must match the dl_arena_alloc request */
+static void dl_arena_free(void *p, u32 size) {
+    if (!p) return;
+    if (size > (1u << DL_ARENA_MAX_SHIFT)) {
+        g_dl_arena.large_bytes -= size;
+        free(p);
+        return;
+    }
+    int c = dl_arena_class(size);
+    DLFreeBlock *b = (DLFreeBlock *)p;
+    b->next = g_dl_arena.free[c];
+    g_dl_arena.free[c] = b;
+}
+
+/* ----------------------------------------------------------------
+ * Compiled display lists
+ *
+ * GXEndDisplayList scans the recorded stream for the vertex formats and
+ * the highest array index it reads from each source. The first call then
+ * replays the stream once with g_dl_capturing set: every primitive group
+ * is assembled into triangles as usual but lands in one shared, vertex-
+ * deduplicated GXSWVertex array plus one triangle index list. Later calls
+ * transform that array and rasterize the list directly, with no per-
+ * command dispatch or array reads.
+ *
+ * The decoded vertices depend on the bound arrays, the attribute formats
+ * and the vertex descriptor, so they are keyed on those and rebuilt when
+ * any changes or when a flush touches the indexed part of an array.
+ * ---------------------------------------------------------------- */
+
+/* Array sources display lists can index, in DL_CMD_*1X16 order */
+static const GXAttr dl_index_attrs[4] = { GX_VA_POS, GX_VA_NRM, GX_VA_CLR0, GX_VA_TEX0 };
+
+typedef struct {
+    int compilable;     /* stream starts with GXBegin, so replay is self-contained */
+    u8 fmt_mask;        /* vertex formats named by its GXBegin commands */
+    s32 max_index[4];   /* highest index read per dl_index_attrs source, -1 = none */
+
+    /* Decoded form, valid while key matches and no source was flushed */
+    int decoded;
+    u64 key;
+    u32 decode_seq;
+    const void *src_data[4];
+    u32 src_size[4];
+    GXSWVertex *verts;
+    u32 nverts;
+    u32 *tris;
+    u32 ntris;
+
+    /* GX vertex state the replay leaves behind */
+    GXPrimitive end_prim;
+    GXVtxFmt end_fmt;
+    u16 end_nverts;
+    GXSWVertex end_vertex;
+    u8 end_has_pos, end_has_nrm, end_has_clr, end_texcoord_count;
+} GXCompiledDL;
+
 /* Display list handle stored in game's buffer.
  * The game allocates a small buffer expecting GC FIFO commands (~4 bytes each).
- * Our DLEntry is much larger (~16 bytes), so we malloc our own buffer and store
- * a handle in the game's buffer that GXCallDisplayList can look up. */
+ * Our DLEntry is much larger (~16 bytes), so we keep the entries in the DL
+ * arena and store a handle in the game's buffer that GXCallDisplayList can
+ * look up. */
 typedef struct {
     u32 magic;        /* 0xDEADDL01 */
     u32 count;
     DLEntry *entries;
+    GXCompiledDL *compiled;
 } DLHandle;
 #define DL_HANDLE_MAGIC 0xDEAD0101
 
+/* Every live list, sorted by the game buffer holding its handle. The
+ * heap allocator calls GXPCReleaseDisplayLists when it frees a block, so
+ * lists die with the model data that owns them. */
+typedef struct {
+    void *game_buf;
+    DLEntry *entries;
+    u32 count;
+    GXCompiledDL *compiled;
+} DLRecord;
+
+static struct {
+    DLRecord *lists;
+    u32 count, cap;
+} g_dl_live;
+
+static GXPCDisplayListStats g_dl_stats;
+
 #define DL_INTERNAL_MAX 16384
 
-static int g_gx_dl_create_count = 0;
-void GXBeginDisplayList(void *list, u32 size) {
-    g_gx.recording_dl = 1;
-    /* Allocate our own internal buffer for DL entries */
-    g_gx.dl_buf = (DLEntry *)malloc(DL_INTERNAL_MAX * sizeof(DLEntry));
-    g_gx.dl_buf_size = DL_INTERNAL_MAX * sizeof(DLEntry);
-    g_gx.dl_count = 0;
-    /* Remember where the game's buffer is so we can store the handle */
-    g_gx.dl_game_buf = list;
-    g_gx_dl_create_count++;
+/* Recording scratch, reused by every GXBeginDisplayList */
+static DLEntry *g_dl_scratch;
+
+/* Accumulates one display list's primitives during its capture replay */
+static struct {
+    GXSWVertex *verts;
+    u32 nverts, vert_cap;
+    u32 *tris;
+    u32 ntris, tri_cap;
+    u32 *slots;         /* dedupe table: vertex index + 1, 0 = empty */
+    u32 slot_mask;
+    u32 remap[GX_MAX_PENDING_VERTS];
+} g_dl_cap;
+
+static void dl_cap_rehash(u32 nslots) {
+    free(g_dl_cap.slots);
+    g_dl_cap.slots = (u32 *)calloc(nslots, sizeof(u32));
+    if (!g_dl_cap.slots) dl_out_of_memory();
+    g_dl_cap.slot_mask = nslots - 1;
+    for (u32 i = 0; i < g_dl_cap.nverts; i++) {
+        u32 h = (u32)gx_hash64(&g_dl_cap.verts[i], sizeof(GXSWVertex), 0) & g_dl_cap.slot_mask;
+        while (g_dl_cap.slots[h]) h = (h + 1) & g_dl_cap.slot_mask;
+        g_dl_cap.slots[h] = i + 1;
+    }
 }
 
-u32 GXEndDisplayList(void) {
-    g_gx.recording_dl = 0;
-    /* Shrink internal buffer to actual size */
-    DLEntry *final = (DLEntry *)realloc(g_gx.dl_buf, g_gx.dl_count * sizeof(DLEntry));
-    if (!final) final = g_gx.dl_buf;
-    /* Store handle in game's buffer */
-    DLHandle *handle = (DLHandle *)g_gx.dl_game_buf;
-    handle->magic = DL_HANDLE_MAGIC;
-    handle->count = g_gx.dl_count;
-    handle->entries = final;
-    if (g_gx_dl_create_count <= 5) {
-        printf("[GX] DL created #%d: buf=%p count=%u entries=%p handle_size=%zu\n",
-               g_gx_dl_create_count, (void*)g_gx.dl_game_buf, g_gx.dl_count, (void*)final, sizeof(DLHandle));
+/* Index of an identical vertex already captured, or of a new copy of v */
+static u32 dl_cap_vertex(const GXSWVertex *v) {
+    if ((g_dl_cap.nverts + 1) * 2 > g_dl_cap.slot_mask + 1) {
+        dl_cap_rehash(g_dl_cap.slot_mask ? (g_dl_cap.slot_mask + 1) * 2 : 4096);
     }
-    g_gx.dl_buf = NULL;
-    /* Return the size of the handle (what the game thinks is the DL size) */
-    return (u32)sizeof(DLHandle);
+    u32 h = (u32)gx_hash64(v, sizeof(GXSWVertex), 0) & g_dl_cap.slot_mask;
+    while (g_dl_cap.slots[h]) {
+        u32 i = g_dl_cap.slots[h] - 1;
+        if (memcmp(&g_dl_cap.verts[i], v, sizeof(GXSWVertex)) == 0) return i;
+        h = (h + 1) & g_dl_cap.slot_mask;
+    }
+    if (g_dl_cap.nverts == g_dl_cap.vert_cap) {
+        u32 cap = g_dl_cap.vert_cap ? g_dl_cap.vert_cap * 2 : 1024;
+        GXSWVertex *grown = (GXSWVertex *)realloc(g_dl_cap.verts, cap * sizeof(GXSWVertex));
+        if (!grown) dl_out_of_memory();
+        g_dl_cap.verts = grown;
+        g_dl_cap.vert_cap = cap;
+    }
+    g_dl_cap.verts[g_dl_cap.nverts] = *v;
+    g_dl_cap.slots[h] = ++g_dl_cap.nverts;
+    return g_dl_cap.nverts - 1;
 }
 
-void GXCallDisplayList(const void *list, u32 nbytes) {
-    g_gx_dl_call_count++;
-    if (!list || nbytes == 0) { g_gx_dl_fail_null++; return; }
-    const DLHandle *handle = (const DLHandle *)list;
-    if (handle->magic != DL_HANDLE_MAGIC || !handle->entries) {
-        g_gx_dl_fail_magic++;
-        if (g_gx_dl_fail_magic <= 5) {
-            printf("[GX] DL magic fail: ptr=%p nbytes=%u magic=0x%08x (expected 0x%08x)\n",
-                   list, nbytes, handle->magic, DL_HANDLE_MAGIC);
+static void dl_capture_primitives(const GXSWVertex *vb, u32 nverts, const u32 *tris, u32 ntris) {
+    if (g_dl_cap.ntris + ntris > g_dl_cap.tri_cap) {
+        u32 cap = g_dl_cap.tri_cap ? g_dl_cap.tri_cap : 1024;
+        while (cap < g_dl_cap.ntris + ntris) cap *= 2;
+        u32 *grown = (u32 *)realloc(g_dl_cap.tris, cap * 3 * sizeof(u32));
+        if (!grown) dl_out_of_memory();
+        g_dl_cap.tris = grown;
+        g_dl_cap.tri_cap = cap;
+    }
+    /* Only vertices some triangle uses are kept */
+    memset(g_dl_cap.remap, 0xFF, nverts * sizeof(u32));
+    u32 *out = &g_dl_cap.tris[g_dl_cap.ntris * 3];
+    for (u32 i = 0; i < ntris * 3; i++) {
+        u32 v = tris[i];
+        if (g_dl_cap.remap[v] == ~0u) g_dl_cap.remap[v] = dl_cap_vertex(&vb[v]);
+        out[i] = g_dl_cap.remap[v];
+    }
+    g_dl_cap.ntris += ntris;
+}
+
+/* Everything besides array contents that the decoded vertices depend on */
+static u64 dl_source_key(const GXCompiledDL *c) {
+    struct {
+        const void *data[4];
+        u32 stride[4];
+        GXVtxAttrFmtEntry fmt[GX_MAX_VTXFMT][4];
+        u32 submit_on;
+    } k;
+    memset(&k, 0, sizeof(k));
+    for (int s = 0; s < 4; s++) {
+        const GXVtxArray *arr = &g_gx.vtx_arrays[dl_index_attrs[s]];
+        k.data[s] = arr->data;
+        k.stride[s] = arr->stride;
+    }
+    for (int f = 0; f < GX_MAX_VTXFMT; f++) {
+        if (!(c->fmt_mask & (1 << f))) continue;
+        for (int s = 0; s < 4; s++) k.fmt[f][s] = g_gx.vtx_attr_fmt[f][dl_index_attrs[s]];
+    }
+    k.submit_on = (u32)g_gx.vtx_submit_on;
+    return gx_hash64(&k, sizeof(k), 0);
+}
+
+/* Scan a finished stream for what its compiled form will depend on */
+static GXCompiledDL *dl_compile(const DLEntry *entries, u32 count) {
+    GXCompiledDL *c = (GXCompiledDL *)dl_arena_alloc(sizeof(GXCompiledDL));
+    memset(c, 0, sizeof(GXCompiledDL));
+    c->compilable = (count > 0 && entries[0].cmd == DL_CMD_BEGIN);
+    for (int s = 0; s < 4; s++) c->max_index[s] = -1;
+    for (u32 i = 0; i < count; i++) {
+        const DLEntry *e = &entries[i];
+        int s;
+        switch (e->cmd) {
+            case DL_CMD_BEGIN:
+                c->fmt_mask |= 1 << (e->begin.fmt < GX_MAX_VTXFMT ? e->begin.fmt : GX_VTXFMT0);
+                continue;
+            case DL_CMD_POSITION1X16: case DL_CMD_POSITION1X8: s = 0; break;
+            case DL_CMD_NORMAL1X16:   case DL_CMD_NORMAL1X8:   s = 1; break;
+            case DL_CMD_COLOR1X16:    case DL_CMD_COLOR1X8:    s = 2; break;
+            case DL_CMD_TEXCOORD1X16: case DL_CMD_TEXCOORD1X8: s = 3; break;
+            default: continue;
         }
-        return;
+        s32 index = (e->cmd >= DL_CMD_POSITION1X8) ? (u8)e->index : e->index;
+        if (index > c->max_index[s]) c->max_index[s] = index;
     }
-    g_gx_dl_ok++;
-    const DLEntry *entries = handle->entries;
-    u32 count = handle->count;
+    return c;
+}
 
+/* Re-invoke the public GX entry points for every recorded command */
+static void dl_replay(const DLEntry *entries, u32 count) {
     for (u32 i = 0; i < count; i++) {
         const DLEntry *e = &entries[i];
         switch (e->cmd) {
@@ -1838,6 +5099,223 @@ void GXCallDisplayList(const void *list, u32 nbytes) {
     }
 }
 
+static u32 dl_decoded_bytes(const GXCompiledDL *c) {
+    return c->nverts * (u32)sizeof(GXSWVertex) + c->ntris * 3 * (u32)sizeof(u32);
+}
+
+static void dl_free_decoded(GXCompiledDL *c) {
+    g_dl_stats.compiled_bytes -= dl_decoded_bytes(c);
+    dl_arena_free(c->verts, c->nverts * sizeof(GXSWVertex));
+    dl_arena_free(c->tris, c->ntris * 3 * sizeof(u32));
+    c->verts = NULL;
+    c->tris = NULL;
+    c->nverts = 0;
+    c->ntris = 0;
+}
+
+/* Decode the stream against the current arrays into c's vertex/triangle lists */
+static void dl_decode(GXCompiledDL *c, const DLEntry *entries, u32 count, u64 key) {
+    g_dl_cap.nverts = 0;
+    g_dl_cap.ntris = 0;
+    if (g_dl_cap.slots) memset(g_dl_cap.slots, 0, (g_dl_cap.slot_mask + 1) * sizeof(u32));
+
+    g_dl_capturing = 1;
+    dl_replay(entries, count);
+    g_dl_capturing = 0;
+
+    dl_free_decoded(c);
+    c->nverts = g_dl_cap.nverts;
+    c->ntris = g_dl_cap.ntris;
+    if (c->nverts) {
+        c->verts = (GXSWVertex *)dl_arena_alloc(c->nverts * sizeof(GXSWVertex));
+        c->tris = (u32 *)dl_arena_alloc(c->ntris * 3 * sizeof(u32));
+        g_dl_stats.compiled_bytes += dl_decoded_bytes(c);
+        memcpy(c->verts, g_dl_cap.verts, c->nverts * sizeof(GXSWVertex));
+        memcpy(c->tris, g_dl_cap.tris, c->ntris * 3 * sizeof(u32));
+    }
+
+    c->end_prim = g_gx.current_prim;
+    c->end_fmt = g_gx.current_vtx_fmt;
+    c->end_nverts = g_gx.current_prim_nverts;
+    c->end_vertex = g_gx.current_vertex;
+    c->end_has_pos = (u8)g_gx.cur_vtx_has_pos;
+    c->end_has_nrm = (u8)g_gx.cur_vtx_has_nrm;
+    c->end_has_clr = (u8)g_gx.cur_vtx_has_clr;
+    c->end_texcoord_count = (u8)g_gx.cur_vtx_texcoord_count;
+
+    for (int s = 0; s < 4; s++) {
+        const GXVtxArray *arr = &g_gx.vtx_arrays[dl_index_attrs[s]];
+        c->src_data[s] = arr->data;
+        c->src_size[s] = (arr->data && c->max_index[s] >= 0)
+                       ? (u32)(c->max_index[s] + 1) * arr->stride : 0;
+    }
+    c->key = key;
+    c->decode_seq = g_vtx_write_seq;
+    c->decoded = 1;
+}
+
+static int dl_decoded_valid(const GXCompiledDL *c, u64 key) {
+    if (!c->decoded || c->key != key) return 0;
+    for (int s = 0; s < 4; s++) {
+        if (vtx_range_dirty(c->src_data[s], c->src_size[s], c->decode_seq)) return 0;
+    }
+    return 1;
+}
+
+/* Draw a decoded list and leave GX vertex state as a replay would */
+static void dl_draw_compiled(const GXCompiledDL *c) {
+    if (c->ntris) rasterize_indexed(c->verts, c->nverts, c->tris, c->ntris);
+    g_gx.current_prim = c->end_prim;
+    g_gx.current_vtx_fmt = c->end_fmt;
+    g_gx.current_prim_nverts = c->end_nverts;
+    g_gx.verts_submitted = 0;
+    g_gx.current_vertex = c->end_vertex;
+    g_gx.cur_vtx_has_pos = c->end_has_pos;
+    g_gx.cur_vtx_has_nrm = c->end_has_nrm;
+    g_gx.cur_vtx_has_clr = c->end_has_clr;
+    g_gx.cur_vtx_texcoord_count = c->end_texcoord_count;
+}
+
+/* First record whose game buffer is at or above addr */
+static u32 dl_live_lower_bound(uintptr_t addr) {
+    u32 lo = 0, hi = g_dl_live.count;
+    while (lo < hi) {
+        u32 mid = (lo + hi) / 2;
+        if ((uintptr_t)g_dl_live.lists[mid].game_buf < addr) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void dl_release(DLRecord *r) {
+    DLHandle *handle = (DLHandle *)r->game_buf;
+    if (handle->magic == DL_HANDLE_MAGIC && handle->entries == r->entries) handle->magic = 0;
+    dl_arena_free(r->entries, (r->count ? r->count : 1) * sizeof(DLEntry));
+    g_dl_stats.entry_bytes -= r->count * sizeof(DLEntry);
+    if (r->compiled) {
+        dl_free_decoded(r->compiled);
+        dl_arena_free(r->compiled, sizeof(GXCompiledDL));
+    }
+    g_dl_stats.lists--;
+    g_dl_stats.released++;
+}
+
+void GXPCReleaseDisplayLists(const void *addr, u32 size) {
+    if (g_dl_live.count == 0 || !addr || size == 0) return;
+    u32 first = dl_live_lower_bound((uintptr_t)addr);
+    u32 last = dl_live_lower_bound((uintptr_t)addr + size);
+    if (first == last) return;
+    for (u32 i = first; i < last; i++) dl_release(&g_dl_live.lists[i]);
+    memmove(&g_dl_live.lists[first], &g_dl_live.lists[last],
+            (g_dl_live.count - last) * sizeof(DLRecord));
+    g_dl_live.count -= last - first;
+}
+
+void GXPCGetDisplayListStats(GXPCDisplayListStats *stats) {
+    *stats = g_dl_stats;
+    stats->arena_bytes = g_dl_arena.slab_bytes + g_dl_arena.large_bytes;
+}
+
+static void dl_live_add(const DLRecord *r) {
+    u32 i = dl_live_lower_bound((uintptr_t)r->game_buf);
+    if (g_dl_live.count == g_dl_live.cap) {
+        u32 cap = g_dl_live.cap ? g_dl_live.cap * 2 : 256;
+        DLRecord *grown = (DLRecord *)realloc(g_dl_live.lists, cap * sizeof(DLRecord));
+        if (!grown) dl_out_of_memory();
+        g_dl_live.lists = grown;
+        g_dl_live.cap = cap;
+    }
+    memmove(&g_dl_live.lists[i + 1], &g_dl_live.lists[i], (g_dl_live.count - i) * sizeof(DLRecord));
+    g_dl_live.lists[i] = *r;
+    g_dl_live.count++;
+    g_dl_stats.lists++;
+}
+
+static int g_gx_dl_create_count = 0;
+void GXBeginDisplayList(void *list, u32 size) {
+    (void)size;
+    /* Re-recording into a buffer replaces the list it held */
+    GXPCReleaseDisplayLists(list, 1);
+    g_gx.recording_dl = 1;
+    if (!g_dl_scratch) {
+        g_dl_scratch = (DLEntry *)malloc(DL_INTERNAL_MAX * sizeof(DLEntry));
+        if (!g_dl_scratch) dl_out_of_memory();
+    }
+    g_gx.dl_buf = g_dl_scratch;
+    g_gx.dl_buf_size = DL_INTERNAL_MAX * sizeof(DLEntry);
+    g_gx.dl_count = 0;
+    /* Remember where the game's buffer is so we can store the handle */
+    g_gx.dl_game_buf = list;
+    g_gx_dl_create_count++;
+}
+
+u32 GXEndDisplayList(void) {
+    g_gx.recording_dl = 0;
+    /* Move the recorded entries into the arena */
+    u32 count = g_gx.dl_count;
+    DLEntry *final = (DLEntry *)dl_arena_alloc((count ? count : 1) * sizeof(DLEntry));
+    memcpy(final, g_gx.dl_buf, count * sizeof(DLEntry));
+    g_dl_stats.entry_bytes += count * sizeof(DLEntry);
+
+    DLRecord r;
+    r.game_buf = g_gx.dl_game_buf;
+    r.entries = final;
+    r.count = count;
+    r.compiled = g_gx_dl_compile ? dl_compile(final, count) : NULL;
+    dl_live_add(&r);
+
+    /* Store handle in game's buffer */
+    DLHandle *handle = (DLHandle *)g_gx.dl_game_buf;
+    handle->magic = DL_HANDLE_MAGIC;
+    handle->count = count;
+    handle->entries = final;
+    handle->compiled = r.compiled;
+    if (g_gx_dl_create_count <= 5) {
+        printf("[GX] DL created #%d: buf=%p count=%u entries=%p handle_size=%zu\n",
+               g_gx_dl_create_count, (void*)g_gx.dl_game_buf, count, (void*)final, sizeof(DLHandle));
+    }
+    g_gx.dl_buf = NULL;
+    /* Return the size of the handle (what the game thinks is the DL size) */
+    return (u32)sizeof(DLHandle);
+}
+
+void GXCallDisplayList(const void *list, u32 nbytes) {
+    g_gx_dl_call_count++;
+    g_gxperf.call_req++;
+    if (!list || nbytes == 0) { g_gx_dl_fail_null++; return; }
+    const DLHandle *handle = (const DLHandle *)list;
+    if (handle->magic != DL_HANDLE_MAGIC || !handle->entries) {
+        g_gx_dl_fail_magic++;
+        if (g_gx_dl_fail_magic <= 5) {
+            printf("[GX] DL magic fail: ptr=%p nbytes=%u magic=0x%08x (expected 0x%08x)\n",
+                   list, nbytes, handle->magic, DL_HANDLE_MAGIC);
+        }
+        return;
+    }
+    g_gx_dl_ok++;
+
+    /* The trace replays the list from its own copy of the commands */
+    int cap = g_gxcap_on && !g_gx.recording_dl;
+    if (cap) {
+        gx_cap_call_dl(list, handle->entries, handle->count);
+        g_gxcap_on = 0;
+    }
+
+    GXCompiledDL *c = handle->compiled;
+    if (!c || !c->compilable || g_gx.recording_dl) {
+        dl_replay(handle->entries, handle->count);
+    } else {
+        u64 key = dl_source_key(c);
+        if (!dl_decoded_valid(c, key)) {
+            dl_decode(c, handle->entries, handle->count, key);
+            g_gx_dl_decodes++;
+            g_dl_stats.decodes++;
+        }
+        dl_draw_compiled(c);
+    }
+    if (cap) g_gxcap_on = 1;
+}
+
 /* ================================================================
  * Misc
  * ================================================================ */
@@ -0,0 +1,310 @@
+#ifndef GX_SIMD_H
+#define GX_SIMD_H
+
+/*
+ * 4-wide float/int vector helpers for the software GX pipeline.
+ * Maps onto SSE2 on x86-64, NEON on ARM64 (Apple Silicon), and plain
+ * arrays elsewhere. Only the handful of operations the rasterizer, lighting
+ * and texture decoders need.
+ */
+
+#include "dolphin/types.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define GX_SIMD_SSE2 1
+#include <emmintrin.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+typedef __m128  v4f;
+typedef __m128i v4i;
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define GX_SIMD_NEON 1
+#include <arm_neon.h>
+typedef float32x4_t v4f;
+typedef int32x4_t   v4i;
+#else
+#define GX_SIMD_SCALAR 1
+#include <math.h>
+#include <string.h>
+typedef struct { float f[4]; } v4f;
+typedef struct { s32 i[4]; } v4i;
+#endif
+
+#if GX_SIMD_SSE2
+
+static inline v4f v4f_set1(float a) { return _mm_set1_ps(a); }
+static inline v4f v4f_set(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+static inline v4f v4f_add(v4f a, v4f b) { return _mm_add_ps(a, b); }
+static inline v4f v4f_sub(v4f a, v4f b) { return _mm_sub_ps(a, b); }
+static inline v4f v4f_mul(v4f a, v4f b) { return _mm_mul_ps(a, b); }
+static inline v4f v4f_div(v4f a, v4f b) { return _mm_div_ps(a, b); }
+static inline v4f v4f_min(v4f a, v4f b) { return _mm_min_ps(a, b); }
+static inline v4f v4f_max(v4f a, v4f b) { return _mm_max_ps(a, b); }
+static inline v4f v4f_sqrt(v4f a) { return _mm_sqrt_ps(a); }
+static inline void v4f_store(float *p, v4f a) { _mm_storeu_ps(p, a); }
+static inline v4f v4f_load(const float *p) { return _mm_loadu_ps(p); }
+/* Bit n set when a[n] <= b[n] */
+static inline int v4f_cmple_mask(v4f a, v4f b) { return _mm_movemask_ps(_mm_cmple_ps(a, b)); }
+/* Lanes where |a| > eps take b, others take c */
+static inline v4f v4f_select_absgt(v4f a, float eps, v4f b, v4f c) {
+    v4f absa = _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+    v4f m = _mm_cmpgt_ps(absa, _mm_set1_ps(eps));
+    return _mm_or_ps(_mm_and_ps(m, b), _mm_andnot_ps(m, c));
+}
+/* Lanes where a >= 0 take b, others take c */
+static inline v4f v4f_select_gez(v4f a, v4f b, v4f c) {
+    v4f m = _mm_cmpge_ps(a, _mm_setzero_ps());
+    return _mm_or_ps(_mm_and_ps(m, b), _mm_andnot_ps(m, c));
+}
+/* Conversions; v4i_from_v4f truncates toward zero. v4f_floor expects
+ * lanes within the s32 range. */
+static inline v4f v4f_from_v4i(v4i a) { return _mm_cvtepi32_ps(a); }
+static inline v4i v4i_from_v4f(v4f a) { return _mm_cvttps_epi32(a); }
+static inline v4f v4f_floor(v4f a) {
+#ifdef __SSE4_1__
+    return _mm_floor_ps(a);
+#else
+    v4f t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+#endif
+}
+
+static inline v4i v4i_set1(s32 a) { return _mm_set1_epi32(a); }
+static inline v4i v4i_set(s32 a, s32 b, s32 c, s32 d) { return _mm_setr_epi32(a, b, c, d); }
+static inline v4i v4i_add(v4i a, v4i b) { return _mm_add_epi32(a, b); }
+static inline v4i v4i_or(v4i a, v4i b) { return _mm_or_si128(a, b); }
+/* Bit n set when lane n is negative */
+static inline int v4i_signmask(v4i a) { return _mm_movemask_ps(_mm_castsi128_ps(a)); }
+
+/* Byte and halfword lane operations (texture decoding) */
+static inline v4i v4i_load(const void *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline void v4i_store(void *p, v4i a) { _mm_storeu_si128((__m128i *)p, a); }
+static inline v4i v4i_and(v4i a, v4i b) { return _mm_and_si128(a, b); }
+/* Bits set in m take a, others b */
+static inline v4i v4i_select(v4i m, v4i a, v4i b) {
+    return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+static inline v4i v4i_set1_16(u16 a) { return _mm_set1_epi16((short)a); }
+static inline v4i v4i_add16(v4i a, v4i b) { return _mm_add_epi16(a, b); }
+static inline v4i v4i_shl16(v4i a, int n) { return _mm_slli_epi16(a, n); }
+static inline v4i v4i_shr16(v4i a, int n) { return _mm_srli_epi16(a, n); }
+static inline v4i v4i_sar16(v4i a, int n) { return _mm_srai_epi16(a, n); }
+static inline v4i v4i_shl32(v4i a, int n) { return _mm_slli_epi32(a, n); }
+static inline v4i v4i_shr32(v4i a, int n) { return _mm_srli_epi32(a, n); }
+/* High half of the unsigned 16x16 product */
+static inline v4i v4i_mulhi_u16(v4i a, v4i b) { return _mm_mulhi_epu16(a, b); }
+static inline v4i v4i_cmpgt_u16(v4i a, v4i b) {
+    v4i bias = _mm_set1_epi16((short)0x8000);
+    return _mm_cmpgt_epi16(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+}
+/* Interleave the low or high halves of a and b */
+static inline v4i v4i_zip8_lo(v4i a, v4i b) { return _mm_unpacklo_epi8(a, b); }
+static inline v4i v4i_zip8_hi(v4i a, v4i b) { return _mm_unpackhi_epi8(a, b); }
+static inline v4i v4i_zip16_lo(v4i a, v4i b) { return _mm_unpacklo_epi16(a, b); }
+static inline v4i v4i_zip16_hi(v4i a, v4i b) { return _mm_unpackhi_epi16(a, b); }
+static inline v4i v4i_zip64_lo(v4i a, v4i b) { return _mm_unpacklo_epi64(a, b); }
+static inline v4i v4i_zip64_hi(v4i a, v4i b) { return _mm_unpackhi_epi64(a, b); }
+/* Swap the bytes of each halfword (big-endian 16-bit texels) */
+static inline v4i v4i_bswap16(v4i a) {
+#ifdef __SSSE3__
+    return _mm_shuffle_epi8(a, _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+#else
+    return _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+#endif
+}
+
+#elif GX_SIMD_NEON
+
+static inline v4f v4f_set1(float a) { return vdupq_n_f32(a); }
+static inline v4f v4f_set(float a, float b, float c, float d) {
+    float t[4] = { a, b, c, d };
+    return vld1q_f32(t);
+}
+static inline v4f v4f_add(v4f a, v4f b) { return vaddq_f32(a, b); }
+static inline v4f v4f_sub(v4f a, v4f b) { return vsubq_f32(a, b); }
+static inline v4f v4f_mul(v4f a, v4f b) { return vmulq_f32(a, b); }
+static inline v4f v4f_div(v4f a, v4f b) { return vdivq_f32(a, b); }
+static inline v4f v4f_min(v4f a, v4f b) { return vminq_f32(a, b); }
+static inline v4f v4f_max(v4f a, v4f b) { return vmaxq_f32(a, b); }
+static inline v4f v4f_sqrt(v4f a) { return vsqrtq_f32(a); }
+static inline void v4f_store(float *p, v4f a) { vst1q_f32(p, a); }
+static inline v4f v4f_load(const float *p) { return vld1q_f32(p); }
+static inline int v4f_cmple_mask(v4f a, v4f b) {
+    static const int32x4_t shift = { 0, 1, 2, 3 };
+    uint32x4_t le = vshrq_n_u32(vcleq_f32(a, b), 31);
+    return (int)vaddvq_u32(vshlq_u32(le, shift));
+}
+static inline v4f v4f_select_absgt(v4f a, float eps, v4f b, v4f c) {
+    uint32x4_t m = vcagtq_f32(a, vdupq_n_f32(eps));
+    return vbslq_f32(m, b, c);
+}
+static inline v4f v4f_select_gez(v4f a, v4f b, v4f c) {
+    return vbslq_f32(vcgezq_f32(a), b, c);
+}
+static inline v4f v4f_from_v4i(v4i a) { return vcvtq_f32_s32(a); }
+static inline v4i v4i_from_v4f(v4f a) { return vcvtq_s32_f32(a); }
+static inline v4f v4f_floor(v4f a) { return vrndmq_f32(a); }
+
+static inline v4i v4i_set1(s32 a) { return vdupq_n_s32(a); }
+static inline v4i v4i_set(s32 a, s32 b, s32 c, s32 d) {
+    s32 t[4] = { a, b, c, d };
+    return vld1q_s32(t);
+}
+static inline v4i v4i_add(v4i a, v4i b) { return vaddq_s32(a, b); }
+static inline v4i v4i_or(v4i a, v4i b) { return vorrq_s32(a, b); }
+static inline int v4i_signmask(v4i a) {
+    static const int32x4_t shift = { 0, 1, 2, 3 };
+    uint32x4_t sign = vshrq_n_u32(vreinterpretq_u32_s32(a), 31);
+    return (int)vaddvq_u32(vshlq_u32(sign, shift));
+}
+
+#define GX_U8(a)  vreinterpretq_u8_s32(a)
+#define GX_U16(a) vreinterpretq_u16_s32(a)
+#define GX_U32(a) vreinterpretq_u32_s32(a)
+#define GX_U64(a) vreinterpretq_u64_s32(a)
+static inline v4i v4i_load(const void *p) { return vreinterpretq_s32_u8(vld1q_u8((const u8 *)p)); }
+static inline void v4i_store(void *p, v4i a) { vst1q_u8((u8 *)p, GX_U8(a)); }
+static inline v4i v4i_and(v4i a, v4i b) { return vandq_s32(a, b); }
+static inline v4i v4i_select(v4i m, v4i a, v4i b) { return vbslq_s32(GX_U32(m), a, b); }
+static inline v4i v4i_set1_16(u16 a) { return vreinterpretq_s32_u16(vdupq_n_u16(a)); }
+static inline v4i v4i_add16(v4i a, v4i b) { return vreinterpretq_s32_u16(vaddq_u16(GX_U16(a), GX_U16(b))); }
+static inline v4i v4i_shl16(v4i a, int n) {
+    return vreinterpretq_s32_u16(vshlq_u16(GX_U16(a), vdupq_n_s16((s16)n)));
+}
+static inline v4i v4i_shr16(v4i a, int n) {
+    return vreinterpretq_s32_u16(vshlq_u16(GX_U16(a), vdupq_n_s16((s16)-n)));
+}
+static inline v4i v4i_sar16(v4i a, int n) {
+    return vreinterpretq_s32_s16(vshlq_s16(vreinterpretq_s16_s32(a), vdupq_n_s16((s16)-n)));
+}
+static inline v4i v4i_shl32(v4i a, int n) {
+    return vreinterpretq_s32_u32(vshlq_u32(GX_U32(a), vdupq_n_s32(n)));
+}
+static inline v4i v4i_shr32(v4i a, int n) {
+    return vreinterpretq_s32_u32(vshlq_u32(GX_U32(a), vdupq_n_s32(-n)));
+}
+static inline v4i v4i_mulhi_u16(v4i a, v4i b) {
+    uint32x4_t lo = vmull_u16(vget_low_u16(GX_U16(a)), vget_low_u16(GX_U16(b)));
+    uint32x4_t hi = vmull_u16(vget_high_u16(GX_U16(a)), vget_high_u16(GX_U16(b)));
+    return vreinterpretq_s32_u16(vcombine_u16(vshrn_n_u32(lo, 16), vshrn_n_u32(hi, 16)));
+}
+static inline v4i v4i_cmpgt_u16(v4i a, v4i b) { return vreinterpretq_s32_u16(vcgtq_u16(GX_U16(a), GX_U16(b))); }
+static inline v4i v4i_zip8_lo(v4i a, v4i b) { return vreinterpretq_s32_u8(vzip1q_u8(GX_U8(a), GX_U8(b))); }
+static inline v4i v4i_zip8_hi(v4i a, v4i b) { return vreinterpretq_s32_u8(vzip2q_u8(GX_U8(a), GX_U8(b))); }
+static inline v4i v4i_zip16_lo(v4i a, v4i b) { return vreinterpretq_s32_u16(vzip1q_u16(GX_U16(a), GX_U16(b))); }
+static inline v4i v4i_zip16_hi(v4i a, v4i b) { return vreinterpretq_s32_u16(vzip2q_u16(GX_U16(a), GX_U16(b))); }
+static inline v4i v4i_zip64_lo(v4i a, v4i b) { return vreinterpretq_s32_u64(vzip1q_u64(GX_U64(a), GX_U64(b))); }
+static inline v4i v4i_zip64_hi(v4i a, v4i b) { return vreinterpretq_s32_u64(vzip2q_u64(GX_U64(a), GX_U64(b))); }
+static inline v4i v4i_bswap16(v4i a) { return vreinterpretq_s32_u8(vrev16q_u8(GX_U8(a))); }
+#undef GX_U8
+#undef GX_U16
+#undef GX_U32
+#undef GX_U64
+
+#else
+
+static inline v4f v4f_set1(float a) { v4f r = {{ a, a, a, a }}; return r; }
+static inline v4f v4f_set(float a, float b, float c, float d) { v4f r = {{ a, b, c, d }}; return r; }
+#define GX_V4F_OP(name, expr) \
+    static inline v4f name(v4f a, v4f b) { v4f r; for (int i = 0; i < 4; i++) r.f[i] = (expr); return r; }
+GX_V4F_OP(v4f_add, a.f[i] + b.f[i])
+GX_V4F_OP(v4f_sub, a.f[i] - b.f[i])
+GX_V4F_OP(v4f_mul, a.f[i] * b.f[i])
+GX_V4F_OP(v4f_div, a.f[i] / b.f[i])
+GX_V4F_OP(v4f_min, a.f[i] < b.f[i] ? a.f[i] : b.f[i])
+GX_V4F_OP(v4f_max, a.f[i] > b.f[i] ? a.f[i] : b.f[i])
+#undef GX_V4F_OP
+static inline v4f v4f_sqrt(v4f a) { v4f r; for (int i = 0; i < 4; i++) r.f[i] = sqrtf(a.f[i]); return r; }
+static inline void v4f_store(float *p, v4f a) { for (int i = 0; i < 4; i++) p[i] = a.f[i]; }
+static inline v4f v4f_load(const float *p) { v4f r; for (int i = 0; i < 4; i++) r.f[i] = p[i]; return r; }
+static inline int v4f_cmple_mask(v4f a, v4f b) {
+    int m = 0;
+    for (int i = 0; i < 4; i++) m |= (a.f[i] <= b.f[i]) << i;
+    return m;
+}
+static inline v4f v4f_select_absgt(v4f a, float eps, v4f b, v4f c) {
+    v4f r;
+    for (int i = 0; i < 4; i++) r.f[i] = (a.f[i] > eps || a.f[i] < -eps) ? b.f[i] : c.f[i];
+    return r;
+}
+static inline v4f v4f_select_gez(v4f a, v4f b, v4f c) {
+    v4f r;
+    for (int i = 0; i < 4; i++) r.f[i] = a.f[i] >= 0.0f ? b.f[i] : c.f[i];
+    return r;
+}
+static inline v4f v4f_from_v4i(v4i a) { v4f r; for (int i = 0; i < 4; i++) r.f[i] = (float)a.i[i]; return r; }
+static inline v4i v4i_from_v4f(v4f a) { v4i r; for (int i = 0; i < 4; i++) r.i[i] = (s32)a.f[i]; return r; }
+static inline v4f v4f_floor(v4f a) { v4f r; for (int i = 0; i < 4; i++) r.f[i] = floorf(a.f[i]); return r; }
+
+static inline v4i v4i_set1(s32 a) { v4i r = {{ a, a, a, a }}; return r; }
+static inline v4i v4i_set(s32 a, s32 b, s32 c, s32 d) { v4i r = {{ a, b, c, d }}; return r; }
+static inline v4i v4i_add(v4i a, v4i b) { v4i r; for (int i = 0; i < 4; i++) r.i[i] = a.i[i] + b.i[i]; return r; }
+static inline v4i v4i_or(v4i a, v4i b) { v4i r; for (int i = 0; i < 4; i++) r.i[i] = a.i[i] | b.i[i]; return r; }
+static inline int v4i_signmask(v4i a) {
+    int m = 0;
+    for (int i = 0; i < 4; i++) m |= (a.i[i] < 0) << i;
+    return m;
+}
+
+/* Lane views go through memcpy, so lanes are in host byte order */
+#define GX_V4I_LANES(name, T, n, expr)                                      \
+    static inline v4i name(v4i va, v4i vb) {                                \
+        T a[n], b[n], r[n];                                                 \
+        memcpy(a, &va, 16); memcpy(b, &vb, 16);                             \
+        for (int i = 0; i < n; i++) r[i] = (T)(expr);                       \
+        v4i vr; memcpy(&vr, r, 16); return vr;                              \
+    }
+#define GX_V4I_SHIFT(name, T, n, expr)                                      \
+    static inline v4i name(v4i va, int s) {                                 \
+        T a[n], r[n];                                                       \
+        memcpy(a, &va, 16);                                                 \
+        for (int i = 0; i < n; i++) r[i] = (T)(expr);                       \
+        v4i vr; memcpy(&vr, r, 16); return vr;                              \
+    }
+#define GX_V4I_ZIP(name, T, n, half)                                        \
+    static inline v4i name(v4i va, v4i vb) {                                \
+        T a[n], b[n], r[n];                                                 \
+        memcpy(a, &va, 16); memcpy(b, &vb, 16);                             \
+        for (int i = 0; i < n / 2; i++) { r[2*i] = a[half + i]; r[2*i+1] = b[half + i]; } \
+        v4i vr; memcpy(&vr, r, 16); return vr;                              \
+    }
+static inline v4i v4i_load(const void *p) { v4i r; memcpy(&r, p, 16); return r; }
+static inline void v4i_store(void *p, v4i a) { memcpy(p, &a, 16); }
+static inline v4i v4i_and(v4i a, v4i b) { v4i r; for (int i = 0; i < 4; i++) r.i[i] = a.i[i] & b.i[i]; return r; }
+static inline v4i v4i_select(v4i m, v4i a, v4i b) {
+    v4i r;
+    for (int i = 0; i < 4; i++) r.i[i] = (m.i[i] & a.i[i]) | (~m.i[i] & b.i[i]);
+    return r;
+}
+static inline v4i v4i_set1_16(u16 a) { v4i r = v4i_set1((s32)(a | ((u32)a << 16))); return r; }
+GX_V4I_LANES(v4i_add16, u16, 8, a[i] + b[i])
+GX_V4I_LANES(v4i_mulhi_u16, u16, 8, ((u32)a[i] * b[i]) >> 16)
+GX_V4I_LANES(v4i_cmpgt_u16, u16, 8, a[i] > b[i] ? 0xFFFF : 0)
+GX_V4I_SHIFT(v4i_shl16, u16, 8, a[i] << s)
+GX_V4I_SHIFT(v4i_shr16, u16, 8, a[i] >> s)
+GX_V4I_SHIFT(v4i_sar16, s16, 8, a[i] >> s)
+GX_V4I_SHIFT(v4i_shl32, u32, 4, a[i] << s)
+GX_V4I_SHIFT(v4i_shr32, u32, 4, a[i] >> s)
+GX_V4I_ZIP(v4i_zip8_lo, u8, 16, 0)
+GX_V4I_ZIP(v4i_zip8_hi, u8, 16, 8)
+GX_V4I_ZIP(v4i_zip16_lo, u16, 8, 0)
+GX_V4I_ZIP(v4i_zip16_hi, u16, 8, 4)
+GX_V4I_ZIP(v4i_zip64_lo, u64, 2, 0)
+GX_V4I_ZIP(v4i_zip64_hi, u64, 2, 1)
+#undef GX_V4I_LANES
+#undef GX_V4I_SHIFT
+#undef GX_V4I_ZIP
+static inline v4i v4i_bswap16(v4i a) {
+    u8 b[16], r[16];
+    memcpy(b, &a, 16);
+    for (int i = 0; i < 16; i++) r[i] = b[i ^ 1];
+    v4i vr; memcpy(&vr, r, 16); return vr;
+}
+
+#endif
+
+#endif /* GX_SIMD_H */
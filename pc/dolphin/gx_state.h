@@ -9,6 +9,8 @@
 #include "dolphin/gx/GXEnum.h"
 #include "dolphin/gx/GXStruct.h"
 
+#include <string.h>
+
 #define GX_MAX_POS_MATRICES  10
 #define GX_MAX_NRM_MATRICES  10
 #define GX_MAX_TEX_MATRICES  10
@@ -29,6 +31,33 @@ typedef struct {
     float texcoord[8][2];
 } GXSWVertex;
 
+/* Clip-space outcode bits. The first five are frustum planes (the near
+ * plane is GX's z = -w); the guard band bits mark vertices too far out
+ * for the fixed-point rasterizer. */
+typedef enum {
+    CLIP_LEFT         = 1 << 0,
+    CLIP_RIGHT        = 1 << 1,
+    CLIP_BOTTOM       = 1 << 2,
+    CLIP_TOP          = 1 << 3,
+    CLIP_NEAR         = 1 << 4,
+    CLIP_GUARD_LEFT   = 1 << 5,
+    CLIP_GUARD_RIGHT  = 1 << 6,
+    CLIP_GUARD_BOTTOM = 1 << 7,
+    CLIP_GUARD_TOP    = 1 << 8,
+} GXClipBits;
+
+/* Planes a triangle must actually be clipped against */
+#define CLIP_MUST_CLIP (CLIP_NEAR | CLIP_GUARD_LEFT | CLIP_GUARD_RIGHT | CLIP_GUARD_BOTTOM | CLIP_GUARD_TOP)
+
+/* Vertex after the modelview/projection/viewport transform */
+typedef struct {
+    float clip[4];    /* homogeneous clip-space position */
+    float screen[3];  /* viewport x, y and depth */
+    float w;
+    u32 outcode;      /* GXClipBits */
+    float color[2][4]; /* lit COLOR0A0, COLOR1A1; set only by light_batch */
+} GXXfVertex;
+
 /* Display list command types */
 typedef enum {
     DL_CMD_BEGIN,
@@ -73,15 +102,87 @@ typedef struct {
     u8 frac;
 } GXVtxAttrFmtEntry;
 
-/* Decoded texture cache entry */
+/* Reads one array element's components as floats. scale is 1 / (1 << frac)
+ * for fixed-point types; color readers produce RGBA in 0..1 and ignore it. */
+typedef void (*GXCompReadFunc)(float *out, const u8 *src, float scale);
+
+typedef struct {
+    GXCompReadFunc read;
+    float scale;
+} GXAttrFetch;
+
+/* Vertex format compiled from vtx_desc + vtx_attr_fmt (see vtx_fetch_get).
+ * Readers are picked once per format change instead of per component. */
 typedef struct {
-    u32 *decoded;      /* linear RGBA8 pixels */
+    GXAttrFetch pos, nrm, clr, tex[8];
+    /* Indexed attributes in GX stream order, for GXPCSubmitVertices */
+    u8 bulk_attrs[GX_MAX_VERTEX_ATTRS];
+    u8 bulk_count;
+} GXVtxFetch;
+
+/* Attribute whose arrival completes an immediate-mode vertex */
+typedef enum {
+    GX_SUBMIT_ON_POS,
+    GX_SUBMIT_ON_NRM,
+    GX_SUBMIT_ON_CLR,
+    GX_SUBMIT_ON_TEX,
+} GXSubmitTrigger;
+
+/* Decoded texture cache entry.
+ * Entries live in a global cache (gx_pc.c) keyed by a content hash of the
+ * GC source bytes plus format/size/TLUT, so they survive GXInvalidateTexAll
+ * and are shared between texmaps that reference identical data. */
+#define GX_TEX_MAX_LEVELS 11 /* 1024 down to 1 */
+
+typedef struct GXTexCacheEntry {
+    u32 *decoded;      /* RGBA8 pixels, or NULL for an indexed entry */
+    u8 *indices;       /* 8-bit palette indices (C4/C8 kept indexed) */
     u16 width, height;
     GXTexFmt format;
-    void *raw_data;    /* original GC data pointer (cache key) */
-    GXTexWrapMode wrap_s, wrap_t;
+    u8 src_levels;     /* mip levels read from the GC data (part of the key) */
+    u8 levels;         /* levels stored: the GC chain, or level 0 plus generated ones */
+    u8 tiled;          /* texels in row-major 4x4 blocks instead of linear rows */
+    u32 level_ofs[GX_TEX_MAX_LEVELS]; /* texel offset of each level in decoded/indices */
+    u64 tlut_key;      /* hash of the palette a CI entry was expanded through, 0 otherwise */
+    u64 hash;          /* content key: hash of source bytes + format/size/TLUT */
+    const void *src;   /* GC data pointer this entry is currently bound to */
+    u32 src_size;      /* bytes of GC source data covered by hash */
+    u32 bytes;         /* host memory held by decoded */
+    u32 gen;           /* invalidation generation the entry was last validated in */
+    struct GXTexCacheEntry *hash_next;  /* content-key bucket chain */
+    struct GXTexCacheEntry *src_next;   /* source-pointer bucket chain */
+    struct GXTexCacheEntry *lru_prev, *lru_next;
 } GXTexCacheEntry;
 
+/* Texture bound to a GXTexMapID by GXLoadTexObj */
+typedef struct {
+    GXTexCacheEntry *entry;
+    GXTexWrapMode wrap_s, wrap_t;
+    const u32 *tlut;   /* expanded TLUT slot colors for an indexed entry */
+    u8 min_filter, mag_filter; /* GXTexFilter */
+    float min_lod, max_lod, lod_bias;
+} GXTexMapState;
+
+/* Hardware light, as loaded by GXLoadLightObjImm. pos and dir are in eye
+ * space; dir is the negated spot direction or the specular half-angle. */
+typedef struct {
+    GXColor color;
+    float a[3];       /* angle attenuation */
+    float k[3];       /* distance attenuation */
+    float pos[3];
+    float dir[3];
+} GXLight;
+
+/* Lighting control of one channel (from GXSetChanCtrl) */
+typedef struct {
+    GXBool     enable;     /* lighting enable */
+    GXColorSrc amb_src;    /* GX_SRC_REG or GX_SRC_VTX */
+    GXColorSrc mat_src;    /* GX_SRC_REG or GX_SRC_VTX */
+    u8         light_mask; /* bit n: GX_LIGHTn */
+    u8         diff_fn;    /* GXDiffuseFn; GX_DF_NONE under GX_AF_SPEC */
+    u8         attn_fn;    /* GXAttnFn */
+} GXChanCtrl;
+
 /* TEV stage order (which texmap + channel) */
 typedef struct {
     GXTexCoordID coord;
@@ -89,6 +190,20 @@ typedef struct {
     GXChannelID color;
 } GXTevOrderEntry;
 
+/* One TEV stage's combiner setup, as written by GXSetTevColorIn/AlphaIn,
+ * GXSetTevColorOp/AlphaOp, the konst selects and GXSetTevSwapMode. Kept in
+ * bytes so the active stages can be hashed directly (see tev_kernel_get). */
+typedef struct {
+    u8 color_in[4];   /* GXTevColorArg a, b, c, d */
+    u8 alpha_in[4];   /* GXTevAlphaArg a, b, c, d */
+    u8 color_op, color_bias, color_scale, color_clamp, color_out;
+    u8 alpha_op, alpha_bias, alpha_scale, alpha_clamp, alpha_out;
+    u8 kcolor_sel;    /* GXTevKColorSel */
+    u8 kalpha_sel;    /* GXTevKAlphaSel */
+    u8 ras_swap;      /* GXTevSwapSel */
+    u8 tex_swap;
+} GXTevStage;
+
 typedef struct {
     /* Projection */
     float projection[4][4];
@@ -115,36 +230,42 @@ typedef struct {
     /* Vertex attribute format [vtxfmt][attr] */
     GXVtxAttrFmtEntry vtx_attr_fmt[GX_MAX_VTXFMT][GX_VA_MAX_ATTR];
 
+    /* Compiled vertex formats; bit n of vtx_fetch_valid covers vtx_fetch[n] */
+    GXVtxFetch      vtx_fetch[GX_MAX_VTXFMT];
+    u8              vtx_fetch_valid;
+    GXSubmitTrigger vtx_submit_on;
+
     /* TEV */
     u8 num_tev_stages;
     u8 num_tex_gens;
     u8 num_chans;
     u8 num_ind_stages;
 
-    /* TEV stage ops (simplified - mode per stage) */
-    GXTevMode tev_mode[GX_MAX_TEV_STAGES];
-
-    /* TEV stage order */
+    /* TEV stage combiners and order */
+    GXTevStage      tev_stage[GX_MAX_TEV_STAGES];
     GXTevOrderEntry tev_order[GX_MAX_TEV_STAGES];
 
+    /* TEV registers (GXSetTevColor*), konst colors and swap tables */
+    GXColorS10 tev_reg[GX_MAX_TEVREG];
+    GXColor    tev_kcolor[GX_MAX_KCOLOR];
+    u8         tev_swap_table[GX_MAX_TEVSWAP][4]; /* GXTevColorChan per r, g, b, a */
+
     /* Textures */
     GXTexObj  tex_obj[GX_MAX_TEXTURES];
     int       tex_loaded[GX_MAX_TEXTURES]; /* 1 if loaded */
 
-    /* Decoded texture cache */
-    GXTexCacheEntry tex_cache[GX_MAX_TEXTURES];
+    /* Decoded texture bound to each texmap */
+    GXTexMapState tex_map[GX_MAX_TEXTURES];
 
     /* Channel colors */
     GXColor chan_amb[2];
     GXColor chan_mat[2];
 
-    /* Channel control (from GXSetChanCtrl) */
-    struct {
-        GXBool     enable;     /* lighting enable */
-        GXColorSrc amb_src;    /* GX_SRC_REG or GX_SRC_VTX */
-        GXColorSrc mat_src;    /* GX_SRC_REG or GX_SRC_VTX */
-        u32        light_mask;
-    } chan_ctrl[2];
+    /* Channel control by GXChannelID: COLOR0, COLOR1, ALPHA0, ALPHA1 */
+    GXChanCtrl chan_ctrl[4];
+
+    /* Loaded lights */
+    GXLight lights[GX_MAX_LIGHTS];
 
     /* Blend / Z */
     GXBlendMode   blend_type;
@@ -191,8 +312,10 @@ typedef struct {
     u32 dl_count;       /* entries recorded */
     void *dl_game_buf;  /* game's original buffer for storing DL handle */
 
-    /* Software framebuffer (RGBA8) */
-    u32 framebuffer[GX_FB_WIDTH * GX_FB_HEIGHT];
+    /* Software framebuffer (RGBA8): the render target of the color buffer
+     * pair, and the zbuffer. Tiles may still be pending a fast clear; read
+     * color through gx_fb_read(). */
+    u32 *framebuffer;
     float zbuffer[GX_FB_WIDTH * GX_FB_HEIGHT];
 
     /* Display state */
@@ -206,4 +329,50 @@ typedef struct {
 
 extern GXState g_gx;
 
+/* Shade all binned triangles into g_gx.framebuffer/zbuffer. Anything that
+ * reads the framebuffer outside gx_pc.c must call this first. */
+void gx_raster_flush(void);
+
+/* Copy the render target's color into dst (pitch bytes per row) with
+ * fast-cleared tiles as the clear color, flushing binned triangles first.
+ * Rows are copied in parallel. */
+void gx_fb_read(u32 *dst, u32 pitch);
+
+/* 64-bit content hash used for cache keys. Four independent lanes keep the
+ * multiply chains out of each other's way so large textures hash at close
+ * to memory bandwidth. */
+static inline u64 gx_hash_rotl(u64 x, int r) { return (x << r) | (x >> (64 - r)); }
+static inline u64 gx_hash_mix(u64 h) {
+    h ^= h >> 33; h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33; h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+static inline u64 gx_hash64(const void *data, size_t len, u64 seed) {
+    const u8 *p = (const u8 *)data;
+    const u64 k1 = 0x87C37B91114253D5ull, k2 = 0x4CF5AD432745937Full;
+    u64 h0 = seed, h1 = seed ^ k1, h2 = seed ^ k2, h3 = ~seed;
+    size_t n = len;
+    while (n >= 32) {
+        u64 w[4];
+        memcpy(w, p, 32);
+        h0 = gx_hash_rotl(h0 ^ (w[0] * k1), 31) * k2;
+        h1 = gx_hash_rotl(h1 ^ (w[1] * k1), 31) * k2;
+        h2 = gx_hash_rotl(h2 ^ (w[2] * k1), 31) * k2;
+        h3 = gx_hash_rotl(h3 ^ (w[3] * k1), 31) * k2;
+        p += 32; n -= 32;
+    }
+    u64 h = gx_hash_rotl(h0, 1) + gx_hash_rotl(h1, 7) + gx_hash_rotl(h2, 12) + gx_hash_rotl(h3, 18);
+    while (n >= 8) {
+        u64 w;
+        memcpy(&w, p, 8);
+        h = gx_hash_rotl(h ^ (w * k1), 27) * k2 + 0x52DCE729;
+        p += 8; n -= 8;
+    }
+    u64 tail = 0;
+    for (size_t i = 0; i < n; i++) tail |= (u64)p[i] << (i * 8);
+    h ^= tail * k1;
+    return gx_hash_mix(h ^ (u64)len);
+}
+
 #endif /* GX_STATE_H */
@@ -0,0 +1,349 @@
+/*
+ * GameCube texture decoders.
+ *
+ * Every format is stored in 32-byte tiles (4x4, 8x4 or 8x8 texels; RGBA8
+ * splits its 4x4 tiles over two). Each
+ * decoder handles one whole tile with 16-byte vector loads, two or four
+ * tile rows at a time, and writes the texels straight into the rows of
+ * the linear output. Partial tiles on the right and bottom edges decode
+ * into a scratch tile first. Channel widths below 8 bits expand by bit
+ * replication, as the texture unit does.
+ */
+#include <string.h>
+
+#include "dolphin/types.h"
+#include "dolphin/gx/GXEnum.h"
+#include "dolphin/gx_texdecode.h"
+#include "dolphin/gx_simd.h"
+
+#define TEX_ALWAYS_INLINE inline __attribute__((always_inline))
+
+typedef void (*GXTileDecodeFunc)(const u8 *src, u32 *dst, int stride);
+
+/* Walk the tiles of a level. Inlined per format so tile() is a direct call. */
+static TEX_ALWAYS_INLINE void decode_tiles(const u8 *src, u32 *dst, int w, int h, int bw, int bh,
+                                           u32 tile_bytes, GXTileDecodeFunc tile) {
+    u32 scratch[8 * 8] __attribute__((aligned(16)));
+    for (int ty = 0; ty < h; ty += bh) {
+        for (int tx = 0; tx < w; tx += bw) {
+            if (tx + bw <= w && ty + bh <= h) {
+                tile(src, dst + ty * w + tx, w);
+            } else {
+                tile(src, scratch, bw);
+                int cw = (w - tx < bw) ? w - tx : bw;
+                int ch = (h - ty < bh) ? h - ty : bh;
+                for (int y = 0; y < ch; y++) {
+                    memcpy(dst + (ty + y) * w + tx, scratch + y * bw, cw * sizeof(u32));
+                }
+            }
+            src += tile_bytes;
+        }
+    }
+}
+
+/* Bit replication of n-bit channels held in halfword lanes */
+static inline v4i expand3(v4i v) { return v4i_or(v4i_or(v4i_shl16(v, 5), v4i_shl16(v, 2)), v4i_shr16(v, 1)); }
+static inline v4i expand4(v4i v) { return v4i_or(v4i_shl16(v, 4), v); }
+static inline v4i expand5(v4i v) { return v4i_or(v4i_shl16(v, 3), v4i_shr16(v, 2)); }
+static inline v4i expand6(v4i v) { return v4i_or(v4i_shl16(v, 2), v4i_shr16(v, 4)); }
+
+/* Eight texels from halfword lanes lo = a | b << 8 and hi = g | r << 8;
+ * the first four go to d0, the rest to d1 */
+static inline void put_texels8(u32 *d0, u32 *d1, v4i lo, v4i hi) {
+    v4i_store(d0, v4i_zip16_lo(lo, hi));
+    v4i_store(d1, v4i_zip16_hi(lo, hi));
+}
+
+/* Sixteen intensities (byte lanes) as opaque grey, eight per row */
+static inline void put_intensity16(u32 *row0, u32 *row1, v4i i) {
+    v4i opaque = v4i_set1_16(0x00FF), high = v4i_set1_16(0xFF00);
+    v4i ii = v4i_zip8_lo(i, i);
+    put_texels8(row0, row0 + 4, v4i_or(v4i_and(ii, high), opaque), ii);
+    ii = v4i_zip8_hi(i, i);
+    put_texels8(row1, row1 + 4, v4i_or(v4i_and(ii, high), opaque), ii);
+}
+
+/* 4x4: 32 bytes of AR pairs, then 32 bytes of GB pairs */
+static TEX_ALWAYS_INLINE void tile_rgba8(const u8 *src, u32 *dst, int stride) {
+    v4i low = v4i_set1_16(0x00FF), high = v4i_set1_16(0xFF00);
+    for (int y = 0; y < 4; y += 2) {
+        v4i ar = v4i_load(src + y * 8);
+        v4i gb = v4i_load(src + 32 + y * 8);
+        v4i lo = v4i_or(v4i_and(ar, low), v4i_and(gb, high));
+        v4i hi = v4i_or(v4i_and(gb, low), v4i_and(ar, high));
+        put_texels8(dst + y * stride, dst + (y + 1) * stride, lo, hi);
+    }
+}
+
+/* 4x4 of big-endian RGB565 */
+static TEX_ALWAYS_INLINE void tile_rgb565(const u8 *src, u32 *dst, int stride) {
+    for (int y = 0; y < 4; y += 2) {
+        v4i x = v4i_bswap16(v4i_load(src + y * 8));
+        v4i r = expand5(v4i_shr16(x, 11));
+        v4i g = expand6(v4i_and(v4i_shr16(x, 5), v4i_set1_16(0x3F)));
+        v4i b = expand5(v4i_and(x, v4i_set1_16(0x1F)));
+        v4i lo = v4i_or(v4i_set1_16(0x00FF), v4i_shl16(b, 8));
+        v4i hi = v4i_or(g, v4i_shl16(r, 8));
+        put_texels8(dst + y * stride, dst + (y + 1) * stride, lo, hi);
+    }
+}
+
+/* 4x4 of big-endian RGB5A3: opaque RGB555 when the top bit is set,
+ * otherwise ARGB3444. Both are expanded and the top bit selects. */
+static TEX_ALWAYS_INLINE void tile_rgb5a3(const u8 *src, u32 *dst, int stride) {
+    v4i m5 = v4i_set1_16(0x1F), m4 = v4i_set1_16(0x0F);
+    for (int y = 0; y < 4; y += 2) {
+        v4i x = v4i_bswap16(v4i_load(src + y * 8));
+        v4i opaque = v4i_sar16(x, 15);
+
+        v4i r = v4i_select(opaque, expand5(v4i_and(v4i_shr16(x, 10), m5)),
+                                   expand4(v4i_and(v4i_shr16(x, 8), m4)));
+        v4i g = v4i_select(opaque, expand5(v4i_and(v4i_shr16(x, 5), m5)),
+                                   expand4(v4i_and(v4i_shr16(x, 4), m4)));
+        v4i b = v4i_select(opaque, expand5(v4i_and(x, m5)), expand4(v4i_and(x, m4)));
+        v4i a = v4i_select(opaque, v4i_set1_16(0x00FF),
+                                   expand3(v4i_and(v4i_shr16(x, 12), v4i_set1_16(0x7))));
+        v4i lo = v4i_or(a, v4i_shl16(b, 8));
+        v4i hi = v4i_or(g, v4i_shl16(r, 8));
+        put_texels8(dst + y * stride, dst + (y + 1) * stride, lo, hi);
+    }
+}
+
+/* 4x4 of alpha, intensity byte pairs */
+static TEX_ALWAYS_INLINE void tile_ia8(const u8 *src, u32 *dst, int stride) {
+    for (int y = 0; y < 4; y += 2) {
+        v4i ai = v4i_load(src + y * 8);
+        v4i ii = v4i_or(v4i_shr16(ai, 8), v4i_and(ai, v4i_set1_16(0xFF00)));
+        put_texels8(dst + y * stride, dst + (y + 1) * stride, ai, ii);
+    }
+}
+
+/* 8x4 of intensity bytes */
+static TEX_ALWAYS_INLINE void tile_i8(const u8 *src, u32 *dst, int stride) {
+    for (int y = 0; y < 4; y += 2) {
+        put_intensity16(dst + y * stride, dst + (y + 1) * stride, v4i_load(src + y * 8));
+    }
+}
+
+/* 8x4 of bytes with alpha in the high nibble, intensity in the low one */
+static TEX_ALWAYS_INLINE void tile_ia4(const u8 *src, u32 *dst, int stride) {
+    for (int y = 0; y < 4; y += 2) {
+        v4i x = v4i_load(src + y * 8);
+        v4i i = expand4(v4i_and(x, v4i_set1_16(0x0F0F)));
+        v4i a = v4i_and(x, v4i_set1_16(0xF0F0));
+        a = v4i_or(a, v4i_shr16(a, 4));
+        u32 *row0 = dst + y * stride, *row1 = row0 + stride;
+        put_texels8(row0, row0 + 4, v4i_zip8_lo(a, i), v4i_zip8_lo(i, i));
+        put_texels8(row1, row1 + 4, v4i_zip8_hi(a, i), v4i_zip8_hi(i, i));
+    }
+}
+
+/* 8x8 of intensity nibbles, high nibble first */
+static TEX_ALWAYS_INLINE void tile_i4(const u8 *src, u32 *dst, int stride) {
+    v4i m4 = v4i_set1_16(0x0F0F);
+    for (int y = 0; y < 8; y += 4) {
+        v4i x = v4i_load(src + y * 4);
+        v4i hi = v4i_and(v4i_shr16(x, 4), m4);
+        v4i lo = v4i_and(x, m4);
+        u32 *row = dst + y * stride;
+        put_intensity16(row, row + stride, expand4(v4i_zip8_lo(hi, lo)));
+        put_intensity16(row + 2 * stride, row + 3 * stride, expand4(v4i_zip8_hi(hi, lo)));
+    }
+}
+
+/* 8x8 of four DXT1-style 4x4 blocks in 2x2 order. The four palettes are
+ * built together: halfword lanes hold c0, c1 of each block, the swapped
+ * pair gives each lane its partner for the 2:1 and 1:1 blends. */
+static TEX_ALWAYS_INLINE void tile_cmpr(const u8 *src, u32 *dst, int stride) {
+    s32 ends[4];
+    for (int k = 0; k < 4; k++) memcpy(&ends[k], src + k * 8, 4);
+    v4i e = v4i_bswap16(v4i_set(ends[0], ends[1], ends[2], ends[3]));
+
+    /* c0 > c1 selects the four-color mode; widen the c0 lane's compare
+     * to both lanes of its block */
+    v4i swapped = v4i_or(v4i_shl32(e, 16), v4i_shr32(e, 16));
+    v4i even = v4i_set1(0x0000FFFF);
+    v4i four = v4i_and(v4i_cmpgt_u16(e, swapped), even);
+    four = v4i_or(four, v4i_shl32(four, 16));
+
+    v4i ch[3] = {
+        expand5(v4i_shr16(e, 11)),
+        expand6(v4i_and(v4i_shr16(e, 5), v4i_set1_16(0x3F))),
+        expand5(v4i_and(e, v4i_set1_16(0x1F))),
+    };
+    v4i mid[3];
+    v4i third = v4i_set1_16(21846); /* mulhi by this is an exact / 3 below 768 */
+    for (int c = 0; c < 3; c++) {
+        v4i other = v4i_or(v4i_shl32(ch[c], 16), v4i_shr32(ch[c], 16));
+        v4i blend3 = v4i_mulhi_u16(v4i_add16(v4i_add16(ch[c], ch[c]), other), third);
+        v4i blend2 = v4i_and(v4i_shr16(v4i_add16(ch[c], other), 1), even);
+        mid[c] = v4i_select(four, blend3, blend2);
+    }
+    /* Color 3 of a three-color block is transparent black */
+    v4i mid_a = v4i_or(v4i_set1(0x000000FF), v4i_and(four, v4i_set1(0x00FF0000)));
+
+    v4i end_lo = v4i_or(v4i_set1_16(0x00FF), v4i_shl16(ch[2], 8));
+    v4i end_hi = v4i_or(ch[1], v4i_shl16(ch[0], 8));
+    v4i mid_lo = v4i_or(mid_a, v4i_shl16(mid[2], 8));
+    v4i mid_hi = v4i_or(mid[1], v4i_shl16(mid[0], 8));
+    v4i e01 = v4i_zip16_lo(end_lo, end_hi), e23 = v4i_zip16_hi(end_lo, end_hi);
+    v4i m01 = v4i_zip16_lo(mid_lo, mid_hi), m23 = v4i_zip16_hi(mid_lo, mid_hi);
+    u32 pal[4][4] __attribute__((aligned(16)));
+    v4i_store(pal[0], v4i_zip64_lo(e01, m01));
+    v4i_store(pal[1], v4i_zip64_hi(e01, m01));
+    v4i_store(pal[2], v4i_zip64_lo(e23, m23));
+    v4i_store(pal[3], v4i_zip64_hi(e23, m23));
+
+    for (int k = 0; k < 4; k++) {
+        const u8 *bits = src + k * 8 + 4;
+        const u32 *p = pal[k];
+        u32 *out = dst + (k >> 1) * 4 * stride + (k & 1) * 4;
+        for (int y = 0; y < 4; y++, out += stride) {
+            u8 b = bits[y];
+            out[0] = p[b >> 6];
+            out[1] = p[(b >> 4) & 3];
+            out[2] = p[(b >> 2) & 3];
+            out[3] = p[b & 3];
+        }
+    }
+}
+
+static void decode_rgba8(const u8 *s, u32 *d, int w, int h)  { decode_tiles(s, d, w, h, 4, 4, 64, tile_rgba8); }
+static void decode_rgb565(const u8 *s, u32 *d, int w, int h) { decode_tiles(s, d, w, h, 4, 4, 32, tile_rgb565); }
+static void decode_rgb5a3(const u8 *s, u32 *d, int w, int h) { decode_tiles(s, d, w, h, 4, 4, 32, tile_rgb5a3); }
+static void decode_ia8(const u8 *s, u32 *d, int w, int h)    { decode_tiles(s, d, w, h, 4, 4, 32, tile_ia8); }
+static void decode_i8(const u8 *s, u32 *d, int w, int h)     { decode_tiles(s, d, w, h, 8, 4, 32, tile_i8); }
+static void decode_ia4(const u8 *s, u32 *d, int w, int h)    { decode_tiles(s, d, w, h, 8, 4, 32, tile_ia4); }
+static void decode_i4(const u8 *s, u32 *d, int w, int h)     { decode_tiles(s, d, w, h, 8, 8, 32, tile_i4); }
+static void decode_cmpr(const u8 *s, u32 *d, int w, int h)   { decode_tiles(s, d, w, h, 8, 8, 32, tile_cmpr); }
+
+/* ================================================================
+ * Color-indexed formats and palettes
+ *
+ * Palette entries are single big-endian texels of the TLUT format, so a
+ * run of 16 is exactly one 4x4 tile decoded with a stride of 4.
+ * ================================================================ */
+void gx_tex_decode_tlut(u32 tlut_fmt, const void *src, u32 *dst, u32 n) {
+    const u8 *s = (const u8 *)src;
+    u8 tail[32] __attribute__((aligned(16)));
+    u32 last[16] __attribute__((aligned(16)));
+    for (u32 i = 0; i < n; i += 16, s += 32) {
+        const u8 *in = s;
+        u32 *out = dst + i;
+        if (n - i < 16) {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, s, (n - i) * 2);
+            in = tail;
+            out = last;
+        }
+        switch (tlut_fmt) {
+            case GX_TL_IA8:    tile_ia8(in, out, 4); break;
+            case GX_TL_RGB565: tile_rgb565(in, out, 4); break;
+            default:           tile_rgb5a3(in, out, 4); break;
+        }
+        if (out == last) memcpy(dst + i, last, (n - i) * sizeof(u32));
+    }
+}
+
+/* Palette indices of one CI tile in row-major order */
+static void ci_tile_indices(u32 fmt, const u8 *src, u16 *idx) {
+    switch (fmt) {
+        case GX_TF_C4:
+            for (int i = 0; i < 32; i++) {
+                idx[i * 2] = src[i] >> 4;
+                idx[i * 2 + 1] = src[i] & 0xF;
+            }
+            break;
+        case GX_TF_C8:
+            for (int i = 0; i < 32; i++) idx[i] = src[i];
+            break;
+        default:
+            for (int i = 0; i < 16; i++) idx[i] = ((src[i * 2] << 8) | src[i * 2 + 1]) & 0x3FFF;
+            break;
+    }
+}
+
+static void ci_tile_dims(u32 fmt, int *bw, int *bh) {
+    switch (fmt) {
+        case GX_TF_C4: *bw = 8; *bh = 8; break;
+        case GX_TF_C8: *bw = 8; *bh = 4; break;
+        default:       *bw = 4; *bh = 4; break;
+    }
+}
+
+int gx_tex_decode_indices(u32 fmt, const void *src, u8 *dst, int w, int h) {
+    if (fmt != GX_TF_C4 && fmt != GX_TF_C8) return 0;
+    const u8 *s = (const u8 *)src;
+    int bw, bh;
+    ci_tile_dims(fmt, &bw, &bh);
+    for (int ty = 0; ty < h; ty += bh) {
+        for (int tx = 0; tx < w; tx += bw, s += 32) {
+            int cw = (w - tx < bw) ? w - tx : bw;
+            int ch = (h - ty < bh) ? h - ty : bh;
+            if (fmt == GX_TF_C8) {
+                /* Tile rows are already linear */
+                for (int y = 0; y < ch; y++) memcpy(dst + (ty + y) * w + tx, s + y * 8, cw);
+                continue;
+            }
+            u16 idx[64];
+            ci_tile_indices(fmt, s, idx);
+            for (int y = 0; y < ch; y++) {
+                u8 *row = dst + (ty + y) * w + tx;
+                for (int x = 0; x < cw; x++) row[x] = (u8)idx[y * bw + x];
+            }
+        }
+    }
+    return 1;
+}
+
+int gx_tex_decode_ci(u32 fmt, const void *src, u32 *dst, int w, int h, const u32 *pal, u32 n) {
+    if (fmt != GX_TF_C4 && fmt != GX_TF_C8 && fmt != GX_TF_C14X2) return 0;
+    const u8 *s = (const u8 *)src;
+    int bw, bh;
+    ci_tile_dims(fmt, &bw, &bh);
+    for (int ty = 0; ty < h; ty += bh) {
+        for (int tx = 0; tx < w; tx += bw, s += 32) {
+            int cw = (w - tx < bw) ? w - tx : bw;
+            int ch = (h - ty < bh) ? h - ty : bh;
+            u16 idx[64];
+            ci_tile_indices(fmt, s, idx);
+            for (int y = 0; y < ch; y++) {
+                u32 *row = dst + (ty + y) * w + tx;
+                for (int x = 0; x < cw; x++) {
+                    u16 i = idx[y * bw + x];
+                    row[x] = (i < n) ? pal[i] : 0;
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+u32 gx_tex_src_size(u32 fmt, u32 w, u32 h) {
+    u32 bw, bh, bpp;
+    switch (fmt) {
+        case GX_TF_I4: case GX_TF_C4: case GX_TF_CMPR:      bw = 8; bh = 8; bpp = 4; break;
+        case GX_TF_I8: case GX_TF_IA4: case GX_TF_C8:       bw = 8; bh = 4; bpp = 8; break;
+        case GX_TF_IA8: case GX_TF_RGB565: case GX_TF_RGB5A3:
+        case GX_TF_C14X2:                                   bw = 4; bh = 4; bpp = 16; break;
+        default:                                            bw = 4; bh = 4; bpp = 32; break;
+    }
+    u32 pw = (w + bw - 1) / bw * bw;
+    u32 ph = (h + bh - 1) / bh * bh;
+    return pw * ph * bpp / 8;
+}
+
+int gx_tex_decode(u32 fmt, const void *src, u32 *dst, int w, int h) {
+    const u8 *s = (const u8 *)src;
+    switch (fmt) {
+        case GX_TF_RGBA8:  decode_rgba8(s, dst, w, h); return 1;
+        case GX_TF_RGB565: decode_rgb565(s, dst, w, h); return 1;
+        case GX_TF_RGB5A3: decode_rgb5a3(s, dst, w, h); return 1;
+        case GX_TF_IA8:    decode_ia8(s, dst, w, h); return 1;
+        case GX_TF_I8:     decode_i8(s, dst, w, h); return 1;
+        case GX_TF_IA4:    decode_ia4(s, dst, w, h); return 1;
+        case GX_TF_I4:     decode_i4(s, dst, w, h); return 1;
+        case GX_TF_CMPR:   decode_cmpr(s, dst, w, h); return 1;
+        default:           return 0;
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef GX_TEXDECODE_H
+#define GX_TEXDECODE_H
+
+/*
+ * GameCube texture decoders for the software GX pipeline. Tiled GC texel
+ * data is de-swizzled straight into linear RGBA8 rows with the gx_simd
+ * vector helpers.
+ */
+
+#include "dolphin/types.h"
+
+/* Bytes of GC texture data for one level, padded to whole tiles */
+u32 gx_tex_src_size(u32 fmt, u32 w, u32 h);
+
+/* Decode one level of GC texture data into w * h linear texels, each
+ * 0xRRGGBBAA. Rows are written with vector stores, so dst is best 16-byte
+ * aligned. Returns 0, leaving dst untouched, for formats without a
+ * decoder. */
+int gx_tex_decode(u32 fmt, const void *src, u32 *dst, int w, int h);
+
+/* Expand n big-endian TLUT entries (GXTlutFmt) into 0xRRGGBBAA colors */
+void gx_tex_decode_tlut(u32 tlut_fmt, const void *src, u32 *dst, u32 n);
+
+/* De-swizzle GX_TF_C4/C8 data into w * h linear 8-bit palette indices.
+ * Returns 0 for other formats. */
+int gx_tex_decode_indices(u32 fmt, const void *src, u8 *dst, int w, int h);
+
+/* Decode GX_TF_C4/C8/C14X2 data through an expanded palette of n colors;
+ * indices past the palette decode as transparent black. Returns 0 for
+ * other formats. */
+int gx_tex_decode_ci(u32 fmt, const void *src, u32 *dst, int w, int h, const u32 *pal, u32 n);
+
+#endif /* GX_TEXDECODE_H */
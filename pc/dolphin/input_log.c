@@ -0,0 +1,314 @@
+/*
+ * Input recording and replay — see input_log.h for the log format.
+ *
+ * Recording keeps the previous pad frame and writes only the ports that
+ * changed; runs of identical frames collapse into one REPEAT record. A
+ * replay reads the whole log up front. Seed events sit between the pad
+ * frames they were drawn in, so a replay that asks for a seed where the
+ * log has a pad frame (or the other way round) has left the recorded
+ * path; the first such point is reported with its frame number.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dolphin/types.h"
+#include "dolphin/os.h"
+#include "dolphin/pad.h"
+#include "dolphin/vifuncs.h"
+#include "pc_config.h"
+#include "dolphin/input_log.h"
+
+#define INLOG_HEADER_SIZE 24
+#define INLOG_PAD_SIZE    11
+
+enum { INLOG_OFF, INLOG_RECORD, INLOG_REPLAY };
+
+int g_inlog_time;
+
+static struct {
+    int inited;
+    int mode;
+    char path[512];
+    FILE *fp;               /* recording */
+    u8 *data;               /* replay: the whole log */
+    u32 size, pos;
+    u32 repeat;             /* recording: frames pending; replay: frames left */
+    u32 frame;
+    int desync;
+    int exit_at_end;
+    PADStatus prev[4];
+    u32 prev_connected;
+    OSTime time_base, time_last;
+    u32 ticks_per_retrace;
+} g_inlog;
+
+/* ---- Serialization ---- */
+static void put_u16(u8 *p, u32 v) { p[0] = (u8)v; p[1] = (u8)(v >> 8); }
+static void put_u32(u8 *p, u32 v) { put_u16(p, v); put_u16(p + 2, v >> 16); }
+static u32 get_u16(const u8 *p) { return p[0] | (u32)p[1] << 8; }
+static u32 get_u32(const u8 *p) { return get_u16(p) | get_u16(p + 2) << 16; }
+
+static void pad_put(u8 *p, const PADStatus *s) {
+    put_u16(p, s->button);
+    p[2] = (u8)s->stickX;
+    p[3] = (u8)s->stickY;
+    p[4] = (u8)s->substickX;
+    p[5] = (u8)s->substickY;
+    p[6] = s->triggerL;
+    p[7] = s->triggerR;
+    p[8] = s->analogA;
+    p[9] = s->analogB;
+    p[10] = (u8)s->err;
+}
+
+static void pad_get(PADStatus *s, const u8 *p) {
+    s->button = (u16)get_u16(p);
+    s->stickX = (s8)p[2];
+    s->stickY = (s8)p[3];
+    s->substickX = (s8)p[4];
+    s->substickY = (s8)p[5];
+    s->triggerL = p[6];
+    s->triggerR = p[7];
+    s->analogA = p[8];
+    s->analogB = p[9];
+    s->err = (s8)p[10];
+}
+
+static int pad_equal(const PADStatus *a, const PADStatus *b) {
+    u8 pa[INLOG_PAD_SIZE], pb[INLOG_PAD_SIZE];
+    pad_put(pa, a);
+    pad_put(pb, b);
+    return memcmp(pa, pb, INLOG_PAD_SIZE) == 0;
+}
+
+/* ---- Recording ---- */
+static void rec_write(const u8 *p, u32 n) {
+    if (fwrite(p, 1, n, g_inlog.fp) != n) {
+        fprintf(stderr, "[PC] input log: write to %s failed, recording stopped\n", g_inlog.path);
+        fclose(g_inlog.fp);
+        g_inlog.fp = NULL;
+        g_inlog.mode = INLOG_OFF;
+    }
+}
+
+static void rec_flush_repeat(void) {
+    while (g_inlog.repeat && g_inlog.fp) {
+        u32 n = g_inlog.repeat > 0xFFFF ? 0xFFFF : g_inlog.repeat;
+        u8 rec[3] = { INLOG_OP_REPEAT };
+        put_u16(rec + 1, n);
+        rec_write(rec, sizeof(rec));
+        g_inlog.repeat -= n;
+    }
+}
+
+static void rec_close(void) {
+    if (!g_inlog.fp) return;
+    rec_flush_repeat();
+    u8 end = INLOG_OP_END;
+    rec_write(&end, 1);
+    if (g_inlog.fp) {
+        fclose(g_inlog.fp);
+        g_inlog.fp = NULL;
+        printf("[PC] input log: recorded %u frame(s) to %s\n", g_inlog.frame, g_inlog.path);
+    }
+}
+
+static int rec_open(void) {
+    g_inlog.fp = fopen(g_inlog.path, "wb");
+    if (!g_inlog.fp) {
+        fprintf(stderr, "[PC] input log: cannot create %s\n", g_inlog.path);
+        return 0;
+    }
+    g_inlog.ticks_per_retrace = OS_TIMER_CLOCK / 60;
+    /* Start where the host clock is, so early timestamps look the same */
+    g_inlog.time_base = OSGetTime();
+
+    u8 hdr[INLOG_HEADER_SIZE] = { 0 };
+    put_u32(hdr, INLOG_MAGIC);
+    put_u16(hdr + 4, INLOG_VERSION);
+    put_u16(hdr + 6, INLOG_HEADER_SIZE);
+    put_u32(hdr + 8, (u32)g_inlog.time_base);
+    put_u32(hdr + 12, (u32)((u64)g_inlog.time_base >> 32));
+    put_u32(hdr + 16, g_inlog.ticks_per_retrace);
+    rec_write(hdr, sizeof(hdr));
+    atexit(rec_close);
+    printf("[PC] input log: recording to %s\n", g_inlog.path);
+    return g_inlog.fp != NULL;
+}
+
+void inlog_pad_record(const PADStatus *status, u32 connected) {
+    if (g_inlog.mode != INLOG_RECORD) return;
+    u8 rec[2 + 4 * INLOG_PAD_SIZE + 4];
+    u32 len = 2, mask = 0;
+    for (int i = 0; i < 4; i++) {
+        if (pad_equal(&status[i], &g_inlog.prev[i])) continue;
+        mask |= 1u << i;
+        pad_put(rec + len, &status[i]);
+        len += INLOG_PAD_SIZE;
+    }
+    if (connected != g_inlog.prev_connected) {
+        mask |= 1u << 4;
+        put_u32(rec + len, connected);
+        len += 4;
+    }
+    g_inlog.frame++;
+    if (!mask) {
+        g_inlog.repeat++;
+        return;
+    }
+    rec_flush_repeat();
+    rec[0] = INLOG_OP_PADS;
+    rec[1] = (u8)mask;
+    rec_write(rec, len);
+    memcpy(g_inlog.prev, status, sizeof(g_inlog.prev));
+    g_inlog.prev_connected = connected;
+}
+
+/* ---- Replay ---- */
+static int rep_open(void) {
+    FILE *fp = fopen(g_inlog.path, "rb");
+    if (!fp) {
+        fprintf(stderr, "[PC] input log: cannot open %s\n", g_inlog.path);
+        return 0;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    g_inlog.data = (u8 *)malloc(size > 0 ? (size_t)size : 1);
+    if (!g_inlog.data || size < INLOG_HEADER_SIZE ||
+        fread(g_inlog.data, 1, (size_t)size, fp) != (size_t)size) {
+        fprintf(stderr, "[PC] input log: cannot read %s\n", g_inlog.path);
+        fclose(fp);
+        free(g_inlog.data);
+        return 0;
+    }
+    fclose(fp);
+
+    const u8 *hdr = g_inlog.data;
+    u32 header_size = get_u16(hdr + 6);
+    if (get_u32(hdr) != INLOG_MAGIC || get_u16(hdr + 4) != INLOG_VERSION ||
+        header_size < INLOG_HEADER_SIZE || header_size > (u32)size) {
+        fprintf(stderr, "[PC] input log: %s is not a version %d input log\n", g_inlog.path,
+                INLOG_VERSION);
+        free(g_inlog.data);
+        return 0;
+    }
+    g_inlog.time_base = (OSTime)(get_u32(hdr + 8) | (u64)get_u32(hdr + 12) << 32);
+    g_inlog.ticks_per_retrace = get_u32(hdr + 16);
+    g_inlog.size = (u32)size;
+    g_inlog.pos = header_size;
+    printf("[PC] input log: replaying %s\n", g_inlog.path);
+    return 1;
+}
+
+static void rep_desync(const char *what) {
+    if (g_inlog.desync) return;
+    g_inlog.desync = 1;
+    fprintf(stderr, "[PC] input log: replay left the recording at frame %u (%s)\n",
+            g_inlog.frame, what);
+}
+
+static void rep_end(void) {
+    printf("[PC] input log: replay ended after %u frame(s)%s\n", g_inlog.frame,
+           g_inlog.desync ? ", desynchronized" : "");
+    fflush(stdout);
+    if (g_inlog.exit_at_end) exit(g_inlog.desync ? 1 : 0);
+    /* Live input from here; the clock stays virtual */
+    g_inlog.mode = INLOG_OFF;
+}
+
+/* Bytes of the record at pos, 0 if it is truncated */
+static u32 rep_record_size(void) {
+    const u8 *p = g_inlog.data + g_inlog.pos;
+    u32 left = g_inlog.size - g_inlog.pos, need;
+    switch (p[0]) {
+        case INLOG_OP_PADS:
+            if (left < 2) return 0;
+            need = 2 + (p[1] & 0x10 ? 4 : 0);
+            for (int i = 0; i < 4; i++) need += p[1] & (1 << i) ? INLOG_PAD_SIZE : 0;
+            break;
+        case INLOG_OP_REPEAT: need = 3; break;
+        case INLOG_OP_SEED: need = 6; break;
+        default: return 0;
+    }
+    return left >= need ? need : 0;
+}
+
+int inlog_pad_replay(PADStatus *status, u32 *connected) {
+    if (g_inlog.mode != INLOG_REPLAY) return 0;
+    while (!g_inlog.repeat) {
+        u32 size = g_inlog.pos < g_inlog.size ? rep_record_size() : 0;
+        if (!size) {
+            rep_end();
+            return 0;
+        }
+        const u8 *p = g_inlog.data + g_inlog.pos;
+        g_inlog.pos += size;
+        if (p[0] == INLOG_OP_SEED) {
+            rep_desync("seed not drawn");
+            continue;
+        }
+        if (p[0] == INLOG_OP_REPEAT) {
+            g_inlog.repeat = get_u16(p + 1);
+            continue;
+        }
+        u32 off = 2;
+        for (int i = 0; i < 4; i++) {
+            if (!(p[1] & (1 << i))) continue;
+            pad_get(&g_inlog.prev[i], p + off);
+            off += INLOG_PAD_SIZE;
+        }
+        if (p[1] & 0x10) g_inlog.prev_connected = get_u32(p + off);
+        g_inlog.repeat = 1;
+    }
+    g_inlog.repeat--;
+    g_inlog.frame++;
+    memcpy(status, g_inlog.prev, sizeof(g_inlog.prev));
+    *connected = g_inlog.prev_connected;
+    return 1;
+}
+
+/* ---- Seeds and time ---- */
+u32 PCInputLogSeed(u32 site, u32 seed) {
+    inlog_init();
+    if (g_inlog.mode == INLOG_RECORD) {
+        u8 rec[6] = { INLOG_OP_SEED, (u8)site };
+        put_u32(rec + 2, seed);
+        rec_flush_repeat();
+        rec_write(rec, sizeof(rec));
+    } else if (g_inlog.mode == INLOG_REPLAY) {
+        const u8 *p = g_inlog.data + g_inlog.pos;
+        if (g_inlog.repeat || g_inlog.pos >= g_inlog.size || p[0] != INLOG_OP_SEED ||
+            !rep_record_size() || p[1] != site) {
+            rep_desync("unexpected seed");
+            return seed;
+        }
+        g_inlog.pos += 6;
+        return get_u32(p + 2);
+    }
+    return seed;
+}
+
+OSTime inlog_time(void) {
+    OSTime t = g_inlog.time_base + (OSTime)VIGetRetraceCount() * g_inlog.ticks_per_retrace;
+    if (t <= g_inlog.time_last) t = g_inlog.time_last + OS_TIMER_CLOCK / 1000000;
+    return g_inlog.time_last = t;
+}
+
+void inlog_init(void) {
+    if (g_inlog.inited) return;
+    g_inlog.inited = 1;
+    const char *rec = getenv("MP4_INPUT_RECORD");
+    const char *rep = getenv("MP4_INPUT_REPLAY");
+    const char *e = getenv("MP4_INPUT_REPLAY_EXIT");
+    g_inlog.exit_at_end = (e && *e) ? atoi(e) : PC_INPUT_REPLAY_EXIT;
+    if (rep && *rep) {
+        snprintf(g_inlog.path, sizeof(g_inlog.path), "%s", rep);
+        if (rep_open()) g_inlog.mode = INLOG_REPLAY;
+    } else if (rec && *rec) {
+        snprintf(g_inlog.path, sizeof(g_inlog.path), "%s", rec);
+        if (rec_open()) g_inlog.mode = INLOG_RECORD;
+    }
+    g_inlog_time = g_inlog.mode != INLOG_OFF;
+}
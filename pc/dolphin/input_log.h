@@ -0,0 +1,78 @@
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+/*
+ * Deterministic input recording and replay.
+ *
+ * MP4_INPUT_RECORD=<path> logs what PADRead returns for all four ports on
+ * every retrace, plus the seeds the game draws for its random number
+ * generators. MP4_INPUT_REPLAY=<path> feeds a log back instead of reading
+ * SDL, so a run follows the same code paths as the recorded one.
+ *
+ * In both modes OSGetTime is a virtual clock: the base from the log
+ * header plus one 60 Hz field per retrace, stepping 1 us per call within
+ * a field so timeout loops still end. Waits on OSGetTick and the time
+ * based seeds are then the same in every run, however fast the host
+ * renders. Stopwatches (HuPerf) keep measuring host time.
+ *
+ * Layout, little-endian: an InputLogHeader, then records starting with a
+ * u8 op:
+ *   INLOG_OP_PADS    u8 mask; for each port bit 0..3 set, 11 bytes of
+ *                    PADStatus (button u16, then the s8/u8 fields in
+ *                    declaration order); if bit 4 is set, u32 connected
+ *   INLOG_OP_REPEAT  u16 n; the last pad frame repeats n more times
+ *   INLOG_OP_SEED    u8 site, u32 seed
+ *   INLOG_OP_END     end of the log
+ * Each PADRead consumes one pad frame (PADS or one repeat). Ports
+ * missing from a PADS mask are unchanged from the previous frame, which
+ * starts out all zero.
+ */
+
+#include "dolphin/types.h"
+#include "dolphin/os.h"
+#include "dolphin/pad.h"
+
+#define INLOG_MAGIC   0x4934504Du /* "MP4I" */
+#define INLOG_VERSION 1
+
+typedef struct {
+    u32 magic;
+    u16 version;
+    u16 header_size;
+    u64 time_base;          /* virtual OSGetTime at retrace 0 */
+    u32 ticks_per_retrace;
+    u32 reserved;
+} InputLogHeader;
+
+enum {
+    INLOG_OP_END = 0,
+    INLOG_OP_PADS = 1,
+    INLOG_OP_REPEAT = 2,
+    INLOG_OP_SEED = 3,
+};
+
+/* Seed sites (PCInputLogSeed) */
+enum {
+    INLOG_SEED_FRAND = 0,   /* frand.c, when the seed is 0 */
+    INLOG_SEED_BOARD = 1,   /* BoardRandInit */
+};
+
+/* Nonzero while OSGetTime is the virtual clock */
+extern int g_inlog_time;
+
+/* Reads MP4_INPUT_RECORD / MP4_INPUT_REPLAY; later calls do nothing */
+void inlog_init(void);
+
+/* PADRead: returns 1 with the next logged frame while replaying */
+int inlog_pad_replay(PADStatus *status, u32 *connected);
+
+/* PADRead: logs the frame about to be returned while recording */
+void inlog_pad_record(const PADStatus *status, u32 connected);
+
+/* The virtual OSGetTime */
+OSTime inlog_time(void);
+
+/* Game seed sites: logs the seed, or returns the logged one on replay */
+u32 PCInputLogSeed(u32 site, u32 seed);
+
+#endif /* INPUT_LOG_H */
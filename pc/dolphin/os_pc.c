@@ -9,11 +9,13 @@
 #include <string.h>
 #include <time.h>
 #include <math.h>
+#include <sys/stat.h>
 
 #include "dolphin/types.h"
 #include "dolphin/os.h"
 #include "dolphin/gx/GXStruct.h"
 #include "pc_config.h"
+#include "dolphin/input_log.h"
 
 /* ---- Clock globals ---- */
 u32 __OSBusClock  = PC_BUS_CLOCK;
@@ -186,11 +188,11 @@ static void ensure_time_init(void) {
     if (!g_time_inited) {
         clock_gettime(CLOCK_MONOTONIC, &g_start_time);
         g_time_inited = 1;
+        inlog_init();
     }
 }
 
-OSTime OSGetTime(void) {
-    ensure_time_init();
+static OSTime os_host_time(void) {
     struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
     u64 ns = (u64)(now.tv_sec - g_start_time.tv_sec) * 1000000000ULL +
@@ -199,6 +201,13 @@ OSTime OSGetTime(void) {
     return (OSTime)(ns * (PC_BUS_CLOCK / 4) / 1000000000ULL);
 }
 
+OSTime OSGetTime(void) {
+    ensure_time_init();
+    /* Recorded and replayed runs see time advance with retraces */
+    if (g_inlog_time) return inlog_time();
+    return os_host_time();
+}
+
 OSTick OSGetTick(void) {
     return (OSTick)(OSGetTime() & 0xFFFFFFFF);
 }
@@ -262,21 +271,30 @@ OSModuleInfo *OSSearchModule(void *ptr, u32 *section, u32 *offset) {
 void OSNotifyLink(void) {}
 void OSNotifyUnlink(void) {}
 
-/* ---- Stopwatch (simple stubs) ---- */
+/* ---- Stopwatch ---- */
 void OSInitStopwatch(OSStopwatch *sw, char *name) {
     memset(sw, 0, sizeof(*sw));
     sw->name = name;
 }
-void OSStartStopwatch(OSStopwatch *sw) { sw->running = TRUE; sw->last = OSGetTime(); }
+/* Stopwatches measure host time even when OSGetTime is virtual */
+void OSStartStopwatch(OSStopwatch *sw) {
+    ensure_time_init();
+    sw->running = TRUE;
+    sw->last = os_host_time();
+}
 void OSStopStopwatch(OSStopwatch *sw) {
     if (sw->running) {
-        OSTime elapsed = OSGetTime() - sw->last;
+        OSTime elapsed = os_host_time() - sw->last;
         sw->total += elapsed;
         sw->hits++;
         sw->running = FALSE;
     }
 }
-OSTime OSCheckStopwatch(OSStopwatch *sw) { return sw->total; }
+/* Includes the running interval, as in the SDK: HuPerf reads its slots
+ * while they run */
+OSTime OSCheckStopwatch(OSStopwatch *sw) {
+    return sw->total + (sw->running ? os_host_time() - sw->last : 0);
+}
 void OSResetStopwatch(OSStopwatch *sw) { sw->total = 0; sw->hits = 0; }
 void OSDumpStopwatch(OSStopwatch *sw) { printf("[OS] Stopwatch '%s': %lld\n", sw->name, (long long)sw->total); }
 
@@ -434,6 +452,33 @@ void PPCDisableSpeculation(void) {}
 void PPCSetFpIEEEMode(void) {}
 void PPCSetFpNonIEEEMode(void) {}
 
+/* ---- Per-user cache directory ---- */
+
+/* Path of name in the per-user cache directory (see pc_config.h), which
+ * is created if missing. Without XDG_CACHE_HOME or HOME it is name itself,
+ * relative to the working directory. */
+void OSPCCachePath(char *out, size_t size, const char *name) {
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    char dir[512];
+    if (xdg && *xdg) {
+        snprintf(dir, sizeof(dir), "%s/%s", xdg, PC_CACHE_DIR);
+    } else if (home && *home) {
+        snprintf(dir, sizeof(dir), "%s/.cache/%s", home, PC_CACHE_DIR);
+    } else {
+        snprintf(out, size, "%s", name);
+        return;
+    }
+    for (char *p = dir + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        mkdir(dir, 0755);
+        *p = '/';
+    }
+    mkdir(dir, 0755);
+    snprintf(out, size, "%s/%s", dir, name);
+}
+
 /* ---- DB stubs ---- */
 void DBInit(void) {}
 void DBInitComm(int *inputFlagPtr, int *mtrCallback) { (void)inputFlagPtr; (void)mtrCallback; }
@@ -7,6 +7,7 @@
 
 #include "dolphin/types.h"
 #include "dolphin/pad.h"
+#include "dolphin/input_log.h"
 
 static SDL_GameController *g_controllers[4] = { NULL, NULL, NULL, NULL };
 static int g_pad_initialized = 0;
@@ -38,6 +39,8 @@ u32 PADRead(PADStatus *status) {
     memset(status, 0, sizeof(PADStatus) * 4);
 
     u32 connected = 0;
+    inlog_init();
+    if (inlog_pad_replay(status, &connected)) return connected;
 
     /* Poll SDL events to update controller state */
     SDL_GameControllerUpdate();
@@ -109,6 +112,7 @@ u32 PADRead(PADStatus *status) {
     status[0].stickX = sx;
     status[0].stickY = sy;
 
+    inlog_pad_record(status, connected);
     return connected;
 }
 
@@ -3,6 +3,7 @@
  */
 #include <SDL.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "dolphin/types.h"
@@ -16,9 +17,6 @@ extern SDL_Window *g_pc_window;
 extern SDL_Renderer *g_pc_renderer;
 extern SDL_Texture *g_pc_texture;
 
-/* Software framebuffer from gx_pc.c */
-extern u32 g_gx_framebuffer[];
-
 /* GX internal state (for accessing the live framebuffer) */
 #include "dolphin/gx_state.h"
 
@@ -109,10 +107,20 @@ void VISetBlack(BOOL black) {
  * background sprites but under foreground UI sprites. */
 void GXPCFlushFramebuffer(void) {
     if (g_pc_renderer && g_pc_texture) {
-        /* Use the live internal framebuffer (g_gx.framebuffer) which has
-         * the current frame's 3D content, not g_gx_framebuffer which is
-         * the display copy from the previous GXCopyDisp call. */
-        SDL_UpdateTexture(g_pc_texture, NULL, g_gx.framebuffer, 640 * sizeof(u32));
+        /* Read the live render target, which has the current frame's 3D
+         * content, not the display copy from the previous GXCopyDisp.
+         * gx_fb_read writes straight into the streaming texture's memory,
+         * filling fast-cleared tiles without touching the framebuffer. */
+        void *pixels;
+        int pitch;
+        if (SDL_LockTexture(g_pc_texture, NULL, &pixels, &pitch) == 0) {
+            gx_fb_read((u32 *)pixels, (u32)pitch);
+            SDL_UnlockTexture(g_pc_texture);
+        } else {
+            static u32 staging[GX_FB_WIDTH * GX_FB_HEIGHT];
+            gx_fb_read(staging, GX_FB_WIDTH * sizeof(u32));
+            SDL_UpdateTexture(g_pc_texture, NULL, staging, GX_FB_WIDTH * sizeof(u32));
+        }
         SDL_RenderCopy(g_pc_renderer, g_pc_texture, NULL, NULL);
     }
 }
@@ -168,6 +176,12 @@ void VIWaitForRetrace(void) {
 
     g_retrace_count++;
 
+    /* Completed DVDReadAsync callbacks */
+    {
+        extern void DVDPCDispatch(void);
+        DVDPCDispatch();
+    }
+
     /* Fire post-retrace callback (reads gamepad input) */
     if (g_post_retrace_cb) {
         g_post_retrace_cb(g_retrace_count);
@@ -0,0 +1,292 @@
+/*
+ * On-disk cache of decompressed data members (see assetcache_pc.h).
+ *
+ * The cache directory is listed on first use into an index of entry keys,
+ * sizes and last-use times; stores add to it and prune it, hits update
+ * it. Entries are written under a temporary name and renamed into place,
+ * so a reader never maps a partial entry.
+ */
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dolphin/types.h"
+#include "dolphin/os.h"
+#include "game/data.h"
+#include "pc_config.h"
+#include "game/assetcache_pc.h"
+
+/* Smaller members decode faster than an entry opens */
+#define ASSET_CACHE_MIN_SIZE 0x4000
+
+extern BOOL DVDPCFileStamp(s32 entrynum, u32 *size, s64 *mtime);
+extern void HuDecodeDataPC(void *src, void *dst, u32 size, s32 decode_type);
+extern void OSPCCachePath(char *out, size_t size, const char *name);
+
+typedef struct {
+    u64 key;
+    u64 size;               /* bytes on disk */
+    s64 used;               /* ns, entry mtime */
+} AssetCacheFile;
+
+static struct {
+    int inited;
+    int enabled;
+    char dir[512];
+    u64 budget, total;
+    AssetCacheFile *files;
+    u32 count, cap;
+    u32 hits, misses, stores;
+    u64 hit_bytes;
+    pthread_mutex_t lock;   /* index and counters */
+} g_acache = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static s64 acache_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (s64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static s64 acache_mtime(const struct stat *st) {
+#ifdef __APPLE__
+    return (s64)st->st_mtimespec.tv_sec * 1000000000 + st->st_mtimespec.tv_nsec;
+#else
+    return (s64)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+static u64 acache_hash(u64 h, const void *data, size_t len) {
+    const u8 *p = (const u8 *)data;
+    for (size_t i = 0; i < len; i++) h = (h ^ p[i]) * 0x100000001B3ull;
+    return h;
+}
+
+static void acache_name(char *out, size_t size, u64 key) {
+    snprintf(out, size, "%s/%016llx.bin", g_acache.dir, (unsigned long long)key);
+}
+
+/* Index slot of key, -1 if none; call with the lock held */
+static s32 acache_find(u64 key) {
+    for (u32 i = 0; i < g_acache.count; i++) {
+        if (g_acache.files[i].key == key) return (s32)i;
+    }
+    return -1;
+}
+
+static void acache_index_add(u64 key, u64 size, s64 used) {
+    if (g_acache.count == g_acache.cap) {
+        g_acache.cap = g_acache.cap ? g_acache.cap * 2 : 256;
+        g_acache.files = (AssetCacheFile *)realloc(g_acache.files,
+                                                   g_acache.cap * sizeof(AssetCacheFile));
+    }
+    g_acache.files[g_acache.count++] = (AssetCacheFile){ key, size, used };
+    g_acache.total += size;
+}
+
+static void acache_index_remove(s32 slot) {
+    g_acache.total -= g_acache.files[slot].size;
+    g_acache.files[slot] = g_acache.files[--g_acache.count];
+}
+
+static int acache_cmp_used(const void *a, const void *b) {
+    s64 ua = ((const AssetCacheFile *)a)->used, ub = ((const AssetCacheFile *)b)->used;
+    return ua < ub ? -1 : ua > ub;
+}
+
+/* Deletes the least recently used entries down to 3/4 of the budget, so
+ * a full cache is not pruned again on every store */
+static void acache_prune(void) {
+    if (g_acache.total <= g_acache.budget) return;
+    qsort(g_acache.files, g_acache.count, sizeof(AssetCacheFile), acache_cmp_used);
+    u32 drop = 0;
+    u64 target = g_acache.budget / 4 * 3;
+    while (drop < g_acache.count && g_acache.total > target) {
+        char path[600];
+        acache_name(path, sizeof(path), g_acache.files[drop].key);
+        unlink(path);
+        g_acache.total -= g_acache.files[drop].size;
+        drop++;
+    }
+    memmove(g_acache.files, g_acache.files + drop, (g_acache.count - drop) * sizeof(AssetCacheFile));
+    g_acache.count -= drop;
+}
+
+static void acache_scan(void) {
+    DIR *d = opendir(g_acache.dir);
+    if (!d) return;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        char path[600];
+        struct stat st;
+        unsigned long long key;
+        int end = 0;
+        int len = snprintf(path, sizeof(path), "%s/%s", g_acache.dir, de->d_name);
+        /* Not an entry name, and unlinking a truncated path could hit
+         * another file */
+        if (len < 0 || (size_t)len >= sizeof(path)) continue;
+        if (strstr(de->d_name, ".tmp.")) {
+            /* Left by a run that stopped while storing */
+            unlink(path);
+            continue;
+        }
+        if (sscanf(de->d_name, "%16llx.bin%n", &key, &end) != 1 || de->d_name[end] != '\0') continue;
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        acache_index_add(key, (u64)st.st_size, acache_mtime(&st));
+    }
+    closedir(d);
+}
+
+static void acache_init(void) {
+    if (g_acache.inited) return;
+    g_acache.inited = 1;
+    const char *e = getenv("MP4_ASSET_CACHE");
+    g_acache.enabled = (e && *e) ? atoi(e) : PC_ASSET_CACHE;
+    if (!g_acache.enabled) return;
+    e = getenv("MP4_ASSET_CACHE_DIR");
+    if (e && *e) {
+        snprintf(g_acache.dir, sizeof(g_acache.dir), "%s", e);
+    } else {
+        OSPCCachePath(g_acache.dir, sizeof(g_acache.dir), PC_ASSET_CACHE_DIR);
+    }
+    e = getenv("MP4_ASSET_CACHE_BYTES");
+    g_acache.budget = (e && *e) ? strtoull(e, NULL, 0) : PC_ASSET_CACHE_BYTES;
+    mkdir(g_acache.dir, 0755);
+    acache_scan();
+    acache_prune();
+    printf("[PC] asset cache: %s, %u entries, %.1f MB\n", g_acache.dir, g_acache.count,
+           g_acache.total / (1024.0 * 1024.0));
+}
+
+/* Copies the entry for key into dst; 0 if it is missing or stale */
+static int acache_load(u64 key, const AssetCacheHeader *want, const char *src_path, void *dst) {
+    char path[600];
+    struct stat st;
+    acache_name(path, sizeof(path), key);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    int ok = 0;
+    if (fstat(fd, &st) == 0 && (u64)st.st_size >= sizeof(AssetCacheHeader)) {
+        const u8 *map = (const u8 *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            const AssetCacheHeader *hdr = (const AssetCacheHeader *)map;
+            size_t path_len = strlen(src_path) + 1;
+            ok = hdr->magic == want->magic && hdr->version == want->version &&
+                 hdr->member == want->member && hdr->comp_type == want->comp_type &&
+                 hdr->raw_len == want->raw_len && hdr->src_size == want->src_size &&
+                 hdr->src_mtime == want->src_mtime &&
+                 hdr->header_size >= sizeof(AssetCacheHeader) + path_len &&
+                 (u64)st.st_size == (u64)hdr->header_size + hdr->raw_len &&
+                 memcmp(map + sizeof(AssetCacheHeader), src_path, path_len) == 0;
+            if (ok) memcpy(dst, map + hdr->header_size, hdr->raw_len);
+            munmap((void *)map, st.st_size);
+        }
+    }
+    if (ok) {
+        futimens(fd, NULL);
+    } else {
+        unlink(path);
+    }
+    close(fd);
+    return ok;
+}
+
+static int acache_write_all(int fd, const void *data, size_t len) {
+    const u8 *p = (const u8 *)data;
+    while (len) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+static int acache_store(u64 key, AssetCacheHeader *hdr, const char *src_path, const void *data) {
+    char tmp[600], path[600];
+    u8 head[512];
+    size_t path_len = strlen(src_path) + 1;
+    size_t header_size = (sizeof(AssetCacheHeader) + path_len + 31) & ~(size_t)31;
+    if (header_size > sizeof(head)) return 0;
+    hdr->header_size = (u16)header_size;
+    memset(head, 0, hdr->header_size);
+    memcpy(head, hdr, sizeof(AssetCacheHeader));
+    memcpy(head + sizeof(AssetCacheHeader), src_path, path_len);
+
+    snprintf(tmp, sizeof(tmp), "%s/%016llx.tmp.XXXXXX", g_acache.dir, (unsigned long long)key);
+    int fd = mkstemp(tmp);
+    if (fd < 0) return 0;
+    int ok = acache_write_all(fd, head, hdr->header_size) && acache_write_all(fd, data, hdr->raw_len);
+    ok = close(fd) == 0 && ok;
+    acache_name(path, sizeof(path), key);
+    if (!ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+void PCAssetCacheDecode(const char *path, s32 entrynum, s32 member, void *src, void *dst,
+                        u32 raw_len, s32 comp_type) {
+    pthread_mutex_lock(&g_acache.lock);
+    acache_init();
+    int enabled = g_acache.enabled;
+    pthread_mutex_unlock(&g_acache.lock);
+
+    AssetCacheHeader hdr = { 0 };
+    if (!enabled || comp_type == DATA_DECODE_NONE || raw_len < ASSET_CACHE_MIN_SIZE ||
+        !DVDPCFileStamp(entrynum, &hdr.src_size, &hdr.src_mtime)) {
+        HuDecodeDataPC(src, dst, raw_len, comp_type);
+        return;
+    }
+    hdr.magic = ASSET_CACHE_MAGIC;
+    hdr.version = ASSET_CACHE_VERSION;
+    hdr.member = (u32)member;
+    hdr.comp_type = (u32)comp_type;
+    hdr.raw_len = raw_len;
+    u64 key = acache_hash(0xCBF29CE484222325ull, path, strlen(path));
+    key = acache_hash(key, &hdr.member, sizeof(hdr.member));
+    key = acache_hash(key, &hdr.comp_type, sizeof(hdr.comp_type));
+    key = acache_hash(key, &hdr.raw_len, sizeof(hdr.raw_len));
+    key = acache_hash(key, &hdr.src_size, sizeof(hdr.src_size));
+    key = acache_hash(key, &hdr.src_mtime, sizeof(hdr.src_mtime));
+
+    if (acache_load(key, &hdr, path, dst)) {
+        pthread_mutex_lock(&g_acache.lock);
+        s32 slot = acache_find(key);
+        if (slot >= 0) g_acache.files[slot].used = acache_now();
+        g_acache.hits++;
+        g_acache.hit_bytes += raw_len;
+        pthread_mutex_unlock(&g_acache.lock);
+        return;
+    }
+
+    HuDecodeDataPC(src, dst, raw_len, comp_type);
+    int stored = acache_store(key, &hdr, path, dst);
+    pthread_mutex_lock(&g_acache.lock);
+    g_acache.misses++;
+    s32 slot = acache_find(key);
+    if (slot >= 0) acache_index_remove(slot);
+    if (stored) {
+        g_acache.stores++;
+        acache_index_add(key, (u64)hdr.header_size + raw_len, acache_now());
+        acache_prune();
+    }
+    pthread_mutex_unlock(&g_acache.lock);
+}
+
+void PCAssetCacheReport(void) {
+    pthread_mutex_lock(&g_acache.lock);
+    if (g_acache.enabled && (g_acache.hits || g_acache.misses)) {
+        printf("[BENCH] asset cache: %u hits (%.1f MB), %u misses, %u stored, %.1f MB on disk\n",
+               g_acache.hits, g_acache.hit_bytes / (1024.0 * 1024.0), g_acache.misses,
+               g_acache.stores, g_acache.total / (1024.0 * 1024.0));
+    }
+    pthread_mutex_unlock(&g_acache.lock);
+}
@@ -0,0 +1,47 @@
+#ifndef _GAME_ASSETCACHE_PC_H
+#define _GAME_ASSETCACHE_PC_H
+
+/*
+ * On-disk cache of decompressed data members for the PC port.
+ *
+ * A compressed member of a data directory is decoded once and written to
+ * PC_ASSET_CACHE_DIR, in the per-user cache directory, as <key>.bin, where
+ * key is a 64-bit hash of the directory path, member number, codec,
+ * decoded size and the size and mtime of the directory file. Later loads
+ * map the entry and copy it into the game's buffer instead of decoding, so
+ * a replaced data file simply misses. The payload is the decoded member as
+ * HuDecodeData writes it.
+ *
+ * Entry layout, little-endian: an AssetCacheHeader, the directory path
+ * (NUL-terminated), zero padding up to header_size, then raw_len bytes of
+ * payload. The files are kept under PC_ASSET_CACHE_BYTES by deleting the
+ * least recently used ones; a hit touches the entry's mtime, so the order
+ * carries over between runs.
+ */
+
+#include "dolphin/types.h"
+
+#define ASSET_CACHE_MAGIC   0x4334504Du /* "MP4C" */
+#define ASSET_CACHE_VERSION 1
+
+typedef struct {
+    u32 magic;
+    u16 version;
+    u16 header_size;        /* offset of the payload */
+    u32 member;
+    u32 comp_type;
+    u32 raw_len;
+    u32 src_size;           /* directory file */
+    s64 src_mtime;          /* ns */
+} AssetCacheHeader;
+
+/* HuDecodeDataPC for member of the directory file path (DVD entry
+ * entrynum), served from the cache when it holds the member. Safe on job
+ * threads; dst is not flushed. */
+void PCAssetCacheDecode(const char *path, s32 entrynum, s32 member, void *src, void *dst,
+                        u32 raw_len, s32 comp_type);
+
+/* Prints hit and miss counts as a [BENCH] line */
+void PCAssetCacheReport(void);
+
+#endif /* _GAME_ASSETCACHE_PC_H */
@@ -395,7 +395,6 @@ s32 get_current_board(void) { return 0; }
  * GX Graphics stubs
  * ======================================================================== */
 
-void GXInitSpecularDir(void) {}
 void GXResetWriteGatherPipe(void) {}
 void GXSetTevIndWarp(void) {}
 u16 GXUnknownu16 = 0;
@@ -44,9 +44,14 @@ void HuMemDCFlushAll(void)
     HuMemDCFlush(0);
 }
 
+/* The game flushes a whole heap when it creates or kills a model, so GX
+ * would see newly loaded data. Host memory needs no flush, and passing
+ * the heap to DCFlushRange would mark every vertex array in it rewritten,
+ * decoding all compiled display lists again; arrays the game does rewrite
+ * (skinning, morphing) are flushed by range. */
 void HuMemDCFlush(HeapID heap)
 {
-    DCFlushRangeNoSync(HeapTbl[heap], HeapSizeTbl[heap]);
+    (void)heap;
 }
 
 void *HuMemDirectMalloc(HeapID heap, s32 size)
@@ -0,0 +1,182 @@
+/*
+ * Overlay-driven data directory prefetch (see prefetch_pc.h).
+ *
+ * The profile is read on the first overlay switch and rewritten whenever
+ * an overlay's directory list changes. A list is replaced by what the
+ * latest visit loaded, so a profile follows the game as it is played; a
+ * visit that loaded nothing keeps the old list.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dolphin/types.h"
+#include "dolphin/dvd.h"
+#include "pc_config.h"
+#include "game/prefetch_pc.h"
+
+#define PREFETCH_MAX_OVL  256
+#define PREFETCH_MAX_DIRS 64
+
+extern BOOL DVDPCPrefetch(s32 entrynum);
+extern void DVDPCPrefetchDrop(void);
+extern u32 DVDPCPrefetchHits(void);
+extern void OSPCCachePath(char *out, size_t size, const char *name);
+
+typedef struct {
+    char *dirs[PREFETCH_MAX_DIRS];
+    int count;
+} PrefetchList;
+
+typedef struct {
+    u32 entries;
+    double total_ms, max_ms;
+} PrefetchStat;
+
+static struct {
+    int inited;
+    int enabled;
+    char path[512];
+    PrefetchList profile[PREFETCH_MAX_OVL];
+    PrefetchList rec;           /* directories of the current visit */
+    s32 cur;                    /* overlay being recorded, -1 = none */
+    u32 queued;                 /* directories read ahead for cur */
+    s32 enter_ovl;
+    double enter_start;
+    u32 enter_hits;
+    PrefetchStat stat[PREFETCH_MAX_OVL];
+} g_pre = { .cur = -1 };
+
+static double pre_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void pre_list_clear(PrefetchList *l) {
+    for (int i = 0; i < l->count; i++) free(l->dirs[i]);
+    l->count = 0;
+}
+
+static void pre_list_add(PrefetchList *l, const char *dir) {
+    for (int i = 0; i < l->count; i++) {
+        if (strcmp(l->dirs[i], dir) == 0) return;
+    }
+    if (l->count < PREFETCH_MAX_DIRS) l->dirs[l->count++] = strdup(dir);
+}
+
+static void pre_load(void) {
+    FILE *f = fopen(g_pre.path, "r");
+    if (!f) return;
+    char line[8192];
+    int ovls = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') continue;
+        char *tok = strtok(line, " \t\r\n");
+        if (!tok) continue;
+        int ovl = atoi(tok);
+        if (ovl < 0 || ovl >= PREFETCH_MAX_OVL) continue;
+        PrefetchList *l = &g_pre.profile[ovl];
+        pre_list_clear(l);
+        while ((tok = strtok(NULL, " \t\r\n")) != NULL) pre_list_add(l, tok);
+        ovls++;
+    }
+    fclose(f);
+    printf("[PC] prefetch: %d overlay(s) in %s\n", ovls, g_pre.path);
+}
+
+static void pre_save(void) {
+    char tmp[520];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", g_pre.path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) return;
+    fprintf(f, "# mp4 prefetch profile 1\n");
+    for (int ovl = 0; ovl < PREFETCH_MAX_OVL; ovl++) {
+        const PrefetchList *l = &g_pre.profile[ovl];
+        if (!l->count) continue;
+        fprintf(f, "%d", ovl);
+        for (int i = 0; i < l->count; i++) fprintf(f, " %s", l->dirs[i]);
+        fprintf(f, "\n");
+    }
+    if (fclose(f) == 0) rename(tmp, g_pre.path);
+}
+
+/* Ends the visit to cur: its directories become its profile line */
+static void pre_commit(void) {
+    if (g_pre.cur < 0 || !g_pre.rec.count) return;
+    PrefetchList *l = &g_pre.profile[g_pre.cur];
+    int same = l->count == g_pre.rec.count;
+    for (int i = 0; same && i < l->count; i++) same = strcmp(l->dirs[i], g_pre.rec.dirs[i]) == 0;
+    if (!same) {
+        pre_list_clear(l);
+        for (int i = 0; i < g_pre.rec.count; i++) pre_list_add(l, g_pre.rec.dirs[i]);
+        pre_save();
+    }
+    pre_list_clear(&g_pre.rec);
+}
+
+static void pre_init(void) {
+    if (g_pre.inited) return;
+    g_pre.inited = 1;
+    const char *e = getenv("MP4_PREFETCH");
+    g_pre.enabled = (e && *e) ? atoi(e) : PC_PREFETCH;
+    e = getenv("MP4_PREFETCH_PROFILE");
+    if (e && *e) {
+        snprintf(g_pre.path, sizeof(g_pre.path), "%s", e);
+    } else {
+        OSPCCachePath(g_pre.path, sizeof(g_pre.path), PC_PREFETCH_PROFILE);
+    }
+    pre_load();
+    atexit(pre_commit);
+}
+
+void PCPrefetchOverlay(s32 ovl) {
+    pre_init();
+    pre_commit();
+    g_pre.cur = ovl >= 0 && ovl < PREFETCH_MAX_OVL ? ovl : -1;
+    g_pre.queued = 0;
+    /* Whatever the last prediction read and nobody used */
+    DVDPCPrefetchDrop();
+    if (!g_pre.enabled || g_pre.cur < 0) return;
+    const PrefetchList *l = &g_pre.profile[g_pre.cur];
+    for (int i = 0; i < l->count; i++) {
+        s32 entrynum = DVDConvertPathToEntrynum(l->dirs[i]);
+        g_pre.queued += DVDPCPrefetch(entrynum) ? 1 : 0;
+    }
+}
+
+void PCPrefetchNoteDir(const char *path) {
+    if (g_pre.cur >= 0 && path) pre_list_add(&g_pre.rec, path);
+}
+
+void PCPrefetchEnterBegin(s32 ovl) {
+    g_pre.enter_ovl = ovl;
+    g_pre.enter_start = pre_now();
+    g_pre.enter_hits = DVDPCPrefetchHits();
+}
+
+void PCPrefetchEnterEnd(void) {
+    s32 ovl = g_pre.enter_ovl;
+    double ms = (pre_now() - g_pre.enter_start) * 1e3;
+    u32 hits = DVDPCPrefetchHits() - g_pre.enter_hits;
+    printf("[PC] prefetch: overlay %d entered in %.1f ms (%u of %u read-ahead directories used)\n",
+           (int)ovl, ms, hits, g_pre.queued);
+    if (ovl < 0 || ovl >= PREFETCH_MAX_OVL) return;
+    PrefetchStat *st = &g_pre.stat[ovl];
+    st->entries++;
+    st->total_ms += ms;
+    if (ms > st->max_ms) st->max_ms = ms;
+}
+
+void PCPrefetchReport(void) {
+    int any = 0;
+    for (int ovl = 0; ovl < PREFETCH_MAX_OVL; ovl++) {
+        const PrefetchStat *st = &g_pre.stat[ovl];
+        if (!st->entries) continue;
+        if (!any) printf("[BENCH] %-8s %8s %8s %8s  (overlay entry, ms)\n", "overlay", "count", "mean", "max");
+        any = 1;
+        printf("[BENCH] %-8d %8u %8.3f %8.3f\n", ovl, st->entries, st->total_ms / st->entries,
+               st->max_ms);
+    }
+}
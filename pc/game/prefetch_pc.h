@@ -0,0 +1,37 @@
+#ifndef _GAME_PREFETCH_PC_H
+#define _GAME_PREFETCH_PC_H
+
+/*
+ * Overlay-driven data directory prefetch for the PC port.
+ *
+ * Every data directory loaded while an overlay is current is noted, in
+ * first-load order, and the list is kept per overlay in a small text
+ * profile (PC_PREFETCH_PROFILE):
+ *
+ *   # mp4 prefetch profile 1
+ *   <overlay> <directory path> ...
+ *
+ * When omOvlGotoEx starts a switch to an overlay with a profile line, its
+ * directories are read into host memory on the DVD threads while the old
+ * overlay fades out, so ObjectSetup finds them in memory (DVDPCPrefetch).
+ * The time the game spends entering each overlay (from the start of entry
+ * in omWatchOverlayProc to the end of ObjectSetup) is logged and kept for
+ * the benchmark report.
+ */
+
+#include "dolphin/types.h"
+
+/* omOvlGotoEx: a switch to overlay ovl begins */
+void PCPrefetchOverlay(s32 ovl);
+
+/* data.c: the directory at path is being read from disc */
+void PCPrefetchNoteDir(const char *path);
+
+/* omWatchOverlayProc: entering ovl starts / ObjectSetup has returned */
+void PCPrefetchEnterBegin(s32 ovl);
+void PCPrefetchEnterEnd(void);
+
+/* Prints entry latency per overlay as [BENCH] lines */
+void PCPrefetchReport(void);
+
+#endif /* _GAME_PREFETCH_PC_H */
@@ -0,0 +1,114 @@
+/*
+ * Headless benchmark mode (see pc_bench.h).
+ *
+ * Each frame stores the wall time since the previous frame and the last
+ * measurement of every HuPerf slot. Samples are kept until the report, so
+ * percentiles are exact.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dolphin/types.h"
+#include "dolphin/os.h"
+#include "dolphin/vi.h"
+#include "game/perf.h"
+#include "pc_config.h"
+#include "pc_bench.h"
+#include "game/assetcache_pc.h"
+#include "game/prefetch_pc.h"
+
+#define PC_BENCH_MAX_SLOTS 10
+
+static struct {
+    int inited;
+    int frames;         /* frames to sample, 0 = off */
+    int count;
+    double start, last;
+    int nslots;
+    const char *names[PC_BENCH_MAX_SLOTS];
+    float *frame_ms;                        /* [frames] */
+    float *slot_ms[PC_BENCH_MAX_SLOTS];     /* [frames] each */
+} g_bench;
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int PCBenchFrames(void) {
+    if (!g_bench.inited) {
+        const char *e = getenv("MP4_BENCH_FRAMES");
+        g_bench.frames = (e && *e) ? atoi(e) : PC_BENCH_FRAMES;
+        if (g_bench.frames < 0) g_bench.frames = 0;
+        g_bench.inited = 1;
+    }
+    return g_bench.frames;
+}
+
+static int bench_cmp(const void *a, const void *b) {
+    float fa = *(const float *)a, fb = *(const float *)b;
+    return fa < fb ? -1 : fa > fb;
+}
+
+/* Sorts samples in place */
+static void bench_print(const char *name, float *ms, int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) sum += ms[i];
+    qsort(ms, n, sizeof(float), bench_cmp);
+    /* Nearest-rank percentiles */
+    int p50 = (n * 50 + 99) / 100 - 1, p99 = (n * 99 + 99) / 100 - 1;
+    printf("[BENCH] %-8s %8.3f %8.3f %8.3f %8.3f\n", name, sum / n, ms[p50 < 0 ? 0 : p50],
+           ms[p99 < 0 ? 0 : p99], ms[n - 1]);
+}
+
+static void bench_report(void) {
+    int n = g_bench.count;
+    double secs = g_bench.last - g_bench.start;
+    printf("[BENCH] mp4_pc: %d frames in %.2f s (%.1f fps), %u retraces\n", n, secs, n / secs,
+           VIGetRetraceCount());
+    printf("[BENCH] %-8s %8s %8s %8s %8s  (ms)\n", "slot", "mean", "p50", "p99", "max");
+    bench_print("frame", g_bench.frame_ms, n);
+    for (int s = 0; s < g_bench.nslots; s++) {
+        /* Slots the game created but never timed */
+        int used = 0;
+        for (int i = 0; i < n && !used; i++) used = g_bench.slot_ms[s][i] > 0.0f;
+        if (used) bench_print(g_bench.names[s], g_bench.slot_ms[s], n);
+    }
+    PCPrefetchReport();
+    PCAssetCacheReport();
+    fflush(stdout);
+}
+
+void PCBenchFrame(void) {
+    if (PCBenchFrames() == 0) return;
+    double now = bench_now();
+    if (!g_bench.frame_ms) {
+        /* The first call closes the frame that started the loop */
+        g_bench.frame_ms = (float *)malloc(g_bench.frames * sizeof(float));
+        for (int s = 0; s < PC_BENCH_MAX_SLOTS; s++)
+            g_bench.slot_ms[s] = (float *)calloc(g_bench.frames, sizeof(float));
+        g_bench.start = g_bench.last = now;
+        if (!g_bench.frame_ms || !g_bench.slot_ms[PC_BENCH_MAX_SLOTS - 1]) {
+            fprintf(stderr, "[PC] bench: out of memory\n");
+            exit(1);
+        }
+        printf("[PC] bench: timing %d frames\n", g_bench.frames);
+        return;
+    }
+
+    int i = g_bench.count++;
+    g_bench.frame_ms[i] = (float)((now - g_bench.last) * 1e3);
+    g_bench.last = now;
+    s64 ticks[PC_BENCH_MAX_SLOTS];
+    g_bench.nslots = HuPerfGetSlots(g_bench.names, ticks, PC_BENCH_MAX_SLOTS);
+    for (int s = 0; s < g_bench.nslots; s++)
+        g_bench.slot_ms[s][i] = (float)(ticks[s] * 1e3 / OS_TIMER_CLOCK);
+
+    if (g_bench.count == g_bench.frames) {
+        bench_report();
+        exit(0);
+    }
+}
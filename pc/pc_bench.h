@@ -0,0 +1,21 @@
+#ifndef PC_BENCH_H
+#define PC_BENCH_H
+
+/*
+ * Headless benchmark mode for the PC port.
+ *
+ * With MP4_BENCH_FRAMES=N the game runs without a visible window (SDL's
+ * dummy video driver, or no video at all if that is unavailable) and
+ * without vsync, so retraces follow game frames instead of wall time and
+ * the main loop runs as fast as it can. After N frames the frame times
+ * are reported (mean, p50, p99, max) in total and per HuPerf stopwatch
+ * slot, and the process exits.
+ */
+
+/* Frames to run before reporting, 0 when the benchmark is off */
+int PCBenchFrames(void);
+
+/* Once per main loop iteration, after the HuPerf slots are final */
+void PCBenchFrame(void);
+
+#endif /* PC_BENCH_H */
@@ -29,10 +29,167 @@ static inline float BEF32(float f) {
 #define MP4_DATA_PATH "orig/GMPE01_00/files/"
 #endif
 
+/* ---- DVD file reads ----
+ * Game files stay open once used. 1 = map each file and serve reads as a
+ * copy from the mapping, 0 = pread from the open descriptor.
+ * MP4_DVD_MMAP in the environment overrides this at startup. */
+#ifndef PC_DVD_MMAP
+#define PC_DVD_MMAP 1
+#endif
+
+/* ---- DVD read threads ----
+ * Threads serving DVDReadAsync; callbacks still run on the main thread.
+ * 0 = read inline and call back at once. MP4_DVD_THREADS in the
+ * environment overrides this at startup. */
+#ifndef PC_DVD_THREADS
+#define PC_DVD_THREADS 2
+#endif
+
+/* ---- Per-user cache directory ----
+ * Files the port keeps between runs (the overlay prefetch profile, the
+ * asset cache) go in $XDG_CACHE_HOME/PC_CACHE_DIR, or ~/.cache/PC_CACHE_DIR
+ * without XDG_CACHE_HOME, not in the working directory. */
+#ifndef PC_CACHE_DIR
+#define PC_CACHE_DIR "mp4"
+#endif
+
+/* ---- Overlay prefetch ----
+ * The data directories each overlay loads are kept in a profile
+ * (PC_PREFETCH_PROFILE in the cache directory); when the game switches to an overlay, the
+ * directories it loaded last time are read ahead on the DVD threads, up
+ * to PC_PREFETCH_BUDGET bytes held at once. PC_PREFETCH = 0 still records
+ * the profile but reads nothing ahead. MP4_PREFETCH, MP4_PREFETCH_PROFILE
+ * (a path) and MP4_PREFETCH_BUDGET override these at startup. */
+#ifndef PC_PREFETCH
+#define PC_PREFETCH 1
+#endif
+#ifndef PC_PREFETCH_PROFILE
+#define PC_PREFETCH_PROFILE "prefetch.txt"
+#endif
+#ifndef PC_PREFETCH_BUDGET
+#define PC_PREFETCH_BUDGET (64u * 1024u * 1024u)
+#endif
+
+/* ---- Asset cache ----
+ * Compressed data members are decoded once into PC_ASSET_CACHE_DIR in the
+ * cache directory and copied from there on later loads (see
+ * game/assetcache_pc.h), keeping at most PC_ASSET_CACHE_BYTES on disk.
+ * MP4_ASSET_CACHE, MP4_ASSET_CACHE_DIR (a path) and MP4_ASSET_CACHE_BYTES
+ * override these at startup. */
+#ifndef PC_ASSET_CACHE
+#define PC_ASSET_CACHE 1
+#endif
+#ifndef PC_ASSET_CACHE_DIR
+#define PC_ASSET_CACHE_DIR "assets"
+#endif
+#ifndef PC_ASSET_CACHE_BYTES
+#define PC_ASSET_CACHE_BYTES (512ull * 1024ull * 1024ull)
+#endif
+
 /* ---- Screen dimensions ---- */
 #define PC_SCREEN_WIDTH  640
 #define PC_SCREEN_HEIGHT 480
 
+/* ---- Decoded texture cache budget (bytes of host RGBA8) ---- */
+#ifndef PC_TEXCACHE_BUDGET
+#define PC_TEXCACHE_BUDGET (96u * 1024u * 1024u)
+#endif
+
+/* ---- Texture decode buffer pool ----
+ * Bytes of released decode buffers kept for reuse by later decodes
+ * instead of being returned to the allocator. */
+#ifndef PC_TEXPOOL_BYTES
+#define PC_TEXPOOL_BYTES (8u * 1024u * 1024u)
+#endif
+
+/* ---- Color-indexed textures ----
+ * 1 = keep GX_TF_C4/C8 textures as 8-bit indices and look up the TLUT at
+ * sample time, 0 = expand them to RGBA8 per (index data, palette).
+ * MP4_TEX_CI_INDEXED in the environment overrides this at startup. */
+#ifndef PC_TEX_CI_INDEXED
+#define PC_TEX_CI_INDEXED 1
+#endif
+
+/* ---- Texture filtering ----
+ * PC_TEX_FORCE_NEAREST = 1 samples level 0 point-filtered regardless of
+ * the texture object's filters and LOD (A/B comparisons); MP4_TEX_NEAREST
+ * overrides it at startup. PC_TEX_AUTO_MIPS = 1 gives textures without a
+ * GC mip chain a box-filtered pyramid, used when they are minified;
+ * MP4_TEX_AUTO_MIPS overrides it. */
+#ifndef PC_TEX_FORCE_NEAREST
+#define PC_TEX_FORCE_NEAREST 0
+#endif
+#ifndef PC_TEX_AUTO_MIPS
+#define PC_TEX_AUTO_MIPS 1
+#endif
+
+/* ---- Decoded texture layout ----
+ * 0 = linear rows, 1 = 4x4 texel blocks for textures at least
+ * PC_TEX_TILE_MIN_SIZE texels on both sides, 2 = 4x4 blocks for every
+ * texture. Blocks keep rotated and vertical texture walks within a few
+ * cache lines. MP4_TEX_LAYOUT overrides it at startup. */
+#ifndef PC_TEX_LAYOUT
+#define PC_TEX_LAYOUT 1
+#endif
+#ifndef PC_TEX_TILE_MIN_SIZE
+#define PC_TEX_TILE_MIN_SIZE 32
+#endif
+
+/* ---- Software rasterizer threads ----
+ * Total threads shading tile bins (including the main thread).
+ * -1 = one per CPU, 1 = binned but single-threaded, 0 = legacy immediate
+ * shading on the submitting thread (debugging). MP4_RASTER_THREADS in the
+ * environment overrides this at startup. */
+#ifndef PC_RASTER_THREADS
+#define PC_RASTER_THREADS (-1)
+#endif
+
+/* ---- Framebuffer clear ----
+ * 1 = a clearing GXCopyDisp only marks raster tiles as cleared and each
+ * tile is filled when first drawn to, 0 = fill every tile at the copy.
+ * MP4_FB_LAZY_CLEAR in the environment overrides this at startup. */
+#ifndef PC_FB_LAZY_CLEAR
+#define PC_FB_LAZY_CLEAR 1
+#endif
+
+/* ---- Compiled display lists ----
+ * 1 = GXEndDisplayList compiles each list into pre-decoded vertices and a
+ * triangle index list, 0 = replay the recorded commands on every call.
+ * MP4_DL_COMPILE in the environment overrides this at startup. */
+#ifndef PC_DL_COMPILE
+#define PC_DL_COMPILE 1
+#endif
+
+/* ---- GX command capture ----
+ * MP4_GX_CAPTURE=<path> writes the GX command stream of a run of frames
+ * to a trace for pc/bench/gx_replay.c. Recording starts once
+ * PC_GX_CAPTURE_START frames have been shown and lasts
+ * PC_GX_CAPTURE_FRAMES frames; MP4_GX_CAPTURE_START and
+ * MP4_GX_CAPTURE_FRAMES override them at startup. */
+#ifndef PC_GX_CAPTURE_START
+#define PC_GX_CAPTURE_START 0
+#endif
+#ifndef PC_GX_CAPTURE_FRAMES
+#define PC_GX_CAPTURE_FRAMES 60
+#endif
+
+/* ---- Headless benchmark ----
+ * PC_BENCH_FRAMES > 0 runs without a window or vsync for that many frames,
+ * then prints frame time statistics per HuPerf slot and exits (see
+ * pc_bench.h). MP4_BENCH_FRAMES overrides it at startup. */
+#ifndef PC_BENCH_FRAMES
+#define PC_BENCH_FRAMES 0
+#endif
+
+/* ---- Input recording and replay ----
+ * MP4_INPUT_RECORD=<path> logs the pad input and random seeds of a run,
+ * MP4_INPUT_REPLAY=<path> plays such a log back (see
+ * dolphin/input_log.h). PC_INPUT_REPLAY_EXIT = 1 exits when the log runs
+ * out, 0 continues with live input; MP4_INPUT_REPLAY_EXIT overrides it. */
+#ifndef PC_INPUT_REPLAY_EXIT
+#define PC_INPUT_REPLAY_EXIT 1
+#endif
+
 /* ---- GC hardware clock constants (for timer macros) ---- */
 #define PC_BUS_CLOCK  162000000u   /* 162 MHz */
 #define PC_CORE_CLOCK 486000000u   /* 486 MHz */
@@ -0,0 +1,136 @@
+/*
+ * Fork/join worker pool for the PC port (see pc_jobs.h).
+ *
+ * Workers sleep on a condition variable between batches. A batch is
+ * published by bumping `batch`; workers and the submitting thread then
+ * pull indices from a shared atomic counter until it runs past `count`.
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "pc_jobs.h"
+
+#define PC_JOBS_MAX_THREADS 32
+
+static struct {
+    pthread_t threads[PC_JOBS_MAX_THREADS];
+    int nthreads;
+    int started;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    pthread_mutex_t submit; /* serializes concurrent submitters */
+
+    /* Current batch (protected by lock, except the index counter) */
+    PCJobFunc fn;
+    void *arg;
+    int count;
+    unsigned batch;
+    int finished;           /* workers done with the current batch */
+    atomic_int next;
+} g_jobs = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+    .submit = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/* Set on pool threads so nested submissions run inline instead of deadlocking */
+static _Thread_local int t_in_job;
+
+static void jobs_drain(PCJobFunc fn, void *arg, int count) {
+    int i;
+    while ((i = atomic_fetch_add_explicit(&g_jobs.next, 1, memory_order_relaxed)) < count) {
+        fn(arg, i);
+    }
+}
+
+static void *jobs_worker(void *unused) {
+    (void)unused;
+    unsigned seen = 0;
+    t_in_job = 1;
+    for (;;) {
+        pthread_mutex_lock(&g_jobs.lock);
+        while (g_jobs.batch == seen) {
+            pthread_cond_wait(&g_jobs.wake, &g_jobs.lock);
+        }
+        seen = g_jobs.batch;
+        PCJobFunc fn = g_jobs.fn;
+        void *arg = g_jobs.arg;
+        int count = g_jobs.count;
+        pthread_mutex_unlock(&g_jobs.lock);
+
+        jobs_drain(fn, arg, count);
+
+        pthread_mutex_lock(&g_jobs.lock);
+        if (++g_jobs.finished == g_jobs.nthreads) {
+            pthread_cond_signal(&g_jobs.done);
+        }
+        pthread_mutex_unlock(&g_jobs.lock);
+    }
+    return NULL;
+}
+
+int PCJobsCpuCount(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n < 1) ? 1 : (int)n;
+}
+
+void PCJobsInit(int nthreads) {
+    pthread_mutex_lock(&g_jobs.submit);
+    if (g_jobs.started) {
+        pthread_mutex_unlock(&g_jobs.submit);
+        return;
+    }
+    g_jobs.started = 1;
+
+    if (nthreads < 0) nthreads = PCJobsCpuCount() - 1;
+    if (nthreads > PC_JOBS_MAX_THREADS) nthreads = PC_JOBS_MAX_THREADS;
+
+    for (int i = 0; i < nthreads; i++) {
+        if (pthread_create(&g_jobs.threads[g_jobs.nthreads], NULL, jobs_worker, NULL) != 0) {
+            printf("[JOBS] pthread_create failed, continuing with %d workers\n", g_jobs.nthreads);
+            break;
+        }
+        g_jobs.nthreads++;
+    }
+    printf("[JOBS] worker pool: %d threads + caller\n", g_jobs.nthreads);
+    pthread_mutex_unlock(&g_jobs.submit);
+}
+
+int PCJobsThreadCount(void) {
+    return g_jobs.nthreads + 1;
+}
+
+void PCJobsParallelFor(PCJobFunc fn, void *arg, int count) {
+    if (count <= 0) return;
+    if (g_jobs.nthreads == 0 || count == 1 || t_in_job) {
+        for (int i = 0; i < count; i++) fn(arg, i);
+        return;
+    }
+
+    pthread_mutex_lock(&g_jobs.submit);
+    pthread_mutex_lock(&g_jobs.lock);
+    g_jobs.fn = fn;
+    g_jobs.arg = arg;
+    g_jobs.count = count;
+    g_jobs.finished = 0;
+    atomic_store_explicit(&g_jobs.next, 0, memory_order_relaxed);
+    g_jobs.batch++;
+    pthread_cond_broadcast(&g_jobs.wake);
+    pthread_mutex_unlock(&g_jobs.lock);
+
+    t_in_job = 1;
+    jobs_drain(fn, arg, count);
+    t_in_job = 0;
+
+    pthread_mutex_lock(&g_jobs.lock);
+    while (g_jobs.finished < g_jobs.nthreads) {
+        pthread_cond_wait(&g_jobs.done, &g_jobs.lock);
+    }
+    pthread_mutex_unlock(&g_jobs.lock);
+    pthread_mutex_unlock(&g_jobs.submit);
+}
@@ -0,0 +1,28 @@
+#ifndef PC_JOBS_H
+#define PC_JOBS_H
+
+/*
+ * Minimal fork/join worker pool for the PC port.
+ *
+ * PCJobsParallelFor() runs fn(arg, i) for every i in [0, count) across the
+ * pool and the calling thread, and returns once all indices are done.
+ * Indices are handed out dynamically, so uneven work balances itself.
+ * With a pool size of 0 everything runs on the calling thread.
+ */
+
+typedef void (*PCJobFunc)(void *arg, int index);
+
+/* Start `nthreads` workers (in addition to the caller). Negative selects
+ * one per online CPU minus the caller. Safe to call more than once; the
+ * pool is only created the first time. */
+void PCJobsInit(int nthreads);
+
+/* Total threads that execute a PCJobsParallelFor (workers + caller) */
+int PCJobsThreadCount(void);
+
+void PCJobsParallelFor(PCJobFunc fn, void *arg, int count);
+
+/* Online CPU count, at least 1 */
+int PCJobsCpuCount(void);
+
+#endif /* PC_JOBS_H */
@@ -1418,6 +1418,13 @@ float BoardArcCos(float value)
 void BoardRandInit(void)
 {
     boardRandSeed = OSGetTime();
+#ifdef TARGET_PC
+    {
+        /* Logged for input replay (INLOG_SEED_BOARD) */
+        extern u32 PCInputLogSeed(u32 site, u32 seed);
+        boardRandSeed = PCInputLogSeed(1, boardRandSeed);
+    }
+#endif
 }
 
 u32 BoardRand(void)
@@ -4,6 +4,9 @@
 #include "dolphin/dvd.h"
 
 #ifdef TARGET_PC
+#include <stdlib.h>
+#include "pc_jobs.h"
+
 #define PTR_OFFSET(ptr, offset) (void *)(((u8 *)(ptr)+(uintptr_t)(offset)))
 #else
 #define PTR_OFFSET(ptr, offset) (void *)(((u8 *)(ptr)+(u32)(offset)))
@@ -28,6 +31,32 @@ static u32 DataDirMax;
 static s32 shortAccessSleep;
 static DataReadStat ATTRIBUTE_ALIGN(32) ReadDataStat[DATA_MAX_READSTAT];
 
+#ifdef TARGET_PC
+/* Directory loads feed the overlay prefetch profile (pc/game/prefetch_pc.c) */
+static void HuDataDirNotePC(s32 dir_id)
+{
+    extern void PCPrefetchNoteDir(const char *path);
+    PCPrefetchNoteDir(DataDirStat[dir_id].name);
+}
+
+/* Members are decoded through the asset cache (pc/game/assetcache_pc.c).
+ * This part is safe on job threads; the flush is left to the caller. */
+static void HuDataDecodeNoFlushPC(s32 data_num, void *src, void *dst, u32 raw_len, s32 comp_type)
+{
+    extern void PCAssetCacheDecode(const char *path, s32 entrynum, s32 member, void *src, void *dst,
+                                   u32 raw_len, s32 comp_type);
+    FileListEntry *dir_stat = &DataDirStat[data_num >> 16];
+    PCAssetCacheDecode(dir_stat->name, dir_stat->file_id, data_num & 0xFFFF, src, dst, raw_len,
+                       comp_type);
+}
+
+static void HuDataDecodePC(s32 data_num, void *src, void *dst, u32 raw_len, s32 comp_type)
+{
+    HuDataDecodeNoFlushPC(data_num, src, dst, raw_len, comp_type);
+    DCFlushRange(dst, raw_len);
+}
+#endif
+
 void HuDataInit(void)
 {
     s32 i = 0;
@@ -127,6 +156,9 @@ DataReadStat *HuDataDirRead(s32 data_num)
                 return NULL;
             }
             read_stat = &ReadDataStat[status];
+#ifdef TARGET_PC
+            HuDataDirNotePC(dir_id);
+#endif
             read_stat->dir = HuDvdDataFastRead(DataDirStat[dir_id].file_id);
             if(read_stat->dir) {
                 read_stat->dir_id = dir_id;
@@ -166,6 +198,9 @@ static DataReadStat *HuDataDirReadNum(s32 data_num, s32 num)
                 return NULL;
             }
             read_stat = &ReadDataStat[status];
+#ifdef TARGET_PC
+            HuDataDirNotePC(dir_id);
+#endif
             read_stat->dir = HuDvdDataFastReadNum(DataDirStat[dir_id].file_id, num);
             if(read_stat->dir) {
                 read_stat->dir_id = dir_id;
@@ -239,6 +274,9 @@ s32 HuDataDirReadAsync(s32 data_num)
             read_stat = &ReadDataStat[status];
             read_stat->status = 1;
             read_stat->dir_id = dir_id;
+#ifdef TARGET_PC
+            HuDataDirNotePC(dir_id);
+#endif
             read_stat->dir = HuDvdDataFastReadAsync(DataDirStat[dir_id].file_id, read_stat);
         }
     } else {
@@ -267,6 +305,9 @@ s32 HuDataDirReadNumAsync(s32 data_num, s32 num)
         read_stat = &ReadDataStat[status];
         read_stat->used = TRUE;
         read_stat->num = num;
+#ifdef TARGET_PC
+        HuDataDirNotePC(dir_id);
+#endif
         read_stat->dir = HuDvdDataFastReadAsync(DataDirStat[dir_id].file_id, read_stat);
     } else {
         status = -1;
@@ -323,7 +364,11 @@ void *HuDataRead(s32 data_num)
     GetFileInfo(read_stat, data_num & 0xFFFF);
     buf = HuMemDirectMalloc(0, DATA_EFF_SIZE(read_stat->raw_len));
     if(buf) {
+#ifdef TARGET_PC
+        HuDataDecodePC(data_num, read_stat->file, buf, read_stat->raw_len, read_stat->comp_type);
+#else
         HuDecodeData(read_stat->file, buf, read_stat->raw_len, read_stat->comp_type);
+#endif
     }
     return buf;
 }
@@ -343,7 +388,11 @@ void *HuDataReadNum(s32 data_num, s32 num)
     GetFileInfo(read_stat, data_num & 0xFFFF);
     buf = HuMemDirectMallocNum(0, DATA_EFF_SIZE(read_stat->raw_len), num);
     if(buf) {
+#ifdef TARGET_PC
+        HuDataDecodePC(data_num, read_stat->file, buf, read_stat->raw_len, read_stat->comp_type);
+#else
         HuDecodeData(read_stat->file, buf, read_stat->raw_len, read_stat->comp_type);
+#endif
     }
     return buf;
 }
@@ -379,7 +428,11 @@ void *HuDataSelHeapRead(s32 data_num, HeapID heap)
             break;
     }
     if(buf) {
+#ifdef TARGET_PC
+        HuDataDecodePC(data_num, read_stat->file, buf, read_stat->raw_len, read_stat->comp_type);
+#else
         HuDecodeData(read_stat->file, buf, read_stat->raw_len, read_stat->comp_type);
+#endif
     }
     return buf;
 }
@@ -415,11 +468,72 @@ void *HuDataSelHeapReadNum(s32 data_num, s32 num, HeapID heap)
             break;
     }
     if(buf) {
+#ifdef TARGET_PC
+        HuDataDecodePC(data_num, read_stat->file, buf, read_stat->raw_len, read_stat->comp_type);
+#else
         HuDecodeData(read_stat->file, buf, read_stat->raw_len, read_stat->comp_type);
+#endif
     }
     return buf;
 }
 
+#ifdef TARGET_PC
+typedef struct {
+    s32 data_num;
+    void *src;
+    void *dst;
+    u32 raw_len;
+    s32 comp_type;
+} DataDecodeJob;
+
+static void HuDataDecodeJobPC(void *arg, int index)
+{
+    DataDecodeJob *job = &((DataDecodeJob *)arg)[index];
+    if(job->dst) {
+        HuDataDecodeNoFlushPC(job->data_num, job->src, job->dst, job->raw_len, job->comp_type);
+    }
+}
+
+/* HuDataRead/HuDataReadNum for each id, with the heap work done in order
+ * on this thread and the decodes spread over the job pool */
+static void HuDataReadMultiDecodePC(s32 *data_ids, s32 count, BOOL use_num, s32 num, void **out_ptrs)
+{
+    DataDecodeJob *jobs = calloc(count ? count : 1, sizeof(DataDecodeJob));
+    s32 i;
+    for(i=0; i<count; i++) {
+        DataReadStat *read_stat;
+        s32 data_num = data_ids[i];
+        s32 status;
+        out_ptrs[i] = NULL;
+        if(use_num ? !HuDataDirReadNum(data_num, num) : !HuDataDirRead(data_num)) {
+            continue;
+        }
+        if((status = HuDataReadChk(data_num)) == -1) {
+            continue;
+        }
+        read_stat = &ReadDataStat[status];
+        GetFileInfo(read_stat, data_num & 0xFFFF);
+        if(use_num) {
+            out_ptrs[i] = HuMemDirectMallocNum(0, DATA_EFF_SIZE(read_stat->raw_len), num);
+        } else {
+            out_ptrs[i] = HuMemDirectMalloc(0, DATA_EFF_SIZE(read_stat->raw_len));
+        }
+        jobs[i].data_num = data_num;
+        jobs[i].src = read_stat->file;
+        jobs[i].dst = out_ptrs[i];
+        jobs[i].raw_len = read_stat->raw_len;
+        jobs[i].comp_type = read_stat->comp_type;
+    }
+    PCJobsParallelFor(HuDataDecodeJobPC, jobs, count);
+    for(i=0; i<count; i++) {
+        if(jobs[i].dst) {
+            DCFlushRange(jobs[i].dst, jobs[i].raw_len);
+        }
+    }
+    free(jobs);
+}
+#endif
+
 void **HuDataReadMulti(s32 *data_ids)
 {
     return HuDataReadMultiSub(data_ids, FALSE, 0);
@@ -486,6 +600,10 @@ void **HuDataReadMultiSub(s32 *data_ids, BOOL use_num, s32 num)
     } else {
         out_ptrs = HuMemDirectMalloc(HEAP_SYSTEM, (total_files+1)*sizeof(void *));
     }
+#ifdef TARGET_PC
+    HuDataReadMultiDecodePC(data_ids, total_files, use_num, num, out_ptrs);
+    i = total_files;
+#else
     for(i=0; data_ids[i] != -1; i++) {
         if(use_num) {
             out_ptrs[i] = HuDataReadNum(data_ids[i], num);
@@ -493,6 +611,7 @@ void **HuDataReadMultiSub(s32 *data_ids, BOOL use_num, s32 num)
             out_ptrs[i] = HuDataRead(data_ids[i]);
         }
     }
+#endif
     out_ptrs[i] = NULL;
     return out_ptrs;
 }
@@ -571,6 +690,9 @@ static s32 HuDataDVDdirDirectOpen(s32 data_id, DVDFileInfo *fileInfo)
 		OSReport("data.c: Data Number Error(0x%08x)\n", data_id);
 		return 0;
 	}
+#ifdef TARGET_PC
+	HuDataDirNotePC(dir);
+#endif
 	if(!DVDFastOpen(DataDirStat[dir].file_id, fileInfo)) {
 		char panic_str[48];
 		sprintf(panic_str, "HuDataDVDdirDirectOpen: File Open Error(%08x)", data_id);
@@ -8,6 +8,203 @@ struct decode_data
     u32 size;
 };
 
+#ifdef TARGET_PC
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * The PC decoders write the same bytes as the originals below for every
+ * stream, including back-references reaching before the start of the
+ * output, but use the output itself as the history window and move
+ * literal runs, fills and copies as blocks instead of a byte at a time.
+ */
+
+/* Repeats the len bytes starting dist back from dst, as a byte loop would
+ * when the source overlaps the bytes being written. Chunked copies may
+ * write up to 15 bytes past dst+len, so they are only used below end. */
+static inline u8 *HuDecodeCopyBack(u8 *dst, u32 dist, u32 len, u8 *end)
+{
+    const u8 *src = dst-dist;
+    u8 *stop = dst+len;
+    if(dist >= 16 && end-dst >= (ptrdiff_t)len+15) {
+        do {
+            memcpy(dst, src, 16);
+            dst += 16;
+            src += 16;
+        } while(dst < stop);
+    } else if(dist >= 8 && end-dst >= (ptrdiff_t)len+7) {
+        do {
+            memcpy(dst, src, 8);
+            dst += 8;
+            src += 8;
+        } while(dst < stop);
+    } else if(dist == 1) {
+        memset(dst, *src, len);
+    } else {
+        /* [src, dst) repeats with period dist, so each copy can take
+         * everything written since src, doubling the next one */
+        while(dst < stop) {
+            size_t n = dst-src;
+            if(n > (size_t)(stop-dst)) {
+                n = stop-dst;
+            }
+            memcpy(dst, src, n);
+            dst += n;
+        }
+    }
+    return stop;
+}
+
+/* As HuDecodeCopyBack, with the window before base reading as zero */
+static inline u8 *HuDecodeCopyWindow(u8 *dst, u32 dist, u32 len, u8 *base, u8 *end)
+{
+    ptrdiff_t avail = dst-base;
+    if(avail < (ptrdiff_t)dist) {
+        u32 zeros = dist-(u32)avail;
+        if(zeros > len) {
+            zeros = len;
+        }
+        memset(dst, 0, zeros);
+        dst += zeros;
+        len -= zeros;
+        if(len == 0) {
+            return dst;
+        }
+    }
+    return HuDecodeCopyBack(dst, dist, len, end);
+}
+
+static void HuDecodeNone(struct decode_data *decode)
+{
+    memcpy(decode->dst, decode->src, decode->size);
+}
+
+/* The original keeps a 1KB ring, zeroed, with output byte n at
+ * (958+n) & 0x3FF; a reference to ring slot i is therefore the output
+ * 1..1024 bytes back, or zero before the start of the output */
+static void HuDecodeLz(struct decode_data *decode)
+{
+    u8 *src = decode->src;
+    u8 *dst = decode->dst;
+    u8 *base = dst;
+    u8 *end = dst+decode->size;
+    u32 size = decode->size;
+    while(size) {
+        u32 flag = *src++;
+        u32 num_bits = 8;
+        while(num_bits && size) {
+            if(flag & 0x1) {
+                u32 run = __builtin_ctz(~flag);
+                if(run > size) {
+                    run = size;
+                }
+                memcpy(dst, src, run);
+                dst += run;
+                src += run;
+                size -= run;
+                flag >>= run;
+                num_bits -= run;
+            } else {
+                u32 i = src[0] | ((src[1] & 0xC0) << 2);
+                u32 copy_len = (src[1] & 0x3F)+3;
+                u32 dist = (958+(u32)(dst-base)-i) & 0x3FF;
+                src += 2;
+                if(dist == 0) {
+                    dist = 1024;
+                }
+                dst = HuDecodeCopyWindow(dst, dist, copy_len, base, end);
+                size -= copy_len;
+                flag >>= 1;
+                num_bits--;
+            }
+        }
+    }
+}
+
+/* SLIDE and FSLIDE differ only in what a reference before the start of
+ * the output reads: zero, or whatever precedes the buffer */
+static inline void HuDecodeSlideCommon(struct decode_data *decode, BOOL zero_window)
+{
+    u8 *src = decode->src+4; /* the header repeats the size */
+    u8 *dst = decode->dst;
+    u8 *base = dst;
+    u8 *end = dst+decode->size;
+    u32 size = decode->size;
+    u32 num_bits = 0;
+    u32 flag = 0;
+    while(size) {
+        if(num_bits == 0) {
+            flag = ((u32)src[0] << 24) | (src[1] << 16) | (src[2] << 8) | src[3];
+            src += 4;
+            num_bits = 32;
+        }
+        if(flag >> 31) {
+            u32 run = (flag == 0xFFFFFFFF) ? 32 : __builtin_clz(~flag);
+            if(run > num_bits) {
+                run = num_bits;
+            }
+            if(run > size) {
+                run = size;
+            }
+            memcpy(dst, src, run);
+            dst += run;
+            src += run;
+            size -= run;
+            flag = (run < 32) ? flag << run : 0;
+            num_bits -= run;
+        } else {
+            u32 dist = (src[0] << 8) | src[1];
+            u32 len = (dist >> 12) & 0xF;
+            src += 2;
+            dist = (dist & 0xFFF)+1;
+            if(len == 0) {
+                len = (*src++)+18;
+            } else {
+                len += 2;
+            }
+            size -= len;
+            if(zero_window) {
+                dst = HuDecodeCopyWindow(dst, dist, len, base, end);
+            } else {
+                dst = HuDecodeCopyBack(dst, dist, len, end);
+            }
+            flag <<= 1;
+            num_bits--;
+        }
+    }
+}
+
+static void HuDecodeSlide(struct decode_data *decode)
+{
+    HuDecodeSlideCommon(decode, TRUE);
+}
+
+static void HuDecodeFslide(struct decode_data *decode)
+{
+    HuDecodeSlideCommon(decode, FALSE);
+}
+
+static void HuDecodeRle(struct decode_data *decode)
+{
+    u8 *src = decode->src;
+    u8 *dst = decode->dst;
+    u32 size = decode->size;
+    while(size) {
+        s32 len = *src++;
+        if(len < 128) {
+            memset(dst, *src++, len);
+        } else {
+            len -= 128;
+            memcpy(dst, src, len);
+            src += len;
+        }
+        dst += len;
+        size -= len;
+    }
+}
+
+#else
+
 static u8 textBuffer[1024];
 
 static void HuDecodeNone(struct decode_data *decode)
@@ -173,7 +370,15 @@ static void HuDecodeRle(struct decode_data *decode)
     }
 }
 
+#endif
+
+#ifdef TARGET_PC
+/* HuDecodeData without the cache flush, which only the main thread may
+ * do on PC; decodes on job threads flush once they have joined */
+void HuDecodeDataPC(void *src, void *dst, u32 size, s32 decode_type)
+#else
 void HuDecodeData(void *src, void *dst, u32 size, s32 decode_type)
+#endif
 {
     struct decode_data decode;
     struct decode_data *decode_ptr = &decode;
@@ -209,5 +414,15 @@ void HuDecodeData(void *src, void *dst, u32 size, s32 decode_type)
             OSReport("decode tyep unknown.(%x)\n", decode_type);
             break;
     }
+#ifndef TARGET_PC
+    DCFlushRange(dst, size);
+#endif
+}
+
+#ifdef TARGET_PC
+void HuDecodeData(void *src, void *dst, u32 size, s32 decode_type)
+{
+    HuDecodeDataPC(src, dst, size, decode_type);
     DCFlushRange(dst, size);
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
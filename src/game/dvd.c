@@ -4,6 +4,10 @@
 #include "dolphin/dvd.h"
 #include "dolphin/os.h"
 
+#ifdef TARGET_PC
+#include <stdlib.h>
+#endif
+
 
 static DVDDiskID correctDiskID = {
     { 'M', 'P', 'G', 'C' }, //gameName
@@ -73,6 +77,49 @@ void *HuDvdDataRead(char *path)
     return data;
 }
 
+#ifdef TARGET_PC
+/* Waits for the reads issued for the first count files */
+static void HuDvdDataReadMultiWaitPC(DVDFileInfo *files, u32 count)
+{
+    u32 i;
+    for(i=0; i<count; i++) {
+        while(DVDGetCommandBlockStatus(&files[i].cb)) {
+            HuDvdErrorWatch();
+        }
+        DVDClose(&files[i]);
+    }
+    HuDvdErrorWatch();
+}
+
+/* The buffers are allocated in path order as before, but every read is
+ * issued before waiting on any, so the DVD threads load them together */
+void **HuDvdDataReadMulti(char **paths)
+{
+    DVDFileInfo *files;
+    int i;
+    u32 count;
+    void **file_ptrs;
+    count = 0;
+    while(paths[count]) {
+        count++;
+    }
+    file_ptrs = HuMemDirectMalloc(0, count*sizeof(void *));
+    files = calloc(count ? count : 1, sizeof(DVDFileInfo));
+    for(i=0; i<count; i++) {
+        if(!DVDOpen(paths[i], &files[i])) {
+            OSPanic("dvd.c", 183, "dvd.c: File Open Error");
+            HuDvdDataReadMultiWaitPC(files, i);
+            free(files);
+            return NULL;
+        } else {
+            file_ptrs[i] = HuDvdDataReadWait(&files[i], HEAP_DVD, 0, 0, HuDVDReadAsyncCallBack, TRUE);
+        }
+    }
+    HuDvdDataReadMultiWaitPC(files, count);
+    free(files);
+    return file_ptrs;
+}
+#else
 void **HuDvdDataReadMulti(char **paths)
 {
     DVDFileInfo file;
@@ -95,6 +142,7 @@ void **HuDvdDataReadMulti(char **paths)
     }
     return file_ptrs;
 }
+#endif
 
 void *HuDvdDataReadDirect(char *path, HeapID heap)
 {
@@ -10,6 +10,13 @@ static inline u32 frandom(u32 param)
         param = rand8();
         param = param ^ (s64)OSGetTime();
         param ^= 0xD826BC89;
+#ifdef TARGET_PC
+        {
+            /* Logged for input replay (INLOG_SEED_FRAND) */
+            extern u32 PCInputLogSeed(u32 site, u32 seed);
+            param = PCInputLogSeed(0, param);
+        }
+#endif
     }
 
     rand2 = param / (u32)0x1F31D;
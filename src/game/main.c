@@ -112,6 +112,12 @@ void main(void)
         GXReadPixMetric(&top_pixels_in, &top_pixels_out, &bot_pixels_in, &bot_pixels_out, &clr_pixels_in, &total_copy_clks);
         GXReadMemMetric(&cp_req, &tc_req, &cpu_rd_req, &cpu_wr_req, &dsp_req, &io_req, &vi_req, &pe_req, &rf_req, &fi_req);
         HuPerfEnd(2);
+#ifdef TARGET_PC
+        {
+            extern void PCBenchFrame(void);
+            PCBenchFrame();
+        }
+#endif
         GlobalCounter++;
     }
 }
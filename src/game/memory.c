@@ -2,6 +2,7 @@
 #include "dolphin/os.h"
 #ifdef TARGET_PC
 #include <stdio.h>
+#include "dolphin/gx/GXExtra.h"
 #endif
 
 #define DATA_GET_BLOCK(ptr) ((struct memory_block *)(((char *)(ptr))-32))
@@ -117,6 +118,10 @@ void HuMemMemoryFree(void *ptr, u32 retaddr)
         OSReport("HuMem>memory free error. %08x( call %08x)\n", ptr, retaddr);
         return;
     }
+#ifdef TARGET_PC
+    /* Display lists recorded into this block die with it */
+    GXPCReleaseDisplayLists(ptr, block->size-32);
+#endif
     if(block->prev < block && !block->prev->flag) {
         block->flag  = 0;
         block->magic = 205;
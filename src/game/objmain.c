@@ -71,6 +71,12 @@ static void omWatchOverlayProc(void)
             if(omnextovl >= 0 && fadeStat == 0) {
                 HuPrcSleep(0);
                 OSReport("++++++++++++++++++++ Start New OVL %d (EVT:%d STAT:0x%08x) ++++++++++++++++++\n", omnextovl, omnextovlevtno, omnextovlstat);
+#ifdef TARGET_PC
+                {
+                    extern void PCPrefetchEnterBegin(s32 ovl);
+                    PCPrefetchEnterBegin(omnextovl);
+                }
+#endif
                 HuMemHeapDump(HuMemHeapPtrGet(HEAP_SYSTEM), -1);
                 HuMemHeapDump(HuMemHeapPtrGet(HEAP_DATA), -1);
                 HuMemHeapDump(HuMemHeapPtrGet(HEAP_DVD), -1);
@@ -91,6 +97,12 @@ static void omWatchOverlayProc(void)
                 omSysPauseEnable(TRUE);
                 omcurdll = omDLLStart(omcurovl, 0);
                 OSReport("objman>ObjectSetup end\n");
+#ifdef TARGET_PC
+                {
+                    extern void PCPrefetchEnterEnd(void);
+                    PCPrefetchEnterEnd();
+                }
+#endif
                 if(omcurovl != OVL_INVALID) {
                     goto watch_child;
                 } else {
@@ -125,6 +137,13 @@ void omOvlGotoEx(OverlayID overlay, s16 arg2, s32 event, s32 stat)
     if(omcurovl >= 0) {
         omOvlKill(arg2);
     }
+#ifdef TARGET_PC
+    {
+        /* Read the new overlay's directories ahead while the old one fades */
+        extern void PCPrefetchOverlay(s32 ovl);
+        PCPrefetchOverlay(overlay);
+    }
+#endif
     omnextovl = overlay;
     omnextovlevtno = event;
     omnextovlstat = stat;
@@ -105,6 +105,23 @@ void HuPerfEnd(s32 arg0) {
     OSResetStopwatch(&perf[arg0].unk18);
 }
 
+#ifdef TARGET_PC
+/* Name and last measured time of each created slot, for the PC benchmark */
+s32 HuPerfGetSlots(const char **names, s64 *times, s32 max) {
+    s32 i, n;
+
+    for (i = 0, n = 0; i < 10 && n < max; i++) {
+        if (perf[i].unk50 == 0) {
+            continue;
+        }
+        names[n] = perf[i].unk18.name;
+        times[n] = perf[i].unk08;
+        n++;
+    }
+    return n;
+}
+#endif
+
 static void DSCallbackFunc(u16 arg0) {
     switch (arg0) {
         case 0xFF00: